@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace leor {
+
+// A face action as a value. Gestures and the shuffle hand these to
+// CommandRouter::dispatch() directly; only BLE text goes through the
+// command parser.
+enum class Action : uint8_t {
+    kNone,
+#define LEOR_ACTION(id, command, reply) id,
+#include "leor/actions.def"
+#undef LEOR_ACTION
+    // Not a built-in action: the producer holds command text for
+    // CommandRouter::handle() instead.
+    kCommand,
+};
+
+// Matches a command name case-insensitively, aliases included; kNone if it
+// is not an action.
+Action action_from_name(std::string_view name);
+// The command name of a built-in action, else "".
+std::string_view action_name(Action action);
+// What CommandRouter::handle() replies after running the action.
+std::string_view action_reply(Action action);
+
+}  // namespace leor
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "sdkconfig.h"
+
+#if CONFIG_LEOR_ALLOC_COUNTER
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#endif
+
+namespace leor {
+
+#if CONFIG_LEOR_ALLOC_COUNTER
+
+// Heap allocations made on the application task, counted by the ESP-IDF
+// heap hooks. Application::tick() brackets every tick, so heap: shows
+// whether a steady-state tick allocated. Nothing in the loop should, since
+// the device runs for months and would slowly fragment its heap. Single
+// writer (the app task); the hook ignores other tasks.
+class AllocCounter {
+public:
+  static AllocCounter &instance();
+
+  // Counts allocations made by the calling task from now on.
+  void attach_current_task();
+  // From the heap hook; inline so it stays in IRAM with its caller.
+  inline void on_alloc(size_t size) {
+    if (task_ == nullptr || xTaskGetCurrentTaskHandle() != task_) {
+      return;
+    }
+    allocs_++;
+    bytes_ += static_cast<uint32_t>(size);
+  }
+  void begin_tick() { tick_start_ = allocs_; }
+  void end_tick();
+  void reset();
+  std::string json() const;
+
+  uint32_t allocs() const { return allocs_; }
+  uint32_t last_tick_allocs() const { return last_tick_; }
+
+private:
+  void *task_ = nullptr;
+  uint32_t allocs_ = 0;
+  uint32_t bytes_ = 0;
+  uint32_t tick_start_ = 0;
+  uint32_t last_tick_ = 0;
+  uint32_t ticks_ = 0;
+  uint32_t alloc_ticks_ = 0; // ticks that allocated at least once
+  uint32_t max_tick_ = 0;
+};
+
+// Charges allocations in the enclosing scope to one tick.
+class AllocTickScope {
+public:
+  AllocTickScope() { AllocCounter::instance().begin_tick(); }
+  ~AllocTickScope() { AllocCounter::instance().end_tick(); }
+  AllocTickScope(const AllocTickScope &) = delete;
+  AllocTickScope &operator=(const AllocTickScope &) = delete;
+};
+
+#define LEOR_ALLOC_TICK_SCOPE() ::leor::AllocTickScope leor_alloc_tick_scope_
+
+#else
+
+#define LEOR_ALLOC_TICK_SCOPE() static_cast<void>(0)
+
+#endif
+
+// Attributes counted allocations to the calling task; no-op when disabled.
+void alloc_counter_attach();
+// heap: / heap:reset handlers. Free-heap figures are always reported; the
+// per-tick counts only with CONFIG_LEOR_ALLOC_COUNTER.
+std::string heap_json();
+void heap_reset();
+
+} // namespace leor
@@ -1,20 +1,31 @@
 #pragma once
 
 #include "leor/ble_service.hpp"
+#include "leor/boot_times.hpp"
 #include "leor/clock_service.hpp"
 #include "leor/command_router.hpp"
 #include "leor/config.hpp"
 #include "leor/display_backend.hpp"
+#include "leor/frame_governor.hpp"
 #include "leor/gesture_service.hpp"
+#include "leor/imu_capture.hpp"
+#include "leor/loop_monitor.hpp"
 #include "leor/menu_service.hpp"
 #include "leor/mochi_eyes_engine.hpp"
+#include "leor/motion_wake.hpp"
+#include "leor/power_policy.hpp"
 #include "leor/power_service.hpp"
 #include "leor/preferences.hpp"
+#include "leor/retained_state.hpp"
+#include "leor/session_recorder.hpp"
 #include "leor/shuffle_service.hpp"
 
 #include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
 
 #include <memory>
+#include <string>
 
 namespace leor {
 
@@ -23,12 +34,41 @@ public:
   Application();
 
   esp_err_t start();
+  // Main loop: tick(), then block until an input event or the next render
+  // deadline. Never returns.
+  void run();
   void tick();
+  // How long the main loop may wait before the next tick().
+  uint32_t next_tick_delay_ms() const { return next_tick_delay_ms_; }
+
+  // Session replay: reseed from the recording and switch inputs over to
+  // apply_replay_event(), which must be called for every event due before
+  // the tick() at the same timestamp.
+  void begin_replay(const SessionReplayer &replayer);
+  void apply_replay_event(const RecordedEvent &event, uint32_t now_ms);
 
 private:
+  static void ble_start_task(void *arg);
+  void start_ble();
+  void capture_retained_state(uint32_t now_ms);
+  // Writes the gyro bias table, retiring the single offsets it replaced.
+  void save_bias_table();
   void open_ble_window(uint32_t now_ms, bool start_advertising);
+  void run_frame(uint32_t now_ms);
+  void select_face_rate(uint32_t now_ms);
+  // Clock-speed mode for the next tick, from what this one left on screen.
+  PowerMode select_power_mode() const;
+
+  // Wake sources for run(); timer deadlines are the wait timeout.
+  static constexpr EventBits_t kEventBleCommand = 1u << 0;
+  static constexpr EventBits_t kEventBleLink = 1u << 1;
+  static constexpr EventBits_t kEventOta = 1u << 2;
+  static constexpr EventBits_t kEventButton = 1u << 3;
+  static constexpr EventBits_t kWakeEvents =
+      kEventBleCommand | kEventBleLink | kEventOta | kEventButton;
 
   RuntimeConfig config_{};
+  EventGroupHandle_t events_ = nullptr;
   Preferences preferences_{};
   std::unique_ptr<DisplayBackend> display_;
   std::unique_ptr<MochiEyesEngine> eyes_;
@@ -36,17 +76,35 @@ private:
   ClockService clock_;
   ShuffleService shuffle_;
   PowerService power_;
+  MotionWake motion_wake_;
   MenuService menu_;
   BleService ble_;
   std::unique_ptr<CommandRouter> commands_;
+  FrameGovernor governor_;
+  LoopMonitor loop_;
+  PowerPolicy power_policy_;
+  SessionRecorder recorder_;
+  ImuCapture capture_;
+  BootTimes boot_{};
+  RetainedState retained_{};
+  std::string ble_name_;
   bool was_clock_enabled_ = false;
   bool was_menu_open_ = false;
   bool ble_window_open_ = false;
   uint32_t ble_window_started_ms_ = 0;
   uint32_t ble_window_duration_ms_ = 60000;
   uint32_t ble_window_deadline_ms_ = 0;
-  uint32_t last_short_press_ms_ = 0;
-  static constexpr uint32_t kDoubleTapThresholdMs = 400;
+  uint32_t next_tick_delay_ms_ = FrameGovernor::kPeriodMs[1];
+  // Set by run_frame(): the rate this frame asked for and the latest time
+  // the next one may start.
+  FrameRate frame_rate_ = FrameRate::kNormal;
+  uint32_t frame_deadline_ms_ = 0;
+  static constexpr uint32_t kBleStartStackBytes = 4096;
+  // Upper bound while idle. With touch edge events the loop only needs to
+  // wake for face deadlines and long presses; without them the pad is
+  // sampled from tick(), and human taps last well over kIdleTickPolledMs.
+  static constexpr uint32_t kIdleTickMaxMs = 1000;
+  static constexpr uint32_t kIdleTickPolledMs = 100;
 };
 
 } // namespace leor
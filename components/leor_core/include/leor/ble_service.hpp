@@ -1,29 +1,58 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <cstddef>
 #include <functional>
 #include <string>
+#include <string_view>
 
 #include "esp_err.h"
 #include "leor/ota_service.hpp"
+#include "leor/spsc_ring.hpp"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 
 namespace leor {
 
+// What woke the BLE side; lets the application loop wake without polling.
+enum class BleActivity : uint8_t {
+    kCommand,
+    kOta,
+    kLink,
+};
+
 class BleService {
   public:
-    using CommandHandler = std::function<std::string(const std::string&)>;
+    using CommandHandler = std::function<std::string(std::string_view)>;
+    using ActivityHandler = std::function<void(BleActivity)>;
 
+    // Blocks for the controller and host bring-up; may run on its own task
+    // while the application keeps rendering. stop()/start_advertising()
+    // before it returns only record the wanted advertising state.
     esp_err_t start(const std::string& device_name, CommandHandler handler);
+    bool started() const { return started_.load(std::memory_order_acquire); }
+    // now_us() time of the first successful advertising start, 0 until then.
+    int64_t first_advertising_us() const;
     void stop(bool disconnect_connected = true);
     void start_advertising();
     bool advertising_enabled() const;
+    // Runs on the application task: applies queued commands, then services
+    // OTA. Call once per frame, before touching any state commands modify.
     void poll();
     void notify_status(const std::string& status);
     void notify_gesture(const std::string& gesture);
-    std::string handle_command(const std::string& command) const;
+    // NimBLE host task: queue a command write for the application task.
+    // Returns false when the queue is full or the command too long.
+    bool enqueue_command(const char* data, size_t len);
+    // NimBLE host task: send responses posted by the application task.
+    void flush_responses();
+    // Called from the NimBLE host task after a command, OTA control write or
+    // link change has been processed.
+    void set_activity_handler(ActivityHandler handler) { activity_handler_ = std::move(handler); }
+    void signal_activity(BleActivity activity) const {
+        if (activity_handler_) activity_handler_(activity);
+    }
     uint8_t ota_handle_control(uint8_t opcode);
     uint8_t ota_handle_data(const uint8_t* data, size_t len);
     bool ota_has_pending_notify() const;
@@ -35,12 +64,26 @@ class BleService {
     OtaService& ota() { return ota_; }
     const OtaService& ota() const { return ota_; }
 
+    static constexpr size_t kMaxCommandBytes = 240;
+
   private:
+    struct CommandSlot {
+        uint16_t len = 0;
+        char text[kMaxCommandBytes];
+    };
+
+    void apply_commands();
+    void post_response(std::string response);
+
     CommandHandler command_handler_;
+    ActivityHandler activity_handler_;
     OtaService ota_{};
     bool connected_ = false;
     bool advertising_enabled_ = true;
+    std::atomic<bool> started_{false};
     SemaphoreHandle_t notify_mutex_ = nullptr;
+    SpscRing<CommandSlot, 8> commands_{};     // host task -> app task
+    SpscRing<std::string, 8> responses_{};    // app task -> host task
 };
 
 }  // namespace leor
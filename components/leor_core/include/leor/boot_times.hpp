@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+
+namespace leor {
+
+// Boot milestones as now_us() values (microseconds since the app started,
+// so bootloader time is not included). 0 = not reached yet.
+struct BootTimes {
+  int64_t nvs_us = 0;         // preferences open
+  int64_t display_us = 0;     // panel initialised
+  int64_t first_frame_us = 0; // first face frame sent
+  int64_t imu_us = 0;         // MPU configured
+  int64_t imu_cal_us = 0;     // gyro bias usable (cached or measured)
+  int64_t ble_us = 0;         // NimBLE host task running
+  bool gyro_cached = false;
+  bool warm = false; // resumed from the deep-sleep retained state
+};
+
+} // namespace leor
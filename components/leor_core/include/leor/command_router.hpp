@@ -1,16 +1,25 @@
 #pragma once
 
+#include "leor/action.hpp"
 #include "leor/ble_service.hpp"
+#include "leor/boot_times.hpp"
 #include "leor/clock_service.hpp"
+#include "leor/frame_governor.hpp"
 #include "leor/gesture_service.hpp"
+#include "leor/imu_capture.hpp"
+#include "leor/loop_monitor.hpp"
 #include "leor/mochi_eyes_engine.hpp"
+#include "leor/motion_wake.hpp"
+#include "leor/power_policy.hpp"
 #include "leor/power_service.hpp"
 #include "leor/preferences.hpp"
+#include "leor/session_recorder.hpp"
 #include "leor/shuffle_service.hpp"
 #include "leor/display_backend.hpp"
 #include "leor/config.hpp"
 
 #include <string>
+#include <string_view>
 
 namespace leor {
 
@@ -24,16 +33,42 @@ class CommandRouter {
                   ShuffleService& shuffle,
                   ClockService& clock,
                   PowerService& power,
-                  BleService& ble);
+                  MotionWake& motion_wake,
+                  BleService& ble,
+                  SessionRecorder& recorder,
+                  ImuCapture& capture,
+                  FrameGovernor& governor,
+                  LoopMonitor& loop,
+                  PowerPolicy& power_policy,
+                  const BootTimes& boot);
 
-    std::string handle(std::string cmd, uint32_t now_ms, bool is_manual = true);
+    // Parses and runs command text from BLE or a replayed log. The reply is a
+    // literal or lives in a buffer the router reuses, so it is only valid
+    // until the next call. Face actions neither copy the command nor
+    // allocate for the reply.
+    std::string_view handle(std::string_view cmd, uint32_t now_ms);
+    // Runs a face action from an internal producer: no parsing and no reply.
+    // `is_manual` restarts the shuffle's wait, as a user command does.
+    void dispatch(Action action, bool is_manual);
 
   private:
-    std::string handle_settings(const std::string& params, uint32_t now_ms);
-    std::string handle_shuffle(const std::string& params);
-    std::string handle_display(const std::string& params);
-    std::string handle_clock(const std::string& params, uint32_t now_ms);
-    std::string sync_json(uint32_t now_ms) const;
+    // Largest reply formatted in place: sync_json().
+    static constexpr size_t kReplyReserve = 2048;
+
+    std::string_view handle_settings(std::string_view params, uint32_t now_ms);
+    std::string_view handle_shuffle(std::string_view params);
+    std::string_view handle_display(std::string_view params);
+    std::string_view handle_clock(std::string_view params, uint32_t now_ms);
+    std::string_view sync_json(uint32_t now_ms);
+    std::string_view frame_budget_json();
+    std::string_view boot_json();
+    std::string_view handle_record(std::string_view params, uint32_t now_ms);
+    std::string_view handle_capture(std::string_view params, uint32_t now_ms);
+    // printf into the reply buffer.
+    std::string_view reply(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+    std::string_view reply_text(std::string_view text);
+    void record_settings_snapshot(uint32_t now_ms);
+    void reseed(uint32_t seed);
     void reset_effects();
 
     Preferences& preferences_;
@@ -44,9 +79,18 @@ class CommandRouter {
     ShuffleService& shuffle_;
     ClockService& clock_;
     PowerService& power_;
+    MotionWake& motion_wake_;
     BleService& ble_;
+    SessionRecorder& recorder_;
+    ImuCapture& capture_;
+    FrameGovernor& governor_;
+    LoopMonitor& loop_;
+    PowerPolicy& power_policy_;
+    const BootTimes& boot_;
     bool mpu_verbose_ = false;
     bool reacting_ = false;
+    char cmd_[BleService::kMaxCommandBytes + 1] = {};  // lower-cased command
+    std::string reply_;
 };
 
 }  // namespace leor
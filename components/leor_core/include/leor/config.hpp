@@ -28,6 +28,7 @@ struct RuntimeConfig {
     uint32_t touch_hold_ms = 3000;
     int pwr_ctrl_pin = 1;
     int led_pin = -1;
+    int imu_int_pin = -1;  // MPU6050 INT (data ready), -1 when not wired
 };
 
 }  // namespace leor
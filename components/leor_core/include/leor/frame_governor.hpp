@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "leor/mochi_eyes_engine.hpp"
+
+namespace leor {
+
+// Render rate tiers, fastest first.
+enum class FrameRate : uint8_t {
+  kFast = 0, // 60 Hz: blinks, expression changes, shakes
+  kNormal,   // 30 Hz: ambient effects, menu, OTA screen
+  kSlow,     // 10 Hz: settling, clock face
+  kIdle,     // no fixed rate: next scheduled deadline only
+  kCount
+};
+
+// Picks the delay until the next frame from how much is moving and keeps
+// time-at-rate counters. Clock speed is PowerPolicy's business.
+class FrameGovernor {
+public:
+  static constexpr uint32_t kPeriodMs[] = {16, 33, 100, 0};
+
+  static FrameRate rate_for(MotionLevel motion);
+  static FrameRate faster(FrameRate a, FrameRate b) {
+    return a < b ? a : b;
+  }
+
+  // Returns the delay until the next frame. deadline_ms (absolute) bounds
+  // the wait for any rate; at kIdle it is the only bound besides max_idle_ms.
+  uint32_t select(FrameRate rate, uint32_t now_ms, uint32_t deadline_ms,
+                  uint32_t max_idle_ms);
+
+  // Caps the render rate (0 = no cap), e.g. to compare battery life.
+  void set_max_hz(uint32_t hz) { max_hz_ = hz; }
+  uint32_t max_hz() const { return max_hz_; }
+  FrameRate rate() const { return rate_; }
+  uint32_t period_ms() const { return period_ms_; }
+
+  void reset_stats(uint32_t now_ms);
+  std::string stats_json(uint32_t now_ms) const;
+
+private:
+  FrameRate rate_ = FrameRate::kNormal;
+  uint32_t period_ms_ = kPeriodMs[1];
+  uint32_t max_hz_ = 0;
+  uint32_t last_select_ms_ = 0;
+  bool started_ = false;
+  uint32_t time_ms_[static_cast<int>(FrameRate::kCount)] = {};
+  uint32_t frames_[static_cast<int>(FrameRate::kCount)] = {};
+  uint32_t switches_ = 0;
+};
+
+} // namespace leor
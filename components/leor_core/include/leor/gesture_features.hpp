@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace leor {
+
+// What classify() and calibration look at for one gesture window.
+struct GestureFeatures {
+    // Channels of FeatureWindow: gyro magnitude, the accelerometer minus its
+    // slow gravity baseline per axis, and jerk, the L1 change of those
+    // deltas since the previous sample.
+    enum Channel : uint8_t { kGyro, kAx, kAy, kAz, kJerk, kChannels };
+
+    // Running since reset(), one add() per sample: the peaks the tunable
+    // thresholds are compared against.
+    float max_gyro = 0.0f;       // dps
+    float max_az_delta = 0.0f;   // g, upward only
+    float max_axy_delta = 0.0f;  // g, larger of the two axes
+    uint32_t start_ms = 0;
+    uint32_t gyro_peak_ms = 0;   // when max_gyro was reached, from start_ms
+    int touch_samples = 0;
+    int total_samples = 0;
+    bool tilt_triggered = false;
+
+    // Over the last window_samples samples, from FeatureWindow::snapshot().
+    // dps for kGyro, g (per sample, for kJerk) for the rest.
+    int window_samples = 0;
+    float mean[kChannels] = {};
+    float variance[kChannels] = {};
+    float energy[kChannels] = {};  // mean square
+    uint8_t peaks[kChannels] = {};
+    uint8_t crossings[kChannels] = {};  // sign changes past a dead band
+    int dominant_axis = -1;  // kAx..kAz with the most energy; -1 when still
+    float dominance = 0.0f;  // its share of the accelerometer energy
+
+    void reset() { *this = GestureFeatures(); }
+    void add(float gyro_dps, float az_delta, float axy_delta, uint32_t now_ms);
+    float touch_ratio() const {
+        return total_samples > 0 ? static_cast<float>(touch_samples) / static_cast<float>(total_samples) : 0.0f;
+    }
+    std::string json() const;
+};
+
+// Ring of the most recent samples with sums, sums of squares, peak and
+// zero-crossing counts kept incrementally: push() adds the new sample and
+// takes the evicted one back out, so it costs the same at any window length,
+// and snapshot() is a handful of divides per channel. Integer accumulators
+// in 0.1 dps and mg; no heap.
+class FeatureWindow {
+  public:
+    // 800 ms at the IMU's 50 Hz, the length of the sampling window.
+    static constexpr int kSize = 40;
+
+    void clear();
+    void push(int32_t gyro_ddps, int32_t ax_mg, int32_t ay_mg, int32_t az_mg);
+    int size() const { return count_; }
+    /// Fills the windowed half of `out`; the running maxima are left alone.
+    void snapshot(GestureFeatures& out) const;
+
+  private:
+    static constexpr int kChannels = GestureFeatures::kChannels;
+
+    struct Slot {
+        int16_t v[kChannels];
+        uint8_t peak;      // bit per channel
+        uint8_t crossing;  // bit per channel
+    };
+
+    const Slot& back(int age) const { return ring_[(head_ + kSize - 1 - age) % kSize]; }
+
+    Slot ring_[kSize] = {};
+    int head_ = 0;
+    int count_ = 0;
+    int32_t sum_[kChannels] = {};
+    int64_t sum_sq_[kChannels] = {};
+    uint8_t peaks_[kChannels] = {};
+    uint8_t crossings_[kChannels] = {};
+    int8_t last_sign_[kChannels] = {};
+};
+
+}  // namespace leor
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+
+#include "leor/gesture_features.hpp"
+
+namespace leor {
+
+// Inputs of the gesture trees, in the order of GestureService's "v" array.
+// Peaks are divided by the matching user threshold, so a split at 1.0 means
+// "crossed the threshold" and calibration still moves the decision.
+// tools/gesture_train.py reads the names from this enum: append only.
+enum GestureFeatureId : uint8_t {
+    kFeatGyroPeak,    // max gyro / shake threshold
+    kFeatAzPeak,      // max upward Z deviation / pat threshold
+    kFeatAxyPeak,     // max horizontal deviation / swipe threshold
+    kFeatTouch,       // touch ratio minus the touch threshold
+    kFeatTilt,        // 1 if the pickup tilt was crossed, else 0
+    kFeatGyroRms,     // window RMS gyro / shake threshold
+    kFeatAxStd,       // window standard deviation, g
+    kFeatAyStd,
+    kFeatAzStd,
+    kFeatJerk,        // window mean jerk, g per sample
+    kFeatAccelPeaks,  // peaks on the three accelerometer channels
+    kFeatCrossings,   // their sign changes
+    kFeatGyroPeaks,
+    kFeatZShare,      // Z's share of the accelerometer energy, 0..1
+    kFeatPeakTime,    // when the gyro peaked, as a fraction of the window
+    kGestureFeatureCount
+};
+
+struct GesturePrediction {
+    int label = -1;          // GestureService label index, -1 for no gesture
+    uint8_t confidence = 0;  // percent
+};
+
+void make_gesture_vector(const GestureFeatures& f, float shake_threshold, float pat_threshold,
+                         float swipe_threshold, float touch_threshold, float out[kGestureFeatureCount]);
+
+// Runs every tree in gesture_tree.def. Each leaf votes for its label with
+// its confidence; the label with the most votes wins, with the mean vote as
+// its confidence. A compare and a branch per level, no allocation.
+GesturePrediction predict_gesture(const float x[kGestureFeatureCount]);
+
+int gesture_tree_count();
+
+}  // namespace leor
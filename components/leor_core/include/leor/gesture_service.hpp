@@ -1,10 +1,18 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <string>
+#include <string_view>
 
-#include "leor/display_backend.hpp"
+#include "leor/action.hpp"
+#include "leor/gesture_features.hpp"
+#include "leor/gesture_model.hpp"
+#include "leor/gyro_bias.hpp"
+#include "leor/imu_capture.hpp"
 #include "leor/mpu6050_ahrs_ng.hpp"
+#include "leor/session_recorder.hpp"
+#include "leor/spsc_ring.hpp"
 
 namespace leor {
 
@@ -23,11 +31,64 @@ enum class CalibrationPhase : uint8_t {
     kComplete,
 };
 
+// Gesture state that survives deep sleep: settings, gravity baselines and
+// the gyro bias, so a wake neither re-reads them nor re-measures.
+struct GestureSnapshot {
+    bool matching;
+    bool inverted;
+    bool was_tilted;
+    bool gyro_valid;
+    uint32_t reaction_time_ms;
+    uint32_t confidence_percent;
+    uint32_t cooldown_ms;
+    float shake_threshold;
+    float pat_threshold;
+    float swipe_threshold;
+    float touch_threshold;
+    float pickup_tilt_deg;
+    float ax_lp;
+    float ay_lp;
+    float az_lp;
+    float gyro_offsets[3];
+};
+
 class GestureService {
   public:
-    void start(bool dummy_enabled, int i2c_sda_pin = 10, int i2c_scl_pin = 7, DisplayBackend* display = nullptr);
+    /// Brings the MPU up without blocking on calibration. With cached gyro
+    /// offsets gestures work immediately and the first half second of
+    /// stillness only checks them; without them matching waits for the
+    /// first still window. `imu_int_pin` is the MPU data-ready line, or -1
+    /// when not wired. Load the bias table first.
+    void start(bool dummy_enabled, int i2c_sda_pin = 10, int i2c_scl_pin = 7,
+               const float* cached_gyro_offsets = nullptr, int imu_int_pin = -1);
     void restore(bool matching, uint32_t rt, uint32_t cf, uint32_t cd, const std::string& actions_csv);
-    std::string poll(uint32_t now_ms, bool touch_active);
+    void snapshot(GestureSnapshot& out) const;
+    /// Applies everything but `matching` and the timings, which go through
+    /// restore() together with the action map.
+    void resume(const GestureSnapshot& in);
+    /// The mapped action for a recognised gesture, Action::kNeutral once it
+    /// has played out, else Action::kNone. Action::kCommand means the mapping
+    /// is not a built-in action; command() then holds its text. Runs every
+    /// queued IMU sample through the state machine at the time it was taken,
+    /// stopping at the first one that yields an action; the rest wait for
+    /// the next call.
+    Action poll(uint32_t now_ms, bool touch_active);
+    /// Mapping text of the gesture poll() last recognised. Valid until the
+    /// action map changes.
+    std::string_view command() const;
+    /// Label index of the gesture poll() last recognised, or -1.
+    int last_label() const { return active_label_; }
+    /// From the first sample of the last classified window to its decision.
+    uint32_t decision_latency_ms() const { return decision_latency_ms_; }
+    /// With early decisions on (the default), a gesture fires on the first
+    /// sample where its prediction has held at gcf or above for a few
+    /// samples, instead of at the end of the 800 ms window. Not persisted.
+    void set_early_decisions(bool on) { early_decisions_ = on; }
+    bool early_decisions() const { return early_decisions_; }
+    /// Decision latency histogram per gesture for matches since the last
+    /// reset_latency(); the last bucket holds full-window decisions.
+    std::string latency_json() const;
+    void reset_latency();
     void set_matching_enabled(bool enabled);
     bool matching_enabled() const { return matching_enabled_; }
     void set_suspended(bool suspended);
@@ -74,13 +135,57 @@ class GestureService {
     std::string list_json() const;
     std::string settings_json() const;
 
-    float pitch() const { return inverted_ ? -mpu_.data().pitch : mpu_.data().pitch; }
-    float roll() const { return mpu_.data().roll; }
+    float pitch() const { return inverted_ ? -mpu_.pitch() : mpu_.pitch(); }
+    float roll() const { return mpu_.roll(); }
+    const float* gyro_offsets() const { return mpu_.gyro_offsets(); }
+    bool imu_calibrated() const { return mpu_calibrated_; }
+    /// Power-off with motion wake: see Mpu6050AhrsNg::arm_motion_wake().
+    /// False without a live MPU.
+    bool arm_motion_wake(uint16_t threshold_mg) {
+        return mpu_available_ && !dummy_enabled_ && !replaying_ && mpu_.arm_motion_wake(threshold_mg);
+    }
+    std::string imu_stats_json() const { return mpu_.stats_json(); }
+    /// Features of the window being sampled, or of the last one classified
+    /// with its model input ("v"), prediction and evaluation cycles.
+    std::string features_json() const;
+    /// With reports on, every classified window's features_json() is held
+    /// for take_window_report(), for collecting training data.
+    void set_window_reports(bool on) { window_reports_ = on; }
+    bool window_reports() const { return window_reports_; }
+    /// The report of a window classified since the last call, else empty.
+    std::string take_window_report();
+    /// Gyro bias learned against temperature; the live offsets follow it.
+    void load_bias_table(const GyroBiasTable& table) { bias_table_ = table; }
+    const GyroBiasTable& bias_table() const { return bias_table_; }
+    void clear_bias_table();
+    /// True when the table has news worth the flash write: a bin learned
+    /// for the first time or restarted as stale, or kBiasSaveIntervalMs
+    /// since the last save.
+    /// `force` takes any unsaved change, for power-off.
+    bool take_bias_table_to_save(uint32_t now_ms, bool force = false);
+    std::string bias_json() const;
+
+    // --- Session record / replay ---
+    void set_recorder(SessionRecorder* recorder) { recorder_ = recorder; }
+    /// Raw samples and touch state go to `capture` while it is active.
+    void set_capture(ImuCapture* capture) { capture_ = capture; }
+    /// Treats the IMU as present and calibrated with the recorded offsets;
+    /// samples then come only from inject_sample().
+    void begin_replay(const float offsets[3]);
+    /// Queues one recorded sample; poll() consumes it like a drained one.
+    void inject_sample(const int16_t raw[7], uint32_t dt_us, uint32_t sample_ms);
+    // -------------------------------
 
   private:
-    bool init_mpu(int i2c_sda_pin, int i2c_scl_pin, DisplayBackend* display);
-    bool read_mpu_sample();
-    void draw_calibration(DisplayBackend* display, int percent, bool done);
+    bool init_mpu(int i2c_sda_pin, int i2c_scl_pin, const float* cached_gyro_offsets, int imu_int_pin);
+    /// Next filtered sample, stamped in `sample_ms` with when it was taken.
+    bool read_mpu_sample(uint32_t now_ms, bool touch_active, uint32_t* sample_ms);
+    /// Per live sample: checks the boot bias, learns still-spell estimates
+    /// and moves the offsets along the table with temperature.
+    void track_bias();
+    Action process_sample(uint32_t now_ms, bool touch_active);
+    /// Non-empty status JSON when the capture completes.
+    std::string calibration_sample(uint32_t now_ms);
 
     float az_lp_ = 1.0f;
     float ax_lp_ = 0.0f;
@@ -89,17 +194,39 @@ class GestureService {
     bool was_touching_ = false;
     bool was_tilted_ = false;
 
-    struct GestureFeatures {
-        float max_gyro = 0.0f;
-        float max_az_delta = 0.0f;
-        float max_axy_delta = 0.0f;
-        int touch_samples = 0;
-        int total_samples = 0;
-        bool tilt_triggered = false;
-        void reset() { *this = GestureFeatures(); }
+    struct Motion {
+        float gyro_mag;   // dps
+        float az_delta;   // g above the baseline
+        float axy_delta;  // g, larger horizontal deviation
     };
+    /// Moves the gravity baselines on by the current sample and pushes it
+    /// into window_, so matching and calibration see the same numbers.
+    Motion measure_sample();
+
+    // Features of the window being sampled, or of the last one classified.
+    GestureFeatures features_{};
+    FeatureWindow window_{};
+    float vector_[kGestureFeatureCount] = {};
+    GesturePrediction prediction_{};
+    uint32_t predict_cycles_ = 0;
+    uint32_t decision_latency_ms_ = 0;
+
+    static constexpr uint32_t kWindowMs = 800;
+    // 60 ms at 50 Hz, so a single-sample spike cannot decide alone.
+    static constexpr int kEarlyStableSamples = 3;
+    bool early_decisions_ = true;
+    int early_label_ = -1;
+    int early_streak_ = 0;
 
-    GestureFeatures window_stats_{};
+    static constexpr std::array<uint32_t, 8> kLatencyEdgesMs = {100, 200, 300, 400, 500, 600, 700, 800};
+    struct LatencyStats {
+        std::array<uint16_t, kLatencyEdgesMs.size() + 1> counts{};
+        uint32_t n = 0;
+        uint32_t sum_ms = 0;
+        uint32_t max_ms = 0;
+    };
+    bool window_reports_ = false;
+    bool report_pending_ = false;
     enum class State { kReady, kSampling, kActive, kCooldown };
     State state_ = State::kReady;
     uint32_t state_start_ms_ = 0;
@@ -132,7 +259,11 @@ class GestureService {
     };
     CalibrationState calib_{};
 
-    std::string classify();
+    /// Label index of the gesture in the window so far, or -1. Before the
+    /// window is full only a confident, stable prediction counts.
+    int classify(bool full_window);
+    void record_latency(int label, uint32_t latency_ms);
+    static Action resolve_action(std::string_view name);
 
     bool dummy_enabled_ = true;
     bool matching_enabled_ = true;
@@ -152,9 +283,30 @@ class GestureService {
     static constexpr int kLabelCount = 4;
     const char* labels_[kLabelCount] = {"pat", "shake", "swipe", "pickup"};
     std::string actions_[kLabelCount] = {"happy", "angry", "curious", "neutral"};
+    // actions_ resolved once when set, so a match needs no string lookup.
+    Action action_ids_[kLabelCount] = {Action::kHappy, Action::kAngry, Action::kCurious, Action::kNeutral};
+    int active_label_ = -1;
+    LatencyStats latency_[kLabelCount] = {};
 
     bool mpu_available_ = false;
     bool mpu_calibrated_ = false;
+
+    // Boot bias check: the cached offsets against a kBiasCheckSamples mean.
+    enum class BiasCheck : uint8_t { kNone, kPending, kKept, kReplaced };
+    static constexpr uint16_t kBiasCheckSamples = 25;      // 0.5 s
+    static constexpr float kBiasCheckLsb = 13.0f;          // 0.1 dps
+    static constexpr uint16_t kBiasFollowSamples = 250;    // 5 s
+    static constexpr uint32_t kBiasSaveIntervalMs = 10 * 60 * 1000;
+    GyroBiasTable bias_table_{};
+    BiasCheck bias_check_ = BiasCheck::kNone;
+    float bias_check_error_ = 0.0f;
+    bool bias_follow_ = false;       // offsets track the table
+    bool bias_replace_bin_ = false;  // next estimate overwrites its bin
+    uint16_t bias_follow_count_ = 0;
+    bool bias_dirty_ = false;
+    bool bias_new_bin_ = false;
+    bool bias_saved_ = false;
+    uint32_t bias_saved_ms_ = 0;
     int i2c_sda_pin_ = 10;
     int i2c_scl_pin_ = 7;
     float gyro_off_x_ = 0.0f;
@@ -166,8 +318,18 @@ class GestureService {
     float ax_g_ = 0.0f;
     float ay_g_ = 0.0f;
     float az_g_ = 0.0f;
-    uint32_t last_mpu_read_ms_ = 0;
     Mpu6050AhrsNg mpu_{};
+
+    SessionRecorder* recorder_ = nullptr;
+    ImuCapture* capture_ = nullptr;
+    bool replaying_ = false;
+    struct ReplaySample {
+        int16_t raw[7];
+        uint32_t dt_us;
+        uint32_t sample_ms;
+    };
+    // A drain's worth of recorded samples arrives between two polls.
+    SpscRing<ReplaySample, 32> replay_queue_;
 };
 
 }  // namespace leor
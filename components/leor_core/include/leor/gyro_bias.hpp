@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace leor {
+
+// Gyro zero-rate offset against die temperature, learned from still spells
+// and kept in NVS as one blob, so a boot can start from the right bias
+// instead of holding the device still for a calibration. The MPU6050's
+// zero-rate output moves with temperature (the datasheet allows 20 dps over
+// its range), so one cached bias goes stale between a cold desk and a warm
+// pocket.
+//
+// Bins are kBinC wide and centred from kFirstC up; a reading lands in the
+// nearest one. Each bin is a running mean of the estimates it was given,
+// turning into an exponential one (1/kMaxWeight) once it is full, so aging
+// still shows up. Lookups interpolate between the nearest learned bins
+// either side and hold the end ones flat beyond them.
+struct GyroBiasTable {
+    static constexpr const char* kPrefsKey = "gbias";
+    static constexpr uint8_t kVersion = 1;
+    static constexpr int kBins = 12;
+    static constexpr float kFirstC = 5.0f;
+    static constexpr float kBinC = 5.0f;
+    static constexpr uint16_t kMaxWeight = 16;
+
+    struct Bin {
+        float bias[3];    // LSB
+        uint16_t weight;  // estimates averaged in, capped at kMaxWeight
+        uint16_t reserved;
+    };
+
+    uint8_t version = kVersion;
+    uint8_t bins = kBins;
+    uint16_t learned = 0;       // estimates taken since the table was made
+    float last_c = 0.0f;        // temperature of the newest one
+    Bin bin[kBins] = {};
+
+    /// A table loaded from NVS is only used when this holds.
+    bool valid() const { return version == kVersion && bins == kBins; }
+    int populated() const;
+    /// Adds one still-spell estimate; `replace` drops what its bin held
+    /// first. True when it filled a bin that was empty before.
+    bool learn(float temp_c, const float bias[3], bool replace = false);
+    /// Bias at `temp_c`; false, `out` untouched, while nothing is learned.
+    bool lookup(float temp_c, float out[3]) const;
+    void clear() { *this = GyroBiasTable(); }
+    /// {"bins":[[centre C, weight, x, y, z], ...]} for the learned bins.
+    std::string json() const;
+
+    static float bin_centre(int i) { return kFirstC + kBinC * static_cast<float>(i); }
+};
+static_assert(sizeof(GyroBiasTable) == 8 + GyroBiasTable::kBins * 16, "GyroBiasTable is an NVS format");
+
+}  // namespace leor
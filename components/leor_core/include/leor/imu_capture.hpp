@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "esp_partition.h"
+
+namespace leor {
+
+// One 24-byte record of an IMU capture.
+//   'i' raw MPU6050 sample taken at t_ms (ax ay az temp gx gy gz), dt_us
+//       since the previous one, flags bit 0 = touch pad held
+//   'l' label annotation at t_ms: raw[0] is the gesture label index (0 pat,
+//       1 shake, 2 swipe, 3 pickup), -1 for "nothing happened here"
+//   's' session start: raw[0..2] gyro offsets in LSB * 256
+struct CaptureRecord {
+    uint32_t t_ms;
+    int16_t raw[7];
+    uint16_t dt_us;
+    uint8_t kind;
+    uint8_t flags;
+    uint16_t check;  // low half of a CRC32 over the bytes above
+};
+static_assert(sizeof(CaptureRecord) == 24, "CaptureRecord is a flash format");
+
+// Records raw IMU samples, touch state and label annotations into the
+// "imutrace" flash partition, so gestures from units in the field can be
+// downloaded and replayed on the host. The partition is a ring of 4 KB
+// sectors, each a 16-byte header with a sequence number and 170 records;
+// when it is full the oldest sector is erased and reused. Records are
+// buffered in RAM and written sixteen at a time; opening a sector costs an
+// erase (tens of ms), once every 3.4 s of sampling. App task only.
+class ImuCapture {
+  public:
+    static constexpr const char* kPartitionLabel = "imutrace";
+    static constexpr uint8_t kPartitionSubtype = 0x40;
+    static constexpr size_t kSectorBytes = 4096;
+    static constexpr size_t kHeaderBytes = 16;
+    static constexpr size_t kRecordsPerSector = (kSectorBytes - kHeaderBytes) / sizeof(CaptureRecord);
+
+    /// Finds the partition and the newest sector. False without a partition;
+    /// everything else is then a no-op.
+    bool begin();
+    bool available() const { return part_ != nullptr; }
+    bool active() const { return active_; }
+
+    /// Opens a session; `gyro_offsets` go into its 's' record for replay.
+    bool start(const float gyro_offsets[3], uint32_t t_ms);
+    void stop();
+    /// Stops and erases the whole partition: about a second of blocking
+    /// flash work.
+    bool clear();
+
+    void record_sample(uint32_t t_ms, const int16_t raw[7], uint32_t dt_us, bool touch);
+    bool label(uint32_t t_ms, int label);
+
+    /// Writes buffered records out, so a dump or a reset keeps them.
+    void flush();
+    /// The capture as one byte stream: every sector oldest first, the
+    /// newest cut after its last record. Same layout as a raw partition
+    /// read, so CaptureReader takes either.
+    size_t dump_bytes() const;
+    /// Appends up to `max_bytes` of the stream from `offset` to `out` as
+    /// base64 and returns the offset to continue from.
+    size_t export_base64(size_t offset, std::string& out, size_t max_bytes) const;
+    std::string status_json() const;
+
+  private:
+    void append(const CaptureRecord& record);
+    bool open_next_sector();
+    size_t read_dump(size_t offset, uint8_t* out, size_t len) const;
+    uint32_t sector_address(uint32_t seq) const;
+
+    static constexpr int kBufferRecords = 16;
+
+    const esp_partition_t* part_ = nullptr;
+    uint32_t sector_count_ = 0;
+    bool active_ = false;
+    bool has_sectors_ = false;
+    uint32_t oldest_seq_ = 0;
+    uint32_t head_seq_ = 0;
+    uint32_t head_records_ = 0;  // written to flash in the head sector
+    CaptureRecord pending_[kBufferRecords] = {};
+    int pending_count_ = 0;
+    uint32_t samples_ = 0;
+    uint32_t labels_ = 0;
+    uint32_t write_errors_ = 0;
+};
+
+// Parses a capture dump or a raw partition image back into records, sector
+// by sector in sequence order. Damaged records are counted and skipped.
+class CaptureReader {
+  public:
+    bool load(const uint8_t* data, size_t len);
+    /// The "cap:<offset>" pages of cap:dump=, as replies or copied from a
+    /// log; lines before, between and after them are ignored.
+    bool load_dump_text(const std::string& text);
+    const std::vector<CaptureRecord>& records() const { return records_; }
+    size_t sectors() const { return sectors_; }
+    size_t bad_records() const { return bad_records_; }
+
+  private:
+    std::vector<CaptureRecord> records_;
+    size_t sectors_ = 0;
+    size_t bad_records_ = 0;
+};
+
+}  // namespace leor
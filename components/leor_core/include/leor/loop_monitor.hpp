@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "leor/profiler.hpp"
+
+namespace leor {
+
+// Watches Application::tick() against the frame slot the governor picked:
+// how late each tick started relative to the planned wake, how long it ran,
+// and how often it overran the slot. An overrun is charged to the profiled
+// stage that took longest in that tick (or "other"), and the worst one
+// since reset keeps its per-stage breakdown. Stage times need
+// CONFIG_LEOR_PROFILER; without it only totals are kept. Single writer (the
+// app task).
+class LoopMonitor {
+public:
+  // Histogram upper edges in ms; the last bucket is everything above.
+  static constexpr uint32_t kEdgesMs[] = {1, 2, 4, 8, 16, 33, 66, 100, 250};
+  static constexpr int kBuckets = sizeof(kEdgesMs) / sizeof(kEdgesMs[0]) + 1;
+  // Misses are counted per window for the optional alert.
+  static constexpr uint32_t kAlertWindowMs = 10000;
+
+  void begin_tick(int64_t now_us);
+  // `slot_ms` is the frame period the tick had to fit in; `next_delay_ms`
+  // the wait the governor chose, which sets the next planned start. Returns
+  // true when the misses in the current window just reached the alert
+  // threshold; alert_json() then describes the window and the latest miss.
+  bool end_tick(int64_t now_us, uint32_t slot_ms, uint32_t next_delay_ms);
+
+  // 0 disables the alert.
+  void set_alert_threshold(uint32_t misses) { alert_threshold_ = misses; }
+  uint32_t alert_threshold() const { return alert_threshold_; }
+
+  uint32_t ticks() const { return ticks_; }
+  uint32_t misses() const { return misses_; }
+
+  void reset();
+  std::string json() const;
+  std::string alert_json() const;
+
+private:
+  // Stages an overrun can be charged to, plus "other" for time outside any
+  // profiled stage.
+  static constexpr int kCauseOther = PERF_STAGE_COUNT;
+
+  static int bucket_for(uint32_t us);
+  int culprit(uint32_t duration_us, uint32_t stage_us[PERF_STAGE_COUNT]) const;
+
+  int64_t tick_start_us_ = 0;
+  int64_t planned_start_us_ = 0;
+  bool planned_ = false;
+
+  uint32_t ticks_ = 0;
+  uint32_t misses_ = 0;
+  uint32_t duration_[kBuckets] = {};
+  uint32_t lateness_[kBuckets] = {};
+  uint32_t max_duration_us_ = 0;
+  uint32_t max_lateness_us_ = 0;
+  uint16_t causes_[kCauseOther + 1] = {};
+
+  struct WorstTick {
+    uint32_t at_ms;
+    uint32_t duration_us;
+    uint32_t slot_ms;
+    int cause;
+    uint32_t stage_us[PERF_STAGE_COUNT];
+  };
+  WorstTick worst_ = {};
+  uint32_t last_miss_us_ = 0;
+  int last_cause_ = kCauseOther;
+
+  uint32_t alert_threshold_ = 0;
+  uint32_t window_start_ms_ = 0;
+  uint32_t window_misses_ = 0;
+  bool window_alerted_ = false;
+};
+
+} // namespace leor
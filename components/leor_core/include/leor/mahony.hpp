@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace leor {
+
+// Mahony complementary filter: the gyro integrates the attitude quaternion
+// and the accelerometer's gravity direction pulls it back with a PI term.
+// Two builds of the same maths: MahonyFloat is the reference, MahonyFixed
+// does it in Q30/Q24 integers because the C3 has no FPU. CONFIG_LEOR_AHRS_FIXED
+// picks the one Mpu6050AhrsNg runs.
+
+// Degrees, in the axis convention Mpu6050AhrsNg reports.
+void quaternion_to_euler(const float q[4], float* yaw, float* pitch, float* roll);
+
+class MahonyFloat {
+  public:
+    void reset();
+    void set_gains(float kp, float ki) { kp_ = kp; ki_ = ki; }
+    // Accelerometer in any consistent unit, gyro in rad/s.
+    void update(float ax, float ay, float az, float gx, float gy, float gz, uint32_t dt_us);
+    void quaternion(float q[4]) const;
+
+  private:
+    float q_[4] = {1.0f, 0.0f, 0.0f, 0.0f};
+    float kp_ = 30.0f;
+    float ki_ = 0.0f;
+    float ix_ = 0.0f;
+    float iy_ = 0.0f;
+    float iz_ = 0.0f;
+};
+
+class MahonyFixed {
+  public:
+    void reset();
+    void set_gains(float kp, float ki);
+    // Accelerometer in any consistent integer unit (up to 2^24), gyro in
+    // bias-free LSB at +-250 dps scaled by 256 (Q8), so the float bias
+    // keeps its fraction.
+    void update(int32_t ax, int32_t ay, int32_t az, int32_t gx_q8, int32_t gy_q8, int32_t gz_q8,
+                uint32_t dt_us);
+    void quaternion(float q[4]) const;
+
+  private:
+    int32_t q_[4] = {1 << 30, 0, 0, 0};  // Q30
+    int32_t kp_ = 30 << 16;             // Q16
+    int32_t ki_ = 0;                    // Q16
+    int64_t i_[3] = {0, 0, 0};          // integral term, Q24 rad/s
+};
+
+// Runs `samples` synthetic 50 Hz samples of a tumbling, noisy sensor through
+// both filters and returns JSON: cycles per update for each, cycles per
+// Euler conversion, and the fixed path's max and RMS difference from the
+// float one in degrees (pitch, roll, yaw). Allocates; not for the tick.
+std::string mahony_bench_json(uint32_t samples);
+
+}  // namespace leor
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "leor/display_backend.hpp"
+#include "leor/rng.hpp"
+#include "leor/timer_wheel.hpp"
 
 #include <cmath>
 #include <cstdint>
@@ -285,16 +287,25 @@ struct RenderState {
   }
 };
 
+// Scheduled behaviours; each one owns a slot in the engine's TimerWheel and
+// re-arms itself with the next absolute fire time when it runs.
+enum AnimTimer : uint8_t {
+  TIMER_BLINK = 0,
+  TIMER_SACCADE,
+  TIMER_MOUTH_ANIM,
+  TIMER_BREATH,
+  TIMER_COUNT
+};
+
 struct AnimationTimers {
-  float mouthAnimRemaining;
+  uint32_t mouthAnimEndMs;
+  uint32_t mouthAnimDurationMs;
   int mouthAnimType;
 
-  float blinkCooldown;
   float blinkInterval;
   float blinkVariation;
   bool autoBlink;
 
-  float idleCooldown;
   float idleInterval;
   float idleVariation;
   bool idleMode;
@@ -302,34 +313,132 @@ struct AnimationTimers {
   float breathingPhase;
   float breathingSpeed;
   float breathingIntensity;
+  float breathingSquish;
+  uint32_t breathingLastMs;
   bool breathingEnabled;
 
   int nextBlinkType;
 
   void reset() {
+    mouthAnimEndMs = 0;
+    mouthAnimDurationMs = 0;
     mouthAnimType = 0;
-    blinkCooldown = 2.0f;
     blinkInterval = 3.0f;
     blinkVariation = 3.0f;
     autoBlink = true;
-    idleCooldown = 0.0f;
     idleInterval = 2.0f;
     idleVariation = 3.0f;
     idleMode = false;
     breathingPhase = 0.0f;
     breathingSpeed = 0.3f;
     breathingIntensity = 0.08f;
+    breathingSquish = 1.0f;
+    breathingLastMs = 0;
     breathingEnabled = true;
     nextBlinkType = 0;
   }
 };
 
+// Face state that survives deep sleep (kept in RTC memory by Application).
+// Timers are stored as intervals and re-armed against the new clock.
+struct FaceSnapshot {
+  EyeLayout layout;
+  EyeParams params;
+  ImpulseTargets targets;
+  AnimationTimers timers;
+};
+
+// How much the face is moving, so the main loop can pick a frame rate.
+enum MotionLevel : uint8_t {
+  MOTION_IDLE = 0, // settled; only scheduled behaviours need a frame
+  MOTION_SETTLING, // easing the last pixel or two towards targets
+  MOTION_AMBIENT,  // phase-driven effects (hearts, sweat, spiral, zzz)
+  MOTION_FAST      // blinks, expression changes, gaze jumps, shakes
+};
+
+// ---------------------------------------------------------------------------
+// Frame budget – per-stage cost tracking and overlay degradation
+// ---------------------------------------------------------------------------
+enum FrameStage : uint8_t {
+  STAGE_TIMERS = 0,
+  STAGE_PARAMS,
+  STAGE_EYES,
+  STAGE_MOUTH,
+  STAGE_SWEAT,
+  STAGE_LOVE,
+  STAGE_UWU,
+  STAGE_XD,
+  STAGE_TEARS,
+  STAGE_KNOCKED,
+  STAGE_SLEEP,
+  STAGE_SEND,
+  STAGE_COUNT
+};
+
+// Applied in order when a frame runs over budget, undone in reverse order
+// once there is headroom again. Only overlay work is ever shed.
+enum DegradeLevel : uint8_t {
+  DEGRADE_NONE = 0,
+  DEGRADE_PARTICLES,     // fewer heart segments, sweat drops, spiral steps
+  DEGRADE_REUSE_OVERLAY, // keep the previous frame while the pose is static
+  DEGRADE_HALF_RATE,     // render overlay frames at half the frame rate
+  DEGRADE_COUNT
+};
+
+struct FrameBudget {
+  uint32_t budgetUs;
+  uint32_t stageUs[STAGE_COUNT]; // smoothed cost per stage
+  uint32_t lastFrameUs;
+  uint32_t avgFrameUs;
+  DegradeLevel level;
+
+  uint16_t overStreak;
+  uint16_t headroomStreak;
+  uint8_t reuseStreak;
+  bool halfRateSkip;
+  uint32_t lastPoseKey;
+
+  uint32_t framesRendered;
+  uint32_t framesReused;
+  uint32_t framesIdle;
+  uint32_t framesOverBudget;
+  uint32_t degradeEvents;
+  uint32_t restoreEvents;
+
+  void reset(uint32_t budget) {
+    budgetUs = budget;
+    for (int i = 0; i < STAGE_COUNT; i++)
+      stageUs[i] = 0;
+    lastFrameUs = 0;
+    avgFrameUs = 0;
+    level = DEGRADE_NONE;
+    overStreak = 0;
+    headroomStreak = 0;
+    reuseStreak = 0;
+    halfRateSkip = false;
+    lastPoseKey = 0;
+    framesRendered = 0;
+    framesReused = 0;
+    framesIdle = 0;
+    framesOverBudget = 0;
+    degradeEvents = 0;
+    restoreEvents = 0;
+  }
+};
+
 class MochiEyesEngine {
 public:
   explicit MochiEyesEngine(DisplayBackend &display);
 
   void begin();
   void update(uint32_t now_ms);
+  // Warm resume: saveSnapshot() before the sleep animation, restoreSnapshot()
+  // after begin() and before the first update().
+  void saveSnapshot(FaceSnapshot &out) const;
+  void restoreSnapshot(const FaceSnapshot &in);
+  // Reseeds blink/saccade/sweat randomness for reproducible runs.
+  void seedRandom(uint32_t seed);
+  void seed_random(uint32_t seed) { seedRandom(seed); }
 
   void setOpenness(float target, float speed = 8.0f);
   void setSquish(float target, float speed = 6.0f);
@@ -469,6 +578,32 @@ public:
     startMouthAnim(anim, duration);
   }
 
+  // Idle scheduling. nextEventMs() is the next frame slot while anything is
+  // still moving, otherwise the earliest scheduled behaviour (blink,
+  // saccade, breathing step, mouth animation end), capped at kMaxIdleMs.
+  uint32_t nextEventMs() const;
+  bool isQuiescent() const { return quiescent && frameValid; }
+  // Forces a redraw after someone else has drawn over the panel.
+  void invalidate() { frameValid = false; }
+  uint32_t next_event_ms() const { return nextEventMs(); }
+  bool is_quiescent() const { return isQuiescent(); }
+  MotionLevel motionLevel() const { return motion; }
+  MotionLevel motion_level() const { return motionLevel(); }
+  // Shortest spacing update() accepts between frames; pacing itself is up
+  // to the caller.
+  static constexpr uint32_t kMinFrameIntervalMs = 14;
+
+  static constexpr uint32_t kMaxIdleMs = 1000;
+  static constexpr uint32_t kMaxBreathStepMs = 500;
+
+  void setFrameBudget(uint32_t budgetUs);
+  const FrameBudget &getFrameBudget() const { return budget; }
+  void resetFrameBudgetStats() { budget.reset(budget.budgetUs); }
+  void set_frame_budget(uint32_t budget_us) { setFrameBudget(budget_us); }
+  const FrameBudget &frame_budget() const { return getFrameBudget(); }
+
+  static constexpr uint32_t kDefaultFrameBudgetUs = 24000;
+
 private:
   DisplayBackend &display_;
 
@@ -477,9 +612,16 @@ private:
   ImpulseTargets targets;
   RenderState render;
   AnimationTimers timers;
+  TimerWheel wheel;
+  FrameBudget budget;
+  Rng rng;
 
   uint32_t lastFrameMs;
   uint32_t frameInterval;
+  bool quiescent;
+  MotionLevel motion;
+  bool frameValid;
+  uint32_t drawnPoseKey;
 
   float sweatY[3];
   float sweatX[3];
@@ -493,10 +635,25 @@ private:
   static float clampf(float v, float lo, float hi);
 
   void updateParams(float dt);
-  void updateTimers(float dt);
+  void updateTimers(float dt, uint32_t fired);
+  void armTimers();
+  void resetSweat();
+  void scheduleBlink();
+  void stepBreathing();
+  uint32_t breathStepMs() const;
+  bool computeQuiescent() const;
+  MotionLevel computeMotion() const;
   void computeRenderState();
   void lerpShape(EyeShapeConfig& current, const EyeShapeConfig& target, float speed, float dt);
 
+  bool overlaysActive() const;
+  uint32_t poseKey() const;
+  bool shouldReuseFrame(bool overlays);
+  void accountFrame(uint32_t frameUs, bool overlays);
+  int particleStride() const {
+    return budget.level >= DEGRADE_PARTICLES ? 2 : 1;
+  }
+
   void drawEyes();
   void drawEyeShape(int16_t centerX, int16_t centerY, EyeShapeConfig* config);
   enum CornerType { T_R, T_L, B_L, B_R };
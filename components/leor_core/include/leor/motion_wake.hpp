@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace leor {
+
+// Deep-sleep wake on motion. At power-off the IMU rail stays up and the
+// MPU6050 keeps only its accelerometer cycling at 5 Hz, with the motion
+// interrupt on the `imu:int` pin as a second wake source next to the touch
+// pad: the MPU draws about 20 uA like that and the OLED in power-save
+// a few more, so sleep stays in the tens of uA. A wake on that pin alone is
+// checked before the display or radio come up: kConfirmMs of samples decide
+// whether the bot was picked up (still moving at the end, or turned more
+// than tilt_deg from where it last settled) or just bumped, in which case
+// it goes straight back to sleep. The resting orientation and the counters
+// live in RTC memory; the first wake after a power-off only records where
+// the bot was put down.
+class MotionWake {
+  public:
+    static constexpr uint16_t kDefaultThresholdMg = 64;
+    static constexpr uint8_t kDefaultTiltDeg = 25;
+    static constexpr uint32_t kConfirmMs = 500;
+
+    /// Settings from NVS ("iw_on", "iw_thr", "iw_tilt") and the INT pin.
+    void configure(bool enabled, uint16_t threshold_mg, uint8_t tilt_deg, int int_pin);
+    void set_enabled(bool on) { enabled_ = on; }
+    bool enabled() const { return enabled_; }
+    void set_threshold_mg(uint16_t mg);
+    uint16_t threshold_mg() const { return threshold_mg_; }
+    void set_tilt_deg(uint8_t deg);
+    uint8_t tilt_deg() const { return tilt_deg_; }
+    int int_pin() const { return int_pin_; }
+    /// Enabled, and the INT pin is one that can wake the chip.
+    bool usable() const;
+
+    /// This boot is a deep-sleep wake by the INT pin and not the touch pad.
+    bool woke_on_motion(int touch_pin) const;
+    /// After woke_on_motion(): watches the IMU, which it brings up on its
+    /// own bus. True for a pickup. False for a bump, with the motion
+    /// interrupt armed again so the caller can go back to sleep.
+    bool confirm(int sda_pin, int scl_pin);
+    /// At power-off, once the IMU is armed: the next settled wake records
+    /// the resting orientation afresh.
+    void forget_rest();
+
+    std::string status_json() const;
+
+  private:
+    bool enabled_ = false;
+    uint16_t threshold_mg_ = kDefaultThresholdMg;
+    uint8_t tilt_deg_ = kDefaultTiltDeg;
+    int int_pin_ = -1;
+};
+
+}  // namespace leor
@@ -1,8 +1,12 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
+#include <string>
 
 #include "driver/i2c_master.h"
+#include "leor/mahony.hpp"
+#include "sdkconfig.h"
 
 namespace leor {
 
@@ -22,57 +26,149 @@ struct Mpu6050Data {
     float gxDps = 0.0f;
     float gyDps = 0.0f;
     float gzDps = 0.0f;
-    float yaw = 0.0f;
-    float pitch = 0.0f;
-    float roll = 0.0f;
 };
 
+// The sensor samples into its own FIFO at kSampleHz and the driver drains it
+// in bursts: one FIFO_COUNT read and one multi-sample read per
+// kDrainIntervalMs instead of a transaction per sample, and a late caller
+// finds the samples it missed still queued. Each sample gets its instant
+// back from its place in the FIFO, anchored on the data-ready interrupt when
+// one is wired (and it fired while awake), else on the drain time.
 class Mpu6050AhrsNg {
   public:
+    static constexpr uint32_t kSampleHz = 50;
+    static constexpr uint32_t kDrainIntervalMs = 100;
+
     explicit Mpu6050AhrsNg(uint8_t addr = 0x68);
     ~Mpu6050AhrsNg();
 
-    bool begin(int sda_pin, int scl_pin, uint32_t i2c_clock_hz = 400000, i2c_port_num_t i2c_port = I2C_NUM_0);
+    // `int_pin` < 0 leaves the data-ready interrupt off.
+    bool begin(int sda_pin, int scl_pin, uint32_t i2c_clock_hz = 400000, i2c_port_num_t i2c_port = I2C_NUM_0,
+               int int_pin = -1);
+    // Filters the next queued sample, draining the FIFO when the last burst
+    // is used up and kDrainIntervalMs has passed. False when none is ready.
+    // Samples that only feed the gyro bias average are consumed on the way.
     bool update();
+    // Feeds a recorded sample (ax, ay, az, temp, gx, gy, gz) through the
+    // same path as update(), using the recorded interval instead of the clock.
+    bool inject(const int16_t raw[7], uint32_t dt_us);
+    uint32_t last_dt_us() const { return last_dt_us_; }
+    // When the sensor took the last sample, on the boot clock.
+    int64_t sample_us() const { return last_us_; }
+    std::string stats_json() const;
+    const float* gyro_offsets() const { return g_off_; }
 
     const Mpu6050Data& data() const { return data_; }
+    // Degrees. Worked out from the quaternion on the first read after a
+    // sample, so samples nobody looks at cost no trigonometry.
+    float yaw() const { return euler(2); }
+    float pitch() const { return euler(0); }
+    float roll() const { return euler(1); }
+    // |pitch| or |roll| above `deg`, tested on the gravity vector without
+    // computing either angle.
+    bool tilt_exceeds(float deg) const;
+    // Gyro bias is averaged over kBiasSamples consecutive still samples; any
+    // motion restarts the average. Until then update() returns false.
+    static constexpr uint16_t kBiasSamples = 200;
     bool is_calibrated() const { return !calibrating_; }
     uint16_t calibration_progress() const { return cal_count_; }
-
-    void set_filter_gains(float kp, float ki) { kp_ = kp; ki_ = ki; }
+    // With offsets already set (e.g. from a cache), keeps averaging still
+    // samples in the background without touching the live offsets: the
+    // first estimate after `first_window` still samples, then one every
+    // kBiasSamples for as long as the sensor stays still. Calibration
+    // carries on the same way once it completes.
+    void start_bias_refine(uint16_t first_window = kBiasSamples);
+    // True once per completed window; `out` gets the fresh bias estimate
+    // and `temp_c` the mean die temperature it was taken at.
+    bool take_refined_offsets(float out[3], float* temp_c = nullptr);
+
+    void set_filter_gains(float kp, float ki) { ahrs_.set_gains(kp, ki); }
     void set_accel_cal(float off_x, float off_y, float off_z, float sc_x, float sc_y, float sc_z);
+    // Replaces the offsets and stops any calibration or refine.
     void set_gyro_offsets(float off_x, float off_y, float off_z);
+    // Replaces the live offsets only; a refine in progress carries on.
+    void adjust_gyro_offsets(const float off[3]);
 
     void sleep();
     void wake();
     void low_power_accel_only(uint8_t wake_freq = 2);
+    // The current sample straight from the data registers, FIFO untouched.
+    bool read_sample(int16_t raw[7]);
+    // Deep-sleep motion wake: the accelerometer alone, cycling at 5 Hz, with
+    // the motion interrupt set at `threshold_mg` after a 5 Hz high-pass (so
+    // gravity and slow tilting never count) and INT latched high until the
+    // next reset. False when the sensor does not answer.
+    bool arm_motion_wake(uint16_t threshold_mg);
 
   private:
     esp_err_t write_reg(uint8_t reg, uint8_t value);
     esp_err_t read_reg(uint8_t reg, uint8_t* out);
-    bool read_sensors();
-    void mahony_update(float ax, float ay, float az, float gx, float gy, float gz, float dt);
-    void compute_euler();
+    void configure();
+    void reset_fifo();
+    bool drain_fifo();
+    bool next_fifo_sample(uint32_t* dt_us);
+    void load_raw(const uint8_t* raw);
+    bool process_sample(uint32_t dt_us);
+    static void data_ready_isr(void* arg);
+    bool accumulate_bias();
+    float euler(int axis) const;
+    void update_fixed_cal();
 
     uint8_t addr_ = 0x68;
     bool owns_bus_ = false;
     i2c_master_bus_handle_t bus_ = nullptr;
     i2c_master_dev_handle_t dev_ = nullptr;
     i2c_port_num_t port_ = I2C_NUM_0;
+    int int_pin_ = -1;
+
+    static constexpr uint32_t kSampleBytes = 14;  // accel, temp, gyro as at 0x3B
+    static constexpr uint32_t kFifoBytes = 1024;
+    static constexpr uint32_t kMaxBurstSamples = 24;
+    static constexpr int64_t kPeriodUs = 1000000 / kSampleHz;
+    uint8_t fifo_buf_[kMaxBurstSamples * kSampleBytes] = {};
+    uint16_t fifo_len_ = 0;      // samples in fifo_buf_
+    uint16_t fifo_pos_ = 0;      // next one to hand out
+    uint16_t fifo_queued_ = 0;   // samples the FIFO held at the last drain
+    uint16_t fifo_backlog_ = 0;  // left behind by a full burst
+    int64_t burst_anchor_us_ = 0;
+    int64_t last_drain_us_ = 0;
+    bool synced_ = false;
+    // Written by the data-ready ISR: low 32 bits of its clock, and a count.
+    std::atomic<uint32_t> drdy_us_{0};
+    std::atomic<uint32_t> drdy_count_{0};
+    uint32_t reads_ = 0;
+    uint32_t bursts_ = 0;
+    uint32_t samples_ = 0;
+    uint32_t resets_ = 0;
 
     bool calibrating_ = true;
+    bool refining_ = false;
+    bool refined_ = false;
     uint16_t cal_count_ = 0;
+    uint16_t bias_window_ = kBiasSamples;
     int64_t last_us_ = 0;
+    uint32_t last_dt_us_ = 0;
     int32_t gsum_[3] = {0, 0, 0};
+    int32_t tsum_ = 0;
     float g_off_[3] = {0.0f, 0.0f, 0.0f};
+    float g_refined_[3] = {0.0f, 0.0f, 0.0f};
+    float refined_temp_c_ = 0.0f;
     float a_cal_[6] = {0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f};
 
-    float q_[4] = {1.0f, 0.0f, 0.0f, 0.0f};
-    float kp_ = 30.0f;
-    float ki_ = 0.0f;
-    float ix_ = 0.0f;
-    float iy_ = 0.0f;
-    float iz_ = 0.0f;
+#if CONFIG_LEOR_AHRS_FIXED
+    MahonyFixed ahrs_;
+    // Integer copies of the calibration: offsets in Q8 LSB, scales in Q16.
+    int32_t g_off_q8_[3] = {0, 0, 0};
+    int32_t a_off_q8_[3] = {0, 0, 0};
+    int32_t a_scale_q16_[3] = {1 << 16, 1 << 16, 1 << 16};
+#else
+    MahonyFloat ahrs_;
+#endif
+    mutable bool euler_valid_ = false;
+    mutable float euler_[3] = {0.0f, 0.0f, 0.0f};  // pitch, roll, yaw
+    mutable float tilt_deg_ = -1.0f;               // limit the two below are for
+    mutable float tilt_sin_ = 0.0f;
+    mutable float tilt_tan_ = 0.0f;
 
     Mpu6050Data data_{};
 };
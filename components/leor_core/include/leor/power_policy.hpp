@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "esp_pm.h"
+
+namespace leor {
+
+// What the app is doing, as far as the CPU clock is concerned.
+enum class PowerMode : uint8_t {
+  kFaceIdle = 0,  // settled, breathing or ambient face (30 Hz or slower)
+  kFaceAnimating, // blinks, expression changes, shakes (60 Hz)
+  kMenu,
+  kClock,
+  kOta,
+  kCount
+};
+
+// Owns the esp_pm configuration and every frequency lock the app task takes.
+// Each tick is a burst at the level its mode needs; between ticks nothing is
+// held, so the core drops to the minimum clock or light-sleeps:
+//   OTA            max clock for the whole transfer, ticks or not
+//   face animating max clock while a tick runs
+//   face idle/menu APB max (80 MHz) while a tick runs
+//   clock          minimum clock throughout
+// Keeps time at each clock level and in each mode for pm:. App task only.
+class PowerPolicy {
+public:
+  static constexpr uint32_t kMinMhz = 40; // XTAL
+  static constexpr uint32_t kApbMhz = 80;
+  static constexpr uint32_t kDefaultMaxMhz = 160;
+
+  void init(uint32_t max_mhz, int64_t now_us);
+  // 80 or 160; reconfigures DFS on the spot. False for any other value.
+  bool set_max_mhz(uint32_t mhz);
+  uint32_t max_mhz() const { return max_mhz_; }
+
+  // Takes effect from the next burst; OTA's lock is taken or dropped here.
+  void set_mode(PowerMode mode, int64_t now_us);
+  PowerMode mode() const { return mode_; }
+
+  void begin_burst(int64_t now_us);
+  void end_burst(int64_t now_us);
+
+  void reset_stats(int64_t now_us);
+  std::string stats_json(int64_t now_us) const;
+
+private:
+  enum Level : uint8_t { kLevelMin = 0, kLevelApb, kLevelMax, kLevelCount };
+
+  static Level burst_level(PowerMode mode);
+  Level level() const;
+  esp_pm_lock_handle_t lock_for(Level level) const;
+  void account(int64_t now_us);
+  void configure();
+
+  uint32_t max_mhz_ = kDefaultMaxMhz;
+  PowerMode mode_ = PowerMode::kFaceIdle;
+  bool in_burst_ = false;
+  Level burst_held_ = kLevelMin;
+  bool mode_lock_held_ = false;
+  esp_pm_lock_handle_t max_lock_ = nullptr;
+  esp_pm_lock_handle_t apb_lock_ = nullptr;
+
+  int64_t last_us_ = 0;
+  uint64_t level_us_[kLevelCount] = {};
+  uint64_t mode_us_[static_cast<int>(PowerMode::kCount)] = {};
+  uint32_t bursts_[kLevelCount] = {};
+};
+
+} // namespace leor
@@ -3,27 +3,72 @@
 #include <cstdint>
 #include <functional>
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "leor/spsc_ring.hpp"
+
 namespace leor {
 
-enum class ButtonEvent { kNone, kShortPress, kLongPress };
+enum class ButtonEvent { kNone, kShortPress, kLongPress, kDoublePress };
 
 class PowerService {
 public:
   using SleepPrepareCallback = std::function<void()>;
+  using EdgeCallback = std::function<void(uint32_t t_ms, bool pressed)>;
+  using MotionArmCallback = std::function<bool()>;
+
+  // Presses shorter than this are contact bounce.
+  static constexpr uint32_t kDebounceMs = 50;
+  // A short press released within this of the previous one is a double.
+  static constexpr uint32_t kDoublePressMs = 400;
 
   void init(uint8_t touch_pin, uint8_t active_level, uint32_t hold_ms,
             int pwr_ctrl_pin = 1, int led_pin = -1);
   void arm(uint32_t delay_ms, uint32_t now_ms);
+  // Classifies the touch edges that arrived since the last call on their own
+  // timestamps and returns the next button event; call until kNone. Without
+  // edge events (or with an input override) the level is sampled instead and
+  // changes are stamped with `now_ms`.
   ButtonEvent poll(uint32_t now_ms);
+  // While the pad is held, when it becomes a long press; false otherwise.
+  bool long_press_deadline(uint32_t *deadline_ms) const;
+  // True while the pad has to be sampled from tick() to classify presses,
+  // i.e. without edge events and during or just after a press.
+  bool needs_polling(uint32_t now_ms) const;
   void do_sleep();
   uint32_t hold_ms() const { return hold_ms_; }
   void set_hold_ms(uint32_t value_ms);
   void set_sleep_prepare_callback(SleepPrepareCallback callback);
+  // Called from poll() for every level change, with its edge time.
+  void set_edge_callback(EdgeCallback callback);
   void set_i2c_pins(int sda_pin, int scl_pin);
+  // Deep-sleep wake on the IMU motion interrupt at `pin` (-1 for none).
+  // do_sleep() calls `arm` once the pad is released; when it returns true
+  // the peripheral rail stays on and `pin` going high wakes the chip as
+  // well, otherwise the rail is cut as usual.
+  void set_motion_wake(int pin, MotionArmCallback arm);
   bool is_pressed() const { return pressed(); }
+  // Replaces the touch GPIO with a fixed level (session replay); -1 restores
+  // the real pin.
+  void set_input_override(int level) { input_override_ = level; }
+
+  // Queues a timestamped edge and sets `bit` in `group` from the GPIO ISR
+  // whenever the touch pin changes level. The interrupt is also a
+  // light-sleep wakeup source, so the loop can block until a real edge.
+  bool enable_edge_events(EventGroupHandle_t group, EventBits_t bit);
+  bool edge_events_enabled() const { return edge_group_ != nullptr; }
 
 private:
+  struct TouchEdge {
+    uint32_t t_ms;
+    bool pressed;
+  };
+
   bool pressed() const;
+  void arm_edge_event();
+  bool next_edge(uint32_t now_ms, TouchEdge *edge);
+  ButtonEvent on_edge(const TouchEdge &edge);
+  static void edge_isr(void *arg);
 
   uint8_t touch_pin_ = 0;
   uint8_t active_level_ = 1;
@@ -31,11 +76,23 @@ private:
   int led_pin_ = 8;
   uint32_t hold_ms_ = 3000;
   uint32_t press_start_ms_ = 0;
+  bool press_valid_ = false; // press_start_ms_ began a press not yet used up
   bool last_state_ = false;
+  uint32_t last_short_ms_ = 0;
+  bool double_armed_ = false; // last_short_ms_ may start a double press
   uint32_t enable_at_ms_ = 0;
+  bool enable_pending_ = false; // enable_at_ms_ not reached yet
   SleepPrepareCallback sleep_prepare_callback_;
+  EdgeCallback edge_callback_;
+  MotionArmCallback motion_arm_;
+  int motion_pin_ = -1;
   int i2c_sda_pin_ = -1;
   int i2c_scl_pin_ = -1;
+  int input_override_ = -1;
+  EventGroupHandle_t edge_group_ = nullptr;
+  EventBits_t edge_bit_ = 0;
+  // Filled by edge_isr(); a tap is two edges, bounce adds a few more.
+  SpscRing<TouchEdge, 16> edges_;
 };
 
 } // namespace leor
@@ -3,6 +3,7 @@
 #include "esp_err.h"
 #include "nvs.h"
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 
@@ -22,6 +23,9 @@ class Preferences {
     uint64_t getULong64(const char* key, uint64_t fallback) const;
     float getFloat(const char* key, float fallback) const;
     std::string getString(const char* key, const char* fallback) const;
+    // Copies a blob of exactly `length` bytes into `out`; false, and `out`
+    // untouched, when it is missing or another size.
+    bool getBytes(const char* key, void* out, size_t length) const;
 
     void putBool(const char* key, bool value);
     void putInt(const char* key, int32_t value);
@@ -29,6 +33,8 @@ class Preferences {
     void putULong64(const char* key, uint64_t value);
     void putFloat(const char* key, float value);
     void putString(const char* key, const std::string& value);
+    void putBytes(const char* key, const void* value, size_t length);
+    void remove(const char* key);
 
   private:
     nvs_handle_t handle_ = 0;
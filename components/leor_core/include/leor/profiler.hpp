@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "sdkconfig.h"
+
+#if CONFIG_LEOR_PROFILER
+#include "esp_cpu.h"
+#endif
+
+namespace leor {
+
+// Profiled stages. PERF_TIMERS..PERF_SEND follow the engine's FrameStage
+// order so a FrameStage maps across by offset.
+enum PerfStage : uint8_t {
+  PERF_TICK = 0, // whole Application::tick()
+  PERF_BLE_POLL,
+  PERF_GESTURE_POLL,
+  PERF_TIMERS,
+  PERF_PARAMS,
+  PERF_EYES,
+  PERF_MOUTH,
+  PERF_SWEAT,
+  PERF_LOVE,
+  PERF_UWU,
+  PERF_XD,
+  PERF_TEARS,
+  PERF_KNOCKED,
+  PERF_SLEEP,
+  PERF_SEND,
+  PERF_OTA_SCREEN, // OTA progress screen, drawn instead of the face
+  PERF_STAGE_COUNT
+};
+
+// Short name used in perf: and loop: output.
+const char *perf_stage_name(PerfStage stage);
+
+#if CONFIG_LEOR_PROFILER
+
+// Cycle-count histograms, one per stage, in a fixed block of RAM. Buckets
+// are four per power of two, so p99 is reported to within ~25%. When a
+// bucket saturates every count is halved, which keeps the percentiles
+// weighted towards recent frames. Single writer (the app task).
+class Profiler {
+public:
+  static Profiler &instance();
+
+  void record(PerfStage stage, uint32_t cycles);
+  void reset();
+  // Per-stage cycles of the tick in progress, for LoopMonitor's breakdown of
+  // an overrun; cleared by begin_tick().
+  void begin_tick();
+  uint32_t tick_cycles(PerfStage stage) const { return tick_[stage]; }
+  std::string json() const;
+
+private:
+  static constexpr int kMinBits = 8;  // below 256 cycles -> bucket 0
+  static constexpr int kMaxBits = 28; // 2^28 cycles and up -> last bucket
+  static constexpr int kSubBuckets = 4;
+  static constexpr int kBuckets = 2 + (kMaxBits - kMinBits) * kSubBuckets;
+
+  struct Histogram {
+    uint16_t counts[kBuckets];
+    uint32_t total;  // sum of counts, after halving
+    uint32_t frames; // samples since reset
+    uint32_t min;
+    uint32_t max;
+    uint32_t avg; // moving average, 1/16 weight per sample
+  };
+
+  static int bucket_for(uint32_t cycles);
+  static uint32_t bucket_ceiling(int bucket);
+  static uint32_t percentile(const Histogram &h, uint32_t per_mille);
+
+  Histogram stages_[PERF_STAGE_COUNT] = {};
+  uint32_t tick_[PERF_STAGE_COUNT] = {};
+};
+
+// Times the enclosing scope.
+class PerfScope {
+public:
+  explicit PerfScope(PerfStage stage)
+      : stage_(stage), start_(esp_cpu_get_cycle_count()) {}
+  ~PerfScope() {
+    Profiler::instance().record(
+        stage_, static_cast<uint32_t>(esp_cpu_get_cycle_count()) - start_);
+  }
+  PerfScope(const PerfScope &) = delete;
+  PerfScope &operator=(const PerfScope &) = delete;
+
+private:
+  PerfStage stage_;
+  uint32_t start_;
+};
+
+// Times back-to-back stages: each lap() charges the cycles since the
+// previous lap (or construction) to `stage`.
+class PerfLap {
+public:
+  PerfLap() : last_(esp_cpu_get_cycle_count()) {}
+  void lap(PerfStage stage) {
+    const uint32_t now = esp_cpu_get_cycle_count();
+    Profiler::instance().record(stage, now - last_);
+    last_ = now;
+  }
+
+private:
+  uint32_t last_;
+};
+
+#define LEOR_PERF_CONCAT_(a, b) a##b
+#define LEOR_PERF_CONCAT(a, b) LEOR_PERF_CONCAT_(a, b)
+#define LEOR_PERF_SCOPE(stage)                                                 \
+  ::leor::PerfScope LEOR_PERF_CONCAT(leor_perf_scope_, __LINE__)(stage)
+
+#else
+
+class PerfLap {
+public:
+  void lap(PerfStage) {}
+};
+
+#define LEOR_PERF_SCOPE(stage) static_cast<void>(0)
+
+#endif
+
+// perf: / perf:reset handlers; report "disabled" when compiled out.
+std::string perf_json();
+void perf_reset();
+
+} // namespace leor
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+#include "leor/gesture_service.hpp"
+#include "leor/mochi_eyes_engine.hpp"
+#include "leor/shuffle_service.hpp"
+
+namespace leor {
+
+// Everything a wake from deep sleep needs to pick up where the face left
+// off without re-reading NVS or re-measuring the gyro. ClockService keeps
+// its own block. Bump kRetainedStateVersion whenever this layout changes.
+struct RetainedState {
+  FaceSnapshot face;
+  GestureSnapshot gesture;
+  ShuffleSnapshot shuffle;
+  char ble_name[32];
+  bool has_face;
+};
+
+constexpr uint16_t kRetainedStateVersion = 1;
+
+// Writes the block into RTC memory with a magic, version, size and CRC32.
+void save_retained_state(const RetainedState &state);
+// Returns true and fills `out` if the block is intact and from this
+// firmware's layout. The block is consumed either way, so a later reset
+// that is not a deep-sleep wake starts cold.
+bool load_retained_state(RetainedState &out);
+
+} // namespace leor
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+
+namespace leor {
+
+// Independent random streams so one subsystem drawing more numbers (e.g.
+// sweat drops while an overlay is up) never shifts another's sequence.
+enum class RngStream : uint8_t {
+  kEyes = 1,
+  kShuffle = 2,
+};
+
+// PCG32 (XSH-RR): 64-bit state, 32-bit output, selectable stream.
+class Rng {
+public:
+  Rng() { seed(0x853c49e6748fea9bULL, 0xda3e39cb94b95bdbULL); }
+
+  void seed(uint64_t init_state, uint64_t stream) {
+    state_ = 0;
+    inc_ = (stream << 1u) | 1u;
+    next();
+    state_ += init_state;
+    next();
+  }
+  void seed(uint32_t seed_value, RngStream stream) {
+    seed(seed_value, static_cast<uint64_t>(stream));
+  }
+
+  uint32_t next() {
+    const uint64_t old = state_;
+    state_ = old * 6364136223846793005ULL + inc_;
+    const uint32_t xorshifted =
+        static_cast<uint32_t>(((old >> 18u) ^ old) >> 27u);
+    const uint32_t rot = static_cast<uint32_t>(old >> 59u);
+    return (xorshifted >> rot) | (xorshifted << ((32u - rot) & 31u));
+  }
+
+  // Uniform in [0, bound); multiply-shift keeps it branch- and divide-free.
+  uint32_t below(uint32_t bound) {
+    return static_cast<uint32_t>(
+        (static_cast<uint64_t>(next()) * bound) >> 32);
+  }
+
+  // Uniform in [0, 1).
+  float unit() { return (next() >> 8) * (1.0f / 16777216.0f); }
+
+private:
+  uint64_t state_ = 0;
+  uint64_t inc_ = 1;
+};
+
+} // namespace leor
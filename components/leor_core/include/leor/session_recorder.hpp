@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+namespace leor {
+
+// One line per event in the exported text log:
+//   # leor-rec 1 seed=<u32> goff=<gx>,<gy>,<gz>
+//   <ms> c <command>
+//   <ms> t <0|1>                        touch pad level change
+//   <ms> b <1|2|3>                      ButtonEvent (short/long/double), informational
+//   <ms> i <ax> <ay> <az> <temp> <gx> <gy> <gz> <dt_us> <sample_ms>
+//                                       raw MPU6050 sample, drained at <ms>,
+//                                       taken at <sample_ms> (older logs: <ms>)
+enum class RecordKind : uint8_t {
+    kCommand = 'c',
+    kTouch = 't',
+    kButton = 'b',
+    kImu = 'i',
+};
+
+struct RecordedEvent {
+    uint32_t t_ms = 0;
+    RecordKind kind = RecordKind::kCommand;
+    std::string command;
+    uint8_t value = 0;
+    int16_t raw[7] = {};
+    uint32_t dt_us = 0;
+    uint32_t sample_ms = 0;
+};
+
+// Captures timestamped inputs into a fixed RAM buffer so a field session can
+// be replayed bit-exactly on the host. Recording stops when the buffer fills.
+class SessionRecorder {
+  public:
+    static constexpr size_t kDefaultCapacity = 16 * 1024;
+
+    bool start(uint32_t seed, size_t capacity = kDefaultCapacity);
+    void stop() { active_ = false; }
+    void clear();
+    bool active() const { return active_; }
+    bool full() const { return full_; }
+    size_t bytes() const { return used_; }
+    size_t capacity() const { return capacity_; }
+    uint32_t seed() const { return seed_; }
+    void set_gyro_offsets(const float offsets[3]);
+
+    void record_command(uint32_t t_ms, std::string_view command);
+    void record_touch(uint32_t t_ms, bool pressed);
+    void record_button(uint32_t t_ms, uint8_t event);
+    void record_imu(uint32_t t_ms, const int16_t raw[7], uint32_t dt_us, uint32_t sample_ms);
+
+    std::string header_line() const;
+    // Appends whole text lines for records starting at byte `offset` until
+    // `out` would exceed max_chars. Returns the offset to continue from;
+    // equal to bytes() once everything has been exported.
+    size_t export_text(size_t offset, std::string& out, size_t max_chars) const;
+    std::string status_json() const;
+
+  private:
+    void append(uint32_t t_ms, RecordKind kind, const void* payload, size_t len);
+
+    std::unique_ptr<uint8_t[]> buf_;
+    size_t capacity_ = 0;
+    size_t used_ = 0;
+    uint32_t seed_ = 0;
+    float gyro_offsets_[3] = {0.0f, 0.0f, 0.0f};
+    bool active_ = false;
+    bool full_ = false;
+    SemaphoreHandle_t mutex_ = nullptr;
+};
+
+// Parses an exported log and hands events back in timestamp order.
+class SessionReplayer {
+  public:
+    bool load(const std::string& text);
+    uint32_t seed() const { return seed_; }
+    const float* gyro_offsets() const { return gyro_offsets_; }
+    bool done() const { return cursor_ >= events_.size(); }
+    uint32_t next_time_ms() const { return events_[cursor_].t_ms; }
+    const RecordedEvent& next() const { return events_[cursor_]; }
+    void advance() { ++cursor_; }
+    void rewind() { cursor_ = 0; }
+    size_t size() const { return events_.size(); }
+    size_t skipped_lines() const { return skipped_lines_; }
+
+  private:
+    bool parse_line(const std::string& line);
+
+    std::vector<RecordedEvent> events_;
+    size_t cursor_ = 0;
+    size_t skipped_lines_ = 0;
+    uint32_t seed_ = 0;
+    float gyro_offsets_[3] = {0.0f, 0.0f, 0.0f};
+};
+
+}  // namespace leor
@@ -1,22 +1,47 @@
 #pragma once
 
+#include "leor/action.hpp"
+#include "leor/rng.hpp"
+
 #include <cstdint>
 
 namespace leor {
 
+// Shuffle state that survives deep sleep; the pending change is stored
+// relative to the moment of the snapshot.
+struct ShuffleSnapshot {
+    bool enabled;
+    bool needs_init;
+    bool expression_phase;
+    int8_t last_index;
+    uint32_t expr_min_ms;
+    uint32_t expr_max_ms;
+    uint32_t neutral_min_ms;
+    uint32_t neutral_max_ms;
+    uint32_t remaining_ms;
+    Rng rng;
+};
+
 class ShuffleService {
   public:
     void restore(bool enabled, uint32_t expr_min_ms, uint32_t expr_max_ms, uint32_t neutral_min_ms, uint32_t neutral_max_ms);
     void reset();
+    void snapshot(ShuffleSnapshot& out, uint32_t now_ms) const;
+    void resume(const ShuffleSnapshot& in, uint32_t now_ms);
+    void seed(uint32_t seed) { rng_.seed(seed, RngStream::kShuffle); }
     bool enabled() const { return enabled_; }
     void set_enabled(bool enabled);
     void set_expr_range(uint32_t min_ms, uint32_t max_ms);
     void set_neutral_range(uint32_t min_ms, uint32_t max_ms);
-    bool should_emit(uint32_t now_ms, bool reacting, bool training, const char** command_out);
+    bool should_emit(uint32_t now_ms, bool reacting, bool training, Action* action_out);
     uint32_t expr_min_ms() const { return expr_min_ms_; }
     uint32_t expr_max_ms() const { return expr_max_ms_; }
     uint32_t neutral_min_ms() const { return neutral_min_ms_; }
     uint32_t neutral_max_ms() const { return neutral_max_ms_; }
+    // Absolute time of the next scheduled change; only meaningful while
+    // has_pending_change() is true.
+    bool has_pending_change() const { return enabled_ && !needs_init_; }
+    uint32_t next_change_ms() const { return next_change_ms_; }
 
   private:
     bool enabled_ = true;
@@ -28,6 +53,7 @@ class ShuffleService {
     uint32_t neutral_max_ms_ = 5000;
     uint32_t next_change_ms_ = 0;
     int last_shuffle_index_ = -1;
+    Rng rng_{};
 };
 
 }  // namespace leor
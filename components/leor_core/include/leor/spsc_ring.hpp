@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace leor {
+
+// Bounded single-producer/single-consumer ring. One task may call push(),
+// one other task may call pop(); neither blocks nor takes a lock. Capacity
+// must be a power of two.
+template <typename T, size_t Capacity>
+class SpscRing {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "SpscRing capacity must be a power of two");
+
+public:
+  // Producer side. Returns false (and leaves `value` untouched) when full.
+  bool push(T &&value) {
+    const uint32_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) >= Capacity) {
+      return false;
+    }
+    slots_[head & kMask] = std::move(value);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+  bool push(const T &value) {
+    T copy = value;
+    return push(std::move(copy));
+  }
+
+  // Consumer side. Returns false when empty.
+  bool pop(T &out) {
+    const uint32_t tail = tail_.load(std::memory_order_relaxed);
+    if (head_.load(std::memory_order_acquire) == tail) {
+      return false;
+    }
+    out = std::move(slots_[tail & kMask]);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const {
+    return head_.load(std::memory_order_acquire) ==
+           tail_.load(std::memory_order_acquire);
+  }
+  size_t size() const {
+    return head_.load(std::memory_order_acquire) -
+           tail_.load(std::memory_order_acquire);
+  }
+  static constexpr size_t capacity() { return Capacity; }
+
+private:
+  static constexpr uint32_t kMask = Capacity - 1;
+
+  T slots_[Capacity]{};
+  std::atomic<uint32_t> head_{0};
+  std::atomic<uint32_t> tail_{0};
+};
+
+} // namespace leor
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+
+namespace leor {
+
+// The one clock leor_core reads. Monotonic time drives every timer,
+// deadline and animation; wall time backs the clock face. The firmware
+// default wraps esp_timer and gettimeofday(); a simulation installs its own
+// and can run a day of activity in seconds.
+class TimeSource {
+public:
+  virtual ~TimeSource() = default;
+  // Microseconds since boot, never decreasing.
+  virtual int64_t monotonic_us() = 0;
+  // POSIX time in microseconds.
+  virtual int64_t wall_us() = 0;
+  virtual void set_wall_us(int64_t us) = 0;
+};
+
+// Time that only moves when told to. Wall time runs alongside monotonic
+// time from whatever set_wall_us() last said.
+class ManualTimeSource final : public TimeSource {
+public:
+  int64_t monotonic_us() override { return now_us_; }
+  int64_t wall_us() override { return wall_offset_us_ + now_us_; }
+  void set_wall_us(int64_t us) override { wall_offset_us_ = us - now_us_; }
+  void set_monotonic_us(int64_t us) { now_us_ = us; }
+  void advance_us(int64_t us) { now_us_ += us; }
+
+private:
+  int64_t now_us_ = 0;
+  int64_t wall_offset_us_ = 0;
+};
+
+TimeSource &time_source();
+// Installs `source` for all later reads; nullptr restores the system clock.
+// Call before Application::start(), never while the loop runs.
+void set_time_source(TimeSource *source);
+
+inline int64_t now_us() { return time_source().monotonic_us(); }
+// Milliseconds since boot as the uint32 every service schedules with. It
+// wraps after 49.7 days: compare deadlines with time_reached() or by
+// subtracting, never with < or >.
+inline uint32_t now_ms() { return static_cast<uint32_t>(now_us() / 1000); }
+
+// True once now_ms has reached deadline_ms, tolerating uint32 wraparound.
+// Deadlines must lie within 24.8 days of now_ms.
+inline bool time_reached(uint32_t now_ms, uint32_t deadline_ms) {
+  return static_cast<int32_t>(now_ms - deadline_ms) >= 0;
+}
+
+} // namespace leor
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+
+#include "leor/time_source.hpp"
+
+namespace leor {
+
+// ---------------------------------------------------------------------------
+// Two-level hierarchical timer wheel for a small, fixed set of timers.
+//
+// Timers are identified by a small integer id (< kMaxTimers) and carry an
+// absolute deadline in milliseconds. Level 0 covers the next 64 ticks at
+// kTickMs resolution, level 1 the next 64 * 64 ticks; anything further out
+// is parked in the last level-1 slot and re-cascaded when it comes round.
+// All time arithmetic is wrap-safe for deadlines within ~24 days of now.
+// ---------------------------------------------------------------------------
+class TimerWheel {
+public:
+  static constexpr uint8_t kMaxTimers = 8;
+  static constexpr uint32_t kTickMs = 8;
+  static constexpr uint32_t kNoDeadline = 0xFFFFFFFFu;
+
+  TimerWheel() { reset(0); }
+
+  void reset(uint32_t now_ms);
+
+  void schedule(uint8_t id, uint32_t deadline_ms);
+  void schedule_in(uint8_t id, uint32_t delay_ms) {
+    schedule(id, now_ms_ + delay_ms);
+  }
+  void cancel(uint8_t id);
+  bool armed(uint8_t id) const { return id < kMaxTimers && timers_[id].armed; }
+  uint32_t deadline(uint8_t id) const { return timers_[id].deadline_ms; }
+
+  // Moves the wheel to now_ms and returns a bitmask (1 << id) of every timer
+  // whose deadline has been reached. Fired timers are disarmed.
+  uint32_t advance(uint32_t now_ms);
+
+  // Earliest armed deadline, or kNoDeadline when nothing is scheduled.
+  uint32_t next_deadline_ms() const { return next_deadline_ms_; }
+  bool empty() const { return next_deadline_ms_ == kNoDeadline; }
+  uint32_t now_ms() const { return now_ms_; }
+
+private:
+  static constexpr uint8_t kSlotBits = 6;
+  static constexpr uint8_t kSlots = 1u << kSlotBits;
+  static constexpr uint8_t kSlotMask = kSlots - 1;
+  static constexpr uint8_t kNil = 0xFF;
+
+  struct Timer {
+    uint32_t deadline_ms = 0;
+    uint8_t next = kNil;
+    uint8_t level = 0;
+    uint8_t slot = 0;
+    bool armed = false;
+  };
+
+  void place(uint8_t id);
+  void unlink(uint8_t id);
+  void cascade();
+  uint32_t expire_slot(uint32_t now_ms);
+  void rebuild(uint32_t now_ms);
+  void refresh_next_deadline();
+
+  Timer timers_[kMaxTimers];
+  uint8_t heads_[2][kSlots];
+  uint32_t tick_ = 0;         // current level-0 cursor
+  uint32_t tick_base_ms_ = 0; // start time of tick_
+  uint32_t now_ms_ = 0;
+  uint32_t pending_ = 0;      // already overdue when scheduled
+  uint32_t next_deadline_ms_ = kNoDeadline;
+};
+
+} // namespace leor
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include "sdkconfig.h"
+
+namespace leor {
+
+enum class TraceId : uint16_t {
+#define LEOR_TRACE_EVENT(name, format) name,
+#include "leor/trace_events.def"
+#undef LEOR_TRACE_EVENT
+  kCount
+};
+
+#if CONFIG_LEOR_TRACE
+
+// Binary event trace: an id, a timestamp and raw argument words per event in
+// a fixed RAM ring, with no formatting on the device. trace:dump exports the
+// ring as hex text and tools/trace_decode.py applies the formats from
+// trace_events.def. Writers on any task claim a slot with one atomic add;
+// each slot is a seqlock, so a reader skips records that are mid-write or
+// were overwritten while it copied them.
+class TraceRing {
+public:
+  static constexpr uint32_t kRecords = 128; // 4 KB
+  static constexpr uint32_t kMaxArgs = 5;
+
+  static TraceRing &instance();
+
+  void write(TraceId id, const uint32_t *args, uint32_t argc);
+  void clear();
+  // Sequence number the next event gets; events before oldest() are gone.
+  uint32_t head() const { return next_.load(std::memory_order_acquire); }
+  uint32_t oldest() const;
+  // Appends one "seq t_us id args..." line per event from `from_seq` on,
+  // until `max_chars`; returns the sequence number to continue from.
+  uint32_t export_text(uint32_t from_seq, std::string &out,
+                       size_t max_chars) const;
+  std::string status_json() const;
+
+private:
+  struct Slot {
+    std::atomic<uint32_t> stamp{0}; // seq + 1 once complete, 0 while writing
+    uint32_t t_us;                  // low 32 bits of now_us()
+    uint16_t id;
+    uint16_t argc;
+    uint32_t args[kMaxArgs];
+  };
+  static_assert(sizeof(Slot) == 32, "trace slots are 32 bytes");
+
+  std::atomic<uint32_t> next_{0};
+  std::atomic<uint32_t> cleared_at_{0};
+  Slot slots_[kRecords];
+};
+
+template <typename T> inline uint32_t trace_word(T value) {
+  if constexpr (std::is_floating_point_v<T>) {
+    const float f = static_cast<float>(value);
+    uint32_t word;
+    std::memcpy(&word, &f, sizeof(word));
+    return word;
+  } else {
+    return static_cast<uint32_t>(value);
+  }
+}
+
+template <typename... Args> inline void trace(TraceId id, Args... args) {
+  static_assert(sizeof...(Args) <= TraceRing::kMaxArgs,
+                "at most five trace arguments");
+  const uint32_t words[sizeof...(Args) + 1] = {trace_word(args)..., 0};
+  TraceRing::instance().write(id, words, sizeof...(Args));
+}
+
+#define LEOR_TRACE(id, ...) ::leor::trace(::leor::TraceId::id, ##__VA_ARGS__)
+
+#else
+
+#define LEOR_TRACE(id, ...) static_cast<void>(0)
+
+#endif
+
+// trace: / trace:dump=<seq> / trace:clear handlers; report "disabled" when
+// compiled out.
+std::string trace_status_json();
+std::string trace_dump(uint32_t from_seq);
+void trace_clear();
+
+} // namespace leor
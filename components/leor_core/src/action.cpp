@@ -0,0 +1,67 @@
+#include "leor/action.hpp"
+
+#include <cctype>
+#include <cstddef>
+
+namespace leor {
+
+namespace {
+
+struct ActionEntry {
+    std::string_view command;
+    std::string_view reply;
+};
+
+// Indexed by Action; entry 0 is kNone.
+constexpr ActionEntry kActions[] = {
+    {"", ""},
+#define LEOR_ACTION(id, command, reply) {command, reply},
+#include "leor/actions.def"
+#undef LEOR_ACTION
+};
+constexpr size_t kActionCount = sizeof(kActions) / sizeof(kActions[0]);
+static_assert(kActionCount == static_cast<size_t>(Action::kCommand), "actions.def and Action out of step");
+
+struct ActionAlias {
+    std::string_view name;
+    Action action;
+};
+
+constexpr ActionAlias kAliases[] = {
+    {"dizzy", Action::kKnocked},
+    {"normal", Action::kNeutral},
+    {"reset", Action::kNeutral},
+};
+
+bool equals_lower(std::string_view text, std::string_view lower) {
+    if (text.size() != lower.size()) return false;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(text[i])) != lower[i]) return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+Action action_from_name(std::string_view name) {
+    if (name.empty()) return Action::kNone;
+    for (size_t i = 1; i < kActionCount; ++i) {
+        if (equals_lower(name, kActions[i].command)) return static_cast<Action>(i);
+    }
+    for (const ActionAlias& alias : kAliases) {
+        if (equals_lower(name, alias.name)) return alias.action;
+    }
+    return Action::kNone;
+}
+
+std::string_view action_name(Action action) {
+    const size_t index = static_cast<size_t>(action);
+    return index < kActionCount ? kActions[index].command : std::string_view();
+}
+
+std::string_view action_reply(Action action) {
+    const size_t index = static_cast<size_t>(action);
+    return index < kActionCount ? kActions[index].reply : std::string_view();
+}
+
+}  // namespace leor
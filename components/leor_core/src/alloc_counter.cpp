@@ -0,0 +1,111 @@
+#include "leor/alloc_counter.hpp"
+
+#include <cstdio>
+
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+namespace leor {
+
+namespace {
+
+#if CONFIG_LEOR_ALLOC_COUNTER
+// Namespace scope rather than a function static: the heap hook may run with
+// the flash cache off and must not take a guard.
+AllocCounter s_counter;
+#endif
+
+std::string heap_fields() {
+  char buf[96];
+  std::snprintf(
+      buf, sizeof(buf), "\"free\":%u,\"min\":%u,\"largest\":%u",
+      static_cast<unsigned>(heap_caps_get_free_size(MALLOC_CAP_DEFAULT)),
+      static_cast<unsigned>(heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT)),
+      static_cast<unsigned>(
+          heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT)));
+  return buf;
+}
+
+} // namespace
+
+#if CONFIG_LEOR_ALLOC_COUNTER
+
+AllocCounter &AllocCounter::instance() { return s_counter; }
+
+void AllocCounter::attach_current_task() {
+  task_ = xTaskGetCurrentTaskHandle();
+}
+
+void AllocCounter::end_tick() {
+  last_tick_ = allocs_ - tick_start_;
+  ticks_++;
+  if (last_tick_ > 0) {
+    alloc_ticks_++;
+  }
+  if (last_tick_ > max_tick_) {
+    max_tick_ = last_tick_;
+  }
+}
+
+void AllocCounter::reset() {
+  allocs_ = 0;
+  bytes_ = 0;
+  tick_start_ = 0;
+  last_tick_ = 0;
+  ticks_ = 0;
+  alloc_ticks_ = 0;
+  max_tick_ = 0;
+}
+
+std::string AllocCounter::json() const {
+  // The tick that runs heap: allocates its own reply, so "last" is that
+  // tick's count only when read back twice.
+  char buf[160];
+  std::snprintf(buf, sizeof(buf),
+                ",\"ticks\":%u,\"alloc_ticks\":%u,\"last\":%u,\"max\":%u,"
+                "\"allocs\":%u,\"bytes\":%u}",
+                static_cast<unsigned>(ticks_),
+                static_cast<unsigned>(alloc_ticks_),
+                static_cast<unsigned>(last_tick_),
+                static_cast<unsigned>(max_tick_),
+                static_cast<unsigned>(allocs_),
+                static_cast<unsigned>(bytes_));
+  return "{\"type\":\"heap\"," + heap_fields() + buf;
+}
+
+void alloc_counter_attach() { AllocCounter::instance().attach_current_task(); }
+
+std::string heap_json() { return AllocCounter::instance().json(); }
+
+void heap_reset() { AllocCounter::instance().reset(); }
+
+#else
+
+void alloc_counter_attach() {}
+
+std::string heap_json() {
+  return "{\"type\":\"heap\"," + heap_fields() + ",\"enabled\":0}";
+}
+
+void heap_reset() {}
+
+#endif
+
+} // namespace leor
+
+#if CONFIG_LEOR_ALLOC_COUNTER
+
+// Called by the heap allocator for every successful allocation
+// (CONFIG_HEAP_USE_HOOKS), possibly with the flash cache disabled.
+extern "C" IRAM_ATTR void esp_heap_trace_alloc_hook(void *ptr, size_t size,
+                                                    uint32_t caps) {
+  (void)ptr;
+  (void)caps;
+  leor::s_counter.on_alloc(size);
+}
+
+extern "C" IRAM_ATTR void esp_heap_trace_free_hook(void *ptr) { (void)ptr; }
+
+#endif
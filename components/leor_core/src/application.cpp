@@ -2,13 +2,19 @@
 
 #include "driver/gpio.h"
 #include "esp_log.h"
-#include "esp_pm.h"
+#include "esp_random.h"
 #include "esp_rom_gpio.h"
-#include "esp_timer.h"
+#include "esp_system.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "nvs_flash.h"
+#include "leor/alloc_counter.hpp"
+#include "leor/profiler.hpp"
+#include "leor/retained_state.hpp"
+#include "leor/time_source.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <cstdio>
 #include <cstdlib>
 
@@ -18,7 +24,6 @@ namespace {
 
 constexpr const char *kTag = "leor_app";
 constexpr uint32_t kPowerOffMessageMs = 320;
-constexpr uint32_t kOtaUiFrameMs = 33;
 constexpr uint32_t kBleWindowMinMs = 20000;
 constexpr uint32_t kBleWindowDefaultMs = 60000;
 
@@ -118,6 +123,8 @@ void draw_ota_screen(DisplayBackend& display, int pct, const char* line1, const
 Application::Application() = default;
 
 esp_err_t Application::start() {
+  // start() and run() share app_main's task, the one tick() runs on.
+  alloc_counter_attach();
   esp_err_t err = nvs_flash_init();
   if (err == ESP_ERR_NVS_NO_FREE_PAGES ||
       err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
@@ -129,14 +136,15 @@ esp_err_t Application::start() {
     return err;
   }
 
-#if CONFIG_PM_ENABLE
-  esp_pm_config_t pm_config = {
-      .max_freq_mhz = 80, .min_freq_mhz = 40, .light_sleep_enable = true};
-  ESP_ERROR_CHECK(esp_pm_configure(&pm_config));
-#endif
-
-  std::srand(esp_timer_get_time() & 0xffffffff);
   ESP_ERROR_CHECK(preferences_.begin("leor"));
+  power_policy_.init(
+      preferences_.getUInt("pm_max", PowerPolicy::kDefaultMaxMhz), now_us());
+  boot_.nvs_us = now_us();
+  // A deep-sleep wake picks the face, gesture and shuffle state back up from
+  // RTC memory; any other reset starts cold from NVS.
+  boot_.warm = esp_reset_reason() == ESP_RST_DEEPSLEEP &&
+               load_retained_state(retained_);
+  events_ = xEventGroupCreate();
 
   config_.display.controller =
       preferences_.getString("disp_type", "ssd1306") == "sh1106"
@@ -170,6 +178,18 @@ esp_err_t Application::start() {
     config_.pwr_ctrl_pin = -1;
   }
 
+  config_.imu_int_pin = static_cast<int>(preferences_.getInt("imu_int", -1));
+  if (config_.imu_int_pin >= 0 &&
+      (conflicts_with_display_i2c(config_.imu_int_pin, config_.display) ||
+       config_.imu_int_pin == static_cast<int>(config_.touch_wake_pin) ||
+       config_.imu_int_pin == config_.pwr_ctrl_pin)) {
+    ESP_LOGW(kTag,
+             "IMU interrupt pin %d is already in use, timing FIFO bursts "
+             "without it",
+             config_.imu_int_pin);
+    config_.imu_int_pin = -1;
+  }
+
   gpio_deep_sleep_hold_dis();
   release_held_pin(config_.display.sda_pin);
   release_held_pin(config_.display.scl_pin);
@@ -177,7 +197,37 @@ esp_err_t Application::start() {
   power_.init(config_.touch_wake_pin, config_.touch_active_level,
               config_.touch_hold_ms, config_.pwr_ctrl_pin, config_.led_pin);
   power_.set_i2c_pins(config_.display.sda_pin, config_.display.scl_pin);
-  power_.arm(1000, 0);
+  power_.arm(1000, now_ms());
+  if (events_ != nullptr && !power_.enable_edge_events(events_, kEventButton)) {
+    ESP_LOGW(kTag, "touch edge events unavailable, polling the pad");
+  }
+
+  motion_wake_.configure(
+      preferences_.getBool("iw_on", false),
+      static_cast<uint16_t>(
+          preferences_.getUInt("iw_thr", MotionWake::kDefaultThresholdMg)),
+      static_cast<uint8_t>(
+          preferences_.getUInt("iw_tilt", MotionWake::kDefaultTiltDeg)),
+      config_.imu_int_pin);
+  if (motion_wake_.woke_on_motion(config_.touch_wake_pin) &&
+      !motion_wake_.confirm(config_.display.sda_pin, config_.display.scl_pin)) {
+    // A bump, not a pickup: back to sleep before the display or radio come
+    // up, with the IMU re-armed and the retained face put back as it was.
+    ESP_LOGI(kTag, "motion wake was a bump, sleeping again");
+    if (boot_.warm) {
+      save_retained_state(retained_);
+    }
+    power_.set_motion_wake(config_.imu_int_pin, [] { return true; });
+    power_.do_sleep();
+  }
+  power_.set_motion_wake(config_.imu_int_pin, [this] {
+    if (!motion_wake_.usable() ||
+        !gesture_.arm_motion_wake(motion_wake_.threshold_mg())) {
+      return false;
+    }
+    motion_wake_.forget_rest();
+    return true;
+  });
 
   display_ = std::make_unique<U8g2DisplayBackend>();
   if (!display_->init(config_.display)) {
@@ -192,43 +242,42 @@ esp_err_t Application::start() {
     display_ = std::make_unique<NullDisplayBackend>();
     display_->init(config_.display);
   }
+  display_->set_contrast(static_cast<uint8_t>(preferences_.getUInt("disp_con", 0x7f)));
+  boot_.display_us = now_us();
 
   eyes_ = std::make_unique<MochiEyesEngine>(*display_);
   eyes_->begin();
-  eyes_->set_width(preferences_.getInt("ew", 36),
-                   preferences_.getInt("ew", 36));
-  eyes_->set_height(preferences_.getInt("eh", 36),
-                    preferences_.getInt("eh", 36));
-  eyes_->set_space_between(preferences_.getInt("es", 10));
-  eyes_->set_border_radius(preferences_.getInt("er", 8),
-                           preferences_.getInt("er", 8));
-  eyes_->set_mouth_size(preferences_.getInt("mw", 20), 6);
-  eyes_->setGazeSpeed(static_cast<float>(preferences_.getInt("gs", 6)));
-  eyes_->setOpennessSpeed(static_cast<float>(preferences_.getInt("os", 12)));
-  eyes_->setSquishSpeed(static_cast<float>(preferences_.getInt("ss", 10)));
-  eyes_->set_breathing(preferences_.getBool("br_en", true),
-                       preferences_.getFloat("br_int", 0.08f),
-                       preferences_.getFloat("br_spd", 0.3f));
+  if (boot_.warm && retained_.has_face) {
+    eyes_->restoreSnapshot(retained_.face);
+  } else {
+    eyes_->set_width(preferences_.getInt("ew", 36),
+                     preferences_.getInt("ew", 36));
+    eyes_->set_height(preferences_.getInt("eh", 36),
+                      preferences_.getInt("eh", 36));
+    eyes_->set_space_between(preferences_.getInt("es", 10));
+    eyes_->set_border_radius(preferences_.getInt("er", 8),
+                             preferences_.getInt("er", 8));
+    eyes_->set_mouth_size(preferences_.getInt("mw", 20), 6);
+    eyes_->setGazeSpeed(static_cast<float>(preferences_.getInt("gs", 6)));
+    eyes_->setOpennessSpeed(static_cast<float>(preferences_.getInt("os", 12)));
+    eyes_->setSquishSpeed(static_cast<float>(preferences_.getInt("ss", 10)));
+    eyes_->set_breathing(preferences_.getBool("br_en", true),
+                         preferences_.getFloat("br_int", 0.08f),
+                         preferences_.getFloat("br_spd", 0.3f));
+  }
+
+  // A pinned seed (rng:seed=) makes idle behaviour repeatable across boots.
+  uint32_t rng_seed = preferences_.getUInt("rng_seed", 0);
+  if (rng_seed == 0) {
+    rng_seed = esp_random();
+  }
+  eyes_->seed_random(rng_seed);
+  shuffle_.seed(rng_seed);
+  if (preferences_.getBool("rec_boot", false)) {
+    preferences_.putBool("rec_boot", false);
+    recorder_.start(rng_seed);
+  }
 
-  gesture_.start(config_.gesture_dummy_enabled, config_.display.sda_pin,
-                 config_.display.scl_pin, display_.get());
-  gesture_.restore(preferences_.getBool("gm", true),
-                    preferences_.getUInt("grt", 1500),
-                    preferences_.getUInt("gcf", 70),
-                    preferences_.getUInt("gcd", 1500),
-                    preferences_.getString("ga", "happy,angry,curious,neutral"));
-  gesture_.set_inverted(preferences_.getBool("ginv", false));
-  gesture_.set_shake_threshold(preferences_.getFloat("gst", 200.0f));
-  gesture_.set_pat_threshold(preferences_.getFloat("gpt", 0.32f));
-  gesture_.set_swipe_threshold(preferences_.getFloat("gvt", 0.45f));
-  gesture_.set_touch_threshold(preferences_.getFloat("gtt", 0.05f));
-  gesture_.set_pickup_tilt_deg(preferences_.getFloat("gtd", 30.0f));
-
-  shuffle_.restore(preferences_.getBool("shuf_en", true),
-                   preferences_.getUInt("shuf_emin", 2000),
-                   preferences_.getUInt("shuf_emax", 5000),
-                   preferences_.getUInt("shuf_nmin", 2000),
-                   preferences_.getUInt("shuf_nmax", 5000));
   clock_.restore(preferences_.getBool("clk_on", false),
                  preferences_.getBool("clk_24", true),
                  static_cast<int16_t>(preferences_.getInt("clk_tz", 0)),
@@ -236,26 +285,288 @@ esp_err_t Application::start() {
                  preferences_.getUInt("clk_sec", 0));
   was_clock_enabled_ = clock_.enabled();
 
+  // Face first: everything below (IMU bring-up, NimBLE, remaining settings)
+  // happens with the eyes already on screen.
+  if (!clock_.enabled()) {
+    eyes_->update(now_ms());
+  }
+  boot_.first_frame_us = now_us();
+
   commands_ = std::make_unique<CommandRouter>(preferences_, config_.display,
                                               *display_, *eyes_, gesture_,
-                                              shuffle_, clock_, power_, ble_);
+                                              shuffle_, clock_, power_,
+                                              motion_wake_, ble_,
+                                              recorder_, capture_, governor_,
+                                              loop_,
+                                              power_policy_,
+                                              boot_);
+
+  ble_.set_activity_handler([this](BleActivity activity) {
+    if (events_ == nullptr) {
+      return;
+    }
+    switch (activity) {
+    case BleActivity::kCommand:
+      xEventGroupSetBits(events_, kEventBleCommand);
+      break;
+    case BleActivity::kOta:
+      xEventGroupSetBits(events_, kEventOta);
+      break;
+    case BleActivity::kLink:
+      xEventGroupSetBits(events_, kEventBleLink);
+      break;
+    }
+  });
+  // Controller and host bring-up overlap the IMU's reset delays below.
+  if (boot_.warm) {
+    retained_.ble_name[sizeof(retained_.ble_name) - 1] = '\0';
+    ble_name_ = retained_.ble_name;
+  } else {
+    ble_name_ = preferences_.getString("ble_name", "Leor");
+  }
+  if (xTaskCreate(ble_start_task, "ble_start", kBleStartStackBytes, this,
+                  uxTaskPriorityGet(nullptr), nullptr) != pdPASS) {
+    ESP_LOGW(kTag, "ble start task unavailable, starting inline");
+    start_ble();
+  }
 
-  const std::string ble_name = preferences_.getString("ble_name", "Leor");
-  ESP_ERROR_CHECK(ble_.start(ble_name, [this](const std::string &cmd) {
-    const uint32_t now_ms =
-        static_cast<uint32_t>(esp_timer_get_time() / 1000ULL);
-    return commands_->handle(cmd, now_ms);
-  }));
-  open_ble_window(static_cast<uint32_t>(esp_timer_get_time() / 1000ULL), false);
-  display_->set_contrast(static_cast<uint8_t>(preferences_.getUInt("disp_con", 0x7f)));
+  GyroBiasTable bias_table;
+  if (preferences_.getBytes(GyroBiasTable::kPrefsKey, &bias_table,
+                            sizeof(bias_table)) &&
+      bias_table.valid()) {
+    gesture_.load_bias_table(bias_table);
+  }
+  float gyro_offsets[3] = {NAN, NAN, NAN};
+  if (boot_.warm && retained_.gesture.gyro_valid) {
+    std::copy(retained_.gesture.gyro_offsets,
+              retained_.gesture.gyro_offsets + 3, gyro_offsets);
+  } else if (!gesture_.bias_table().lookup(gesture_.bias_table().last_c,
+                                           gyro_offsets)) {
+    // Single offsets cached before the table existed.
+    gyro_offsets[0] = preferences_.getFloat("gox", NAN);
+    gyro_offsets[1] = preferences_.getFloat("goy", NAN);
+    gyro_offsets[2] = preferences_.getFloat("goz", NAN);
+  }
+  boot_.gyro_cached = std::isfinite(gyro_offsets[0]) &&
+                      std::isfinite(gyro_offsets[1]) &&
+                      std::isfinite(gyro_offsets[2]);
+  gesture_.start(config_.gesture_dummy_enabled, config_.display.sda_pin,
+                 config_.display.scl_pin,
+                 boot_.gyro_cached ? gyro_offsets : nullptr,
+                 config_.imu_int_pin);
+  boot_.imu_us = now_us();
+  if (gesture_.imu_calibrated()) {
+    boot_.imu_cal_us = boot_.imu_us;
+  }
+  gesture_.set_recorder(&recorder_);
+  capture_.begin();
+  gesture_.set_capture(&capture_);
+  recorder_.set_gyro_offsets(gesture_.gyro_offsets());
+  const std::string gesture_actions =
+      preferences_.getString("ga", "happy,angry,curious,neutral");
+  if (boot_.warm) {
+    const GestureSnapshot &g = retained_.gesture;
+    gesture_.restore(g.matching, g.reaction_time_ms, g.confidence_percent,
+                     g.cooldown_ms, gesture_actions);
+    gesture_.resume(g);
+    shuffle_.resume(retained_.shuffle, now_ms());
+  } else {
+    gesture_.restore(preferences_.getBool("gm", true),
+                      preferences_.getUInt("grt", 1500),
+                      preferences_.getUInt("gcf", 70),
+                      preferences_.getUInt("gcd", 1500),
+                      gesture_actions);
+    gesture_.set_inverted(preferences_.getBool("ginv", false));
+    gesture_.set_shake_threshold(preferences_.getFloat("gst", 200.0f));
+    gesture_.set_pat_threshold(preferences_.getFloat("gpt", 0.32f));
+    gesture_.set_swipe_threshold(preferences_.getFloat("gvt", 0.45f));
+    gesture_.set_touch_threshold(preferences_.getFloat("gtt", 0.05f));
+    gesture_.set_pickup_tilt_deg(preferences_.getFloat("gtd", 30.0f));
+
+    shuffle_.restore(preferences_.getBool("shuf_en", true),
+                     preferences_.getUInt("shuf_emin", 2000),
+                     preferences_.getUInt("shuf_emax", 5000),
+                     preferences_.getUInt("shuf_nmin", 2000),
+                     preferences_.getUInt("shuf_nmax", 5000));
+  }
+  loop_.set_alert_threshold(preferences_.getUInt("loop_ntf", 0));
+  power_.set_sleep_prepare_callback([this] { save_retained_state(retained_); });
+  power_.set_edge_callback([this](uint32_t t_ms, bool pressed) {
+    if (recorder_.active()) {
+      recorder_.record_touch(t_ms, pressed);
+    }
+  });
 
+  open_ble_window(now_ms(), false);
+
+  ESP_LOGI(kTag, "%s boot: nvs=%ums display=%ums frame=%ums imu=%ums%s",
+           boot_.warm ? "warm" : "cold",
+           static_cast<unsigned>(boot_.nvs_us / 1000),
+           static_cast<unsigned>(boot_.display_us / 1000),
+           static_cast<unsigned>(boot_.first_frame_us / 1000),
+           static_cast<unsigned>(boot_.imu_us / 1000),
+           boot_.gyro_cached ? " (cached bias)" : "");
   ESP_LOGI(kTag, "application started");
   return ESP_OK;
 }
 
+void Application::capture_retained_state(uint32_t now_ms) {
+  retained_.has_face = eyes_ != nullptr;
+  if (eyes_) {
+    eyes_->saveSnapshot(retained_.face);
+  }
+  gesture_.snapshot(retained_.gesture);
+  shuffle_.snapshot(retained_.shuffle, now_ms);
+  // A renamed device (ble:name=) takes effect on the next start, warm or not.
+  const std::string name = preferences_.getString("ble_name", "Leor");
+  std::snprintf(retained_.ble_name, sizeof(retained_.ble_name), "%s",
+                name.c_str());
+}
+
+void Application::save_bias_table() {
+  const GyroBiasTable &table = gesture_.bias_table();
+  preferences_.putBytes(GyroBiasTable::kPrefsKey, &table, sizeof(table));
+  preferences_.remove("gox");
+  preferences_.remove("goy");
+  preferences_.remove("goz");
+}
+
+void Application::ble_start_task(void *arg) {
+  static_cast<Application *>(arg)->start_ble();
+  vTaskDelete(nullptr);
+}
+
+void Application::start_ble() {
+  ESP_ERROR_CHECK(ble_.start(ble_name_, [this](std::string_view cmd) {
+    const uint32_t now_ms = leor::now_ms();
+    if (recorder_.active() && cmd.substr(0, 4) != "rec:") {
+      recorder_.record_command(now_ms, cmd);
+    }
+    // Copied once here: the reply crosses to the NimBLE host task.
+    return std::string(commands_->handle(cmd, now_ms));
+  }));
+  boot_.ble_us = now_us();
+}
+
+void Application::begin_replay(const SessionReplayer &replayer) {
+  eyes_->seed_random(replayer.seed());
+  shuffle_.seed(replayer.seed());
+  gesture_.begin_replay(replayer.gyro_offsets());
+  power_.set_input_override(0);
+}
+
+void Application::apply_replay_event(const RecordedEvent &event,
+                                     uint32_t now_ms) {
+  switch (event.kind) {
+  case RecordKind::kCommand:
+    commands_->handle(event.command, now_ms);
+    break;
+  case RecordKind::kTouch:
+    power_.set_input_override(event.value);
+    break;
+  case RecordKind::kImu:
+    gesture_.inject_sample(event.raw, event.dt_us, event.sample_ms);
+    break;
+  case RecordKind::kButton:
+    // Derived from the touch level again during replay; kept in the log so
+    // a diverging replay is easy to spot.
+    break;
+  }
+}
+
+void Application::select_face_rate(uint32_t now_ms) {
+  frame_rate_ = FrameGovernor::rate_for(eyes_->motion_level());
+  // Sampling the touch pad from tick() needs at least 30 Hz. The IMU queues
+  // its own samples; draining them every 100 ms is enough.
+  if (power_.needs_polling(now_ms)) {
+    frame_rate_ = FrameGovernor::faster(frame_rate_, FrameRate::kNormal);
+  } else if (gesture_.matching_enabled() && !gesture_.suspended()) {
+    frame_rate_ = FrameGovernor::faster(frame_rate_, FrameRate::kSlow);
+  }
+
+  auto consider = [&](uint32_t candidate_ms) {
+    if (static_cast<int32_t>(candidate_ms - frame_deadline_ms_) < 0) {
+      frame_deadline_ms_ = candidate_ms;
+    }
+  };
+  if (eyes_->is_quiescent()) {
+    consider(eyes_->next_event_ms());
+  }
+  if (shuffle_.has_pending_change()) {
+    consider(shuffle_.next_change_ms());
+  }
+  if (ble_window_open_) {
+    consider(ble_window_deadline_ms_);
+  }
+  uint32_t long_press_ms = 0;
+  if (power_.long_press_deadline(&long_press_ms)) {
+    consider(long_press_ms);
+  }
+}
+
+PowerMode Application::select_power_mode() const {
+  if (ble_.ota().in_progress() || ble_.ota().reboot_pending() ||
+      ble_.ota().error_pending()) {
+    return PowerMode::kOta;
+  }
+  if (menu_.is_open()) {
+    return PowerMode::kMenu;
+  }
+  if (clock_.enabled()) {
+    return PowerMode::kClock;
+  }
+  return frame_rate_ == FrameRate::kFast ? PowerMode::kFaceAnimating
+                                         : PowerMode::kFaceIdle;
+}
+
+void Application::run() {
+  while (true) {
+    const uint32_t started_ms = now_ms();
+    tick();
+
+    const uint32_t elapsed_ms = now_ms() - started_ms;
+    const TickType_t wait = pdMS_TO_TICKS(
+        elapsed_ms < next_tick_delay_ms_ ? next_tick_delay_ms_ - elapsed_ms : 0);
+    if (events_ == nullptr) {
+      vTaskDelay(wait);
+      continue;
+    }
+    xEventGroupWaitBits(events_, kWakeEvents, pdTRUE, pdFALSE, wait);
+  }
+}
+
 void Application::tick() {
-  uint32_t now_ms = static_cast<uint32_t>(esp_timer_get_time() / 1000ULL);
-  ble_.poll();
+  LEOR_PERF_SCOPE(PERF_TICK);
+  LEOR_ALLOC_TICK_SCOPE();
+  const int64_t started_us = now_us();
+  loop_.begin_tick(started_us);
+  power_policy_.begin_burst(started_us);
+  // The slot this tick had to fit in: the period of the rate the previous
+  // tick chose. Idle ticks are held to the slow rate.
+  const FrameRate slot_rate = governor_.rate() == FrameRate::kIdle ? FrameRate::kSlow : governor_.rate();
+  const uint32_t now_ms = static_cast<uint32_t>(started_us / 1000);
+  const uint32_t max_idle_ms =
+      power_.edge_events_enabled() ? kIdleTickMaxMs : kIdleTickPolledMs;
+  frame_rate_ = FrameRate::kNormal;
+  frame_deadline_ms_ = now_ms + max_idle_ms;
+  run_frame(now_ms);
+  next_tick_delay_ms_ =
+      governor_.select(frame_rate_, now_ms, frame_deadline_ms_, max_idle_ms);
+  const int64_t ended_us = now_us();
+  power_policy_.set_mode(select_power_mode(), ended_us);
+  power_policy_.end_burst(ended_us);
+  if (loop_.end_tick(ended_us, FrameGovernor::kPeriodMs[static_cast<int>(slot_rate)],
+                     next_tick_delay_ms_) &&
+      ble_.connected()) {
+    ble_.notify_status(loop_.alert_json());
+  }
+}
+
+void Application::run_frame(uint32_t now_ms) {
+  {
+    LEOR_PERF_SCOPE(PERF_BLE_POLL);
+    ble_.poll();
+  }
   const bool ota_active = ble_.ota().in_progress() || ble_.ota().reboot_pending() || ble_.ota().error_pending();
 
   if (ble_window_open_) {
@@ -266,7 +577,7 @@ void Application::tick() {
     }
   }
 
-  if (ble_window_open_ && !ota_active && now_ms >= ble_window_deadline_ms_) {
+  if (ble_window_open_ && !ota_active && time_reached(now_ms, ble_window_deadline_ms_)) {
     ble_.stop(false);
     ble_window_open_ = false;
   }
@@ -276,6 +587,7 @@ void Application::tick() {
   // all normal rendering and logic (IMU, gestures, splines) to speed up BLE transfer.
   if (ota_active) {
     if (display_) {
+      LEOR_PERF_SCOPE(PERF_OTA_SCREEN);
       if (ble_.ota().error_pending()) {
         draw_ota_screen(*display_, 0, "OTA FAILED", ble_.ota().error_message() ? ble_.ota().error_message() : "Unknown", now_ms);
       } else {
@@ -299,29 +611,35 @@ void Application::tick() {
         }
       }
     }
-    vTaskDelay(pdMS_TO_TICKS(kOtaUiFrameMs));
+    if (eyes_) {
+      eyes_->invalidate();
+    }
     return;
   }
   // ---------------------------
 
-  ButtonEvent btn = power_.poll(now_ms);
-  if (btn == ButtonEvent::kShortPress) {
-    if (now_ms - last_short_press_ms_ < kDoubleTapThresholdMs) {
-      // Double tap detected
-      if (menu_.is_open()) {
-        menu_.close();
-      }
-      last_short_press_ms_ = 0; // Reset
-    } else {
-      last_short_press_ms_ = now_ms;
+  for (ButtonEvent btn; (btn = power_.poll(now_ms)) != ButtonEvent::kNone;) {
+    if (recorder_.active()) {
+      recorder_.record_button(now_ms, static_cast<uint8_t>(btn));
+    }
+    switch (btn) {
+    case ButtonEvent::kShortPress:
       open_ble_window(now_ms, true);
       if (menu_.is_open()) {
         menu_.on_short_press(now_ms);
       }
+      break;
+    case ButtonEvent::kDoublePress:
+      if (menu_.is_open()) {
+        menu_.close();
+      }
+      break;
+    case ButtonEvent::kLongPress:
+      menu_.on_long_press(now_ms);
+      break;
+    default:
+      break;
     }
-  } else if (btn == ButtonEvent::kLongPress) {
-    menu_.on_long_press(now_ms);
-    last_short_press_ms_ = 0;
   }
 
   if (menu_.is_open() && (now_ms - menu_.last_activity_ms() > MenuService::kTimeoutMs)) {
@@ -337,6 +655,12 @@ void Application::tick() {
     break;
   }
   case MenuAction::kPowerOff:
+    // Before the sleep animation, so a wake resumes the face as it was.
+    capture_retained_state(now_ms);
+    capture_.stop();
+    if (gesture_.take_bias_table_to_save(now_ms, true)) {
+      save_bias_table();
+    }
     if (display_ && eyes_) {
       bool was_shuffle = shuffle_.enabled();
       if (was_shuffle) shuffle_.set_enabled(false);
@@ -344,8 +668,7 @@ void Application::tick() {
       eyes_->triggerSleep();
       uint32_t start_ms = now_ms;
       while (!eyes_->is_sleep_done()) {
-        uint32_t loop_ms =
-            static_cast<uint32_t>(esp_timer_get_time() / 1000ULL);
+        uint32_t loop_ms = leor::now_ms();
         display_->clear();
         eyes_->update(loop_ms);
         vTaskDelay(pdMS_TO_TICKS(16));
@@ -455,11 +778,33 @@ void Application::tick() {
       }
 
       display_->send_buffer();
+      eyes_->invalidate();
     }
   } else {
-    const std::string gesture_cmd = gesture_.poll(now_ms, power_.is_pressed());
-    if (!gesture_cmd.empty() && !clock_.enabled() && !menu_.is_open()) {
-      commands_->handle(gesture_cmd, now_ms);
+    Action gesture_action;
+    {
+      LEOR_PERF_SCOPE(PERF_GESTURE_POLL);
+      gesture_action = gesture_.poll(now_ms, power_.is_pressed());
+    }
+    if (gesture_.take_bias_table_to_save(now_ms)) {
+      save_bias_table();
+      recorder_.set_gyro_offsets(gesture_.gyro_offsets());
+    }
+    if (gesture_.window_reports()) {
+      const std::string report = gesture_.take_window_report();
+      if (!report.empty()) {
+        ble_.notify_status(report);
+      }
+    }
+    if (boot_.imu_cal_us == 0 && gesture_.imu_calibrated()) {
+      boot_.imu_cal_us = now_us();
+    }
+    if (gesture_action != Action::kNone && !clock_.enabled() && !menu_.is_open()) {
+      if (gesture_action == Action::kCommand) {
+        commands_->handle(gesture_.command(), now_ms);
+      } else {
+        commands_->dispatch(gesture_action, true);
+      }
     }
   }
 
@@ -483,10 +828,9 @@ void Application::tick() {
   }
   // -----------------------------------
 
-  const char *shuffle_cmd = nullptr;
-  if (!clock_.enabled() && shuffle_.should_emit(now_ms, false, false, &shuffle_cmd) &&
-      shuffle_cmd != nullptr) {
-    commands_->handle(shuffle_cmd, now_ms, false);
+  Action shuffle_action = Action::kNone;
+  if (!clock_.enabled() && shuffle_.should_emit(now_ms, false, false, &shuffle_action)) {
+    commands_->dispatch(shuffle_action, false);
   }
 
   const bool is_clock_enabled = clock_.enabled();
@@ -496,6 +840,7 @@ void Application::tick() {
   if (is_clock_enabled != was_clock_enabled_ && !gesture_.calibrating()) {
     display_->clear();
     display_->send_buffer();
+    eyes_->invalidate();
     was_clock_enabled_ = is_clock_enabled;
   }
 
@@ -507,6 +852,7 @@ void Application::tick() {
     }
     display_->clear();
     display_->send_buffer();
+    eyes_->invalidate();
     was_menu_open_ = menu_.is_open();
   }
 
@@ -517,8 +863,10 @@ void Application::tick() {
   } else if (!gesture_.calibrating()) {
     if (is_clock_enabled) {
       clock_.draw(*display_, ble_.connected());
+      frame_rate_ = FrameRate::kSlow;
     } else {
       eyes_->update(now_ms);
+      select_face_rate(now_ms);
     }
   }
 }
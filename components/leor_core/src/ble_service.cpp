@@ -4,6 +4,7 @@
 #include "host/ble_att.h"
 #include "host/ble_hs.h"
 #include "host/util/util.h"
+#include "nimble/nimble_npl.h"
 #include "nimble/nimble_port.h"
 #include "nimble/nimble_port_freertos.h"
 #include "os/os_mbuf.h"
@@ -15,6 +16,8 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "leor/time_source.hpp"
+#include "leor/trace.hpp"
 
 extern "C" void ble_store_config_init(void);
 
@@ -31,8 +34,10 @@ static uint16_t s_ota_control_handle = 0;
 static uint16_t s_ota_data_handle = 0;
 static uint16_t s_conn_handle = BLE_HS_CONN_HANDLE_NONE;
 static bool s_advertising = false;
+static int64_t s_first_adv_us = 0;
 static std::string s_last_status = "ready";
 static std::string s_last_gesture = "idle";
+static ble_npl_event s_response_event;
 
 constexpr ble_uuid128_t kServiceUuid = BLE_UUID128_INIT(0x4b,0x91,0x31,0xc3,0xc9,0xc5,0xcc,0x8f,0x9e,0x45,0xb5,0x1f,0x01,0xc2,0xaf,0x4f);
 constexpr ble_uuid128_t kCommandUuid = BLE_UUID128_INIT(0xa8,0x26,0x1b,0x36,0x07,0xea,0xf5,0xb7,0x88,0x46,0xe1,0x36,0x3e,0x48,0xb5,0xbe);
@@ -49,20 +54,27 @@ int gap_event(struct ble_gap_event* event, void* arg) {
         case BLE_GAP_EVENT_CONNECT:
             if (event->connect.status == 0) {
                 s_conn_handle = event->connect.conn_handle;
+                LEOR_TRACE(BLE_CONNECT, s_conn_handle);
                 s_advertising = false;
                 if (s_service) {
                     s_service->on_connected(s_conn_handle);
                     s_service->notify_status("connected");
+                    s_service->signal_activity(BleActivity::kLink);
                 }
             } else {
+                LEOR_TRACE(BLE_CONNECT_FAILED, event->connect.status);
                 s_advertising = false;
                 advertise();
             }
             return 0;
         case BLE_GAP_EVENT_DISCONNECT:
+            LEOR_TRACE(BLE_DISCONNECT, event->disconnect.reason);
             s_conn_handle = BLE_HS_CONN_HANDLE_NONE;
             s_advertising = false;
-            if (s_service) s_service->on_disconnected();
+            if (s_service) {
+                s_service->on_disconnected();
+                s_service->signal_activity(BleActivity::kLink);
+            }
             if (s_service && s_service->advertising_enabled()) {
                 advertise();
             }
@@ -81,14 +93,21 @@ int gap_event(struct ble_gap_event* event, void* arg) {
 int gatt_access(uint16_t conn_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt* ctxt, void* arg) {
     const ble_uuid_t* uuid = ctxt->chr->uuid;
     if (ble_uuid_cmp(uuid, &kCommandUuid.u) == 0 && ctxt->op == BLE_GATT_ACCESS_OP_WRITE_CHR) {
-        std::string cmd;
-        cmd.resize(OS_MBUF_PKTLEN(ctxt->om));
-        os_mbuf_copydata(ctxt->om, 0, cmd.size(), cmd.data());
         if (s_service) {
-            const std::string response = s_service->handle_command(cmd);
-            if (!response.empty()) {
-                s_service->notify_status(response);
+            char cmd[BleService::kMaxCommandBytes];
+            const size_t len = OS_MBUF_PKTLEN(ctxt->om);
+            if (len > sizeof(cmd)) {
+                LEOR_TRACE(BLE_CMD_TOO_LONG, len);
+                s_service->notify_status("Command too long");
+                return 0;
             }
+            os_mbuf_copydata(ctxt->om, 0, len, cmd);
+            if (!s_service->enqueue_command(cmd, len)) {
+                LEOR_TRACE(BLE_CMD_DROPPED, len);
+                s_service->notify_status("Busy: command dropped");
+                return 0;
+            }
+            s_service->signal_activity(BleActivity::kCommand);
         }
         return 0;
     }
@@ -102,6 +121,7 @@ int gatt_access(uint16_t conn_handle, uint16_t attr_handle, struct ble_gatt_acce
                 struct os_mbuf* om = ble_hs_mbuf_from_flat(&ack, 1);
                 ble_gatts_notify_custom(s_conn_handle, s_ota_control_handle, om);
             }
+            s_service->signal_activity(BleActivity::kOta);
         }
         return 0;
     }
@@ -165,6 +185,12 @@ void on_sync(void) {
     }
 }
 
+void on_response_event(ble_npl_event* event) {
+    if (s_service) {
+        s_service->flush_responses();
+    }
+}
+
 void host_task(void* param) {
     nimble_port_run();
     nimble_port_freertos_deinit();
@@ -181,7 +207,7 @@ void advertise() {
     adv_fields.uuids128_is_complete = 1;
     int rc = ble_gap_adv_set_fields(&adv_fields);
     if (rc != 0) {
-        ESP_LOGW(kTag, "adv fields set failed rc=%d", rc);
+        LEOR_TRACE(BLE_ADV_FIELDS_FAILED, rc);
     }
 
     struct ble_hs_adv_fields rsp_fields = {};
@@ -196,7 +222,7 @@ void advertise() {
         rsp_fields.name_is_complete = 0;
         rc = ble_gap_adv_rsp_set_fields(&rsp_fields);
         if (rc != 0) {
-            ESP_LOGW(kTag, "adv scan response set failed rc=%d", rc);
+            LEOR_TRACE(BLE_ADV_RSP_FAILED, rc);
         }
     }
 
@@ -205,10 +231,13 @@ void advertise() {
     adv.disc_mode = BLE_GAP_DISC_MODE_GEN;
     rc = ble_gap_adv_start(s_own_addr_type, nullptr, BLE_HS_FOREVER, &adv, gap_event, nullptr);
     if (rc != 0) {
-        ESP_LOGW(kTag, "adv start failed rc=%d", rc);
+        LEOR_TRACE(BLE_ADV_FAILED, rc);
         return;
     }
     s_advertising = true;
+    if (s_first_adv_us == 0) {
+        s_first_adv_us = now_us();
+    }
 }
 
 }  // namespace
@@ -216,6 +245,7 @@ void advertise() {
 esp_err_t BleService::start(const std::string& device_name, CommandHandler handler) {
     command_handler_ = std::move(handler);
     s_service = this;
+    ble_npl_event_init(&s_response_event, on_response_event, nullptr);
     if (notify_mutex_ == nullptr) {
         notify_mutex_ = xSemaphoreCreateMutex();
     }
@@ -230,12 +260,20 @@ esp_err_t BleService::start(const std::string& device_name, CommandHandler handl
     ble_svc_gap_device_name_set(device_name.c_str());
     ble_store_config_init();
     nimble_port_freertos_init(host_task);
+    started_.store(true, std::memory_order_release);
     return ESP_OK;
 }
 
+int64_t BleService::first_advertising_us() const {
+    return s_first_adv_us;
+}
+
 void BleService::stop(bool disconnect_connected) {
     // Must stop BLE before deep sleep or ESP-IDF will panic & reboot.
     advertising_enabled_ = false;
+    if (!started()) {
+        return;
+    }
     if (disconnect_connected && connected_ && s_conn_handle != BLE_HS_CONN_HANDLE_NONE) {
         ble_gap_terminate(s_conn_handle, BLE_ERR_REM_USER_CONN_TERM);
     }
@@ -245,7 +283,9 @@ void BleService::stop(bool disconnect_connected) {
 
 void BleService::start_advertising() {
     advertising_enabled_ = true;
-    advertise();
+    if (started()) {
+        advertise();
+    }
 }
 
 bool BleService::advertising_enabled() const {
@@ -253,6 +293,7 @@ bool BleService::advertising_enabled() const {
 }
 
 void BleService::poll() {
+    apply_commands();
     ota_.poll();
     if (connected_ && ota_.control_notify_pending()) {
         const uint8_t code = ota_.control_notify_code();
@@ -351,8 +392,45 @@ void BleService::ota_consume_pending_notify() {
     ota_.consume_control_notify();
 }
 
-std::string BleService::handle_command(const std::string& command) const {
-    return command_handler_ ? command_handler_(command) : std::string();
+bool BleService::enqueue_command(const char* data, size_t len) {
+    if (len > kMaxCommandBytes) {
+        return false;
+    }
+    CommandSlot slot;
+    slot.len = static_cast<uint16_t>(len);
+    std::memcpy(slot.text, data, len);
+    return commands_.push(std::move(slot));
+}
+
+void BleService::apply_commands() {
+    // Bounded so a burst of writes cannot stall a frame indefinitely; the
+    // rest are picked up on the next tick.
+    CommandSlot slot;
+    for (size_t i = 0; i < commands_.capacity() && commands_.pop(slot); ++i) {
+        if (!command_handler_) {
+            continue;
+        }
+        std::string response = command_handler_(std::string_view(slot.text, slot.len));
+        if (!response.empty()) {
+            post_response(std::move(response));
+        }
+    }
+}
+
+void BleService::post_response(std::string response) {
+    [[maybe_unused]] const size_t len = response.size();
+    if (!responses_.push(std::move(response))) {
+        LEOR_TRACE(BLE_REPLY_DROPPED, len);
+        return;
+    }
+    ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &s_response_event);
+}
+
+void BleService::flush_responses() {
+    std::string response;
+    while (responses_.pop(response)) {
+        notify_status(response);
+    }
 }
 
 }  // namespace leor
@@ -2,11 +2,11 @@
 
 #include <cstdio>
 #include <ctime>
-#include <sys/time.h>
 #include <cstdlib>
 
 #include "esp_attr.h"
 #include "esp_log.h"
+#include "leor/time_source.hpp"
 
 namespace leor {
 
@@ -62,17 +62,15 @@ void draw_ble_icon(DisplayBackend& display, int x, int y, bool connected) {
 }
 
 uint64_t read_system_time_ms() {
-    struct timeval tv {};
-    gettimeofday(&tv, nullptr);
-    return static_cast<uint64_t>(tv.tv_sec) * 1000ULL +
-           static_cast<uint64_t>(tv.tv_usec / 1000);
+    return static_cast<uint64_t>(time_source().wall_us() / 1000);
 }
 
 void set_system_time(uint64_t epoch_ms_value) {
-    struct timeval tv {};
-    tv.tv_sec = static_cast<time_t>(epoch_ms_value / 1000ULL);
-    tv.tv_usec = static_cast<suseconds_t>((epoch_ms_value % 1000ULL) * 1000ULL);
-    settimeofday(&tv, nullptr);
+    time_source().set_wall_us(static_cast<int64_t>(epoch_ms_value) * 1000);
+}
+
+time_t wall_time() {
+    return static_cast<time_t>(time_source().wall_us() / 1000000);
 }
 
 }  // namespace
@@ -111,7 +109,7 @@ void ClockService::format_date(char* out, std::size_t out_size) const {
         return;
     }
     static const char* const weekdays[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
-    time_t now = time(nullptr);
+    time_t now = wall_time();
     struct tm tm_value;
     localtime_r(&now, &tm_value);
     std::snprintf(out, out_size, "%s %02d", weekdays[tm_value.tm_wday], tm_value.tm_mday);
@@ -137,7 +135,7 @@ void ClockService::update_tz_env() const {
 }
 
 void ClockService::restore(bool enabled, bool use24, int16_t tz_offset, uint64_t epoch_ms_value, uint32_t manual_sec) {
-    time_t now = time(nullptr);
+    time_t now = wall_time();
     bool is_sane = now > kSaneTimeMinSec;
 
     if (s_clock_state.magic == kClockStateMagic && s_clock_state.has_time && is_sane) {
@@ -186,7 +184,7 @@ void ClockService::set_time_of_day(uint8_t hours, uint8_t minutes, uint8_t secon
     has_time_ = true;
     has_epoch_ = false;
 
-    // Build a synthetic POSIX time so gettimeofday() ticks from this point.
+    // Build a synthetic POSIX time so the wall clock ticks from this point.
     // Offset by tz so that seconds_of_day() gives the correct local time.
     uint32_t day_seconds = static_cast<uint32_t>(hours % 24U) * 3600U +
                            static_cast<uint32_t>(minutes % 60U) * 60U +
@@ -194,10 +192,7 @@ void ClockService::set_time_of_day(uint8_t hours, uint8_t minutes, uint8_t secon
     time_t synthetic = static_cast<time_t>(day_seconds) +
                        static_cast<time_t>(tz_offset_minutes_) * 60 +
                        86400 * 2;  // keep positive
-    struct timeval tv {};
-    tv.tv_sec = synthetic;
-    tv.tv_usec = 0;
-    settimeofday(&tv, nullptr);
+    set_system_time(static_cast<uint64_t>(synthetic) * 1000ULL);
 
     save_retained_state();
     last_draw_key_ = UINT32_MAX;
@@ -219,7 +214,7 @@ uint32_t ClockService::seconds_of_day() const {
     if (!has_time_) {
         return 0;
     }
-    time_t now = time(nullptr);
+    time_t now = wall_time();
     struct tm tm_value;
     localtime_r(&now, &tm_value);
     return static_cast<uint32_t>(tm_value.tm_hour * 3600 + tm_value.tm_min * 60 + tm_value.tm_sec);
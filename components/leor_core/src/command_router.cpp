@@ -3,42 +3,59 @@
 #include <algorithm>
 #include <cctype>
 #include <cmath>
+#include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
-#include <sstream>
-#include <vector>
+#include <cstring>
 
+#include "esp_random.h"
 #include "esp_system.h"
+#include "leor/alloc_counter.hpp"
+#include "leor/mahony.hpp"
+#include "leor/profiler.hpp"
+#include "leor/time_source.hpp"
+#include "leor/trace.hpp"
 
 namespace leor {
 
 namespace {
 
-std::string trim(std::string value) {
-    auto not_space = [](unsigned char c) { return !std::isspace(c); };
-    value.erase(value.begin(), std::find_if(value.begin(), value.end(), not_space));
-    value.erase(std::find_if(value.rbegin(), value.rend(), not_space).base(), value.end());
+std::string_view trim(std::string_view value) {
+    while (!value.empty() && std::isspace(static_cast<unsigned char>(value.front()))) value.remove_prefix(1);
+    while (!value.empty() && std::isspace(static_cast<unsigned char>(value.back()))) value.remove_suffix(1);
     return value;
 }
 
-std::string lower(std::string value) {
-    std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
-    return value;
+bool starts_with(std::string_view value, std::string_view prefix) {
+    return value.substr(0, prefix.size()) == prefix;
 }
 
-bool starts_with(const std::string& value, const char* prefix) {
-    return value.rfind(prefix, 0) == 0;
+// Takes the next `delim`-separated token off the front of `rest`; false once
+// nothing is left. Same tokens as std::getline, without the copies.
+bool next_token(std::string_view& rest, char delim, std::string_view& token) {
+    if (rest.empty()) return false;
+    const size_t pos = rest.find(delim);
+    token = rest.substr(0, pos);
+    rest = pos == std::string_view::npos ? std::string_view() : rest.substr(pos + 1);
+    return true;
 }
 
-std::vector<std::string> split(const std::string& text, char delim) {
-    std::vector<std::string> out;
-    std::stringstream ss(text);
-    std::string item;
-    while (std::getline(ss, item, delim)) {
-        out.push_back(item);
-    }
-    return out;
-}
+// A terminated copy of a number for the C parsers, which cannot take a view.
+struct NumberText {
+    explicit NumberText(std::string_view text) {
+        const size_t len = std::min(text.size(), sizeof(buf) - 1);
+        std::memcpy(buf, text.data(), len);
+        buf[len] = '\0';
+    }
+    char buf[32];
+};
+
+int to_int(std::string_view text) { return std::atoi(NumberText(text).buf); }
+long to_long(std::string_view text, int base) { return std::strtol(NumberText(text).buf, nullptr, base); }
+unsigned long to_ulong(std::string_view text) { return std::strtoul(NumberText(text).buf, nullptr, 10); }
+unsigned long long to_ull(std::string_view text) { return std::strtoull(NumberText(text).buf, nullptr, 10); }
+float to_float(std::string_view text) { return std::strtof(NumberText(text).buf, nullptr); }
+double to_double(std::string_view text) { return std::atof(NumberText(text).buf); }
 
 }  // namespace
 
@@ -50,7 +67,14 @@ CommandRouter::CommandRouter(Preferences& preferences,
                              ShuffleService& shuffle,
                              ClockService& clock,
                              PowerService& power,
-                             BleService& ble)
+                             MotionWake& motion_wake,
+                             BleService& ble,
+                             SessionRecorder& recorder,
+                             ImuCapture& capture,
+                             FrameGovernor& governor,
+                             LoopMonitor& loop,
+                             PowerPolicy& power_policy,
+                             const BootTimes& boot)
     : preferences_(preferences),
       display_config_(display_config),
       display_(display),
@@ -59,7 +83,40 @@ CommandRouter::CommandRouter(Preferences& preferences,
       shuffle_(shuffle),
       clock_(clock),
       power_(power),
-      ble_(ble) {}
+      motion_wake_(motion_wake),
+      ble_(ble),
+      recorder_(recorder),
+      capture_(capture),
+      governor_(governor),
+      loop_(loop),
+      power_policy_(power_policy),
+      boot_(boot) {
+    // Sized for the largest reply (sync_json), so formatting never allocates.
+    reply_.reserve(kReplyReserve);
+}
+
+std::string_view CommandRouter::reply(const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    va_list retry;
+    va_copy(retry, args);
+    reply_.resize(reply_.capacity());
+    int len = std::vsnprintf(&reply_[0], reply_.size() + 1, fmt, args);
+    va_end(args);
+    if (len < 0) len = 0;
+    if (static_cast<size_t>(len) > reply_.size()) {
+        reply_.resize(static_cast<size_t>(len));
+        std::vsnprintf(&reply_[0], reply_.size() + 1, fmt, retry);
+    }
+    va_end(retry);
+    reply_.resize(static_cast<size_t>(len));
+    return reply_;
+}
+
+std::string_view CommandRouter::reply_text(std::string_view text) {
+    reply_.assign(text.data(), text.size());
+    return reply_;
+}
 
 void CommandRouter::reset_effects() {
     clock_.set_enabled(false);
@@ -75,11 +132,25 @@ void CommandRouter::reset_effects() {
     eyes_.set_breathing(preferences_.getBool("br_en", true), eyes_.get_breathing_intensity(), eyes_.get_breathing_speed());
 }
 
-std::string CommandRouter::sync_json(uint32_t now_ms) const {
-    char buf[2048];
+std::string_view CommandRouter::frame_budget_json() {
+    const FrameBudget& fb = eyes_.frame_budget();
+    return reply("{\"type\":\"fb\",\"lvl\":%u,\"budget\":%u,\"last\":%u,\"avg\":%u,\"frames\":%u,\"reuse\":%u,\"idle\":%u,\"over\":%u,\"deg\":%u,\"rst\":%u}",
+                  static_cast<unsigned>(fb.level), static_cast<unsigned>(fb.budgetUs), static_cast<unsigned>(fb.lastFrameUs),
+                  static_cast<unsigned>(fb.avgFrameUs), static_cast<unsigned>(fb.framesRendered), static_cast<unsigned>(fb.framesReused), static_cast<unsigned>(fb.framesIdle),
+                  static_cast<unsigned>(fb.framesOverBudget), static_cast<unsigned>(fb.degradeEvents), static_cast<unsigned>(fb.restoreEvents));
+}
+
+std::string_view CommandRouter::boot_json() {
+    // Milliseconds since the app started; 0 = not reached yet.
+    auto ms = [](int64_t us) { return static_cast<unsigned>(us / 1000); };
+    return reply("{\"type\":\"boot\",\"warm\":%d,\"nvs\":%u,\"disp\":%u,\"frame\":%u,\"imu\":%u,\"cal\":%u,\"cached\":%d,\"ble\":%u,\"adv\":%u}",
+                  boot_.warm ? 1 : 0, ms(boot_.nvs_us), ms(boot_.display_us), ms(boot_.first_frame_us), ms(boot_.imu_us),
+                  ms(boot_.imu_cal_us), boot_.gyro_cached ? 1 : 0, ms(boot_.ble_us), ms(ble_.first_advertising_us()));
+}
+
+std::string_view CommandRouter::sync_json(uint32_t now_ms) {
     const unsigned ble_window_ms = static_cast<unsigned>(std::max<uint32_t>(20000U, preferences_.getUInt("ble_win", 60000)));
-    std::snprintf(
-        buf, sizeof(buf),
+    return reply(
         "{\"type\":\"sync\",\"settings\":{\"ew\":%d,\"eh\":%d,\"es\":%d,\"er\":%d,\"mw\":%d,\"bi\":%d,\"gs\":%d,\"os\":%d,\"ss\":%d,\"ct\":%u,\"td\":%u,\"wp\":%u,\"pp\":%u},"
         "\"display\":{\"type\":\"%s\",\"addr\":\"0x%02X\"},"
         "\"state\":{\"shuf\":%d,\"mpu\":%d,\"clk\":%d},"
@@ -98,19 +169,19 @@ std::string CommandRouter::sync_json(uint32_t now_ms) const {
         static_cast<unsigned>(shuffle_.expr_min_ms() / 1000U), static_cast<unsigned>(shuffle_.expr_max_ms() / 1000U), static_cast<unsigned>(shuffle_.neutral_min_ms() / 1000U), static_cast<unsigned>(shuffle_.neutral_max_ms() / 1000U),
         eyes_.get_breathing_enabled() ? 1 : 0, eyes_.get_breathing_intensity(), eyes_.get_breathing_speed(),
         ble_window_ms, gestures_.settings_json().c_str());
-    return buf;
 }
 
-std::string CommandRouter::handle_settings(const std::string& params, uint32_t now_ms) {
+std::string_view CommandRouter::handle_settings(std::string_view params, uint32_t now_ms) {
     if (params.empty()) {
         return sync_json(now_ms);
     }
-    for (const auto& token_raw : split(params, ',')) {
+    std::string_view token_raw;
+    while (next_token(params, ',', token_raw)) {
         const auto token = trim(token_raw);
         const auto eq = token.find('=');
-        if (eq == std::string::npos) continue;
+        if (eq == std::string_view::npos) continue;
         const auto key = token.substr(0, eq);
-        const int value = std::atoi(token.substr(eq + 1).c_str());
+        const int value = to_int(token.substr(eq + 1));
         if (key == "ew") {
             eyes_.set_width(value, value);
             preferences_.putInt("ew", value);
@@ -154,16 +225,151 @@ std::string CommandRouter::handle_settings(const std::string& params, uint32_t n
     return "Settings applied & saved";
 }
 
-std::string CommandRouter::handle_shuffle(const std::string& params) {
+void CommandRouter::reseed(uint32_t seed) {
+    eyes_.seed_random(seed);
+    shuffle_.seed(seed);
+}
+
+void CommandRouter::record_settings_snapshot(uint32_t now_ms) {
+    // Everything Application::start() restores from NVS, as commands, so a
+    // replay that starts from defaults reaches the same state.
+    char buf[160];
+    std::snprintf(buf, sizeof(buf), "s:ew=%d,eh=%d,es=%d,er=%d,mw=%d,gs=%d,os=%d,ss=%d,td=%u",
+                  static_cast<int>(preferences_.getInt("ew", 36)), static_cast<int>(preferences_.getInt("eh", 36)),
+                  static_cast<int>(preferences_.getInt("es", 10)), static_cast<int>(preferences_.getInt("er", 8)),
+                  static_cast<int>(preferences_.getInt("mw", 20)), static_cast<int>(preferences_.getInt("gs", 6)),
+                  static_cast<int>(preferences_.getInt("os", 12)), static_cast<int>(preferences_.getInt("ss", 10)),
+                  static_cast<unsigned>(preferences_.getUInt("touch_ms", 3000)));
+    recorder_.record_command(now_ms, buf);
+
+    std::snprintf(buf, sizeof(buf), "br=%d", eyes_.get_breathing_enabled() ? 1 : 0);
+    recorder_.record_command(now_ms, buf);
+    std::snprintf(buf, sizeof(buf), "bri=%.9g", eyes_.get_breathing_intensity());
+    recorder_.record_command(now_ms, buf);
+    std::snprintf(buf, sizeof(buf), "brs=%.9g", eyes_.get_breathing_speed());
+    recorder_.record_command(now_ms, buf);
+
+    recorder_.record_command(now_ms, gestures_.inverted() ? "ginv=1" : "ginv=0");
+    recorder_.record_command(now_ms, "grt=" + std::to_string(gestures_.reaction_time_ms()));
+    recorder_.record_command(now_ms, "gcf=" + std::to_string(gestures_.confidence_percent()));
+    recorder_.record_command(now_ms, "gcd=" + std::to_string(gestures_.cooldown_ms()));
+    std::snprintf(buf, sizeof(buf), "gst=%.9g", gestures_.shake_threshold());
+    recorder_.record_command(now_ms, buf);
+    std::snprintf(buf, sizeof(buf), "gpt=%.9g", gestures_.pat_threshold());
+    recorder_.record_command(now_ms, buf);
+    std::snprintf(buf, sizeof(buf), "gvt=%.9g", gestures_.swipe_threshold());
+    recorder_.record_command(now_ms, buf);
+    std::snprintf(buf, sizeof(buf), "gtt=%.9g", gestures_.touch_threshold());
+    recorder_.record_command(now_ms, buf);
+    std::snprintf(buf, sizeof(buf), "gtd=%.9g", gestures_.pickup_tilt_deg());
+    recorder_.record_command(now_ms, buf);
+    for (int i = 0; i < 4; ++i) {
+        recorder_.record_command(now_ms, "ga=" + std::to_string(i) + ":" + gestures_.action(i));
+    }
+    recorder_.record_command(now_ms, gestures_.matching_enabled() ? "gm=1" : "gm=0");
+
+    std::snprintf(buf, sizeof(buf), "sh:expr=%u-%u,neutral=%u-%u,%s",
+                  static_cast<unsigned>(shuffle_.expr_min_ms() / 1000U), static_cast<unsigned>(shuffle_.expr_max_ms() / 1000U),
+                  static_cast<unsigned>(shuffle_.neutral_min_ms() / 1000U), static_cast<unsigned>(shuffle_.neutral_max_ms() / 1000U),
+                  shuffle_.enabled() ? "on" : "off");
+    if (shuffle_.expr_min_ms() == 1000 && shuffle_.expr_max_ms() == 2000 &&
+        shuffle_.neutral_min_ms() == 500 && shuffle_.neutral_max_ms() == 1500) {
+        std::snprintf(buf, sizeof(buf), "sh:quick,%s", shuffle_.enabled() ? "on" : "off");
+    } else if (shuffle_.expr_min_ms() == 4000 && shuffle_.expr_max_ms() == 8000 &&
+               shuffle_.neutral_min_ms() == 3000 && shuffle_.neutral_max_ms() == 6000) {
+        std::snprintf(buf, sizeof(buf), "sh:slow,%s", shuffle_.enabled() ? "on" : "off");
+    }
+    recorder_.record_command(now_ms, buf);
+}
+
+std::string_view CommandRouter::handle_record(std::string_view params, uint32_t now_ms) {
+    if (params.empty()) return reply_text(recorder_.status_json());
+    if (params == "start") {
+        const uint32_t seed = esp_random();
+        reseed(seed);
+        if (!recorder_.start(seed)) return "rec:err no memory";
+        recorder_.set_gyro_offsets(gestures_.gyro_offsets());
+        record_settings_snapshot(now_ms);
+        return reply_text(recorder_.status_json());
+    }
+    if (params == "boot") {
+        // Recording from boot captures the whole session, so replay needs no
+        // settings snapshot beyond what the host starts with.
+        preferences_.putBool("rec_boot", true);
+        esp_restart();
+        return "rec:boot";
+    }
+    if (params == "stop") {
+        recorder_.stop();
+        return reply_text(recorder_.status_json());
+    }
+    if (params == "clear") {
+        recorder_.clear();
+        return reply_text(recorder_.status_json());
+    }
+    if (starts_with(params, "dump=")) {
+        // Pages stay under ~2 KB so one response fits a few notify chunks.
+        constexpr size_t kPageChars = 2048;
+        const size_t offset = static_cast<size_t>(to_ulong(params.substr(5)));
+        if (offset >= recorder_.bytes()) {
+            return offset == 0 ? reply_text("rec:0\n" + recorder_.header_line()) : "rec:end";
+        }
+        std::string lines = offset == 0 ? recorder_.header_line() : std::string();
+        const size_t next = recorder_.export_text(offset, lines, kPageChars);
+        return reply_text("rec:" + std::to_string(next) + "\n" + lines);
+    }
+    return "rec: usage - start, boot, stop, clear, dump=<offset>";
+}
+
+std::string_view CommandRouter::handle_capture(std::string_view params, uint32_t now_ms) {
+    if (params.empty()) return reply_text(capture_.status_json());
+    if (!capture_.available()) return "cap:err no imutrace partition";
+    if (params == "start") {
+        capture_.start(gestures_.gyro_offsets(), now_ms);
+        return reply_text(capture_.status_json());
+    }
+    if (params == "stop") {
+        capture_.stop();
+        return reply_text(capture_.status_json());
+    }
+    if (params == "clear") {
+        capture_.clear();
+        return reply_text(capture_.status_json());
+    }
+    if (starts_with(params, "label=")) {
+        const std::string_view name = params.substr(6);
+        int label = -2;
+        if (name == "none") label = -1;
+        const char* names[] = {"pat", "shake", "swipe", "pickup"};
+        for (int i = 0; i < 4; ++i) {
+            if (name == names[i]) label = i;
+        }
+        if (label == -2) return "cap:label invalid. Use pat, shake, swipe, pickup or none";
+        if (!capture_.label(now_ms, label)) return "cap:err not capturing";
+        return reply("cap:label=%.*s", static_cast<int>(name.size()), name.data());
+    }
+    if (starts_with(params, "dump=")) {
+        // 1536 bytes is 2048 base64 characters, the same page size as rec:.
+        constexpr size_t kPageBytes = 1536;
+        capture_.flush();
+        const size_t offset = static_cast<size_t>(to_ulong(params.substr(5)));
+        if (offset >= capture_.dump_bytes()) return "cap:end";
+        std::string page;
+        const size_t next = capture_.export_base64(offset, page, kPageBytes);
+        return reply_text("cap:" + std::to_string(next) + "\n" + page);
+    }
+    return "cap: usage - start, stop, clear, label=<gesture|none>, dump=<offset>";
+}
+
+std::string_view CommandRouter::handle_shuffle(std::string_view params) {
     if (params.empty()) {
-        char buf[96];
-        std::snprintf(buf, sizeof(buf), "Shuffle: %s\nexpr=%u-%us\nneutral=%u-%us",
+        return reply("Shuffle: %s\nexpr=%u-%us\nneutral=%u-%us",
                       shuffle_.enabled() ? "ON" : "OFF",
                       static_cast<unsigned>(shuffle_.expr_min_ms() / 1000U), static_cast<unsigned>(shuffle_.expr_max_ms() / 1000U),
                       static_cast<unsigned>(shuffle_.neutral_min_ms() / 1000U), static_cast<unsigned>(shuffle_.neutral_max_ms() / 1000U));
-        return buf;
     }
-    for (const auto& token_raw : split(params, ',')) {
+    std::string_view token_raw;
+    while (next_token(params, ',', token_raw)) {
         const auto token = trim(token_raw);
         if (token == "on" || token == "1") {
             shuffle_.set_enabled(true);
@@ -179,29 +385,29 @@ std::string CommandRouter::handle_shuffle(const std::string& params) {
             shuffle_.set_enabled(true);
         } else if (starts_with(token, "expr=") || starts_with(token, "e=")) {
             const auto eq = token.find('=');
-            const std::string value = token.substr(eq + 1);
+            const std::string_view value = token.substr(eq + 1);
             const auto dash = value.find('-');
             uint32_t min_s = 1;
             uint32_t max_s = 1;
-            if (dash != std::string::npos) {
-                min_s = static_cast<uint32_t>(std::max(1, std::atoi(value.substr(0, dash).c_str())));
-                max_s = static_cast<uint32_t>(std::max(static_cast<int>(min_s), std::atoi(value.substr(dash + 1).c_str())));
+            if (dash != std::string_view::npos) {
+                min_s = static_cast<uint32_t>(std::max(1, to_int(value.substr(0, dash))));
+                max_s = static_cast<uint32_t>(std::max(static_cast<int>(min_s), to_int(value.substr(dash + 1))));
             } else {
-                min_s = static_cast<uint32_t>(std::max(1, std::atoi(value.c_str())));
+                min_s = static_cast<uint32_t>(std::max(1, to_int(value)));
                 max_s = min_s;
             }
             shuffle_.set_expr_range(min_s * 1000U, max_s * 1000U);
         } else if (starts_with(token, "neutral=") || starts_with(token, "n=")) {
             const auto eq = token.find('=');
-            const std::string value = token.substr(eq + 1);
+            const std::string_view value = token.substr(eq + 1);
             const auto dash = value.find('-');
             uint32_t min_s = 1;
             uint32_t max_s = 1;
-            if (dash != std::string::npos) {
-                min_s = static_cast<uint32_t>(std::max(1, std::atoi(value.substr(0, dash).c_str())));
-                max_s = static_cast<uint32_t>(std::max(static_cast<int>(min_s), std::atoi(value.substr(dash + 1).c_str())));
+            if (dash != std::string_view::npos) {
+                min_s = static_cast<uint32_t>(std::max(1, to_int(value.substr(0, dash))));
+                max_s = static_cast<uint32_t>(std::max(static_cast<int>(min_s), to_int(value.substr(dash + 1))));
             } else {
-                min_s = static_cast<uint32_t>(std::max(1, std::atoi(value.c_str())));
+                min_s = static_cast<uint32_t>(std::max(1, to_int(value)));
                 max_s = min_s;
             }
             shuffle_.set_neutral_range(min_s * 1000U, max_s * 1000U);
@@ -215,16 +421,16 @@ std::string CommandRouter::handle_shuffle(const std::string& params) {
     return handle_shuffle("");
 }
 
-std::string CommandRouter::handle_display(const std::string& params) {
+std::string_view CommandRouter::handle_display(std::string_view params) {
     if (starts_with(params, "type=")) {
-        const auto type = lower(trim(params.substr(5)));
+        const auto type = trim(params.substr(5));
         if (type == "ssd1306") {
-            preferences_.putString("disp_type", type);
+            preferences_.putString("disp_type", std::string(type));
             display_config_.controller = DisplayController::kSsd1306;
             return "display:type=ssd1306 saved. Restart required: send 'restart' command";
         }
         if (type == "sh1106") {
-            preferences_.putString("disp_type", type);
+            preferences_.putString("disp_type", std::string(type));
             display_config_.controller = DisplayController::kSh1106;
             return "display:type=sh1106 saved. Restart required: send 'restart' command";
         }
@@ -232,20 +438,20 @@ std::string CommandRouter::handle_display(const std::string& params) {
     }
     if (starts_with(params, "addr=")) {
         const auto raw = trim(params.substr(5));
-        const long value = std::strtol(raw.c_str(), nullptr, 16);
+        const long value = to_long(raw, 16);
         if (value >= 0 && value <= 0x7f) {
             display_config_.i2c_address = static_cast<uint8_t>(value);
             preferences_.putUInt("disp_addr", value);
-            return "display:addr=" + raw + " saved. Restart required: send 'restart' command";
+            return reply("display:addr=%.*s saved. Restart required: send 'restart' command", static_cast<int>(raw.size()), raw.data());
         }
         return "display:addr invalid. Use hex format: 0x3C or 0x3D";
     }
     if (starts_with(params, "contrast=")) {
-        const int value = std::atoi(params.substr(9).c_str());
+        const int value = to_int(params.substr(9));
         if (value >= 0 && value <= 255) {
             display_.set_contrast(static_cast<uint8_t>(value));
             preferences_.putUInt("disp_con", static_cast<uint32_t>(value));
-            return "display:contrast=" + std::to_string(value) + " saved";
+            return reply("display:contrast=%d saved", value);
         }
         return "display:contrast invalid. Use 0-255";
     }
@@ -263,155 +469,166 @@ std::string CommandRouter::handle_display(const std::string& params) {
         return "display:clear";
     }
     if (params == "info") {
-        char buf[128];
-        std::snprintf(buf, sizeof(buf), "Display: %s @ 0x%02X (%dx%d)", display_config_.controller == DisplayController::kSsd1306 ? "SSD1306" : "SH1106", display_config_.i2c_address, display_.width(), display_.height());
-        return buf;
+        return reply("Display: %s @ 0x%02X (%dx%d)", display_config_.controller == DisplayController::kSsd1306 ? "SSD1306" : "SH1106", display_config_.i2c_address, display_.width(), display_.height());
     }
     return "display: usage - type=<sh1106|ssd1306>, addr=<hex>, contrast=<0-255>, test, clear, info";
 }
 
-std::string CommandRouter::handle_clock(const std::string& params, uint32_t now_ms) {
-    if (params.empty()) return clock_.status_string(ble_.connected());
+std::string_view CommandRouter::handle_clock(std::string_view params, uint32_t now_ms) {
+    if (params.empty()) return reply_text(clock_.status_string(ble_.connected()));
     if (params == "on") {
         clock_.set_enabled(true);
         preferences_.putBool("clk_on", true);
-        return clock_.status_string(ble_.connected());
+        return reply_text(clock_.status_string(ble_.connected()));
     }
     if (params == "off") {
         clock_.set_enabled(false);
         preferences_.putBool("clk_on", false);
-        return clock_.status_string(ble_.connected());
+        return reply_text(clock_.status_string(ble_.connected()));
     }
     if (starts_with(params, "fmt=")) {
-        const int fmt = std::atoi(params.substr(4).c_str());
+        const int fmt = to_int(params.substr(4));
         if (fmt == 12 || fmt == 24) {
             clock_.set_use_24_hour(fmt == 24);
             preferences_.putBool("clk_24", fmt == 24);
-            return clock_.status_string(ble_.connected());
+            return reply_text(clock_.status_string(ble_.connected()));
         }
         return "clock:fmt invalid. Use 12 or 24";
     }
     if (starts_with(params, "sync=")) {
         const auto value = params.substr(5);
         const auto comma = value.find(',');
-        const uint64_t epoch = std::strtoull(value.substr(0, comma).c_str(), nullptr, 10);
-        const int16_t tz = comma == std::string::npos ? 0 : static_cast<int16_t>(std::atoi(value.substr(comma + 1).c_str()));
+        const uint64_t epoch = to_ull(value.substr(0, comma));
+        const int16_t tz = comma == std::string_view::npos ? 0 : static_cast<int16_t>(to_int(value.substr(comma + 1)));
         clock_.set_from_epoch_ms(epoch, tz);
         preferences_.putULong64("clk_epoch", epoch);
         preferences_.putInt("clk_tz", tz);
         preferences_.putUInt("clk_sec", clock_.seconds_of_day());
-        return clock_.status_string(ble_.connected());
+        return reply_text(clock_.status_string(ble_.connected()));
     }
     if (starts_with(params, "set=")) {
-        const auto parts = split(params.substr(4), ':');
-        if (parts.size() < 2) return "clock:set invalid. Use HH:MM or HH:MM:SS";
-        const int hh = std::atoi(parts[0].c_str());
-        const int mm = std::atoi(parts[1].c_str());
-        const int ss = parts.size() > 2 ? std::atoi(parts[2].c_str()) : 0;
+        std::string_view rest = params.substr(4);
+        std::string_view parts[3];
+        size_t count = 0;
+        while (count < 3 && next_token(rest, ':', parts[count])) ++count;
+        if (count < 2) return "clock:set invalid. Use HH:MM or HH:MM:SS";
+        const int hh = to_int(parts[0]);
+        const int mm = to_int(parts[1]);
+        const int ss = count > 2 ? to_int(parts[2]) : 0;
         if (hh < 0 || hh > 23 || mm < 0 || mm > 59 || ss < 0 || ss > 59) return "clock:set invalid. Use HH:MM or HH:MM:SS";
         clock_.set_time_of_day(static_cast<uint8_t>(hh), static_cast<uint8_t>(mm), static_cast<uint8_t>(ss));
         preferences_.putUInt("clk_sec", hh * 3600U + mm * 60U + ss);
         preferences_.putULong64("clk_epoch", 0);
-        return clock_.status_string(ble_.connected());
+        return reply_text(clock_.status_string(ble_.connected()));
     }
     return "clock: usage - on, off, set=HH:MM[:SS], sync=EPOCH_MS[,TZ], fmt=12|24";
 }
 
-std::string CommandRouter::handle(std::string cmd, uint32_t now_ms, bool is_manual) {
-    cmd = trim(cmd);
-    if (cmd.empty()) return "Empty command";
-    cmd = lower(cmd);
-
-    auto set_expression = [&](int mood, int gaze, int mouth_type) {
+void CommandRouter::dispatch(Action action, bool is_manual) {
+    auto set_expression = [&](int mood, int gaze, int mouth_type, Expression expression) {
         reset_effects();
         eyes_.set_mood(mood);
         eyes_.set_position(gaze);
         eyes_.set_mouth_type(mouth_type);
-        if (is_manual) shuffle_.reset();
+        eyes_.setExpression(expression);
     };
 
-    if (cmd == "happy") { set_expression(HAPPY, 0, 1); eyes_.setExpression(EXPR_HAPPY); return "Expression: Happy"; }
-    if (cmd == "sad") { set_expression(TIRED, 0, 2); eyes_.setExpression(EXPR_SAD); return "Expression: Sad"; }
-    if (cmd == "angry") { set_expression(ANGRY, 0, 5); eyes_.setExpression(EXPR_ANGRY); return "Expression: Angry"; }
-    if (cmd == "love") { set_expression(DEFAULT, 0, 3); eyes_.setExpression(EXPR_NORMAL); eyes_.anim_love(); return "Expression: Love"; }
-    if (cmd == "surprised") { set_expression(DEFAULT, 0, 4); eyes_.setExpression(EXPR_SURPRISED); eyes_.blink(); return "Expression: Surprised"; }
-    if (cmd == "confused") { set_expression(DEFAULT, 0, 4); eyes_.setExpression(EXPR_NORMAL); eyes_.anim_confused(); return "Expression: Confused"; }
-    if (cmd == "sleepy") { set_expression(TIRED, POS_SW, 5); eyes_.setExpression(EXPR_SLEEPY); return "Expression: Sleepy"; }
-    if (cmd == "curious") { set_expression(DEFAULT, 0, 4); eyes_.setExpression(EXPR_NORMAL); eyes_.set_curiosity(true); return "Expression: Curious"; }
-    if (cmd == "nervous") { set_expression(DEFAULT, 0, 9); eyes_.setExpression(EXPR_WORRIED); eyes_.set_sweat(true); eyes_.set_curiosity(true); return "Expression: Nervous"; }
-    if (cmd == "knocked" || cmd == "dizzy") { reset_effects(); eyes_.set_knocked(true); return "Expression: Knocked"; }
-    if (cmd == "neutral" || cmd == "normal" || cmd == "reset") { set_expression(DEFAULT, 0, 1); eyes_.setExpression(EXPR_NORMAL); return "Expression: Neutral"; }
-    if (cmd == "idle") { set_expression(DEFAULT, 0, 1); eyes_.setExpression(EXPR_NORMAL); eyes_.set_idle_mode(true, 1, 2); return "Mode: Idle"; }
-    if (cmd == "raised") { set_expression(DEFAULT, 0, 4); eyes_.setExpression(EXPR_NORMAL); eyes_.set_eyebrows(true); return "Expression: Raised eyebrows"; }
-    // New esp32-eyes expressions
-    if (cmd == "glee") { set_expression(HAPPY, 0, 1); eyes_.setExpression(EXPR_GLEE); return "Expression: Glee"; }
-    if (cmd == "worried") { set_expression(DEFAULT, 0, 9); eyes_.setExpression(EXPR_WORRIED); return "Expression: Worried"; }
-    if (cmd == "focused") { set_expression(DEFAULT, 0, 5); eyes_.setExpression(EXPR_FOCUSED); return "Expression: Focused"; }
-    if (cmd == "annoyed") { set_expression(DEFAULT, 0, 9); eyes_.setExpression(EXPR_ANNOYED); return "Expression: Annoyed"; }
-    if (cmd == "skeptic") { set_expression(DEFAULT, 0, 2); eyes_.setExpression(EXPR_SKEPTIC); return "Expression: Skeptic"; }
-    if (cmd == "frustrated") { set_expression(DEFAULT, 0, 9); eyes_.setExpression(EXPR_FRUSTRATED); return "Expression: Frustrated"; }
-    if (cmd == "unimpressed") { set_expression(DEFAULT, 0, 2); eyes_.setExpression(EXPR_UNIMPRESSED); return "Expression: Unimpressed"; }
-    if (cmd == "suspicious") { set_expression(DEFAULT, 0, 4); eyes_.setExpression(EXPR_SUSPICIOUS); return "Expression: Suspicious"; }
-    if (cmd == "squint") { set_expression(DEFAULT, 0, 4); eyes_.setExpression(EXPR_SQUINT); return "Expression: Squint"; }
-    if (cmd == "furious") { set_expression(ANGRY, 0, 9); eyes_.setExpression(EXPR_FURIOUS); return "Expression: Furious"; }
-    if (cmd == "scared") { set_expression(DEFAULT, 0, 10); eyes_.setExpression(EXPR_SCARED); return "Expression: Scared"; }
-    if (cmd == "awe") { set_expression(DEFAULT, 0, 10); eyes_.setExpression(EXPR_AWE); return "Expression: Awe"; }
-    auto set_mouth = [&](int type, const char* name) {
-        eyes_.set_mouth_type(type);
-        if (is_manual) shuffle_.reset();
-        return std::string("Mouth: ") + name;
-    };
+    switch (action) {
+        case Action::kNone:
+        case Action::kCommand:
+            return;
+        case Action::kHappy: set_expression(HAPPY, 0, 1, EXPR_HAPPY); break;
+        case Action::kSad: set_expression(TIRED, 0, 2, EXPR_SAD); break;
+        case Action::kAngry: set_expression(ANGRY, 0, 5, EXPR_ANGRY); break;
+        case Action::kLove: set_expression(DEFAULT, 0, 3, EXPR_NORMAL); eyes_.anim_love(); break;
+        case Action::kSurprised: set_expression(DEFAULT, 0, 4, EXPR_SURPRISED); eyes_.blink(); break;
+        case Action::kConfused: set_expression(DEFAULT, 0, 4, EXPR_NORMAL); eyes_.anim_confused(); break;
+        case Action::kSleepy: set_expression(TIRED, POS_SW, 5, EXPR_SLEEPY); break;
+        case Action::kCurious: set_expression(DEFAULT, 0, 4, EXPR_NORMAL); eyes_.set_curiosity(true); break;
+        case Action::kNervous: set_expression(DEFAULT, 0, 9, EXPR_WORRIED); eyes_.set_sweat(true); eyes_.set_curiosity(true); break;
+        // Knocked keeps the current mood and leaves the shuffle alone.
+        case Action::kKnocked: reset_effects(); eyes_.set_knocked(true); return;
+        case Action::kNeutral: set_expression(DEFAULT, 0, 1, EXPR_NORMAL); break;
+        case Action::kIdle: set_expression(DEFAULT, 0, 1, EXPR_NORMAL); eyes_.set_idle_mode(true, 1, 2); break;
+        case Action::kRaised: set_expression(DEFAULT, 0, 4, EXPR_NORMAL); eyes_.set_eyebrows(true); break;
+        // esp32-eyes expressions
+        case Action::kGlee: set_expression(HAPPY, 0, 1, EXPR_GLEE); break;
+        case Action::kWorried: set_expression(DEFAULT, 0, 9, EXPR_WORRIED); break;
+        case Action::kFocused: set_expression(DEFAULT, 0, 5, EXPR_FOCUSED); break;
+        case Action::kAnnoyed: set_expression(DEFAULT, 0, 9, EXPR_ANNOYED); break;
+        case Action::kSkeptic: set_expression(DEFAULT, 0, 2, EXPR_SKEPTIC); break;
+        case Action::kFrustrated: set_expression(DEFAULT, 0, 9, EXPR_FRUSTRATED); break;
+        case Action::kUnimpressed: set_expression(DEFAULT, 0, 2, EXPR_UNIMPRESSED); break;
+        case Action::kSuspicious: set_expression(DEFAULT, 0, 4, EXPR_SUSPICIOUS); break;
+        case Action::kSquint: set_expression(DEFAULT, 0, 4, EXPR_SQUINT); break;
+        case Action::kFurious: set_expression(ANGRY, 0, 9, EXPR_FURIOUS); break;
+        case Action::kScared: set_expression(DEFAULT, 0, 10, EXPR_SCARED); break;
+        case Action::kAwe: set_expression(DEFAULT, 0, 10, EXPR_AWE); break;
+        case Action::kSmile: eyes_.set_mouth_type(1); break;
+        case Action::kFrown: eyes_.set_mouth_type(2); break;
+        case Action::kOpen: eyes_.set_mouth_type(3); break;
+        case Action::kOoo: eyes_.set_mouth_type(4); break;
+        case Action::kFlat: eyes_.set_mouth_type(5); break;
+        case Action::kUwu: eyes_.trigger_uwu(); break;
+        case Action::kXd: eyes_.trigger_xd(); break;
+        case Action::kUwuMouth: eyes_.set_mouth_type(6); break;
+        case Action::kXdMouth: eyes_.set_mouth_type(7); break;
+        case Action::kSmirk: eyes_.set_mouth_type(8); break;
+        case Action::kZigzag: eyes_.set_mouth_type(9); break;
+        case Action::kBigO: eyes_.set_mouth_type(10); break;
+        case Action::kBlink: eyes_.blink(); break;
+        case Action::kWink: eyes_.wink(true); eyes_.set_mouth_type(1); break;
+        case Action::kWinkRight: eyes_.wink(false); eyes_.set_mouth_type(1); break;
+        case Action::kLaugh: eyes_.anim_laugh(); break;
+        case Action::kCry: eyes_.anim_cry(); break;
+    }
+    if (is_manual) shuffle_.reset();
+}
+
+std::string_view CommandRouter::handle(std::string_view text, uint32_t now_ms) {
+    text = trim(text);
+    if (text.empty()) return "Empty command";
+    if (text.size() >= sizeof(cmd_)) return "Command too long";
+    for (size_t i = 0; i < text.size(); ++i) {
+        cmd_[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(text[i])));
+    }
+    cmd_[text.size()] = '\0';
+    const std::string_view cmd(cmd_, text.size());
+
+    const Action action = action_from_name(cmd);
+    if (action != Action::kNone) {
+        dispatch(action, true);
+        return action_reply(action);
+    }
+
     auto set_pos = [&](int pos, const char* name) {
         eyes_.set_position(pos);
-        if (is_manual) shuffle_.reset();
-        return std::string("Position: ") + name;
-    };
-    auto do_action = [&](auto func, const char* name) {
-        func();
-        if (is_manual) shuffle_.reset();
-        return std::string("Action: ") + name;
+        shuffle_.reset();
+        return reply("Position: %s", name);
     };
 
-    if (cmd == "smile") return set_mouth(1, "Smile");
-    if (cmd == "frown") return set_mouth(2, "Frown");
-    if (cmd == "open") return set_mouth(3, "Open");
-    if (cmd == "ooo") return set_mouth(4, "Ooo");
-    if (cmd == "flat") return set_mouth(5, "Flat");
-    if (cmd == "uwu") return do_action([&]{ eyes_.trigger_uwu(); }, "UwU");
-    if (cmd == "xd") return do_action([&]{ eyes_.trigger_xd(); }, "XD");
-    if (cmd == "uwum") return set_mouth(6, "UwU");
-    if (cmd == "xdm") return set_mouth(7, "XD");
-    if (cmd == "smirk") return set_mouth(8, "Smirk");
-    if (cmd == "zigzag") return set_mouth(9, "Zigzag");
-    if (cmd == "bigo") return set_mouth(10, "Big O");
     if (starts_with(cmd, "talk")) {
         uint32_t duration = 3000;
         const auto pos = cmd.find(' ');
-        if (pos != std::string::npos) duration = static_cast<uint32_t>(std::max(100, std::atoi(cmd.substr(pos + 1).c_str())));
+        if (pos != std::string_view::npos) duration = static_cast<uint32_t>(std::max(100, to_int(cmd.substr(pos + 1))));
         eyes_.start_mouth_anim(1, duration);
         return "Mouth: Talking";
     }
     if (starts_with(cmd, "chew")) {
         uint32_t duration = 2000;
         const auto pos = cmd.find(' ');
-        if (pos != std::string::npos) duration = static_cast<uint32_t>(std::max(100, std::atoi(cmd.substr(pos + 1).c_str())));
+        if (pos != std::string_view::npos) duration = static_cast<uint32_t>(std::max(100, to_int(cmd.substr(pos + 1))));
         eyes_.start_mouth_anim(2, duration);
         return "Mouth: Chewing";
     }
     if (starts_with(cmd, "wobble")) {
         uint32_t duration = 2000;
         const auto pos = cmd.find(' ');
-        if (pos != std::string::npos) duration = static_cast<uint32_t>(std::max(100, std::atoi(cmd.substr(pos + 1).c_str())));
+        if (pos != std::string_view::npos) duration = static_cast<uint32_t>(std::max(100, to_int(cmd.substr(pos + 1))));
         eyes_.start_mouth_anim(3, duration);
         return "Mouth: Wobbling";
     }
 
-    if (cmd == "blink") return do_action([&]{ eyes_.blink(); }, "Blink");
-    if (cmd == "wink") return do_action([&]{ eyes_.wink(true); eyes_.set_mouth_type(1); }, "Wink");
-    if (cmd == "winkr") return do_action([&]{ eyes_.wink(false); eyes_.set_mouth_type(1); }, "Wink Right");
-    if (cmd == "laugh") return do_action([&]{ eyes_.anim_laugh(); }, "Laugh");
-    if (cmd == "cry") return do_action([&]{ eyes_.anim_cry(); }, "Cry");
-
     if (cmd == "center") return set_pos(0, "Center");
     if (cmd == "n" || cmd == "up") return set_pos(POS_N, "North");
     if (cmd == "ne") return set_pos(POS_NE, "North-East");
@@ -425,14 +642,12 @@ std::string CommandRouter::handle(std::string cmd, uint32_t now_ms, bool is_manu
     if (cmd == "sweat") { eyes_.set_sweat(true); return "Sweat: ON"; }
     if (cmd == "cyclops") { eyes_.set_cyclops(true); return "Cyclops: ON"; }
     if (cmd == "br:") {
-        char buf[64];
-        std::snprintf(buf, sizeof(buf), "br:%s i=%.2f s=%.2f", eyes_.get_breathing_enabled() ? "on" : "off", eyes_.get_breathing_intensity(), eyes_.get_breathing_speed());
-        return buf;
+        return reply("br:%s i=%.2f s=%.2f", eyes_.get_breathing_enabled() ? "on" : "off", eyes_.get_breathing_intensity(), eyes_.get_breathing_speed());
     }
-    if (starts_with(cmd, "br=")) { const bool on = std::atoi(cmd.substr(3).c_str()) == 1; eyes_.set_breathing(on); preferences_.putBool("br_en", on); return on ? "Breathing: ON" : "Breathing: OFF"; }
+    if (starts_with(cmd, "br=")) { const bool on = to_int(cmd.substr(3)) == 1; eyes_.set_breathing(on); preferences_.putBool("br_en", on); return on ? "Breathing: ON" : "Breathing: OFF"; }
     if (cmd == "br") { const bool on = !eyes_.get_breathing_enabled(); eyes_.set_breathing(on); preferences_.putBool("br_en", on); return on ? "Breathing: ON" : "Breathing: OFF"; }
-    if (starts_with(cmd, "bri=")) { const float value = std::strtof(cmd.substr(4).c_str(), nullptr); eyes_.set_breathing_intensity(value); preferences_.putFloat("br_int", value); return "Breathing intensity updated"; }
-    if (starts_with(cmd, "brs=")) { const float value = std::strtof(cmd.substr(4).c_str(), nullptr); eyes_.set_breathing_speed(value); preferences_.putFloat("br_spd", value); return "Breathing speed updated"; }
+    if (starts_with(cmd, "bri=")) { const float value = to_float(cmd.substr(4)); eyes_.set_breathing_intensity(value); preferences_.putFloat("br_int", value); return "Breathing intensity updated"; }
+    if (starts_with(cmd, "brs=")) { const float value = to_float(cmd.substr(4)); eyes_.set_breathing_speed(value); preferences_.putFloat("br_spd", value); return "Breathing speed updated"; }
     if (cmd == "mouth") { eyes_.set_mouth_enabled(false); return "Mouth toggled"; }
     if (cmd == "mpulog") { mpu_verbose_ = !mpu_verbose_; return mpu_verbose_ ? "MPU verbose ON" : "MPU verbose OFF"; }
 
@@ -441,8 +656,8 @@ std::string CommandRouter::handle(std::string cmd, uint32_t now_ms, bool is_manu
     if (starts_with(cmd, "ga=")) {
         const auto params = cmd.substr(3);
         const auto pos = params.find(':');
-        if (pos != std::string::npos) {
-            gestures_.set_action(std::atoi(params.substr(0, pos).c_str()), trim(params.substr(pos + 1)));
+        if (pos != std::string_view::npos) {
+            gestures_.set_action(to_int(params.substr(0, pos)), std::string(trim(params.substr(pos + 1))));
             std::string actions_csv;
             for (int i = 0; i < 4; ++i) {
                 actions_csv += gestures_.action(i);
@@ -454,67 +669,86 @@ std::string CommandRouter::handle(std::string cmd, uint32_t now_ms, bool is_manu
         return "ga:err";
     }
     if (starts_with(cmd, "ginv=")) {
-        const bool inv = std::atoi(cmd.substr(5).c_str()) == 1;
+        const bool inv = to_int(cmd.substr(5)) == 1;
         gestures_.set_inverted(inv);
         preferences_.putBool("ginv", inv);
         return inv ? "ginv=1" : "ginv=0";
     }
     if (starts_with(cmd, "gm=")) {
-        const bool on = std::atoi(cmd.substr(3).c_str()) == 1;
+        const bool on = to_int(cmd.substr(3)) == 1;
         gestures_.set_matching_enabled(on);
         preferences_.putBool("gm", on);
         return on ? "gm=1" : "gm=0";
     }
     if (cmd == "gc") return "gc:ok";
-    if (cmd == "gi") return gestures_.list_json();
-    if (cmd == "gs:") return gestures_.settings_json();
+    if (cmd == "gi") return reply_text(gestures_.list_json());
+    if (cmd == "gs:") return reply_text(gestures_.settings_json());
+    if (cmd == "gf:") return reply_text(gestures_.features_json());
+    if (starts_with(cmd, "gf=")) {
+        const bool on = to_int(cmd.substr(3)) == 1;
+        gestures_.set_window_reports(on);
+        return on ? "gf=1" : "gf=0";
+    }
+    if (starts_with(cmd, "ged=")) {
+        const bool on = to_int(cmd.substr(4)) == 1;
+        gestures_.set_early_decisions(on);
+        return on ? "ged=1" : "ged=0";
+    }
+    if (cmd == "gl:") return reply_text(gestures_.latency_json());
+    if (cmd == "gl:reset") { gestures_.reset_latency(); return "gl:reset"; }
+    if (cmd == "gb:") return reply_text(gestures_.bias_json());
+    if (cmd == "gb:clear") {
+        gestures_.clear_bias_table();
+        preferences_.remove(GyroBiasTable::kPrefsKey);
+        return "gb:clear";
+    }
     if (starts_with(cmd, "grt=")) {
-        const int val = std::atoi(cmd.substr(4).c_str());
+        const int val = to_int(cmd.substr(4));
         gestures_.set_reaction_time(val);
         preferences_.putUInt("grt", val);
-        return "rt=" + std::to_string(gestures_.reaction_time_ms());
+        return reply("rt=%u", static_cast<unsigned>(gestures_.reaction_time_ms()));
     }
     if (starts_with(cmd, "gcf=")) {
-        const int val = std::atoi(cmd.substr(4).c_str());
+        const int val = to_int(cmd.substr(4));
         gestures_.set_confidence(val);
         preferences_.putUInt("gcf", val);
-        return "cf=" + std::to_string(gestures_.confidence_percent());
+        return reply("cf=%u", static_cast<unsigned>(gestures_.confidence_percent()));
     }
     if (starts_with(cmd, "gcd=")) {
-        const int val = std::atoi(cmd.substr(4).c_str());
+        const int val = to_int(cmd.substr(4));
         gestures_.set_cooldown(val);
         preferences_.putUInt("gcd", val);
-        return "cd=" + std::to_string(gestures_.cooldown_ms());
+        return reply("cd=%u", static_cast<unsigned>(gestures_.cooldown_ms()));
     }
     if (starts_with(cmd, "gst=")) {
-        const float val = std::atof(cmd.substr(4).c_str());
+        const float val = static_cast<float>(to_double(cmd.substr(4)));
         gestures_.set_shake_threshold(val);
         preferences_.putFloat("gst", val);
-        return "gst=" + std::to_string(val);
+        return reply("gst=%f", val);
     }
     if (starts_with(cmd, "gpt=")) {
-        const float val = std::atof(cmd.substr(4).c_str());
+        const float val = static_cast<float>(to_double(cmd.substr(4)));
         gestures_.set_pat_threshold(val);
         preferences_.putFloat("gpt", val);
-        return "gpt=" + std::to_string(val);
+        return reply("gpt=%f", val);
     }
     if (starts_with(cmd, "gvt=")) {
-        const float val = std::atof(cmd.substr(4).c_str());
+        const float val = static_cast<float>(to_double(cmd.substr(4)));
         gestures_.set_swipe_threshold(val);
         preferences_.putFloat("gvt", val);
-        return "gvt=" + std::to_string(val);
+        return reply("gvt=%f", val);
     }
     if (starts_with(cmd, "gtt=")) {
-        const float val = std::atof(cmd.substr(4).c_str());
+        const float val = static_cast<float>(to_double(cmd.substr(4)));
         gestures_.set_touch_threshold(val);
         preferences_.putFloat("gtt", val);
-        return "gtt=" + std::to_string(val);
+        return reply("gtt=%f", val);
     }
     if (starts_with(cmd, "gtd=")) {
-        const float val = std::atof(cmd.substr(4).c_str());
+        const float val = static_cast<float>(to_double(cmd.substr(4)));
         gestures_.set_pickup_tilt_deg(val);
         preferences_.putFloat("gtd", val);
-        return "gtd=" + std::to_string(val);
+        return reply("gtd=%f", val);
     }
 
     // Per-gesture calibration commands
@@ -540,7 +774,7 @@ std::string CommandRouter::handle(std::string cmd, uint32_t now_ms, bool is_manu
     }
     if (cmd == "gcal:status") {
         if (!gestures_.calibrating()) return "gcal:status — idle (no calibration running)";
-        std::string json = gestures_.calibration_status_json();
+        const std::string_view json = reply_text(gestures_.calibration_status_json());
         // Persist on completion
         if (gestures_.calibration_phase() == CalibrationPhase::kComplete) {
             int idx = gestures_.calibration_gesture_index();
@@ -556,26 +790,99 @@ std::string CommandRouter::handle(std::string cmd, uint32_t now_ms, bool is_manu
         return json;
     }
 
-    if (cmd == "ble:") return std::string("ble:win=") + std::to_string(std::max<uint32_t>(20000U, preferences_.getUInt("ble_win", 60000)));
+    if (cmd == "ble:") return reply("ble:win=%u", static_cast<unsigned>(std::max<uint32_t>(20000U, preferences_.getUInt("ble_win", 60000))));
     if (starts_with(cmd, "ble:win=")) {
-        const int window_ms = std::atoi(cmd.substr(8).c_str());
+        const int window_ms = to_int(cmd.substr(8));
         const int clamped_ms = std::max(20000, std::min(window_ms, 600000));
         preferences_.putUInt("ble_win", static_cast<uint32_t>(clamped_ms));
-        return "ble:win=" + std::to_string(clamped_ms);
+        return reply("ble:win=%d", clamped_ms);
     }
-    if (cmd == "ble:name") return "ble:name=" + preferences_.getString("ble_name", "Leor");
+    if (cmd == "ble:name") return reply("ble:name=%s", preferences_.getString("ble_name", "Leor").c_str());
     if (starts_with(cmd, "ble:name=")) {
         const auto name = trim(cmd.substr(9));
-        preferences_.putString("ble_name", name);
-        return "ble:name=" + name + " saved. Reconnect now; restart if not visible.";
+        preferences_.putString("ble_name", std::string(name));
+        return reply("ble:name=%.*s saved. Reconnect now; restart if not visible.", static_cast<int>(name.size()), name.data());
+    }
+    if (cmd == "tw:") return reply("tw:pin=%u active=high hold=%ums", static_cast<unsigned>(preferences_.getUInt("wake_pin", 0)), static_cast<unsigned>(power_.hold_ms()));
+    if (cmd == "fb:") return frame_budget_json();
+    if (cmd == "fb:reset") { eyes_.resetFrameBudgetStats(); return "fb:reset"; }
+    if (starts_with(cmd, "fb:budget=")) {
+        const int budget_us = std::max(1000, std::min(to_int(cmd.substr(10)), 100000));
+        eyes_.set_frame_budget(static_cast<uint32_t>(budget_us));
+        return reply("fb:budget=%d", budget_us);
+    }
+    if (cmd == "fps:") return reply_text(governor_.stats_json(now_ms));
+    if (cmd == "fps:reset") { governor_.reset_stats(now_ms); return "fps:reset"; }
+    if (starts_with(cmd, "fps:max=")) {
+        const int hz = std::max(0, std::min(to_int(cmd.substr(8)), 60));
+        governor_.set_max_hz(static_cast<uint32_t>(hz));
+        return reply("fps:max=%d", hz);
+    }
+    if (cmd == "loop:") return reply_text(loop_.json());
+    if (cmd == "loop:reset") { loop_.reset(); return "loop:reset"; }
+    if (starts_with(cmd, "loop:notify=")) {
+        const uint32_t misses = static_cast<uint32_t>(std::max(0, to_int(cmd.substr(12))));
+        loop_.set_alert_threshold(misses);
+        preferences_.putUInt("loop_ntf", misses);
+        return reply("loop:notify=%u", static_cast<unsigned>(misses));
+    }
+    if (cmd == "pm:") return reply_text(power_policy_.stats_json(now_us()));
+    if (cmd == "pm:reset") { power_policy_.reset_stats(now_us()); return "pm:reset"; }
+    if (starts_with(cmd, "pm:max=")) {
+        const int mhz = to_int(cmd.substr(7));
+        if (!power_policy_.set_max_mhz(static_cast<uint32_t>(std::max(0, mhz)))) return "pm:max invalid. Use 80 or 160";
+        preferences_.putUInt("pm_max", static_cast<uint32_t>(mhz));
+        return reply("pm:max=%d", mhz);
+    }
+    if (cmd == "imu:") return reply_text(gestures_.imu_stats_json());
+    if (cmd == "imu:bench") return reply_text(mahony_bench_json(500));
+    if (starts_with(cmd, "imu:int=")) {
+        const int pin = to_int(cmd.substr(8));
+        if (pin < -1 || pin > 21) return "imu:int invalid. Use a GPIO 0-21, or -1 for none";
+        preferences_.putInt("imu_int", pin);
+        return reply("imu:int=%d saved. Restart to apply.", pin);
+    }
+    if (cmd == "imu:wake") return reply_text(motion_wake_.status_json());
+    if (starts_with(cmd, "imu:wake=")) {
+        const bool on = to_int(cmd.substr(9)) == 1;
+        motion_wake_.set_enabled(on);
+        preferences_.putBool("iw_on", on);
+        if (on && !motion_wake_.usable()) return "imu:wake=1 saved, but imu:int is not a deep-sleep wake pin (GPIO 0-5)";
+        return on ? "imu:wake=1" : "imu:wake=0";
+    }
+    if (starts_with(cmd, "imu:wake:thr=")) {
+        motion_wake_.set_threshold_mg(static_cast<uint16_t>(std::max(0, std::min(to_int(cmd.substr(13)), 1000))));
+        preferences_.putUInt("iw_thr", motion_wake_.threshold_mg());
+        return reply("imu:wake:thr=%u", static_cast<unsigned>(motion_wake_.threshold_mg()));
+    }
+    if (starts_with(cmd, "imu:wake:tilt=")) {
+        motion_wake_.set_tilt_deg(static_cast<uint8_t>(std::max(0, std::min(to_int(cmd.substr(14)), 90))));
+        preferences_.putUInt("iw_tilt", motion_wake_.tilt_deg());
+        return reply("imu:wake:tilt=%u", static_cast<unsigned>(motion_wake_.tilt_deg()));
+    }
+    if (cmd == "boot:") return boot_json();
+    if (cmd == "perf:") return reply_text(perf_json());
+    if (cmd == "perf:reset") { perf_reset(); return "perf:reset"; }
+    if (cmd == "heap:") return reply_text(heap_json());
+    if (cmd == "heap:reset") { heap_reset(); return "heap:reset"; }
+    if (cmd == "trace:") return reply_text(trace_status_json());
+    if (cmd == "trace:clear") { trace_clear(); return "trace:clear"; }
+    if (starts_with(cmd, "trace:dump=")) return reply_text(trace_dump(static_cast<uint32_t>(to_ulong(cmd.substr(11)))));
+    if (cmd == "cap" || starts_with(cmd, "cap:")) return handle_capture(cmd.size() > 4 ? trim(cmd.substr(4)) : std::string_view(), now_ms);
+    if (cmd == "rec" || starts_with(cmd, "rec:")) return handle_record(cmd.size() > 4 ? trim(cmd.substr(4)) : std::string_view(), now_ms);
+    if (cmd == "rng:") return reply("rng:seed=%u", static_cast<unsigned>(preferences_.getUInt("rng_seed", 0)));
+    if (starts_with(cmd, "rng:seed=")) {
+        const uint32_t seed = static_cast<uint32_t>(to_ulong(cmd.substr(9)));
+        preferences_.putUInt("rng_seed", seed);
+        reseed(seed != 0 ? seed : esp_random());
+        return reply("rng:seed=%u", static_cast<unsigned>(seed));
     }
-    if (cmd == "tw:") return "tw:pin=" + std::to_string(preferences_.getUInt("wake_pin", 0)) + " active=high hold=" + std::to_string(power_.hold_ms()) + "ms";
     if (starts_with(cmd, "sh:") || starts_with(cmd, "shuffle:")) return handle_shuffle(cmd.substr(cmd[2] == ':' ? 3 : 8));
     if (starts_with(cmd, "display:")) return handle_display(trim(cmd.substr(8)));
     if (starts_with(cmd, "clock:")) return handle_clock(trim(cmd.substr(6)), now_ms);
     if (cmd == "restart" || cmd == "reboot") { esp_restart(); return "Restarting..."; }
     if (cmd == "help" || cmd == "?") return "help";
-    return "Unknown: " + cmd;
+    return reply("Unknown: %.*s", static_cast<int>(cmd.size()), cmd.data());
 }
 
 }  // namespace leor
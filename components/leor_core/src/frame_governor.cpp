@@ -0,0 +1,93 @@
+#include "leor/frame_governor.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace leor {
+
+namespace {
+
+constexpr const char *kRateNames[] = {"fast", "normal", "slow", "idle"};
+
+} // namespace
+
+FrameRate FrameGovernor::rate_for(MotionLevel motion) {
+  switch (motion) {
+  case MOTION_FAST:
+    return FrameRate::kFast;
+  case MOTION_AMBIENT:
+    return FrameRate::kNormal;
+  case MOTION_SETTLING:
+    return FrameRate::kSlow;
+  case MOTION_IDLE:
+  default:
+    return FrameRate::kIdle;
+  }
+}
+
+uint32_t FrameGovernor::select(FrameRate rate, uint32_t now_ms,
+                               uint32_t deadline_ms, uint32_t max_idle_ms) {
+  // Time since the previous frame belongs to the rate chosen back then.
+  if (started_) {
+    time_ms_[static_cast<int>(rate_)] += now_ms - last_select_ms_;
+  }
+  started_ = true;
+  last_select_ms_ = now_ms;
+  if (rate != rate_) {
+    switches_++;
+  }
+  rate_ = rate;
+  frames_[static_cast<int>(rate)]++;
+
+  uint32_t delay_ms = rate == FrameRate::kIdle
+                          ? max_idle_ms
+                          : kPeriodMs[static_cast<int>(rate)];
+  const int32_t until_deadline = static_cast<int32_t>(deadline_ms - now_ms);
+  if (until_deadline <= 0) {
+    delay_ms = 0;
+  } else if (static_cast<uint32_t>(until_deadline) < delay_ms) {
+    delay_ms = static_cast<uint32_t>(until_deadline);
+  }
+  if (max_hz_ > 0) {
+    delay_ms = std::max(delay_ms, 1000U / max_hz_);
+  }
+  period_ms_ = delay_ms;
+  return delay_ms;
+}
+
+void FrameGovernor::reset_stats(uint32_t now_ms) {
+  for (int i = 0; i < static_cast<int>(FrameRate::kCount); i++) {
+    time_ms_[i] = 0;
+    frames_[i] = 0;
+  }
+  switches_ = 0;
+  last_select_ms_ = now_ms;
+}
+
+std::string FrameGovernor::stats_json(uint32_t now_ms) const {
+  // Include the time spent in the current rate so far.
+  uint32_t time_ms[static_cast<int>(FrameRate::kCount)];
+  for (int i = 0; i < static_cast<int>(FrameRate::kCount); i++) {
+    time_ms[i] = time_ms_[i];
+  }
+  if (started_) {
+    time_ms[static_cast<int>(rate_)] += now_ms - last_select_ms_;
+  }
+  const unsigned hz = period_ms_ > 0 ? 1000U / period_ms_ : 1000U;
+
+  char buf[320];
+  std::snprintf(
+      buf, sizeof(buf),
+      "{\"type\":\"fps\",\"rate\":\"%s\",\"hz\":%u,\"max\":%u,\"sw\":%u,"
+      "\"ms\":{\"fast\":%u,\"normal\":%u,\"slow\":%u,\"idle\":%u},"
+      "\"frames\":{\"fast\":%u,\"normal\":%u,\"slow\":%u,\"idle\":%u}}",
+      kRateNames[static_cast<int>(rate_)], hz,
+      static_cast<unsigned>(max_hz_), static_cast<unsigned>(switches_),
+      static_cast<unsigned>(time_ms[0]), static_cast<unsigned>(time_ms[1]),
+      static_cast<unsigned>(time_ms[2]), static_cast<unsigned>(time_ms[3]),
+      static_cast<unsigned>(frames_[0]), static_cast<unsigned>(frames_[1]),
+      static_cast<unsigned>(frames_[2]), static_cast<unsigned>(frames_[3]));
+  return buf;
+}
+
+} // namespace leor
@@ -0,0 +1,152 @@
+#include "leor/gesture_features.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+namespace leor {
+
+namespace {
+
+// Below these a local maximum is sensor noise or handling, not a peak.
+constexpr int32_t kPeakFloor[GestureFeatures::kChannels] = {600, 150, 150, 150, 150};
+// A sign change only counts once the value has left this band around zero.
+constexpr int32_t kCrossingBand = 50;
+// Accelerometer energy under this (about 30 mg RMS) has no dominant axis.
+constexpr int64_t kStillEnergy = 900;
+// Channel units to dps and g.
+constexpr float kScale[GestureFeatures::kChannels] = {0.1f, 0.001f, 0.001f, 0.001f, 0.001f};
+
+int16_t clamp16(int32_t v) {
+    return static_cast<int16_t>(std::max<int32_t>(-32768, std::min<int32_t>(32767, v)));
+}
+
+}  // namespace
+
+void GestureFeatures::add(float gyro_dps, float az_delta, float axy_delta, uint32_t now_ms) {
+    if (total_samples == 0) {
+        start_ms = now_ms;
+    }
+    total_samples++;
+    if (gyro_dps > max_gyro) {
+        max_gyro = gyro_dps;
+        gyro_peak_ms = now_ms - start_ms;
+    }
+    if (az_delta > max_az_delta) max_az_delta = az_delta;
+    if (axy_delta > max_axy_delta) max_axy_delta = axy_delta;
+}
+
+std::string GestureFeatures::json() const {
+    char buf[640];
+    int n = std::snprintf(buf, sizeof(buf),
+                          "{\"type\":\"gfeat\",\"samples\":%d,\"touch\":%.2f,\"tilt\":%d,"
+                          "\"max\":{\"gyro\":%.1f,\"az\":%.3f,\"axy\":%.3f},\"peak_ms\":%u,\"n\":%d",
+                          total_samples, touch_ratio(), tilt_triggered ? 1 : 0, max_gyro, max_az_delta,
+                          max_axy_delta, static_cast<unsigned>(gyro_peak_ms), window_samples);
+    const struct {
+        const char* key;
+        const float* values;
+    } rows[] = {{"mean", mean}, {"var", variance}, {"energy", energy}};
+    for (const auto& row : rows) {
+        n += std::snprintf(buf + n, sizeof(buf) - n, ",\"%s\":[%.4g,%.4g,%.4g,%.4g,%.4g]", row.key, row.values[0],
+                           row.values[1], row.values[2], row.values[3], row.values[4]);
+    }
+    std::snprintf(buf + n, sizeof(buf) - n,
+                  ",\"peaks\":[%u,%u,%u,%u,%u],\"zc\":[%u,%u,%u],\"dom\":%d,\"domr\":%.2f}", peaks[0], peaks[1],
+                  peaks[2], peaks[3], peaks[4], crossings[kAx], crossings[kAy], crossings[kAz], dominant_axis,
+                  dominance);
+    return buf;
+}
+
+void FeatureWindow::clear() {
+    *this = FeatureWindow();
+}
+
+void FeatureWindow::push(int32_t gyro_ddps, int32_t ax_mg, int32_t ay_mg, int32_t az_mg) {
+    Slot& slot = ring_[head_];
+    if (count_ == kSize) {
+        // slot is the oldest sample; take it back out.
+        for (int c = 0; c < kChannels; ++c) {
+            sum_[c] -= slot.v[c];
+            sum_sq_[c] -= static_cast<int32_t>(slot.v[c]) * slot.v[c];
+            peaks_[c] -= (slot.peak >> c) & 1;
+            crossings_[c] -= (slot.crossing >> c) & 1;
+        }
+    } else {
+        count_++;
+    }
+
+    int32_t v[kChannels] = {gyro_ddps, ax_mg, ay_mg, az_mg, 0};
+    if (count_ > 1) {
+        const Slot& prev = back(0);
+        v[GestureFeatures::kJerk] = std::abs(ax_mg - prev.v[GestureFeatures::kAx]) +
+                                    std::abs(ay_mg - prev.v[GestureFeatures::kAy]) +
+                                    std::abs(az_mg - prev.v[GestureFeatures::kAz]);
+    }
+
+    slot.peak = 0;
+    slot.crossing = 0;
+    for (int c = 0; c < kChannels; ++c) {
+        slot.v[c] = clamp16(v[c]);
+        sum_[c] += slot.v[c];
+        sum_sq_[c] += static_cast<int32_t>(slot.v[c]) * slot.v[c];
+
+        // The previous sample is a peak once this one is no higher. It is
+        // still in the ring, so its bit comes back out when it is evicted.
+        if (count_ > 2) {
+            const int32_t before = std::abs(back(1).v[c]);
+            const int32_t mid = std::abs(back(0).v[c]);
+            if (mid >= kPeakFloor[c] && mid > before && mid >= std::abs(slot.v[c])) {
+                ring_[(head_ + kSize - 1) % kSize].peak |= 1 << c;
+                peaks_[c]++;
+            }
+        }
+
+        const int8_t sign = slot.v[c] > kCrossingBand ? 1 : slot.v[c] < -kCrossingBand ? -1 : 0;
+        if (sign != 0) {
+            if (last_sign_[c] != 0 && sign != last_sign_[c]) {
+                slot.crossing |= 1 << c;
+                crossings_[c]++;
+            }
+            last_sign_[c] = sign;
+        }
+    }
+    head_ = (head_ + 1) % kSize;
+}
+
+void FeatureWindow::snapshot(GestureFeatures& out) const {
+    out.window_samples = count_;
+    out.dominant_axis = -1;
+    out.dominance = 0.0f;
+    if (count_ == 0) {
+        return;
+    }
+    const int64_t n = count_;
+    for (int c = 0; c < kChannels; ++c) {
+        const float scale = kScale[c];
+        out.mean[c] = static_cast<float>(sum_[c]) / static_cast<float>(n) * scale;
+        out.energy[c] = static_cast<float>(sum_sq_[c]) / static_cast<float>(n) * scale * scale;
+        // n * sum_sq - sum^2 is exact in 64 bits for 40 int16 samples.
+        const int64_t spread = n * sum_sq_[c] - static_cast<int64_t>(sum_[c]) * sum_[c];
+        out.variance[c] = static_cast<float>(spread) / static_cast<float>(n * n) * scale * scale;
+        out.peaks[c] = peaks_[c];
+        out.crossings[c] = crossings_[c];
+    }
+
+    int64_t total = 0;
+    int64_t top = 0;
+    for (int c = GestureFeatures::kAx; c <= GestureFeatures::kAz; ++c) {
+        total += sum_sq_[c];
+        if (sum_sq_[c] > top) {
+            top = sum_sq_[c];
+            out.dominant_axis = c;
+        }
+    }
+    if (total / n < kStillEnergy) {
+        out.dominant_axis = -1;
+        return;
+    }
+    out.dominance = static_cast<float>(top) / static_cast<float>(total);
+}
+
+}  // namespace leor
@@ -0,0 +1,124 @@
+#include "leor/gesture_model.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace leor {
+
+namespace {
+
+struct GestureNode {
+    int8_t feature;      // -1 for a leaf
+    int8_t label;        // leaf only
+    uint8_t confidence;  // leaf only, percent
+    uint16_t right;      // split only: taken when x[feature] > threshold
+    float threshold;
+};
+
+constexpr GestureNode kNodes[] = {
+#define LEOR_GESTURE_ROOT(node)
+#define LEOR_GESTURE_SPLIT(feature, threshold, right) {feature, 0, 0, right, threshold},
+#define LEOR_GESTURE_LEAF(label, confidence) {-1, label, confidence, 0, 0.0f},
+#include "leor/gesture_tree.def"
+#undef LEOR_GESTURE_ROOT
+#undef LEOR_GESTURE_SPLIT
+#undef LEOR_GESTURE_LEAF
+};
+
+constexpr uint16_t kRoots[] = {
+#define LEOR_GESTURE_ROOT(node) node,
+#define LEOR_GESTURE_SPLIT(feature, threshold, right)
+#define LEOR_GESTURE_LEAF(label, confidence)
+#include "leor/gesture_tree.def"
+#undef LEOR_GESTURE_ROOT
+#undef LEOR_GESTURE_SPLIT
+#undef LEOR_GESTURE_LEAF
+};
+
+constexpr int kNodeCount = sizeof(kNodes) / sizeof(kNodes[0]);
+constexpr int kTreeCount = sizeof(kRoots) / sizeof(kRoots[0]);
+// Labels -1..3, shifted by one for the vote table.
+constexpr int kVoteSlots = 5;
+
+// Splits may only point forward and inside the table, so every walk in
+// predict_gesture() ends on a leaf.
+constexpr bool tables_valid() {
+    for (int i = 0; i < kNodeCount; ++i) {
+        const GestureNode& n = kNodes[i];
+        if (n.feature >= 0) {
+            if (n.feature >= kGestureFeatureCount || i + 1 >= kNodeCount || n.right <= i + 1 ||
+                n.right >= kNodeCount) {
+                return false;
+            }
+        } else if (n.label < -1 || n.label >= kVoteSlots - 1 || n.confidence > 100) {
+            return false;
+        }
+    }
+    for (int t = 0; t < kTreeCount; ++t) {
+        if (kRoots[t] >= kNodeCount) {
+            return false;
+        }
+    }
+    return kTreeCount > 0;
+}
+static_assert(tables_valid(), "gesture_tree.def: split child out of range or bad leaf");
+
+}  // namespace
+
+void make_gesture_vector(const GestureFeatures& f, float shake_threshold, float pat_threshold,
+                         float swipe_threshold, float touch_threshold, float out[kGestureFeatureCount]) {
+    // A zero threshold would make every peak infinite; treat it as tiny.
+    const float shake = std::max(shake_threshold, 1e-3f);
+    const float pat = std::max(pat_threshold, 1e-3f);
+    const float swipe = std::max(swipe_threshold, 1e-3f);
+
+    out[kFeatGyroPeak] = f.max_gyro / shake;
+    out[kFeatAzPeak] = f.max_az_delta / pat;
+    out[kFeatAxyPeak] = f.max_axy_delta / swipe;
+    out[kFeatTouch] = f.touch_ratio() - touch_threshold;
+    out[kFeatTilt] = f.tilt_triggered ? 1.0f : 0.0f;
+    out[kFeatGyroRms] = std::sqrt(f.energy[GestureFeatures::kGyro]) / shake;
+    out[kFeatAxStd] = std::sqrt(f.variance[GestureFeatures::kAx]);
+    out[kFeatAyStd] = std::sqrt(f.variance[GestureFeatures::kAy]);
+    out[kFeatAzStd] = std::sqrt(f.variance[GestureFeatures::kAz]);
+    out[kFeatJerk] = f.mean[GestureFeatures::kJerk];
+    out[kFeatAccelPeaks] = static_cast<float>(f.peaks[GestureFeatures::kAx] + f.peaks[GestureFeatures::kAy] +
+                                              f.peaks[GestureFeatures::kAz]);
+    out[kFeatCrossings] = static_cast<float>(f.crossings[GestureFeatures::kAx] +
+                                             f.crossings[GestureFeatures::kAy] +
+                                             f.crossings[GestureFeatures::kAz]);
+    out[kFeatGyroPeaks] = static_cast<float>(f.peaks[GestureFeatures::kGyro]);
+    const float accel_energy = f.energy[GestureFeatures::kAx] + f.energy[GestureFeatures::kAy] +
+                               f.energy[GestureFeatures::kAz];
+    out[kFeatZShare] = accel_energy > 0.0f ? f.energy[GestureFeatures::kAz] / accel_energy : 0.0f;
+    // The window is kSize samples of 20 ms.
+    out[kFeatPeakTime] = static_cast<float>(f.gyro_peak_ms) / (FeatureWindow::kSize * 20.0f);
+}
+
+GesturePrediction predict_gesture(const float x[kGestureFeatureCount]) {
+    uint16_t votes[kVoteSlots] = {};
+    for (int t = 0; t < kTreeCount; ++t) {
+        int i = kRoots[t];
+        while (kNodes[i].feature >= 0) {
+            const GestureNode& n = kNodes[i];
+            i = x[n.feature] <= n.threshold ? i + 1 : n.right;
+        }
+        votes[kNodes[i].label + 1] += kNodes[i].confidence;
+    }
+    int best = 0;
+    for (int slot = 1; slot < kVoteSlots; ++slot) {
+        if (votes[slot] > votes[best]) {
+            best = slot;
+        }
+    }
+    GesturePrediction p;
+    p.label = best - 1;
+    p.confidence = static_cast<uint8_t>(votes[best] / kTreeCount);
+    return p;
+}
+
+int gesture_tree_count() {
+    return kTreeCount;
+}
+
+}  // namespace leor
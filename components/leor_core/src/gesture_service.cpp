@@ -1,14 +1,16 @@
 #include "leor/gesture_service.hpp"
 
 #include <algorithm>
+#include <cctype>
 #include <cmath>
 #include <cstdio>
 #include <string>
 
 #include "driver/i2c_master.h"
-#include "esp_log.h"
+#include "esp_cpu.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "leor/trace.hpp"
 
 namespace {
 
@@ -16,15 +18,16 @@ namespace {
 
 namespace leor {
 
-void GestureService::start(bool dummy_enabled, int i2c_sda_pin, int i2c_scl_pin, DisplayBackend* display) {
+void GestureService::start(bool dummy_enabled, int i2c_sda_pin, int i2c_scl_pin, const float* cached_gyro_offsets,
+                           int imu_int_pin) {
     dummy_enabled_ = dummy_enabled;
     last_emit_ms_ = 0;
     i2c_sda_pin_ = i2c_sda_pin;
     i2c_scl_pin_ = i2c_scl_pin;
 
     if (!dummy_enabled_) {
-        mpu_available_ = init_mpu(i2c_sda_pin_, i2c_scl_pin_, display);
-        mpu_calibrated_ = mpu_available_;
+        mpu_available_ = init_mpu(i2c_sda_pin_, i2c_scl_pin_, cached_gyro_offsets, imu_int_pin);
+        mpu_calibrated_ = mpu_available_ && mpu_.is_calibrated();
     }
 }
 
@@ -48,12 +51,47 @@ void GestureService::restore(bool matching, uint32_t rt, uint32_t cf, uint32_t c
             }
             i++;
         }
+        for (int k = 0; k < kLabelCount; ++k) {
+            action_ids_[k] = resolve_action(actions_[k]);
+        }
     }
     
     // Set matching state last to handle MPU sleep/wake correctly
     set_matching_enabled(matching);
 }
 
+void GestureService::snapshot(GestureSnapshot& out) const {
+    out.matching = matching_enabled_;
+    out.inverted = inverted_;
+    out.was_tilted = was_tilted_;
+    out.gyro_valid = mpu_calibrated_;
+    out.reaction_time_ms = reaction_time_ms_;
+    out.confidence_percent = confidence_percent_;
+    out.cooldown_ms = cooldown_ms_;
+    out.shake_threshold = shake_threshold_;
+    out.pat_threshold = pat_threshold_;
+    out.swipe_threshold = swipe_threshold_;
+    out.touch_threshold = touch_ratio_threshold_;
+    out.pickup_tilt_deg = pickup_tilt_deg_;
+    out.ax_lp = ax_lp_;
+    out.ay_lp = ay_lp_;
+    out.az_lp = az_lp_;
+    std::copy(mpu_.gyro_offsets(), mpu_.gyro_offsets() + 3, out.gyro_offsets);
+}
+
+void GestureService::resume(const GestureSnapshot& in) {
+    inverted_ = in.inverted;
+    was_tilted_ = in.was_tilted;
+    shake_threshold_ = in.shake_threshold;
+    pat_threshold_ = in.pat_threshold;
+    swipe_threshold_ = in.swipe_threshold;
+    touch_ratio_threshold_ = in.touch_threshold;
+    pickup_tilt_deg_ = in.pickup_tilt_deg;
+    ax_lp_ = in.ax_lp;
+    ay_lp_ = in.ay_lp;
+    az_lp_ = in.az_lp;
+}
+
 void GestureService::set_matching_enabled(bool enabled) {
     if (matching_enabled_ == enabled) return;
     
@@ -61,10 +99,11 @@ void GestureService::set_matching_enabled(bool enabled) {
     if (mpu_available_) {
         // Only wake if we are NOT suspended
         if (enabled && !suspended_) {
-            ESP_LOGI("leor_gest", "Gestures enabled: Waking MPU");
+            LEOR_TRACE(GEST_MPU_WAKE, 0u);
             mpu_.wake();
+            window_.clear();
         } else if (!enabled) {
-            ESP_LOGI("leor_gest", "Gestures disabled: Sleeping MPU");
+            LEOR_TRACE(GEST_MPU_SLEEP, 0u);
             mpu_.sleep();
             state_ = State::kReady;
         }
@@ -78,43 +117,63 @@ void GestureService::set_suspended(bool suspended) {
     if (mpu_available_) {
         // If we are suspending, always sleep
         if (suspended) {
-            ESP_LOGI("leor_gest", "System suspended: Sleeping MPU");
+            LEOR_TRACE(GEST_MPU_SLEEP, 1u);
             mpu_.sleep();
             state_ = State::kReady;
         } 
         // If we are resuming, only wake if user enabled gestures
         else if (matching_enabled_) {
-            ESP_LOGI("leor_gest", "System resumed: Waking MPU");
+            LEOR_TRACE(GEST_MPU_WAKE, 1u);
             mpu_.wake();
+            window_.clear();
         }
     }
 }
 
-std::string GestureService::poll(uint32_t now_ms, bool touch_active) {
-    if (calibrating()) return "";
-    if (!matching_enabled_ || suspended_ || !mpu_available_ || !mpu_calibrated_) {
-        return "";
+Action GestureService::poll(uint32_t now_ms, bool touch_active) {
+    if (calibrating()) return Action::kNone;
+    if (!matching_enabled_ || suspended_ || !mpu_available_) {
+        return Action::kNone;
     }
 
-    if (now_ms - last_mpu_read_ms_ < 20) {
-        return "";
+    uint32_t sample_ms = 0;
+    while (read_mpu_sample(now_ms, touch_active, &sample_ms)) {
+        const Action action = process_sample(sample_ms, touch_active);
+        if (action != Action::kNone) {
+            return action;
+        }
     }
-    last_mpu_read_ms_ = now_ms;
-    if (!read_mpu_sample()) {
-        return "";
+    if (!mpu_calibrated_ && mpu_.is_calibrated()) {
+        LEOR_TRACE(GEST_BIAS_READY, mpu_.gyro_offsets()[0], mpu_.gyro_offsets()[1],
+                   mpu_.gyro_offsets()[2]);
+        mpu_calibrated_ = true;
     }
+    return Action::kNone;
+}
 
+GestureService::Motion GestureService::measure_sample() {
     const auto& d = mpu_.data();
-    
+
     // Baselines
-    az_lp_ = az_lp_ * 0.95f + d.azG * 0.05f; 
+    az_lp_ = az_lp_ * 0.95f + d.azG * 0.05f;
     ax_lp_ = ax_lp_ * 0.95f + d.axG * 0.05f;
     ay_lp_ = ay_lp_ * 0.95f + d.ayG * 0.05f;
 
-    const bool currently_tilted = (std::abs(d.pitch) > pickup_tilt_deg_ || std::abs(d.roll) > pickup_tilt_deg_);
-    const float gyro_mag = std::sqrt(d.gxDps * d.gxDps + d.gyDps * d.gyDps + d.gzDps * d.gzDps);
-    const float az_delta = d.azG - az_lp_;
-    const float axy_delta = std::max(std::abs(d.axG - ax_lp_), std::abs(d.ayG - ay_lp_));
+    Motion m;
+    m.gyro_mag = std::sqrt(d.gxDps * d.gxDps + d.gyDps * d.gyDps + d.gzDps * d.gzDps);
+    m.az_delta = d.azG - az_lp_;
+    m.axy_delta = std::max(std::abs(d.axG - ax_lp_), std::abs(d.ayG - ay_lp_));
+    window_.push(std::lround(m.gyro_mag * 10.0f), std::lround((d.axG - ax_lp_) * 1000.0f),
+                 std::lround((d.ayG - ay_lp_) * 1000.0f), std::lround(m.az_delta * 1000.0f));
+    return m;
+}
+
+Action GestureService::process_sample(uint32_t now_ms, bool touch_active) {
+    const Motion m = measure_sample();
+    const bool currently_tilted = mpu_.tilt_exceeds(pickup_tilt_deg_);
+    const float gyro_mag = m.gyro_mag;
+    const float az_delta = m.az_delta;
+    const float axy_delta = m.axy_delta;
 
     // --- State Machine ---
 
@@ -124,30 +183,38 @@ std::string GestureService::poll(uint32_t now_ms, bool touch_active) {
             if (impulse) {
                 state_ = State::kSampling;
                 state_start_ms_ = now_ms;
-                window_stats_.reset();
-                ESP_LOGI("leor_gest", "LIFE: READY -> SAMPLING (800ms)");
+                features_.reset();
+                early_label_ = -1;
+                early_streak_ = 0;
+                LEOR_TRACE(GEST_SAMPLING);
             }
             break;
         }
 
         case State::kSampling: {
-            window_stats_.total_samples++;
-            if (touch_active) window_stats_.touch_samples++;
-            if (gyro_mag > window_stats_.max_gyro) window_stats_.max_gyro = gyro_mag;
-            if (az_delta > window_stats_.max_az_delta) window_stats_.max_az_delta = az_delta;
-            if (axy_delta > window_stats_.max_axy_delta) window_stats_.max_axy_delta = axy_delta;
-            if (currently_tilted && !was_tilted_) window_stats_.tilt_triggered = true;
-
-            if (now_ms - state_start_ms_ >= 800) {
-                std::string result = classify();
-                if (!result.empty()) {
+            features_.add(gyro_mag, az_delta, axy_delta, now_ms);
+            if (touch_active) features_.touch_samples++;
+            if (currently_tilted && !was_tilted_) features_.tilt_triggered = true;
+
+            // Every sample gets a prediction; a confident one ends the
+            // window early, and the full window decides the rest.
+            const uint32_t elapsed = now_ms - state_start_ms_;
+            const bool full_window = elapsed >= kWindowMs;
+            if (full_window || early_decisions_) {
+                const int label = classify(full_window);
+                if (!full_window && label < 0) break;
+                decision_latency_ms_ = elapsed;
+                const Action action = label >= 0 ? action_ids_[label] : Action::kNone;
+                if (action != Action::kNone) {
+                    record_latency(label, elapsed);
                     state_ = State::kActive;
                     state_start_ms_ = now_ms;
-                    ESP_LOGI("leor_gest", "LIFE: SAMPLING -> ACTIVE (Duration: %ums)", (unsigned)reaction_time_ms_);
-                    return result;
+                    active_label_ = label;
+                    LEOR_TRACE(GEST_ACTIVE, reaction_time_ms_);
+                    return action;
                 } else {
                     state_ = State::kReady;
-                    ESP_LOGI("leor_gest", "LIFE: SAMPLING -> READY (No match)");
+                    LEOR_TRACE(GEST_NO_MATCH);
                 }
             }
             break;
@@ -158,8 +225,8 @@ std::string GestureService::poll(uint32_t now_ms, bool touch_active) {
             if (now_ms - state_start_ms_ >= reaction_time_ms_) {
                 state_ = State::kCooldown;
                 state_start_ms_ = now_ms;
-                ESP_LOGI("leor_gest", "LIFE: ACTIVE -> COOLDOWN (Lockout: %ums)", (unsigned)cooldown_ms_);
-                return "neutral"; // Return to neutral automatically
+                LEOR_TRACE(GEST_COOLDOWN, cooldown_ms_);
+                return Action::kNeutral; // Return to neutral automatically
             }
             break;
         }
@@ -168,7 +235,7 @@ std::string GestureService::poll(uint32_t now_ms, bool touch_active) {
             // Wait for Cooldown (cd)
             if (now_ms - state_start_ms_ >= cooldown_ms_) {
                 state_ = State::kReady;
-                ESP_LOGI("leor_gest", "LIFE: COOLDOWN -> READY");
+                LEOR_TRACE(GEST_READY);
             }
             break;
         }
@@ -176,38 +243,109 @@ std::string GestureService::poll(uint32_t now_ms, bool touch_active) {
 
     was_touching_ = touch_active;
     was_tilted_ = currently_tilted;
-    return "";
+    return Action::kNone;
 }
 
-std::string GestureService::classify() {
-    float touch_ratio = (float)window_stats_.touch_samples / (float)window_stats_.total_samples;
-    
-    ESP_LOGI("leor_gest", "ALGO EVAL: G=%.1f, AZ=%.2f, AXY=%.2f, T=%.2f, Tilt=%d", 
-             window_stats_.max_gyro, window_stats_.max_az_delta, 
-             window_stats_.max_axy_delta, touch_ratio, window_stats_.tilt_triggered);
+int GestureService::classify(bool full_window) {
+    window_.snapshot(features_);
+    const GestureFeatures& f = features_;
+    make_gesture_vector(f, shake_threshold_, pat_threshold_, swipe_threshold_, touch_ratio_threshold_, vector_);
+    const uint32_t start = esp_cpu_get_cycle_count();
+    prediction_ = predict_gesture(vector_);
+    predict_cycles_ = esp_cpu_get_cycle_count() - start;
+    if (!full_window) {
+        // A partial window only decides once the same confident gesture
+        // has held for kEarlyStableSamples samples in a row.
+        if (prediction_.label < 0 || prediction_.confidence < confidence_percent_) {
+            early_streak_ = 0;
+            return -1;
+        }
+        if (prediction_.label != early_label_) {
+            early_label_ = prediction_.label;
+            early_streak_ = 0;
+        }
+        if (++early_streak_ < kEarlyStableSamples) return -1;
+        LEOR_TRACE(GEST_EARLY, prediction_.label, f.total_samples);
+    }
+    report_pending_ = window_reports_;
 
-    // Rule 1: Shake (Violent energy)
-    if (window_stats_.max_gyro > shake_threshold_) {
-        return actions_[1]; // shake
+    LEOR_TRACE(GEST_EVAL, f.max_gyro, f.max_az_delta, f.max_axy_delta, f.touch_ratio(), f.tilt_triggered);
+    LEOR_TRACE(GEST_WINDOW, f.energy[GestureFeatures::kGyro], f.variance[GestureFeatures::kAz],
+               f.mean[GestureFeatures::kJerk], f.peaks[GestureFeatures::kAz], f.dominant_axis);
+    LEOR_TRACE(GEST_PREDICT, prediction_.label, prediction_.confidence, predict_cycles_);
+
+    if (prediction_.label < 0) {
+        LEOR_TRACE(GEST_DISCARD);
+        return -1;
+    }
+    if (prediction_.confidence < confidence_percent_) {
+        LEOR_TRACE(GEST_LOW_CONFIDENCE, prediction_.label, prediction_.confidence, confidence_percent_);
+        return -1;
     }
+    LEOR_TRACE(GEST_MATCH, prediction_.label);
+    return prediction_.label;
+}
 
-    // Rule 2: Pat (Vertical impulse + ANY touch contact)
-    if (window_stats_.max_az_delta > pat_threshold_ && touch_ratio > touch_ratio_threshold_) {
-        return actions_[0]; // pat
+std::string GestureService::features_json() const {
+    std::string json = features_.json();
+    json.pop_back();
+    char buf[320];
+    int n = std::snprintf(buf, sizeof(buf), ",\"v\":[");
+    for (int i = 0; i < kGestureFeatureCount; ++i) {
+        n += std::snprintf(buf + n, sizeof(buf) - n, i == 0 ? "%.6g" : ",%.6g", vector_[i]);
     }
+    std::snprintf(buf + n, sizeof(buf) - n, "],\"pred\":%d,\"conf\":%u,\"trees\":%d,\"cyc\":%u,\"ms\":%u}",
+                  prediction_.label, static_cast<unsigned>(prediction_.confidence), gesture_tree_count(),
+                  static_cast<unsigned>(predict_cycles_), static_cast<unsigned>(decision_latency_ms_));
+    return json + buf;
+}
 
-    // Rule 3: Pickup (Priority 3, after Pat)
-    if (window_stats_.tilt_triggered) {
-        return actions_[3]; // pickup
+void GestureService::record_latency(int label, uint32_t latency_ms) {
+    LatencyStats& s = latency_[label];
+    size_t bucket = 0;
+    while (bucket < kLatencyEdgesMs.size() && latency_ms >= kLatencyEdgesMs[bucket]) ++bucket;
+    ++s.counts[bucket];
+    ++s.n;
+    s.sum_ms += latency_ms;
+    s.max_ms = std::max(s.max_ms, latency_ms);
+}
+
+void GestureService::reset_latency() {
+    for (LatencyStats& s : latency_) {
+        s = LatencyStats{};
     }
+}
 
-    // Rule 4: Swipe (Horizontal impulse + touch contact)
-    if (window_stats_.max_axy_delta > swipe_threshold_ && touch_ratio > touch_ratio_threshold_) {
-        return actions_[2]; // swipe
+std::string GestureService::latency_json() const {
+    std::string json = "{\"type\":\"glat\",\"early\":";
+    json += early_decisions_ ? "1" : "0";
+    json += ",\"edges\":[";
+    for (size_t i = 0; i < kLatencyEdgesMs.size(); ++i) {
+        if (i > 0) json += ',';
+        json += std::to_string(kLatencyEdgesMs[i]);
+    }
+    json += ']';
+    for (int label = 0; label < kLabelCount; ++label) {
+        const LatencyStats& s = latency_[label];
+        char buf[96];
+        std::snprintf(buf, sizeof(buf), ",\"%s\":{\"n\":%u,\"avg\":%u,\"max\":%u,\"h\":[", labels_[label],
+                      static_cast<unsigned>(s.n), static_cast<unsigned>(s.n > 0 ? s.sum_ms / s.n : 0),
+                      static_cast<unsigned>(s.max_ms));
+        json += buf;
+        for (size_t i = 0; i < s.counts.size(); ++i) {
+            if (i > 0) json += ',';
+            json += std::to_string(s.counts[i]);
+        }
+        json += "]}";
     }
+    json += '}';
+    return json;
+}
 
-    ESP_LOGI("leor_gest", "ALGO: DISCARDED (Below Confidence)");
-    return "";
+std::string GestureService::take_window_report() {
+    if (!report_pending_) return std::string();
+    report_pending_ = false;
+    return features_json();
 }
 
 // ==========================================================================
@@ -224,14 +362,14 @@ void GestureService::start_calibration(int gesture_index, uint32_t now_ms) {
     calib_.calib_start_ms = now_ms;
 
     if (mpu_available_) mpu_.wake();
-    ESP_LOGI("leor_gest", "CAL: Starting calibration for gesture[%d] %s",
-             gesture_index, labels_[gesture_index]);
+    window_.clear();
+    LEOR_TRACE(CAL_START, gesture_index);
 }
 
 void GestureService::abort_calibration() {
     calib_.reset();
     if (mpu_available_ && !matching_enabled_) mpu_.sleep();
-    ESP_LOGI("leor_gest", "CAL: Aborted");
+    LEOR_TRACE(CAL_ABORT);
 }
 
 std::string GestureService::calibration_tick(uint32_t now_ms, bool touch_active) {
@@ -239,28 +377,28 @@ std::string GestureService::calibration_tick(uint32_t now_ms, bool touch_active)
 
     const uint32_t elapsed_total = now_ms - calib_.calib_start_ms;
     if (elapsed_total > CalibrationState::kTotalTimeoutMs) {
-        ESP_LOGW("leor_gest", "CAL: Timeout after %ums — aborting", 
-                 static_cast<unsigned>(elapsed_total));
+        LEOR_TRACE(CAL_TIMEOUT, elapsed_total);
         calib_.reset();
         if (mpu_available_ && !matching_enabled_) mpu_.sleep();
         return "{\"type\":\"cal\",\"phase\":\"timeout\"}";
     }
 
-    // Rate-limit IMU reads to 50 Hz
-    if (now_ms - last_mpu_read_ms_ < 20) return "";
-    last_mpu_read_ms_ = now_ms;
-    if (!read_mpu_sample()) return "";
-
-    const auto& d = mpu_.data();
+    uint32_t sample_ms = 0;
+    while (read_mpu_sample(now_ms, touch_active, &sample_ms)) {
+        std::string result = calibration_sample(sample_ms);
+        if (!result.empty()) {
+            return result;
+        }
+    }
+    return "";
+}
 
-    const float gyro_mag = std::sqrt(d.gxDps * d.gxDps + d.gyDps * d.gyDps + d.gzDps * d.gzDps);
-    const float az_delta_raw = d.azG - az_lp_;
-    const float axy_mag = std::max(std::abs(d.axG - ax_lp_), std::abs(d.ayG - ay_lp_));
-    const float tilt_mag = std::max(std::abs(d.pitch), std::abs(d.roll));
+std::string GestureService::calibration_sample(uint32_t now_ms) {
+    // Drained samples can predate the command that started this phase.
+    if (static_cast<int32_t>(now_ms - calib_.phase_start_ms) < 0) return "";
 
-    az_lp_ = az_lp_ * 0.95f + d.azG * 0.05f;
-    ax_lp_ = ax_lp_ * 0.95f + d.axG * 0.05f;
-    ay_lp_ = ay_lp_ * 0.95f + d.ayG * 0.05f;
+    const Motion m = measure_sample();
+    const float tilt_mag = std::max(std::abs(mpu_.pitch()), std::abs(mpu_.roll()));
 
     switch (calib_.phase) {
         case CalibrationPhase::kWait: {
@@ -269,8 +407,8 @@ std::string GestureService::calibration_tick(uint32_t now_ms, bool touch_active)
                 calib_.phase_start_ms = now_ms;
                 calib_.capture_ms = 0;
                 calib_.peak_value = 0.0f;
-                ESP_LOGI("leor_gest", "CAL: NOW CAPTURING — perform gesture %s",
-                         labels_[calib_.gesture_index]);
+                features_.reset();
+                LEOR_TRACE(CAL_CAPTURING, calib_.gesture_index);
             }
             break;
         }
@@ -279,18 +417,21 @@ std::string GestureService::calibration_tick(uint32_t now_ms, bool touch_active)
             calib_.sample_count++;
             calib_.capture_ms = now_ms - calib_.phase_start_ms;
 
+            // The same running peaks classify() compares the thresholds to.
+            features_.add(m.gyro_mag, m.az_delta, m.axy_delta, now_ms);
             float feature = 0.0f;
             switch (calib_.gesture_index) {
-                case 0: feature = az_delta_raw; break;
-                case 1: feature = gyro_mag;     break;
-                case 2: feature = axy_mag;      break;
-                case 3: feature = tilt_mag;     break;
+                case 0: feature = m.az_delta;  calib_.peak_value = features_.max_az_delta;  break;
+                case 1: feature = m.gyro_mag;  calib_.peak_value = features_.max_gyro;      break;
+                case 2: feature = m.axy_delta; calib_.peak_value = features_.max_axy_delta; break;
+                case 3:
+                    feature = tilt_mag;
+                    if (feature > calib_.peak_value) calib_.peak_value = feature;
+                    break;
             }
-            if (feature > calib_.peak_value) calib_.peak_value = feature;
 
-            ESP_LOGD("leor_gest", "CAL: capture g=%d f=%.3f peak=%.3f ms=%lu",
-                     calib_.gesture_index, (double)feature, (double)calib_.peak_value,
-                     (unsigned long)calib_.capture_ms);
+            LEOR_TRACE(CAL_SAMPLE, calib_.gesture_index, feature, calib_.peak_value,
+                       calib_.capture_ms);
 
             if (calib_.capture_ms >= CalibrationState::kCaptureMs) {
                 float new_thresh = calib_.peak_value * CalibrationState::kThresholdRatio;
@@ -302,8 +443,7 @@ std::string GestureService::calibration_tick(uint32_t now_ms, bool touch_active)
                     case 3: pickup_tilt_deg_ = new_thresh; break;
                 }
                 calib_.phase = CalibrationPhase::kComplete;
-                ESP_LOGI("leor_gest", "CAL: COMPLETE — gesture[%d] peak=%.3f new_threshold=%.3f",
-                         calib_.gesture_index, (double)calib_.peak_value, (double)new_thresh);
+                LEOR_TRACE(CAL_COMPLETE, calib_.gesture_index, calib_.peak_value, new_thresh);
                 return calibration_status_json();
             }
             break;
@@ -349,48 +489,135 @@ std::string GestureService::calibration_status_json() const {
     return buf;
 }
 
-bool GestureService::init_mpu(int i2c_sda_pin, int i2c_scl_pin, DisplayBackend* display) {
-    if (!mpu_.begin(i2c_sda_pin, i2c_scl_pin, 400000, I2C_NUM_0)) {
+bool GestureService::init_mpu(int i2c_sda_pin, int i2c_scl_pin, const float* cached_gyro_offsets,
+                              int imu_int_pin) {
+    if (!mpu_.begin(i2c_sda_pin, i2c_scl_pin, 400000, I2C_NUM_0, imu_int_pin)) {
         return false;
     }
+    // With a learned table the first live sample moves the offsets to its
+    // temperature.
+    bias_follow_ = bias_table_.populated() > 0;
+    bias_follow_count_ = kBiasFollowSamples - 1;
+    bias_check_ = BiasCheck::kNone;
+    if (cached_gyro_offsets != nullptr) {
+        // Start from the cached bias; the first short still spell checks it,
+        // full ones after that keep the table learning.
+        mpu_.set_gyro_offsets(cached_gyro_offsets[0], cached_gyro_offsets[1], cached_gyro_offsets[2]);
+        mpu_.start_bias_refine(kBiasCheckSamples);
+        bias_check_ = BiasCheck::kPending;
+    }
+    return true;
+}
 
-    int guard = 0;
-    int last_drawn_pct = -1;
-    while (!mpu_.is_calibrated() && guard < 5000) {
-        const bool updated = mpu_.update();
-        if (display != nullptr) {
-            const int pct = (static_cast<int>(mpu_.calibration_progress()) * 100) / 500;
-            if (last_drawn_pct < 0 || pct >= last_drawn_pct + 4 || pct == 100) {
-                draw_calibration(display, pct, false);
-                last_drawn_pct = pct;
+void GestureService::track_bias() {
+    float estimate[3];
+    float temp_c = 0.0f;
+    if (mpu_.take_refined_offsets(estimate, &temp_c)) {
+        if (bias_check_ == BiasCheck::kPending) {
+            const float* live = mpu_.gyro_offsets();
+            float error = 0.0f;
+            for (int i = 0; i < 3; ++i) {
+                error = std::max(error, std::abs(estimate[i] - live[i]));
+            }
+            bias_check_error_ = error;
+            if (error <= kBiasCheckLsb) {
+                bias_check_ = BiasCheck::kKept;
+            } else {
+                // Stale cache (a new board, or a table bin gone off): use the
+                // short mean until a full window replaces the bin.
+                bias_check_ = BiasCheck::kReplaced;
+                mpu_.adjust_gyro_offsets(estimate);
+                bias_follow_ = false;
+                bias_replace_bin_ = true;
+            }
+            LEOR_TRACE(GYRO_BIAS_CHECK, bias_check_ == BiasCheck::kKept ? 1u : 0u, error);
+        } else {
+            // An estimate that far from what the table says means the table
+            // is stale there: start that bin again instead of averaging.
+            float expected[3];
+            if (bias_table_.lookup(temp_c, expected)) {
+                for (int i = 0; i < 3; ++i) {
+                    bias_replace_bin_ = bias_replace_bin_ || std::abs(estimate[i] - expected[i]) > kBiasCheckLsb;
+                }
             }
+            LEOR_TRACE(GYRO_BIAS_LEARN, estimate[0], estimate[1], estimate[2], temp_c);
+            // A new or restarted bin is worth saving straight away.
+            bias_new_bin_ = bias_table_.learn(temp_c, estimate, bias_replace_bin_) || bias_replace_bin_ ||
+                            bias_new_bin_;
+            bias_replace_bin_ = false;
+            bias_dirty_ = true;
+            bias_follow_ = true;
+            bias_follow_count_ = kBiasFollowSamples - 1;
         }
-        if (!updated) {
-            vTaskDelay(pdMS_TO_TICKS(2));
+    }
+    if (bias_follow_ && ++bias_follow_count_ >= kBiasFollowSamples) {
+        bias_follow_count_ = 0;
+        float offsets[3];
+        if (bias_table_.lookup(mpu_.data().tempC, offsets)) {
+            mpu_.adjust_gyro_offsets(offsets);
         }
-        ++guard;
     }
+}
+
+void GestureService::clear_bias_table() {
+    bias_table_.clear();
+    bias_follow_ = false;
+    bias_dirty_ = false;
+    bias_new_bin_ = false;
+}
 
-    if (!mpu_.is_calibrated()) {
-        ESP_LOGE("leor_gest", "MPU calibration timed out! check I2C / sensor orientation");
+bool GestureService::take_bias_table_to_save(uint32_t now_ms, bool force) {
+    if (!bias_dirty_) {
         return false;
     }
-
-    if (display != nullptr) {
-        draw_calibration(display, 100, true);
-        vTaskDelay(pdMS_TO_TICKS(250));
-        display->clear();
-        display->send_buffer();
+    // A table refines every few seconds of stillness; writing each estimate
+    // would wear the NVS sectors for fractions of an LSB.
+    if (!force && !bias_new_bin_ && bias_saved_ && now_ms - bias_saved_ms_ < kBiasSaveIntervalMs) {
+        return false;
     }
-
+    bias_dirty_ = false;
+    bias_new_bin_ = false;
+    bias_saved_ = true;
+    bias_saved_ms_ = now_ms;
     return true;
 }
 
-bool GestureService::read_mpu_sample() {
-    if (!mpu_.update()) {
+std::string GestureService::bias_json() const {
+    static constexpr const char* kCheck[] = {"none", "pending", "kept", "replaced"};
+    const float* live = mpu_.gyro_offsets();
+    char buf[192];
+    std::snprintf(buf, sizeof(buf),
+                  "{\"type\":\"gbias\",\"live\":[%.2f,%.2f,%.2f],\"temp\":%.1f,\"check\":\"%s\","
+                  "\"check_err\":%.1f,\"learned\":%u,\"unsaved\":%d,",
+                  live[0], live[1], live[2], mpu_.data().tempC, kCheck[static_cast<int>(bias_check_)],
+                  bias_check_error_, static_cast<unsigned>(bias_table_.learned), bias_dirty_ ? 1 : 0);
+    // Splice the table's object in after the fields above.
+    return buf + bias_table_.json().substr(1);
+}
+
+bool GestureService::read_mpu_sample(uint32_t now_ms, bool touch_active, uint32_t* sample_ms) {
+    if (replaying_) {
+        ReplaySample sample;
+        do {
+            if (!replay_queue_.pop(sample)) {
+                return false;
+            }
+        } while (!mpu_.inject(sample.raw, sample.dt_us));
+        *sample_ms = sample.sample_ms;
+    } else if (mpu_.update()) {
+        *sample_ms = static_cast<uint32_t>(mpu_.sample_us() / 1000);
+        track_bias();
+    } else {
         return false;
     }
     const auto& d = mpu_.data();
+    const bool recording = recorder_ != nullptr && recorder_->active();
+    const bool capturing = capture_ != nullptr && capture_->active();
+    if (recording || capturing) {
+        const int16_t raw[7] = {d.rawAx, d.rawAy, d.rawAz, d.rawTemp, d.rawGx, d.rawGy, d.rawGz};
+        if (recording) recorder_->record_imu(now_ms, raw, mpu_.last_dt_us(), *sample_ms);
+        if (capturing) capture_->record_sample(*sample_ms, raw, mpu_.last_dt_us(), touch_active);
+    }
     gx_dps_ = d.gxDps;
     gy_dps_ = d.gyDps;
     gz_dps_ = d.gzDps;
@@ -400,29 +627,45 @@ bool GestureService::read_mpu_sample() {
     return true;
 }
 
-void GestureService::draw_calibration(DisplayBackend* display, int percent, bool done) {
-    if (display == nullptr) {
-        return;
+void GestureService::begin_replay(const float offsets[3]) {
+    dummy_enabled_ = false;
+    mpu_available_ = true;
+    mpu_calibrated_ = true;
+    replaying_ = true;
+    ReplaySample stale;
+    while (replay_queue_.pop(stale)) {
     }
-    display->clear();
-    display->set_font_small();
-    if (done) {
-        display->draw_text(18, 30, "Calibration Done!");
-    } else {
-        display->draw_text(18, 22, "Calibrating IMU");
-        display->draw_frame(14, 35, 100, 6);
-        const int fill = (96 * std::max(0, std::min(100, percent))) / 100;
-        display->fill_box(16, 37, fill, 2);
-    }
-    display->send_buffer();
+    mpu_.set_gyro_offsets(offsets[0], offsets[1], offsets[2]);
+}
+
+void GestureService::inject_sample(const int16_t raw[7], uint32_t dt_us, uint32_t sample_ms) {
+    ReplaySample sample;
+    std::copy(raw, raw + 7, sample.raw);
+    sample.dt_us = dt_us;
+    sample.sample_ms = sample_ms;
+    // Full means poll() has fallen a whole queue behind; the sample is lost.
+    replay_queue_.push(sample);
 }
 
 void GestureService::set_action(int index, const std::string& action) {
     if (index >= 0 && index < kLabelCount) {
         actions_[index] = action;
+        action_ids_[index] = resolve_action(action);
     }
 }
 
+std::string_view GestureService::command() const {
+    return active_label_ >= 0 ? std::string_view(actions_[active_label_]) : std::string_view();
+}
+
+Action GestureService::resolve_action(std::string_view name) {
+    while (!name.empty() && std::isspace(static_cast<unsigned char>(name.front()))) name.remove_prefix(1);
+    while (!name.empty() && std::isspace(static_cast<unsigned char>(name.back()))) name.remove_suffix(1);
+    if (name.empty()) return Action::kNone;
+    const Action action = action_from_name(name);
+    return action != Action::kNone ? action : Action::kCommand;
+}
+
 std::string GestureService::action(int index) const {
     return (index >= 0 && index < kLabelCount) ? actions_[index] : std::string();
 }
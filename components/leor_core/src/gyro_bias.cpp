@@ -0,0 +1,89 @@
+#include "leor/gyro_bias.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace leor {
+
+int GyroBiasTable::populated() const {
+    int n = 0;
+    for (const Bin& b : bin) {
+        n += b.weight > 0 ? 1 : 0;
+    }
+    return n;
+}
+
+bool GyroBiasTable::learn(float temp_c, const float bias[3], bool replace) {
+    if (!std::isfinite(temp_c)) {
+        return false;
+    }
+    const int i = std::clamp(static_cast<int>(std::lround((temp_c - kFirstC) / kBinC)), 0, kBins - 1);
+    Bin& b = bin[i];
+    const bool fresh = b.weight == 0;
+    if (replace) {
+        b.weight = 0;
+    }
+    if (b.weight < kMaxWeight) {
+        b.weight++;
+    }
+    const float k = 1.0f / static_cast<float>(b.weight);
+    for (int a = 0; a < 3; ++a) {
+        b.bias[a] += (bias[a] - b.bias[a]) * k;
+    }
+    if (learned < UINT16_MAX) {
+        learned++;
+    }
+    last_c = temp_c;
+    return fresh;
+}
+
+bool GyroBiasTable::lookup(float temp_c, float out[3]) const {
+    // Position in bins; the nearest learned bin at or below and above it.
+    const float pos = std::isfinite(temp_c) ? (temp_c - kFirstC) / kBinC : 0.0f;
+    int lo = -1;
+    int hi = -1;
+    for (int i = 0; i < kBins; ++i) {
+        if (bin[i].weight == 0) {
+            continue;
+        }
+        if (static_cast<float>(i) <= pos) {
+            lo = i;
+        } else if (hi < 0) {
+            hi = i;
+        }
+    }
+    if (lo < 0 && hi < 0) {
+        return false;
+    }
+    if (lo < 0 || hi < 0) {
+        const Bin& b = bin[lo < 0 ? hi : lo];
+        std::copy(b.bias, b.bias + 3, out);
+        return true;
+    }
+    const float t = (pos - static_cast<float>(lo)) / static_cast<float>(hi - lo);
+    for (int a = 0; a < 3; ++a) {
+        out[a] = bin[lo].bias[a] + (bin[hi].bias[a] - bin[lo].bias[a]) * t;
+    }
+    return true;
+}
+
+std::string GyroBiasTable::json() const {
+    std::string out = "{\"bins\":[";
+    char buf[96];
+    bool first = true;
+    for (int i = 0; i < kBins; ++i) {
+        const Bin& b = bin[i];
+        if (b.weight == 0) {
+            continue;
+        }
+        std::snprintf(buf, sizeof(buf), "%s[%.0f,%u,%.2f,%.2f,%.2f]", first ? "" : ",", bin_centre(i),
+                      static_cast<unsigned>(b.weight), b.bias[0], b.bias[1], b.bias[2]);
+        out += buf;
+        first = false;
+    }
+    out += "]}";
+    return out;
+}
+
+}  // namespace leor
@@ -0,0 +1,352 @@
+#include "leor/imu_capture.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "leor/time_source.hpp"
+#include "leor/trace.hpp"
+
+namespace leor {
+
+namespace {
+
+constexpr const char* kTag = "leor_cap";
+constexpr uint32_t kSectorMagic = 0x554D494C;  // "LIMU"
+constexpr uint8_t kErased = 0xFF;
+constexpr size_t kCheckedBytes = offsetof(CaptureRecord, check);
+constexpr char kBase64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+struct SectorHeader {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t reserved;
+    uint32_t crc;  // over the three words above
+};
+static_assert(sizeof(SectorHeader) == ImuCapture::kHeaderBytes, "SectorHeader is a flash format");
+static_assert(ImuCapture::kHeaderBytes + ImuCapture::kRecordsPerSector * sizeof(CaptureRecord) ==
+                  ImuCapture::kSectorBytes,
+              "records fill a sector exactly");
+
+uint32_t header_crc(const SectorHeader& h) {
+    return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&h), offsetof(SectorHeader, crc));
+}
+
+bool header_valid(const SectorHeader& h) {
+    return h.magic == kSectorMagic && h.crc == header_crc(h);
+}
+
+uint16_t record_check(const CaptureRecord& r) {
+    return static_cast<uint16_t>(esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&r), kCheckedBytes));
+}
+
+int base64_value(char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+}  // namespace
+
+bool ImuCapture::begin() {
+    part_ = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, static_cast<esp_partition_subtype_t>(kPartitionSubtype),
+                                     kPartitionLabel);
+    if (part_ == nullptr) {
+        ESP_LOGW(kTag, "no %s partition, capture disabled", kPartitionLabel);
+        return false;
+    }
+    sector_count_ = part_->size / kSectorBytes;
+    if (sector_count_ < 2) {
+        part_ = nullptr;
+        return false;
+    }
+
+    // Sequence numbers only grow, so the valid sectors are one contiguous
+    // run oldest_seq_..head_seq_ around the ring.
+    has_sectors_ = false;
+    for (uint32_t i = 0; i < sector_count_; ++i) {
+        SectorHeader h;
+        if (esp_partition_read(part_, i * kSectorBytes, &h, sizeof(h)) != ESP_OK || !header_valid(h)) {
+            continue;
+        }
+        if (!has_sectors_) {
+            oldest_seq_ = head_seq_ = h.seq;
+            has_sectors_ = true;
+        } else {
+            oldest_seq_ = std::min(oldest_seq_, h.seq);
+            head_seq_ = std::max(head_seq_, h.seq);
+        }
+    }
+    head_records_ = 0;
+    if (has_sectors_) {
+        // The head sector's written records end at the first erased one.
+        const uint32_t base = sector_address(head_seq_) + kHeaderBytes;
+        while (head_records_ < kRecordsPerSector) {
+            CaptureRecord r;
+            if (esp_partition_read(part_, base + head_records_ * sizeof(r), &r, sizeof(r)) != ESP_OK ||
+                r.kind == kErased) {
+                break;
+            }
+            ++head_records_;
+        }
+    }
+    ESP_LOGI(kTag, "capture %u sectors, %u in use", static_cast<unsigned>(sector_count_),
+             static_cast<unsigned>(has_sectors_ ? head_seq_ - oldest_seq_ + 1 : 0));
+    return true;
+}
+
+bool ImuCapture::start(const float gyro_offsets[3], uint32_t t_ms) {
+    if (part_ == nullptr) return false;
+    CaptureRecord r{};
+    r.t_ms = t_ms;
+    r.kind = 's';
+    for (int i = 0; i < 3; ++i) {
+        r.raw[i] = static_cast<int16_t>(std::clamp(gyro_offsets[i] * 256.0f, -32768.0f, 32767.0f));
+    }
+    active_ = true;
+    samples_ = 0;
+    labels_ = 0;
+    append(r);
+    return true;
+}
+
+void ImuCapture::stop() {
+    flush();
+    active_ = false;
+}
+
+bool ImuCapture::clear() {
+    if (part_ == nullptr) return false;
+    active_ = false;
+    pending_count_ = 0;
+    has_sectors_ = false;
+    head_records_ = 0;
+    samples_ = 0;
+    labels_ = 0;
+    return esp_partition_erase_range(part_, 0, sector_count_ * kSectorBytes) == ESP_OK;
+}
+
+void ImuCapture::record_sample(uint32_t t_ms, const int16_t raw[7], uint32_t dt_us, bool touch) {
+    if (!active_) return;
+    CaptureRecord r{};
+    r.t_ms = t_ms;
+    std::copy(raw, raw + 7, r.raw);
+    r.dt_us = static_cast<uint16_t>(std::min<uint32_t>(dt_us, 0xFFFF));
+    r.kind = 'i';
+    r.flags = touch ? 1 : 0;
+    append(r);
+    ++samples_;
+}
+
+bool ImuCapture::label(uint32_t t_ms, int label) {
+    if (!active_) return false;
+    CaptureRecord r{};
+    r.t_ms = t_ms;
+    r.raw[0] = static_cast<int16_t>(label);
+    r.kind = 'l';
+    append(r);
+    ++labels_;
+    return true;
+}
+
+void ImuCapture::append(const CaptureRecord& record) {
+    CaptureRecord& r = pending_[pending_count_++];
+    r = record;
+    r.check = record_check(r);
+    if (pending_count_ == kBufferRecords) {
+        flush();
+    }
+}
+
+void ImuCapture::flush() {
+    int done = 0;
+    while (done < pending_count_) {
+        if (!has_sectors_ || head_records_ == kRecordsPerSector) {
+            if (!open_next_sector()) {
+                ++write_errors_;
+                break;
+            }
+        }
+        const int n = std::min<int>(pending_count_ - done, kRecordsPerSector - head_records_);
+        const uint32_t address = sector_address(head_seq_) + kHeaderBytes + head_records_ * sizeof(CaptureRecord);
+        if (esp_partition_write(part_, address, &pending_[done], n * sizeof(CaptureRecord)) != ESP_OK) {
+            ++write_errors_;
+            break;
+        }
+        head_records_ += n;
+        done += n;
+    }
+    pending_count_ = 0;
+}
+
+bool ImuCapture::open_next_sector() {
+    const uint32_t seq = has_sectors_ ? head_seq_ + 1 : 0;
+    const int64_t erase_start_us = now_us();
+    if (esp_partition_erase_range(part_, sector_address(seq), kSectorBytes) != ESP_OK) {
+        return false;
+    }
+    SectorHeader h{kSectorMagic, seq, 0, 0};
+    h.crc = header_crc(h);
+    if (esp_partition_write(part_, sector_address(seq), &h, sizeof(h)) != ESP_OK) {
+        return false;
+    }
+    LEOR_TRACE(CAP_SECTOR, seq, static_cast<uint32_t>(now_us() - erase_start_us));
+    if (!has_sectors_) {
+        oldest_seq_ = seq;
+        has_sectors_ = true;
+    } else if (seq - oldest_seq_ >= sector_count_) {
+        ++oldest_seq_;  // the ring came round and reused the oldest sector
+    }
+    head_seq_ = seq;
+    head_records_ = 0;
+    return true;
+}
+
+uint32_t ImuCapture::sector_address(uint32_t seq) const {
+    return (seq % sector_count_) * kSectorBytes;
+}
+
+size_t ImuCapture::dump_bytes() const {
+    if (!has_sectors_) return 0;
+    return (head_seq_ - oldest_seq_) * kSectorBytes + kHeaderBytes + head_records_ * sizeof(CaptureRecord);
+}
+
+size_t ImuCapture::read_dump(size_t offset, uint8_t* out, size_t len) const {
+    const size_t total = dump_bytes();
+    if (offset >= total) return 0;
+    len = std::min(len, total - offset);
+    size_t done = 0;
+    while (done < len) {
+        const size_t at = offset + done;
+        const uint32_t seq = oldest_seq_ + static_cast<uint32_t>(at / kSectorBytes);
+        const size_t in_sector = at % kSectorBytes;
+        const size_t n = std::min(len - done, kSectorBytes - in_sector);
+        if (esp_partition_read(part_, sector_address(seq) + in_sector, out + done, n) != ESP_OK) {
+            break;
+        }
+        done += n;
+    }
+    return done;
+}
+
+size_t ImuCapture::export_base64(size_t offset, std::string& out, size_t max_bytes) const {
+    // Three bytes per four characters; read in groups of 48 so only the
+    // last group of the stream is padded.
+    uint8_t chunk[48];
+    max_bytes -= max_bytes % 3;
+    size_t done = 0;
+    while (done < max_bytes) {
+        const size_t n = read_dump(offset + done, chunk, std::min(sizeof(chunk), max_bytes - done));
+        if (n == 0) break;
+        for (size_t i = 0; i < n; i += 3) {
+            const uint32_t b = (chunk[i] << 16) | (i + 1 < n ? chunk[i + 1] << 8 : 0) | (i + 2 < n ? chunk[i + 2] : 0);
+            out += kBase64[(b >> 18) & 63];
+            out += kBase64[(b >> 12) & 63];
+            out += i + 1 < n ? kBase64[(b >> 6) & 63] : '=';
+            out += i + 2 < n ? kBase64[b & 63] : '=';
+        }
+        done += n;
+    }
+    return offset + done;
+}
+
+std::string ImuCapture::status_json() const {
+    char buf[192];
+    std::snprintf(buf, sizeof(buf),
+                  "{\"type\":\"cap\",\"ok\":%d,\"on\":%d,\"bytes\":%u,\"cap\":%u,\"sectors\":%u,\"samples\":%u,"
+                  "\"labels\":%u,\"errors\":%u}",
+                  part_ != nullptr ? 1 : 0, active_ ? 1 : 0, static_cast<unsigned>(dump_bytes()),
+                  static_cast<unsigned>(sector_count_ * kSectorBytes),
+                  static_cast<unsigned>(has_sectors_ ? head_seq_ - oldest_seq_ + 1 : 0),
+                  static_cast<unsigned>(samples_), static_cast<unsigned>(labels_),
+                  static_cast<unsigned>(write_errors_));
+    return buf;
+}
+
+bool CaptureReader::load(const uint8_t* data, size_t len) {
+    records_.clear();
+    sectors_ = 0;
+    bad_records_ = 0;
+
+    struct Sector {
+        uint32_t seq;
+        size_t offset;
+    };
+    std::vector<Sector> order;
+    for (size_t at = 0; at + ImuCapture::kHeaderBytes <= len; at += ImuCapture::kSectorBytes) {
+        SectorHeader h;
+        std::memcpy(&h, data + at, sizeof(h));
+        if (header_valid(h)) {
+            order.push_back({h.seq, at});
+        }
+    }
+    std::sort(order.begin(), order.end(), [](const Sector& a, const Sector& b) { return a.seq < b.seq; });
+
+    for (const Sector& s : order) {
+        const size_t end = std::min(len, s.offset + ImuCapture::kSectorBytes);
+        for (size_t at = s.offset + ImuCapture::kHeaderBytes; at + sizeof(CaptureRecord) <= end;
+             at += sizeof(CaptureRecord)) {
+            CaptureRecord r;
+            std::memcpy(&r, data + at, sizeof(r));
+            if (r.kind == kErased) break;
+            if (r.check != record_check(r)) {
+                ++bad_records_;
+                continue;
+            }
+            records_.push_back(r);
+        }
+    }
+    sectors_ = order.size();
+    return sectors_ > 0;
+}
+
+bool CaptureReader::load_dump_text(const std::string& text) {
+    std::vector<uint8_t> bytes;
+    bool in_page = false;
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos) end = text.size();
+        std::string_view line(text.data() + start, end - start);
+        start = end + 1;
+        if (line.substr(0, 2) == "< ") line.remove_prefix(2);
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.remove_suffix(1);
+
+        if (line.size() > 4 && line.substr(0, 4) == "cap:" &&
+            std::all_of(line.begin() + 4, line.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            in_page = true;
+            continue;
+        }
+        if (!in_page) continue;
+        in_page = false;
+        uint32_t bits = 0;
+        int count = 0;
+        for (char c : line) {
+            const int v = base64_value(c);
+            if (v < 0) continue;  // '=' padding
+            bits = (bits << 6) | static_cast<uint32_t>(v);
+            if (++count == 4) {
+                bytes.push_back(static_cast<uint8_t>(bits >> 16));
+                bytes.push_back(static_cast<uint8_t>(bits >> 8));
+                bytes.push_back(static_cast<uint8_t>(bits));
+                bits = 0;
+                count = 0;
+            }
+        }
+        if (count >= 2) {
+            bits <<= 6 * (4 - count);
+            bytes.push_back(static_cast<uint8_t>(bits >> 16));
+            if (count == 3) bytes.push_back(static_cast<uint8_t>(bits >> 8));
+        }
+    }
+    return load(bytes.data(), bytes.size());
+}
+
+}  // namespace leor
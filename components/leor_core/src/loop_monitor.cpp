@@ -0,0 +1,217 @@
+#include "leor/loop_monitor.hpp"
+
+#include <cstdio>
+
+#if CONFIG_LEOR_PROFILER
+#include "esp_rom_sys.h"
+#endif
+
+namespace leor {
+
+namespace {
+
+void append_counts(std::string &out, const char *name, const uint32_t *counts,
+                   int n) {
+  char buf[16];
+  out += ",\"";
+  out += name;
+  out += "\":[";
+  for (int i = 0; i < n; i++) {
+    std::snprintf(buf, sizeof(buf), "%s%u", i == 0 ? "" : ",",
+                  static_cast<unsigned>(counts[i]));
+    out += buf;
+  }
+  out += "]";
+}
+
+const char *cause_name(int cause) {
+  return cause < PERF_STAGE_COUNT ? perf_stage_name(static_cast<PerfStage>(cause))
+                                  : "other";
+}
+
+} // namespace
+
+int LoopMonitor::bucket_for(uint32_t us) {
+  for (int i = 0; i < kBuckets - 1; i++) {
+    if (us < kEdgesMs[i] * 1000U) {
+      return i;
+    }
+  }
+  return kBuckets - 1;
+}
+
+void LoopMonitor::begin_tick(int64_t now_us) {
+  tick_start_us_ = now_us;
+  if (planned_) {
+    // Negative means an event woke the loop before its timeout: on time.
+    const int64_t late_us = now_us - planned_start_us_;
+    const uint32_t late =
+        late_us > 0 ? static_cast<uint32_t>(late_us) : 0;
+    lateness_[bucket_for(late)]++;
+    if (late > max_lateness_us_) {
+      max_lateness_us_ = late;
+    }
+  }
+#if CONFIG_LEOR_PROFILER
+  Profiler::instance().begin_tick();
+#endif
+}
+
+int LoopMonitor::culprit(uint32_t duration_us,
+                         uint32_t stage_us[PERF_STAGE_COUNT]) const {
+  for (int i = 0; i < PERF_STAGE_COUNT; i++) {
+    stage_us[i] = 0;
+  }
+#if CONFIG_LEOR_PROFILER
+  const uint32_t per_us = esp_rom_get_cpu_ticks_per_us();
+  uint32_t staged_us = 0;
+  int cause = kCauseOther;
+  uint32_t cause_us = 0;
+  for (int i = 0; i < PERF_STAGE_COUNT; i++) {
+    const auto stage = static_cast<PerfStage>(i);
+    stage_us[i] = Profiler::instance().tick_cycles(stage) / per_us;
+    // Every other stage runs inside PERF_TICK, so it is not a cause.
+    if (stage == PERF_TICK) {
+      continue;
+    }
+    staged_us += stage_us[i];
+    if (stage_us[i] > cause_us) {
+      cause = i;
+      cause_us = stage_us[i];
+    }
+  }
+  const uint32_t other_us = duration_us > staged_us ? duration_us - staged_us : 0;
+  return other_us > cause_us ? kCauseOther : cause;
+#else
+  (void)duration_us;
+  return kCauseOther;
+#endif
+}
+
+bool LoopMonitor::end_tick(int64_t now_us, uint32_t slot_ms,
+                           uint32_t next_delay_ms) {
+  const uint32_t duration_us =
+      static_cast<uint32_t>(now_us - tick_start_us_);
+  ticks_++;
+  duration_[bucket_for(duration_us)]++;
+  if (duration_us > max_duration_us_) {
+    max_duration_us_ = duration_us;
+  }
+  // run() waits out the rest of the delay, or not at all after an overrun.
+  const int64_t planned = tick_start_us_ + static_cast<int64_t>(next_delay_ms) * 1000;
+  planned_start_us_ = planned > now_us ? planned : now_us;
+  planned_ = true;
+
+  if (slot_ms == 0 || duration_us <= slot_ms * 1000U) {
+    return false;
+  }
+
+  misses_++;
+  uint32_t stage_us[PERF_STAGE_COUNT];
+  const int cause = culprit(duration_us, stage_us);
+  if (causes_[cause] < UINT16_MAX) {
+    causes_[cause]++;
+  }
+  last_miss_us_ = duration_us;
+  last_cause_ = cause;
+  const uint32_t now_ms = static_cast<uint32_t>(now_us / 1000);
+  if (duration_us > worst_.duration_us) {
+    worst_.at_ms = now_ms;
+    worst_.duration_us = duration_us;
+    worst_.slot_ms = slot_ms;
+    worst_.cause = cause;
+    for (int i = 0; i < PERF_STAGE_COUNT; i++) {
+      worst_.stage_us[i] = stage_us[i];
+    }
+  }
+
+  if (window_misses_ == 0 || now_ms - window_start_ms_ >= kAlertWindowMs) {
+    window_start_ms_ = now_ms;
+    window_misses_ = 0;
+    window_alerted_ = false;
+  }
+  window_misses_++;
+  if (alert_threshold_ > 0 && !window_alerted_ &&
+      window_misses_ >= alert_threshold_) {
+    window_alerted_ = true;
+    return true;
+  }
+  return false;
+}
+
+void LoopMonitor::reset() {
+  const uint32_t threshold = alert_threshold_;
+  *this = LoopMonitor{};
+  alert_threshold_ = threshold;
+}
+
+std::string LoopMonitor::json() const {
+  std::string out;
+  out.reserve(512);
+  char buf[96];
+  const double met =
+      ticks_ == 0 ? 100.0 : 100.0 * (ticks_ - misses_) / static_cast<double>(ticks_);
+  std::snprintf(buf, sizeof(buf),
+                "{\"type\":\"loop\",\"ticks\":%u,\"miss\":%u,\"met\":%.2f",
+                static_cast<unsigned>(ticks_), static_cast<unsigned>(misses_),
+                met);
+  out += buf;
+  append_counts(out, "edges", kEdgesMs, kBuckets - 1);
+  append_counts(out, "dur", duration_, kBuckets);
+  append_counts(out, "late", lateness_, kBuckets);
+  std::snprintf(buf, sizeof(buf), ",\"max_us\":[%u,%u],\"alert\":%u",
+                static_cast<unsigned>(max_duration_us_),
+                static_cast<unsigned>(max_lateness_us_),
+                static_cast<unsigned>(alert_threshold_));
+  out += buf;
+
+  out += ",\"cause\":{";
+  bool first = true;
+  for (int i = 0; i <= kCauseOther; i++) {
+    if (causes_[i] == 0) {
+      continue;
+    }
+    std::snprintf(buf, sizeof(buf), "%s\"%s\":%u", first ? "" : ",",
+                  cause_name(i), static_cast<unsigned>(causes_[i]));
+    out += buf;
+    first = false;
+  }
+  out += "}";
+
+  if (worst_.duration_us > 0) {
+    std::snprintf(buf, sizeof(buf),
+                  ",\"worst\":{\"t\":%u,\"us\":%u,\"slot\":%u,\"cause\":\"%s\","
+                  "\"stages\":{",
+                  static_cast<unsigned>(worst_.at_ms),
+                  static_cast<unsigned>(worst_.duration_us),
+                  static_cast<unsigned>(worst_.slot_ms),
+                  cause_name(worst_.cause));
+    out += buf;
+    first = true;
+    for (int i = 0; i < PERF_STAGE_COUNT; i++) {
+      if (worst_.stage_us[i] == 0) {
+        continue;
+      }
+      std::snprintf(buf, sizeof(buf), "%s\"%s\":%u", first ? "" : ",",
+                    cause_name(i), static_cast<unsigned>(worst_.stage_us[i]));
+      out += buf;
+      first = false;
+    }
+    out += "}}";
+  }
+  out += "}";
+  return out;
+}
+
+std::string LoopMonitor::alert_json() const {
+  char buf[128];
+  std::snprintf(buf, sizeof(buf),
+                "{\"type\":\"loop\",\"alert\":%u,\"window_ms\":%u,\"us\":%u,"
+                "\"cause\":\"%s\"}",
+                static_cast<unsigned>(window_misses_),
+                static_cast<unsigned>(kAlertWindowMs),
+                static_cast<unsigned>(last_miss_us_), cause_name(last_cause_));
+  return buf;
+}
+
+} // namespace leor
@@ -0,0 +1,292 @@
+#include "leor/mahony.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+
+namespace leor {
+
+namespace {
+
+constexpr float kPi = 3.14159265358979323846f;
+constexpr double kGyroRadPerLsb = 250.0 / 32768.0 * 3.14159265358979323846 / 180.0;
+// Q8 LSB to Q24 rad/s goes through a Q32 factor and a 16-bit shift.
+constexpr int64_t kGyroRadQ32 = static_cast<int64_t>(kGyroRadPerLsb * 4294967296.0 + 0.5);
+// Microseconds to half a second in Q30, as a Q16 factor.
+constexpr int64_t kHalfDtQ16 = static_cast<int64_t>(1073741824.0 / 2000000.0 * 65536.0 + 0.5);
+constexpr int32_t kHalfQ30 = 1 << 29;
+
+inline int32_t mul_q30(int32_t a, int32_t b) {
+    return static_cast<int32_t>((static_cast<int64_t>(a) * b) >> 30);
+}
+
+// 1/sqrt(m / 2^32) for m in [2^30, 2^32), in Q30: a seed from the top four
+// bits (1/sqrt of each bucket's midpoint, within 6%) and three Newton steps,
+// which take it to the last bit of Q30 (two leave 5e-5).
+int64_t inv_sqrt_unit(uint32_t m) {
+    static constexpr uint32_t kSeed[12] = {2024667000, 1831380208, 1684624773, 1568300315,
+                                           1473161629, 1393471397, 1325455684, 1266516759,
+                                           1214800200, 1168942037, 1127913670, 1090922784};
+    int64_t y = kSeed[(m >> 28) - 4];
+    for (int i = 0; i < 3; ++i) {
+        const int64_t y2 = (y * y) >> 30;
+        const int64_t xy2 = (static_cast<int64_t>(m) * y2) >> 32;
+        y = (y * ((3LL << 30) - xy2)) >> 31;
+    }
+    return y;
+}
+
+// Scales `v` to unit length in Q30. False for the zero vector.
+bool normalize(const int64_t* v, int32_t* out, int n) {
+    uint64_t s = 0;
+    for (int i = 0; i < n; ++i) {
+        s += static_cast<uint64_t>(v[i] * v[i]);
+    }
+    if (s == 0) {
+        return false;
+    }
+    // s = m * 2^sh with m in [2^30, 2^32) and sh even, so that
+    // 1/sqrt(s) = inv_sqrt_unit(m) * 2^-(32 + sh) / 2 exactly.
+    int sh = 63 - __builtin_clzll(s) - 31;
+    if (sh & 1) {
+        sh++;
+    }
+    const uint32_t m = static_cast<uint32_t>(sh >= 0 ? s >> sh : s << -sh);
+    const int64_t y = inv_sqrt_unit(m);
+    const int out_shift = (32 + sh) / 2;
+    for (int i = 0; i < n; ++i) {
+        out[i] = static_cast<int32_t>((v[i] * y) >> out_shift);
+    }
+    return true;
+}
+
+}  // namespace
+
+void quaternion_to_euler(const float q[4], float* yaw, float* pitch, float* roll) {
+    *roll = std::atan2((q[0] * q[1] + q[2] * q[3]), 0.5f - (q[1] * q[1] + q[2] * q[2])) * 180.0f / kPi;
+    *pitch = std::asin(2.0f * (q[0] * q[2] - q[1] * q[3])) * 180.0f / kPi;
+    *yaw = -std::atan2((q[1] * q[2] + q[0] * q[3]), 0.5f - (q[2] * q[2] + q[3] * q[3])) * 180.0f / kPi;
+}
+
+void MahonyFloat::reset() {
+    q_[0] = 1.0f;
+    q_[1] = q_[2] = q_[3] = 0.0f;
+    ix_ = iy_ = iz_ = 0.0f;
+}
+
+void MahonyFloat::quaternion(float q[4]) const {
+    std::copy(q_, q_ + 4, q);
+}
+
+void MahonyFloat::update(float ax, float ay, float az, float gx, float gy, float gz, uint32_t dt_us) {
+    float dt = static_cast<float>(dt_us) * 1.0e-6f;
+    const float tmp = ax * ax + ay * ay + az * az;
+    if (tmp > 0.0f) {
+        const float recip_norm = 1.0f / std::sqrt(tmp);
+        ax *= recip_norm;
+        ay *= recip_norm;
+        az *= recip_norm;
+
+        const float vx = q_[1] * q_[3] - q_[0] * q_[2];
+        const float vy = q_[0] * q_[1] + q_[2] * q_[3];
+        const float vz = q_[0] * q_[0] - 0.5f + q_[3] * q_[3];
+
+        const float ex = ay * vz - az * vy;
+        const float ey = az * vx - ax * vz;
+        const float ez = ax * vy - ay * vx;
+
+        if (ki_ > 0.0f) {
+            ix_ += ki_ * ex * dt;
+            iy_ += ki_ * ey * dt;
+            iz_ += ki_ * ez * dt;
+            gx += ix_;
+            gy += iy_;
+            gz += iz_;
+        }
+
+        gx += kp_ * ex;
+        gy += kp_ * ey;
+        gz += kp_ * ez;
+    }
+
+    dt *= 0.5f;
+    gx *= dt;
+    gy *= dt;
+    gz *= dt;
+    const float qa = q_[0], qb = q_[1], qc = q_[2];
+
+    q_[0] += (-qb * gx - qc * gy - q_[3] * gz);
+    q_[1] += (qa * gx + qc * gz - q_[3] * gy);
+    q_[2] += (qa * gy - qb * gz + q_[3] * gx);
+    q_[3] += (qa * gz + qb * gy - qc * gx);
+
+    const float recip_norm = 1.0f / std::sqrt(q_[0] * q_[0] + q_[1] * q_[1] + q_[2] * q_[2] + q_[3] * q_[3]);
+    q_[0] *= recip_norm;
+    q_[1] *= recip_norm;
+    q_[2] *= recip_norm;
+    q_[3] *= recip_norm;
+}
+
+void MahonyFixed::reset() {
+    q_[0] = 1 << 30;
+    q_[1] = q_[2] = q_[3] = 0;
+    i_[0] = i_[1] = i_[2] = 0;
+}
+
+void MahonyFixed::set_gains(float kp, float ki) {
+    kp_ = static_cast<int32_t>(kp * 65536.0f);
+    ki_ = static_cast<int32_t>(ki * 65536.0f);
+}
+
+void MahonyFixed::quaternion(float q[4]) const {
+    for (int i = 0; i < 4; ++i) {
+        q[i] = static_cast<float>(q_[i]) * (1.0f / 1073741824.0f);
+    }
+}
+
+void MahonyFixed::update(int32_t ax, int32_t ay, int32_t az, int32_t gx_q8, int32_t gy_q8, int32_t gz_q8,
+                         uint32_t dt_us) {
+    // Q24 rad/s.
+    int64_t g[3] = {(gx_q8 * kGyroRadQ32) >> 16, (gy_q8 * kGyroRadQ32) >> 16, (gz_q8 * kGyroRadQ32) >> 16};
+    const int64_t half_dt = (static_cast<int64_t>(dt_us) * kHalfDtQ16) >> 16;  // Q30 s
+
+    const int64_t a_raw[3] = {ax, ay, az};
+    int32_t a[3];
+    if (normalize(a_raw, a, 3)) {
+        const int32_t vx = mul_q30(q_[1], q_[3]) - mul_q30(q_[0], q_[2]);
+        const int32_t vy = mul_q30(q_[0], q_[1]) + mul_q30(q_[2], q_[3]);
+        const int32_t vz = mul_q30(q_[0], q_[0]) - kHalfQ30 + mul_q30(q_[3], q_[3]);
+
+        const int64_t e[3] = {
+            static_cast<int64_t>(mul_q30(a[1], vz)) - mul_q30(a[2], vy),
+            static_cast<int64_t>(mul_q30(a[2], vx)) - mul_q30(a[0], vz),
+            static_cast<int64_t>(mul_q30(a[0], vy)) - mul_q30(a[1], vx),
+        };
+        for (int k = 0; k < 3; ++k) {
+            if (ki_ > 0) {
+                i_[k] += (((ki_ * e[k]) >> 22) * (2 * half_dt)) >> 30;
+                g[k] += i_[k];
+            }
+            g[k] += (kp_ * e[k]) >> 22;  // Q16 * Q30 -> Q24
+        }
+    }
+
+    // Half-angle increments, Q30.
+    const int64_t hx = (g[0] * half_dt) >> 24;
+    const int64_t hy = (g[1] * half_dt) >> 24;
+    const int64_t hz = (g[2] * half_dt) >> 24;
+    const int64_t q0 = q_[0], q1 = q_[1], q2 = q_[2], q3 = q_[3];
+    const int64_t next[4] = {
+        q0 + ((-q1 * hx - q2 * hy - q3 * hz) >> 30),
+        q1 + ((q0 * hx + q2 * hz - q3 * hy) >> 30),
+        q2 + ((q0 * hy - q1 * hz + q3 * hx) >> 30),
+        q3 + ((q0 * hz + q1 * hy - q2 * hx) >> 30),
+    };
+    normalize(next, q_, 4);
+}
+
+std::string mahony_bench_json(uint32_t samples) {
+    struct Sample {
+        int16_t a[3];
+        int16_t g[3];
+    };
+    constexpr uint32_t kDtUs = 20000;
+
+    // A sensor tumbling on all three axes (up to ~115 dps) with a few LSB of
+    // noise, integrated in double from the same quaternion kinematics.
+    std::vector<Sample> input(samples);
+    double q[4] = {1.0, 0.0, 0.0, 0.0};
+    uint32_t rng = 0x2545F491u;
+    auto noise = [&rng](int amplitude) {
+        rng = rng * 1664525u + 1013904223u;
+        return static_cast<int>((rng >> 16) % (2 * amplitude + 1)) - amplitude;
+    };
+    auto clamp16 = [](double v) {
+        return static_cast<int16_t>(std::max(-32768.0, std::min(32767.0, std::round(v))));
+    };
+    for (uint32_t i = 0; i < samples; ++i) {
+        const double t = i * (kDtUs * 1.0e-6);
+        const double w[3] = {2.0 * std::sin(2.0 * 3.14159265358979 * 0.3 * t),
+                             1.5 * std::sin(2.0 * 3.14159265358979 * 0.45 * t + 1.0),
+                             1.0 * std::cos(2.0 * 3.14159265358979 * 0.2 * t)};
+        const double v[3] = {2.0 * (q[1] * q[3] - q[0] * q[2]), 2.0 * (q[0] * q[1] + q[2] * q[3]),
+                             q[0] * q[0] - q[1] * q[1] - q[2] * q[2] + q[3] * q[3]};
+        for (int k = 0; k < 3; ++k) {
+            input[i].a[k] = clamp16(v[k] * 16384.0 + noise(60));
+            input[i].g[k] = clamp16(w[k] / kGyroRadPerLsb + noise(20));
+        }
+        const double h = 0.5 * kDtUs * 1.0e-6;
+        const double n[4] = {q[0] + h * (-q[1] * w[0] - q[2] * w[1] - q[3] * w[2]),
+                             q[1] + h * (q[0] * w[0] + q[2] * w[2] - q[3] * w[1]),
+                             q[2] + h * (q[0] * w[1] - q[1] * w[2] + q[3] * w[0]),
+                             q[3] + h * (q[0] * w[2] + q[1] * w[1] - q[2] * w[0])};
+        const double norm = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2] + n[3] * n[3]);
+        for (int k = 0; k < 4; ++k) {
+            q[k] = n[k] / norm;
+        }
+    }
+
+    const float gscale = static_cast<float>(kGyroRadPerLsb);
+    MahonyFloat flt;
+    MahonyFixed fix;
+    flt.set_gains(30.0f, 0.0f);
+    fix.set_gains(30.0f, 0.0f);
+
+    esp_cpu_cycle_count_t start = esp_cpu_get_cycle_count();
+    for (const Sample& s : input) {
+        flt.update(s.a[0], s.a[1], s.a[2], s.g[0] * gscale, s.g[1] * gscale, s.g[2] * gscale, kDtUs);
+    }
+    const uint32_t float_cycles = esp_cpu_get_cycle_count() - start;
+
+    start = esp_cpu_get_cycle_count();
+    for (const Sample& s : input) {
+        fix.update(s.a[0], s.a[1], s.a[2], s.g[0] * 256, s.g[1] * 256, s.g[2] * 256, kDtUs);
+    }
+    const uint32_t fixed_cycles = esp_cpu_get_cycle_count() - start;
+
+    // Accuracy on a second, untimed pass: Euler angles after every sample.
+    flt.reset();
+    fix.reset();
+    double max_err[3] = {0.0, 0.0, 0.0};
+    double sum_sq[3] = {0.0, 0.0, 0.0};
+    uint32_t euler_cycles = 0;
+    for (const Sample& s : input) {
+        flt.update(s.a[0], s.a[1], s.a[2], s.g[0] * gscale, s.g[1] * gscale, s.g[2] * gscale, kDtUs);
+        fix.update(s.a[0], s.a[1], s.a[2], s.g[0] * 256, s.g[1] * 256, s.g[2] * 256, kDtUs);
+        float qf[4];
+        float qx[4];
+        flt.quaternion(qf);
+        fix.quaternion(qx);
+        float ef[3];
+        float ex[3];
+        start = esp_cpu_get_cycle_count();
+        quaternion_to_euler(qf, &ef[2], &ef[0], &ef[1]);
+        euler_cycles += esp_cpu_get_cycle_count() - start;
+        quaternion_to_euler(qx, &ex[2], &ex[0], &ex[1]);
+        for (int k = 0; k < 3; ++k) {
+            double d = std::fabs(static_cast<double>(ef[k]) - ex[k]);
+            if (d > 180.0) {
+                d = 360.0 - d;  // yaw and roll wrap
+            }
+            max_err[k] = std::max(max_err[k], d);
+            sum_sq[k] += d * d;
+        }
+    }
+
+    const uint32_t n = samples > 0 ? samples : 1;
+    char buf[320];
+    std::snprintf(buf, sizeof(buf),
+                  "{\"type\":\"ahrs\",\"n\":%u,\"mhz\":%u,\"cyc\":{\"float\":%u,\"fixed\":%u,\"euler\":%u},"
+                  "\"max_deg\":[%.4f,%.4f,%.4f],\"rms_deg\":[%.4f,%.4f,%.4f]}",
+                  static_cast<unsigned>(samples), static_cast<unsigned>(esp_rom_get_cpu_ticks_per_us()),
+                  static_cast<unsigned>(float_cycles / n), static_cast<unsigned>(fixed_cycles / n),
+                  static_cast<unsigned>(euler_cycles / n), max_err[0], max_err[1], max_err[2],
+                  std::sqrt(sum_sq[0] / n), std::sqrt(sum_sq[1] / n), std::sqrt(sum_sq[2] / n));
+    return buf;
+}
+
+}  // namespace leor
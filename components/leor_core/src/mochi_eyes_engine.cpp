@@ -3,8 +3,14 @@
 #include <cmath>
 #include <cstdlib>
 
+#include "leor/profiler.hpp"
+#include "leor/time_source.hpp"
+
 namespace leor {
 
+static_assert(PERF_SEND - PERF_TIMERS == STAGE_SEND - STAGE_TIMERS,
+              "PerfStage must mirror FrameStage");
+
 // ---------------------------------------------------------------------------
 // Expression presets – ported from esp32-eyes EyePresets.h
 // [0] = right eye (or both if symmetric), [1] = left eye (or alternate)
@@ -85,13 +91,27 @@ MochiEyesEngine::MochiEyesEngine(DisplayBackend &display) : display_(display) {
   params.reset();
   targets.reset();
   timers.reset();
+  budget.reset(kDefaultFrameBudgetUs);
 
   lastFrameMs = 0;
-  frameInterval = 20; // 50fps default
+  frameInterval = kMinFrameIntervalMs;
+  quiescent = false;
+  motion = MOTION_FAST;
+  frameValid = false;
+  drawnPoseKey = 0;
 
+  resetSweat();
+}
+
+void MochiEyesEngine::seedRandom(uint32_t seed) {
+  rng.seed(seed, RngStream::kEyes);
+  resetSweat();
+}
+
+void MochiEyesEngine::resetSweat() {
   for (int i = 0; i < 3; i++) {
-    sweatX[i] = std::rand() % layout.screenW;
-    sweatY[i] = std::rand() % 20;
+    sweatX[i] = rng.below(layout.screenW);
+    sweatY[i] = rng.below(20);
     sweatSize[i] = 2;
   }
 }
@@ -103,6 +123,7 @@ void MochiEyesEngine::begin() {
 
   display_.clear();
   display_.send_buffer();
+  invalidate();
 
   params.openness = 0.0f;
   params.leftOpenness = 1.0f;
@@ -110,13 +131,42 @@ void MochiEyesEngine::begin() {
   targets.openness = 1.0f;
 }
 
+void MochiEyesEngine::saveSnapshot(FaceSnapshot &out) const {
+  out.layout = layout;
+  out.params = params;
+  out.targets = targets;
+  out.timers = timers;
+}
+
+void MochiEyesEngine::restoreSnapshot(const FaceSnapshot &in) {
+  const int16_t screenW = layout.screenW;
+  const int16_t screenH = layout.screenH;
+  layout = in.layout;
+  layout.screenW = screenW;
+  layout.screenH = screenH;
+  layout.recompute();
+  params = in.params;
+  targets = in.targets;
+  timers = in.timers;
+  // Absolute times belong to the previous boot; armTimers() rebuilds them
+  // on the first update().
+  timers.mouthAnimEndMs = 0;
+  timers.breathingLastMs = 0;
+  lastFrameMs = 0;
+  invalidate();
+}
+
 void MochiEyesEngine::update(uint32_t now_ms) {
   if (lastFrameMs != 0 && now_ms - lastFrameMs < frameInterval)
     return;
 
   float dt = (now_ms - lastFrameMs) / 1000.0f;
-  if (lastFrameMs == 0)
+  if (lastFrameMs == 0) {
     dt = 0.02f;
+    // Anything scheduled before the first frame was relative to t=0.
+    wheel.reset(now_ms);
+    armTimers();
+  }
   if (dt > 0.1f)
     dt = 0.1f; // Clamp max dt to prevent animation explosions
   lastFrameMs = now_ms;
@@ -124,24 +174,327 @@ void MochiEyesEngine::update(uint32_t now_ms) {
   render.saveOldDirty();
   render.resetDirty();
 
-  updateTimers(dt);
+  const int64_t frameStartUs = now_us();
+  int64_t stageStartUs = frameStartUs;
+  PerfLap perf;
+  auto endStage = [&](FrameStage stage) {
+    const int64_t nowUs = now_us();
+    const uint32_t costUs = static_cast<uint32_t>(nowUs - stageStartUs);
+    budget.stageUs[stage] = (budget.stageUs[stage] * 7 + costUs) / 8;
+    stageStartUs = nowUs;
+    perf.lap(static_cast<PerfStage>(PERF_TIMERS + stage));
+  };
+
+  const uint32_t fired = wheel.advance(now_ms);
+  updateTimers(dt, fired);
+  endStage(STAGE_TIMERS);
   updateParams(dt);
   computeRenderState();
+  endStage(STAGE_PARAMS);
+
+  // Nothing moving and no timer fired: the panel already shows this frame.
+  const bool wasQuiescent = quiescent;
+  quiescent = computeQuiescent();
+  motion = computeMotion();
+  const uint32_t key = poseKey();
+  if (quiescent && wasQuiescent && frameValid && fired == 0 &&
+      key == drawnPoseKey) {
+    budget.framesIdle++;
+    return;
+  }
+
+  const bool overlays = overlaysActive();
+  if (shouldReuseFrame(overlays)) {
+    // Previous frame (overlay included) stays on screen; animation state
+    // above has still advanced so the next rendered frame catches up.
+    budget.framesReused++;
+    return;
+  }
 
   // Always clear full screen to prevent parametric shape artifacts
   display_.clear();
 
   drawEyes();
+  endStage(STAGE_EYES);
   drawMouth();
+  endStage(STAGE_MOUTH);
   drawSweat();
+  endStage(STAGE_SWEAT);
   drawLoveOverlay();
+  endStage(STAGE_LOVE);
   drawUwUOverlay();
+  endStage(STAGE_UWU);
   drawXDOverlay();
+  endStage(STAGE_XD);
   drawTears();
+  endStage(STAGE_TEARS);
   drawKnockedOverlay();
+  endStage(STAGE_KNOCKED);
   drawSleepOverlay();
+  endStage(STAGE_SLEEP);
 
   display_.send_buffer();
+  endStage(STAGE_SEND);
+
+  // Only a frame drawn once everything settled can stand in for later ones.
+  frameValid = quiescent;
+  drawnPoseKey = key;
+
+  accountFrame(static_cast<uint32_t>(stageStartUs - frameStartUs), overlays);
+}
+
+void MochiEyesEngine::armTimers() {
+  if (timers.autoBlink)
+    wheel.schedule_in(TIMER_BLINK, 2000);
+  if (timers.idleMode)
+    wheel.schedule_in(TIMER_SACCADE, 500);
+  if (timers.breathingEnabled) {
+    timers.breathingLastMs = wheel.now_ms();
+    wheel.schedule_in(TIMER_BREATH, 0);
+  }
+  if (timers.mouthAnimType != 0) {
+    timers.mouthAnimEndMs = wheel.now_ms() + timers.mouthAnimDurationMs;
+    wheel.schedule(TIMER_MOUTH_ANIM, timers.mouthAnimEndMs);
+  }
+}
+
+void MochiEyesEngine::scheduleBlink() {
+  if (!timers.autoBlink)
+    return;
+  float intervalVariation = ((float)rng.below(200) - 50.0f) / 100.0f;
+  float delay =
+      timers.blinkInterval + (intervalVariation * timers.blinkVariation);
+  if (delay < 1.0f)
+    delay = 1.0f;
+  wheel.schedule_in(TIMER_BLINK, static_cast<uint32_t>(delay * 1000.0f));
+}
+
+uint32_t MochiEyesEngine::breathStepMs() const {
+  // Step so the squish moves about one pixel per tick at peak slope; slower
+  // or shallower breathing needs correspondingly fewer wakeups.
+  const float pxPerSec = timers.breathingIntensity * timers.breathingSpeed *
+                         6.28318f * static_cast<float>(layout.baseHeight);
+  if (pxPerSec <= 0.0f)
+    return kMaxBreathStepMs;
+  const float stepMs = 1000.0f / pxPerSec;
+  if (stepMs < static_cast<float>(frameInterval))
+    return frameInterval;
+  if (stepMs > static_cast<float>(kMaxBreathStepMs))
+    return kMaxBreathStepMs;
+  return static_cast<uint32_t>(stepMs);
+}
+
+void MochiEyesEngine::stepBreathing() {
+  // Advance by real elapsed time rather than the clamped frame dt so long
+  // idle gaps keep the breathing period intact.
+  const uint32_t nowMs = wheel.now_ms();
+  const float elapsed = (nowMs - timers.breathingLastMs) / 1000.0f;
+  timers.breathingLastMs = nowMs;
+  timers.breathingPhase = std::fmod(
+      timers.breathingPhase + elapsed * timers.breathingSpeed * 6.28318f,
+      6.28318f);
+  timers.breathingSquish =
+      1.0f + std::sin(timers.breathingPhase) * timers.breathingIntensity;
+
+  // Steps are about a pixel, so snapping is invisible and lets the face
+  // settle between ticks instead of easing for several frames.
+  if (params.curiousIntensity <= 0.01f &&
+      std::fabs(params.squish - timers.breathingSquish) * layout.baseHeight <
+          1.5f) {
+    params.squish = timers.breathingSquish;
+  }
+  wheel.schedule_in(TIMER_BREATH, breathStepMs());
+}
+
+bool MochiEyesEngine::computeQuiescent() const {
+  constexpr float kEps = 0.002f;
+  auto settled = [](float current, float target) {
+    return std::fabs(current - target) < kEps;
+  };
+  auto shapeSettled = [&](const EyeShapeConfig &c, const EyeShapeConfig &t) {
+    return c.OffsetX == t.OffsetX && c.OffsetY == t.OffsetY &&
+           c.Width == t.Width && c.Height == t.Height &&
+           c.Radius_Top == t.Radius_Top &&
+           c.Radius_Bottom == t.Radius_Bottom &&
+           settled(c.Slope_Top, t.Slope_Top) &&
+           settled(c.Slope_Bottom, t.Slope_Bottom);
+  };
+
+  // Phase-driven effects animate every frame regardless of targets.
+  if (timers.mouthAnimType != 0 || params.mouthShape != params.targetMouthShape ||
+      targets.love > 0.5f || targets.fatigue > 0.3f ||
+      params.confusedIntensity > 0.1f || params.laughIntensity > 0.1f ||
+      params.knockedIntensity > 0.1f || params.curiousIntensity > 0.01f ||
+      params.sweatIntensity >= 0.1f || params.sleepIntensity > 0.1f)
+    return false;
+
+  return settled(params.openness, targets.openness) &&
+         settled(params.leftOpenness, targets.leftOpenness) &&
+         settled(params.rightOpenness, targets.rightOpenness) &&
+         settled(params.squish, targets.squish) &&
+         settled(params.gazeX, targets.gazeX) &&
+         settled(params.gazeY, targets.gazeY) &&
+         settled(params.joy, targets.joy) &&
+         settled(params.anger, targets.anger) &&
+         settled(params.fatigue, targets.fatigue) &&
+         settled(params.love, targets.love) &&
+         settled(params.mouthOpenness, targets.mouthOpenness) &&
+         settled(params.heartScale, targets.heartScale) &&
+         settled(params.knockedIntensity, targets.knockedIntensity) &&
+         settled(params.sweatIntensity, targets.sweatIntensity) &&
+         settled(params.curiousIntensity, targets.curiousIntensity) &&
+         settled(params.uwuIntensity, targets.uwuIntensity) &&
+         settled(params.xdIntensity, targets.xdIntensity) &&
+         settled(params.sleepIntensity, targets.sleepIntensity) &&
+         shapeSettled(params.leftShape, params.leftShapeTarget) &&
+         shapeSettled(params.rightShape, params.rightShapeTarget);
+}
+
+MotionLevel MochiEyesEngine::computeMotion() const {
+  if (quiescent)
+    return MOTION_IDLE;
+
+  // A 5% gap on a 36 px eye is a couple of pixels per frame at the default
+  // speeds: smooth only at full rate.
+  constexpr float kFastDelta = 0.05f;
+  auto moving = [](float current, float target) {
+    return std::fabs(current - target) > kFastDelta;
+  };
+  auto shapeMoving = [](const EyeShapeConfig &c, const EyeShapeConfig &t) {
+    return std::abs(c.OffsetX - t.OffsetX) > 1 ||
+           std::abs(c.OffsetY - t.OffsetY) > 1 ||
+           std::abs(c.Width - t.Width) > 1 ||
+           std::abs(c.Height - t.Height) > 1 ||
+           std::abs(c.Radius_Top - t.Radius_Top) > 1 ||
+           std::abs(c.Radius_Bottom - t.Radius_Bottom) > 1;
+  };
+  if (moving(params.openness, targets.openness) ||
+      moving(params.leftOpenness, targets.leftOpenness) ||
+      moving(params.rightOpenness, targets.rightOpenness) ||
+      moving(params.squish, targets.squish) ||
+      moving(params.gazeX, targets.gazeX) ||
+      moving(params.gazeY, targets.gazeY) ||
+      moving(params.joy, targets.joy) ||
+      moving(params.anger, targets.anger) ||
+      moving(params.mouthOpenness, targets.mouthOpenness) ||
+      params.hFlicker != 0.0f || params.vFlicker != 0.0f ||
+      params.laughIntensity > 0.1f ||
+      shapeMoving(params.leftShape, params.leftShapeTarget) ||
+      shapeMoving(params.rightShape, params.rightShapeTarget))
+    return MOTION_FAST;
+
+  if (timers.mouthAnimType != 0 || params.mouthShape != params.targetMouthShape ||
+      overlaysActive() || targets.fatigue > 0.3f ||
+      params.confusedIntensity > 0.1f || params.curiousIntensity > 0.01f)
+    return MOTION_AMBIENT;
+
+  return MOTION_SETTLING;
+}
+
+uint32_t MochiEyesEngine::nextEventMs() const {
+  if (!quiescent || !frameValid)
+    return lastFrameMs + frameInterval;
+  const uint32_t horizon = lastFrameMs + kMaxIdleMs;
+  if (wheel.empty())
+    return horizon;
+  const uint32_t next = wheel.next_deadline_ms();
+  return time_reached(next, horizon) ? horizon : next;
+}
+
+void MochiEyesEngine::setFrameBudget(uint32_t budgetUs) {
+  if (budgetUs < 1000)
+    budgetUs = 1000;
+  budget.budgetUs = budgetUs;
+  budget.overStreak = 0;
+  budget.headroomStreak = 0;
+}
+
+bool MochiEyesEngine::overlaysActive() const {
+  return params.sweatIntensity >= 0.1f || params.love >= 0.1f ||
+         params.uwuIntensity >= 0.1f || params.xdIntensity >= 0.1f ||
+         params.tearProgress > 0 || params.knockedIntensity >= 0.05f ||
+         params.sleepIntensity >= 0.3f;
+}
+
+uint32_t MochiEyesEngine::poseKey() const {
+  // Cheap FNV-1a over the integer geometry that ends up on screen.
+  const int16_t fields[] = {
+      render.leftX,  render.leftY,  render.leftW,  render.leftH,
+      render.rightX, render.rightY, render.rightW, render.rightH,
+      render.mouthX, render.mouthY, render.mouthH,
+      params.leftShape.Width,  params.leftShape.Height,
+      params.rightShape.Width, params.rightShape.Height,
+      static_cast<int16_t>(params.mouthShape)};
+  uint32_t hash = 2166136261u;
+  for (int16_t v : fields) {
+    hash = (hash ^ static_cast<uint16_t>(v)) * 16777619u;
+  }
+  return hash;
+}
+
+bool MochiEyesEngine::shouldReuseFrame(bool overlays) {
+  if (!overlays || budget.level < DEGRADE_REUSE_OVERLAY) {
+    budget.reuseStreak = 0;
+    return false;
+  }
+
+  bool reuse = false;
+  if (budget.level >= DEGRADE_HALF_RATE) {
+    budget.halfRateSkip = !budget.halfRateSkip;
+    reuse = budget.halfRateSkip;
+  }
+  // Never hold a frame for more than two ticks so overlays keep moving.
+  if (!reuse && budget.reuseStreak < 2 && poseKey() == budget.lastPoseKey) {
+    reuse = true;
+  }
+  if (reuse && budget.reuseStreak >= 2) {
+    reuse = false;
+  }
+
+  if (reuse) {
+    budget.reuseStreak++;
+  } else {
+    budget.reuseStreak = 0;
+    budget.lastPoseKey = poseKey();
+  }
+  return reuse;
+}
+
+void MochiEyesEngine::accountFrame(uint32_t frameUs, bool overlays) {
+  static constexpr uint16_t kDegradeAfterFrames = 3;
+  static constexpr uint16_t kRestoreAfterFrames = 30;
+
+  budget.framesRendered++;
+  budget.lastFrameUs = frameUs;
+  budget.avgFrameUs = (budget.avgFrameUs * 7 + frameUs) / 8;
+
+  if (frameUs > budget.budgetUs) {
+    budget.framesOverBudget++;
+    budget.headroomStreak = 0;
+    // Only overlay work can be shed; escalating without overlays on screen
+    // would just delay recovery once they appear.
+    if (overlays && budget.level < DEGRADE_HALF_RATE &&
+        ++budget.overStreak >= kDegradeAfterFrames) {
+      budget.level = static_cast<DegradeLevel>(budget.level + 1);
+      budget.degradeEvents++;
+      budget.overStreak = 0;
+    }
+    return;
+  }
+
+  budget.overStreak = 0;
+  if (budget.level == DEGRADE_NONE)
+    return;
+  // Restore only with clear headroom (75% of budget) to avoid oscillating.
+  if (frameUs * 4 < budget.budgetUs * 3) {
+    if (++budget.headroomStreak >= kRestoreAfterFrames) {
+      budget.level = static_cast<DegradeLevel>(budget.level - 1);
+      budget.restoreEvents++;
+      budget.headroomStreak = 0;
+    }
+  } else {
+    budget.headroomStreak = 0;
+  }
 }
 
 void MochiEyesEngine::lerpShape(EyeShapeConfig& current, const EyeShapeConfig& target, float speed, float dt) {
@@ -219,7 +572,7 @@ void MochiEyesEngine::updateParams(float dt) {
   lerpShape(params.rightShape, params.rightShapeTarget, shapeSpeed, dt);
 }
 
-void MochiEyesEngine::updateTimers(float dt) {
+void MochiEyesEngine::updateTimers(float dt, uint32_t fired) {
   if (params.mouthShape != params.targetMouthShape) {
     params.mouthTransition += dt * 8.0f;
     if (params.mouthTransition >= 1.0f) {
@@ -232,9 +585,13 @@ void MochiEyesEngine::updateTimers(float dt) {
     params.mouthShape = MOUTH_OOO;
   }
 
-  if (timers.mouthAnimRemaining > 0) {
-    timers.mouthAnimRemaining -= dt;
-    float t = timers.mouthAnimRemaining;
+  if (fired & (1u << TIMER_MOUTH_ANIM)) {
+    targets.mouthOpenness = 0.0f;
+    timers.mouthAnimType = 0;
+  } else if (timers.mouthAnimType != 0) {
+    const int32_t remainingMs =
+        static_cast<int32_t>(timers.mouthAnimEndMs - lastFrameMs);
+    float t = remainingMs > 0 ? remainingMs / 1000.0f : 0.0f;
 
     switch (timers.mouthAnimType) {
     case 1:
@@ -249,9 +606,6 @@ void MochiEyesEngine::updateTimers(float dt) {
           0.3f + std::sin(t * 15.0f) * 0.2f + std::cos(t * 7.0f) * 0.1f;
       break;
     }
-  } else if (timers.mouthAnimType != 0) {
-    targets.mouthOpenness = 0.0f;
-    timers.mouthAnimType = 0;
   }
 
   if (targets.love > 0.5f) {
@@ -289,10 +643,9 @@ void MochiEyesEngine::updateTimers(float dt) {
     params.spiralAngle += dt * 8.0f;
   }
 
-  if (timers.autoBlink && params.knockedIntensity < 0.5f) {
-    timers.blinkCooldown -= dt;
-    if (timers.blinkCooldown <= 0) {
-      int blinkRoll = std::rand() % 100;
+  if (fired & (1u << TIMER_BLINK)) {
+    if (timers.autoBlink && params.knockedIntensity < 0.5f) {
+      int blinkRoll = static_cast<int>(rng.below(100));
       if (blinkRoll < 60)
         timers.nextBlinkType = 0;
       else if (blinkRoll < 75)
@@ -327,7 +680,7 @@ void MochiEyesEngine::updateTimers(float dt) {
         targets.openness = 1.0f;
         break;
       case 4:
-        if ((std::rand() % 2) == 0) {
+        if (rng.below(2) == 0) {
           params.leftOpenness = 0.0f;
           targets.leftOpenness = 1.0f;
           params.rightOpenness = 0.3f;
@@ -343,30 +696,25 @@ void MochiEyesEngine::updateTimers(float dt) {
         targets.openness = 1.0f;
         break;
       }
-
-      float intervalVariation = ((float)(std::rand() % 200) - 50.0f) / 100.0f;
-      timers.blinkCooldown =
-          timers.blinkInterval + (intervalVariation * timers.blinkVariation);
-      if (timers.blinkCooldown < 1.0f)
-        timers.blinkCooldown = 1.0f;
     }
+    // Knocked-out faces skip the blink but keep the cadence.
+    scheduleBlink();
   }
 
-  if (timers.idleMode) {
-    timers.idleCooldown -= dt;
-    if (timers.idleCooldown <= 0) {
-      targets.gazeX = ((float)(std::rand() % 200) - 100.0f) / 100.0f;
-      targets.gazeY = ((float)(std::rand() % 200) - 100.0f) / 100.0f;
-      timers.idleCooldown =
-          timers.idleInterval +
-          ((float)(std::rand() % 100) / 100.0f) * timers.idleVariation;
-    }
+  if ((fired & (1u << TIMER_SACCADE)) && timers.idleMode) {
+    targets.gazeX = ((float)rng.below(200) - 100.0f) / 100.0f;
+    targets.gazeY = ((float)rng.below(200) - 100.0f) / 100.0f;
+    const float delay =
+        timers.idleInterval +
+        ((float)rng.below(100) / 100.0f) * timers.idleVariation;
+    wheel.schedule_in(TIMER_SACCADE, static_cast<uint32_t>(delay * 1000.0f));
   }
 
+  if ((fired & (1u << TIMER_BREATH)) && timers.breathingEnabled) {
+    stepBreathing();
+  }
   if (timers.breathingEnabled) {
-    timers.breathingPhase += dt * timers.breathingSpeed * 6.28318f;
-    float breathCycle = std::sin(timers.breathingPhase);
-    targets.squish = 1.0f + (breathCycle * timers.breathingIntensity);
+    targets.squish = timers.breathingSquish;
   }
 
   if (params.curiousIntensity > 0.01f) {
@@ -867,14 +1215,15 @@ void MochiEyesEngine::drawHeart(int16_t cx, int16_t cy, float scale) {
   float pulse = 1.0f + std::sin(params.heartPulse) * 0.15f;
   scale *= pulse;
 
-  constexpr int kSegments = 64;
-  int16_t px[kSegments + 1];
-  int16_t py[kSegments + 1];
+  constexpr int kMaxSegments = 64;
+  const int segments = kMaxSegments / particleStride();
+  int16_t px[kMaxSegments + 1];
+  int16_t py[kMaxSegments + 1];
 
   const float s = std::max(0.65f, scale * 0.92f);
-  for (int i = 0; i <= kSegments; ++i) {
+  for (int i = 0; i <= segments; ++i) {
     const float t = (2.0f * 3.1415926f * static_cast<float>(i)) /
-                    static_cast<float>(kSegments);
+                    static_cast<float>(segments);
     const float st = std::sin(t);
     const float ct = std::cos(t);
     const float x = 16.0f * st * st * st;
@@ -884,7 +1233,7 @@ void MochiEyesEngine::drawHeart(int16_t cx, int16_t cy, float scale) {
     py[i] = cy - static_cast<int16_t>(y * s) + static_cast<int16_t>(2.0f * s);
   }
 
-  for (int i = 0; i < kSegments; ++i) {
+  for (int i = 0; i < segments; ++i) {
     fillTriangle(cx, cy, px[i], py[i], px[i + 1], py[i + 1], MAINCOLOR);
   }
 }
@@ -965,7 +1314,8 @@ void MochiEyesEngine::drawUwUOverlay() {
 
     int16_t totalSteps = legH * 2 + (int16_t)(3.14159f * halfW);
 
-    for (int16_t step = 0; step <= totalSteps; step++) {
+    const int16_t stepInc = particleStride();
+    for (int16_t step = 0; step <= totalSteps; step += stepInc) {
       float t = (float)step / (float)totalSteps;
       int16_t px, py;
       float radius;
@@ -1019,7 +1369,7 @@ void MochiEyesEngine::drawUwUOverlay() {
   float edgeThick = 1.0f;
   float centerThick = 2.5f;
 
-  for (int16_t angle = 0; angle <= 180; angle += 4) {
+  for (int16_t angle = 0; angle <= 180; angle += 4 * particleStride()) {
     float t = (float)(180 - angle) / 180.0f;
     float rad = angle * 3.14159f / 180.0f;
     int16_t px = mouthCX - bumpR - (int16_t)(bumpR * std::cos(rad));
@@ -1031,7 +1381,7 @@ void MochiEyesEngine::drawUwUOverlay() {
       drawPixel(px, py, MAINCOLOR);
   }
 
-  for (int16_t angle = 0; angle <= 180; angle += 4) {
+  for (int16_t angle = 0; angle <= 180; angle += 4 * particleStride()) {
     float t = (float)(180 - angle) / 180.0f;
     float rad = angle * 3.14159f / 180.0f;
     int16_t px = mouthCX + bumpR + (int16_t)(bumpR * std::cos(rad));
@@ -1123,7 +1473,10 @@ void MochiEyesEngine::drawXDOverlay() {
   int16_t mouthY = render.mouthY;
   int16_t radius = mouthW / 2;
 
-  for (int16_t angle = 0; angle <= 180; angle++) {
+  // Fan fill; the 1-degree step is only needed for a solid look at full
+  // quality, 3 degrees still covers the 20px mouth when over budget.
+  const int16_t angleStep = particleStride() > 1 ? 3 : 1;
+  for (int16_t angle = 0; angle <= 180; angle += angleStep) {
     float rad = angle * 3.14159f / 180.0f;
     int16_t x = layout.centerX + (int16_t)(radius * std::cos(rad));
     int16_t y = mouthY + (int16_t)(mouthH * std::sin(rad));
@@ -1163,6 +1516,7 @@ void MochiEyesEngine::drawSpiral(int16_t cx, int16_t cy, int16_t maxRadius) {
   float angle = params.spiralAngle;
   float radius = 3;
   int prevX = cx, prevY = cy;
+  const float stride = static_cast<float>(particleStride());
 
   while (radius < maxRadius) {
     int x = cx + (int)(std::cos(angle) * radius);
@@ -1172,8 +1526,8 @@ void MochiEyesEngine::drawSpiral(int16_t cx, int16_t cy, int16_t maxRadius) {
     drawLine(prevX, prevY + 1, x, y + 1, MAINCOLOR);
     prevX = x;
     prevY = y;
-    angle += 0.25f;
-    radius += 0.5f;
+    angle += 0.25f * stride;
+    radius += 0.5f * stride;
   }
 }
 
@@ -1211,13 +1565,13 @@ void MochiEyesEngine::drawSweat() {
 
   for (int i = 0; i < 3; i++) {
     sweatY[i] += 0.5f * params.sweatIntensity;
-    if (sweatY[i] > 20 + (std::rand() % 10)) {
+    if (sweatY[i] > 20 + rng.below(10)) {
       if (i == 0)
-        sweatX[i] = std::rand() % 30;
+        sweatX[i] = rng.below(30);
       else if (i == 1)
-        sweatX[i] = 30 + (std::rand() % (layout.screenW - 60));
+        sweatX[i] = 30 + rng.below(layout.screenW - 60);
       else
-        sweatX[i] = layout.screenW - 30 + (std::rand() % 30);
+        sweatX[i] = layout.screenW - 30 + rng.below(30);
       sweatY[i] = 2;
       sweatSize[i] = 2;
     }
@@ -1229,6 +1583,9 @@ void MochiEyesEngine::drawSweat() {
     if (sweatSize[i] < 1)
       sweatSize[i] = 1;
 
+    // Drops keep falling while degraded; only every other one is drawn.
+    if (i % particleStride() != 0)
+      continue;
     float scaledSize = sweatSize[i] * params.sweatIntensity;
     if (scaledSize >= 1.0f) {
       fillRoundRect((int16_t)sweatX[i], (int16_t)sweatY[i], (int16_t)scaledSize,
@@ -1301,8 +1658,8 @@ void MochiEyesEngine::resetEmotions() {
   targets.rightOpenness = 1.0f;
   targets.squish = 1.0f;
   targets.mouthOpenness = 0.0f;
-  timers.mouthAnimRemaining = 0.0f;
   timers.mouthAnimType = 0;
+  wheel.cancel(TIMER_MOUTH_ANIM);
   setExpression(EXPR_NORMAL);
 }
 
@@ -1434,6 +1791,10 @@ void MochiEyesEngine::setAutoblinker(bool active, float interval,
   timers.autoBlink = active;
   timers.blinkInterval = interval;
   timers.blinkVariation = variation;
+  if (!active)
+    wheel.cancel(TIMER_BLINK);
+  else if (!wheel.armed(TIMER_BLINK))
+    scheduleBlink();
 }
 
 void MochiEyesEngine::setIdleMode(bool active, float interval,
@@ -1442,15 +1803,23 @@ void MochiEyesEngine::setIdleMode(bool active, float interval,
   timers.idleInterval = interval;
   timers.idleVariation = variation;
   if (active)
-    timers.idleCooldown = 0.5f;
+    wheel.schedule_in(TIMER_SACCADE, 500);
+  else
+    wheel.cancel(TIMER_SACCADE);
 }
 
 void MochiEyesEngine::setBreathing(bool active, float intensity, float speed) {
   timers.breathingEnabled = active;
   timers.breathingIntensity = intensity;
   timers.breathingSpeed = speed;
-  if (!active)
+  if (!active) {
     targets.squish = 1.0f;
+    timers.breathingSquish = 1.0f;
+    wheel.cancel(TIMER_BREATH);
+  } else if (!wheel.armed(TIMER_BREATH)) {
+    timers.breathingLastMs = wheel.now_ms();
+    wheel.schedule_in(TIMER_BREATH, 0);
+  }
 }
 
 void MochiEyesEngine::setBreathingIntensity(float intensity) {
@@ -1488,6 +1857,7 @@ void MochiEyesEngine::setMouthSize(int16_t width, int16_t height) {
 void MochiEyesEngine::setDisplayColors(uint8_t bg, uint8_t main) {
   BGCOLOR = bg;
   MAINCOLOR = main;
+  invalidate();
 }
 
 void MochiEyesEngine::setExpression(Expression expr) {
@@ -1507,7 +1877,7 @@ void MochiEyesEngine::setMood(uint8_t mood) {
   targets.mouthOpenness = 0.0f;
   params.mouthOpenness = 0.0f;
   timers.mouthAnimType = 0;
-  timers.mouthAnimRemaining = 0.0f;
+  wheel.cancel(TIMER_MOUTH_ANIM);
   setMouthShape(MOUTH_SMILE);
   switch (mood) {
   case 1: // TIRED
@@ -1620,8 +1990,10 @@ void MochiEyesEngine::setEyebrows(bool raised) {}
 
 void MochiEyesEngine::startMouthAnim(int anim, unsigned long duration) {
   clearAllOverlays();
-  timers.mouthAnimRemaining = duration / 1000.0f;
+  timers.mouthAnimDurationMs = static_cast<uint32_t>(duration);
+  timers.mouthAnimEndMs = wheel.now_ms() + timers.mouthAnimDurationMs;
   timers.mouthAnimType = anim;
+  wheel.schedule(TIMER_MOUTH_ANIM, timers.mouthAnimEndMs);
 }
 
 void MochiEyesEngine::triggerSleep() {
@@ -1631,6 +2003,8 @@ void MochiEyesEngine::triggerSleep() {
   // which fights the closing animation and re-opens the eyes.
   timers.autoBlink = false;
   timers.idleMode = false;
+  wheel.cancel(TIMER_BLINK);
+  wheel.cancel(TIMER_SACCADE);
   // Ensure eyes are fully open before the closing animation starts,
   // otherwise isSleepDone() may fire immediately if eyes were mid-blink.
   params.openness = 1.0f;
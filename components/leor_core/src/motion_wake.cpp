@@ -0,0 +1,177 @@
+#include "leor/motion_wake.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+
+#include "driver/gpio.h"
+#include "esp_attr.h"
+#include "esp_sleep.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "leor/mpu6050_ahrs_ng.hpp"
+#include "leor/trace.hpp"
+
+namespace leor {
+
+namespace {
+
+struct MotionWakeRtc {
+    uint32_t magic;
+    int16_t rest[3];  // accelerometer LSB where the bot last settled
+    uint8_t has_rest;
+    uint8_t last;     // 0 none yet, 1 pickup, 2 bump
+    uint32_t pickups;
+    uint32_t bumps;
+};
+
+constexpr uint32_t kMotionWakeMagic = 0x4C4D5731U;  // "LMW1"
+
+RTC_NOINIT_ATTR MotionWakeRtc s_rtc;
+
+constexpr uint32_t kSampleMs = 20;
+constexpr int kSamples = MotionWake::kConfirmMs / kSampleMs;
+// The decision looks at the last 200 ms; a bump has died down by then.
+constexpr int kRestSamples = 10;
+// Spread over those samples that still counts as lying on something: a
+// few times the sensor noise, well under a hand's tremor.
+constexpr float kHeldMg = 20.0f;
+constexpr float kHeldDps = 3.0f;
+constexpr float kAccelLsbPerMg = 16.384f;
+constexpr float kGyroLsbPerDps = 131.0f;
+
+MotionWakeRtc& rtc() {
+    if (s_rtc.magic != kMotionWakeMagic || esp_reset_reason() != ESP_RST_DEEPSLEEP) {
+        s_rtc = MotionWakeRtc{};
+        s_rtc.magic = kMotionWakeMagic;
+    }
+    return s_rtc;
+}
+
+float degrees_between(const float a[3], const float b[3]) {
+    const float dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    const float norms = std::sqrt((a[0] * a[0] + a[1] * a[1] + a[2] * a[2]) * (b[0] * b[0] + b[1] * b[1] + b[2] * b[2]));
+    if (norms <= 0.0f) {
+        return 0.0f;
+    }
+    return std::acos(std::clamp(dot / norms, -1.0f, 1.0f)) * 57.29578f;
+}
+
+}  // namespace
+
+void MotionWake::configure(bool enabled, uint16_t threshold_mg, uint8_t tilt_deg, int int_pin) {
+    enabled_ = enabled;
+    set_threshold_mg(threshold_mg);
+    set_tilt_deg(tilt_deg);
+    int_pin_ = int_pin;
+    rtc();  // a cold start clears the counters
+}
+
+void MotionWake::set_threshold_mg(uint16_t mg) {
+    // MOT_THR counts 2 mg in eight bits.
+    threshold_mg_ = std::clamp<uint16_t>(mg, 4, 510);
+}
+
+void MotionWake::set_tilt_deg(uint8_t deg) {
+    tilt_deg_ = std::clamp<uint8_t>(deg, 5, 90);
+}
+
+bool MotionWake::usable() const {
+    return enabled_ && int_pin_ >= 0 && esp_sleep_is_valid_wakeup_gpio(static_cast<gpio_num_t>(int_pin_));
+}
+
+bool MotionWake::woke_on_motion(int touch_pin) const {
+    if (!usable() || esp_reset_reason() != ESP_RST_DEEPSLEEP ||
+        esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_GPIO) {
+        return false;
+    }
+    const uint64_t pins = esp_sleep_get_gpio_wakeup_status();
+    return (pins & (1ULL << int_pin_)) != 0 && (pins & (1ULL << touch_pin)) == 0;
+}
+
+bool MotionWake::confirm(int sda_pin, int scl_pin) {
+    MotionWakeRtc& state = rtc();
+    Mpu6050AhrsNg imu;
+    if (!imu.begin(sda_pin, scl_pin)) {
+        return true;  // nothing to judge by; wake up
+    }
+    int16_t lo[6] = {INT16_MAX, INT16_MAX, INT16_MAX, INT16_MAX, INT16_MAX, INT16_MAX};
+    int16_t hi[6] = {INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN};
+    int32_t sum[3] = {0, 0, 0};
+    int count = 0;
+    for (int i = 0; i < kSamples; ++i) {
+        vTaskDelay(pdMS_TO_TICKS(kSampleMs));
+        int16_t raw[7];
+        if (!imu.read_sample(raw) || i < kSamples - kRestSamples) {
+            continue;
+        }
+        const int16_t axes[6] = {raw[0], raw[1], raw[2], raw[4], raw[5], raw[6]};
+        for (int k = 0; k < 6; ++k) {
+            lo[k] = std::min(lo[k], axes[k]);
+            hi[k] = std::max(hi[k], axes[k]);
+        }
+        for (int k = 0; k < 3; ++k) {
+            sum[k] += raw[k];
+        }
+        ++count;
+    }
+    if (count == 0) {
+        return true;
+    }
+    int accel_spread = 0;
+    int gyro_spread = 0;
+    for (int k = 0; k < 3; ++k) {
+        accel_spread = std::max(accel_spread, hi[k] - lo[k]);
+        gyro_spread = std::max(gyro_spread, hi[3 + k] - lo[3 + k]);
+    }
+    const float accel_spread_mg = static_cast<float>(accel_spread) / kAccelLsbPerMg;
+    const bool held = accel_spread_mg > kHeldMg || static_cast<float>(gyro_spread) / kGyroLsbPerDps > kHeldDps;
+    const float mean[3] = {static_cast<float>(sum[0]) / static_cast<float>(count),
+                           static_cast<float>(sum[1]) / static_cast<float>(count),
+                           static_cast<float>(sum[2]) / static_cast<float>(count)};
+    float turned = 0.0f;
+    if (state.has_rest) {
+        const float rest[3] = {static_cast<float>(state.rest[0]), static_cast<float>(state.rest[1]),
+                               static_cast<float>(state.rest[2])};
+        turned = degrees_between(mean, rest);
+    }
+    const bool pickup = held || turned > static_cast<float>(tilt_deg_);
+    LEOR_TRACE(MOTION_WAKE, pickup ? 1u : 0u, static_cast<unsigned>(accel_spread_mg), turned);
+    if (pickup) {
+        state.pickups++;
+        state.last = 1;
+        return true;
+    }
+    // Settled again: that is the new rest, so slow nudges never add up.
+    for (int k = 0; k < 3; ++k) {
+        state.rest[k] = static_cast<int16_t>(std::lround(mean[k]));
+    }
+    state.has_rest = 1;
+    state.bumps++;
+    state.last = 2;
+    // Without the interrupt armed again the only way back is the touch pad;
+    // better to stay awake.
+    return !imu.arm_motion_wake(threshold_mg_);
+}
+
+void MotionWake::forget_rest() {
+    rtc().has_rest = 0;
+}
+
+std::string MotionWake::status_json() const {
+    static constexpr const char* kLast[] = {"none", "pickup", "bump"};
+    const MotionWakeRtc& state = rtc();
+    char buf[224];
+    std::snprintf(buf, sizeof(buf),
+                  "{\"type\":\"iwake\",\"on\":%d,\"pin\":%d,\"usable\":%d,\"thr_mg\":%u,\"tilt\":%u,"
+                  "\"pickups\":%u,\"bumps\":%u,\"last\":\"%s\",\"rest\":%d}",
+                  enabled_ ? 1 : 0, int_pin_, usable() ? 1 : 0, static_cast<unsigned>(threshold_mg_),
+                  static_cast<unsigned>(tilt_deg_), static_cast<unsigned>(state.pickups),
+                  static_cast<unsigned>(state.bumps), kLast[std::min<uint8_t>(state.last, 2)],
+                  state.has_rest ? 1 : 0);
+    return buf;
+}
+
+}  // namespace leor
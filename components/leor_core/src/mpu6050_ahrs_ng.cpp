@@ -1,11 +1,17 @@
 #include "leor/mpu6050_ahrs_ng.hpp"
 
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
 
+#include "driver/gpio.h"
+#include "esp_attr.h"
 #include "esp_log.h"
-#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "leor/time_source.hpp"
+#include "leor/trace.hpp"
 
 namespace leor {
 
@@ -17,6 +23,7 @@ constexpr float kPi = 3.14159265358979323846f;
 constexpr float kGscale = (250.0f / 32768.0f) * (kPi / 180.0f);
 constexpr float kGToDps = 250.0f / 32768.0f;
 constexpr float kAToG = 1.0f / 16384.0f;
+constexpr int32_t kStillLsb = 131;  // 1 dps at +-250 dps full scale
 
 inline int16_t be16(uint8_t hi, uint8_t lo) {
     return static_cast<int16_t>((static_cast<uint16_t>(hi) << 8) | lo);
@@ -37,7 +44,8 @@ Mpu6050AhrsNg::~Mpu6050AhrsNg() {
     }
 }
 
-bool Mpu6050AhrsNg::begin(int sda_pin, int scl_pin, uint32_t i2c_clock_hz, i2c_port_num_t i2c_port) {
+bool Mpu6050AhrsNg::begin(int sda_pin, int scl_pin, uint32_t i2c_clock_hz, i2c_port_num_t i2c_port,
+                          int int_pin) {
     port_ = i2c_port;
 
     if (i2c_master_get_bus_handle(port_, &bus_) != ESP_OK) {
@@ -79,38 +87,164 @@ bool Mpu6050AhrsNg::begin(int sda_pin, int scl_pin, uint32_t i2c_clock_hz, i2c_p
     vTaskDelay(pdMS_TO_TICKS(100));
     write_reg(0x6B, 0x01);
     vTaskDelay(pdMS_TO_TICKS(100));
-    write_reg(0x1B, 0x00);
-    write_reg(0x1C, 0x00);
-    write_reg(0x1A, 0x03);
-    write_reg(0x19, 0x00);
+
+    int_pin_ = -1;
+    if (int_pin >= 0) {
+        const gpio_num_t pin = static_cast<gpio_num_t>(int_pin);
+        gpio_config_t cfg = {};
+        cfg.pin_bit_mask = 1ULL << int_pin;
+        cfg.mode = GPIO_MODE_INPUT;
+        cfg.pull_down_en = GPIO_PULLDOWN_ENABLE;
+        cfg.intr_type = GPIO_INTR_POSEDGE;
+        const esp_err_t err = gpio_install_isr_service(0);
+        if (gpio_config(&cfg) == ESP_OK && (err == ESP_OK || err == ESP_ERR_INVALID_STATE) &&
+            gpio_isr_handler_add(pin, &Mpu6050AhrsNg::data_ready_isr, this) == ESP_OK) {
+            int_pin_ = int_pin;
+        } else {
+            ESP_LOGW(kTag, "data-ready interrupt on GPIO %d unavailable", int_pin);
+        }
+    }
+    configure();
     vTaskDelay(pdMS_TO_TICKS(50));
+    reset_fifo();  // drop what queued while the filters settled
 
-    last_us_ = esp_timer_get_time();
+    last_us_ = leor::now_us();
     calibrating_ = true;
+    refining_ = false;
+    refined_ = false;
     cal_count_ = 0;
+    bias_window_ = kBiasSamples;
     gsum_[0] = gsum_[1] = gsum_[2] = 0;
-    ix_ = iy_ = iz_ = 0.0f;
-    q_[0] = 1.0f;
-    q_[1] = q_[2] = q_[3] = 0.0f;
+    tsum_ = 0;
+    ahrs_.reset();
+    euler_valid_ = false;
     return found;
 }
 
 esp_err_t Mpu6050AhrsNg::write_reg(uint8_t reg, uint8_t value) {
+    if (dev_ == nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
     uint8_t write_buf[2] = {reg, value};
     return i2c_master_transmit(dev_, write_buf, sizeof(write_buf), 100);
 }
 
 esp_err_t Mpu6050AhrsNg::read_reg(uint8_t reg, uint8_t* out) {
+    if (dev_ == nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
     return i2c_master_transmit_receive(dev_, &reg, 1, out, 1, 100);
 }
 
-bool Mpu6050AhrsNg::read_sensors() {
-    uint8_t reg = 0x3B;
-    uint8_t raw[14] = {};
-    if (i2c_master_transmit_receive(dev_, &reg, 1, raw, sizeof(raw), 100) != ESP_OK) {
+void Mpu6050AhrsNg::configure() {
+    write_reg(0x1B, 0x00);
+    write_reg(0x1C, 0x00);
+    write_reg(0x1A, 0x03);                                       // DLPF 44 Hz, 1 kHz gyro rate
+    write_reg(0x19, static_cast<uint8_t>(1000 / kSampleHz - 1));  // SMPLRT_DIV
+    write_reg(0x37, 0x00);                                       // INT active high, 50 us pulse
+    write_reg(0x38, int_pin_ >= 0 ? 0x01 : 0x00);                // DATA_RDY_EN
+    write_reg(0x23, 0xF8);                                       // FIFO: temp, gyro, accel
+    reset_fifo();
+}
+
+void Mpu6050AhrsNg::reset_fifo() {
+    // FIFO_RESET only takes with FIFO_EN clear.
+    write_reg(0x6A, 0x00);
+    write_reg(0x6A, 0x04);
+    write_reg(0x6A, 0x40);
+    fifo_len_ = 0;
+    fifo_pos_ = 0;
+    fifo_queued_ = 0;
+    fifo_backlog_ = 0;
+    synced_ = false;
+    last_drain_us_ = leor::now_us();
+}
+
+void IRAM_ATTR Mpu6050AhrsNg::data_ready_isr(void* arg) {
+    auto* self = static_cast<Mpu6050AhrsNg*>(arg);
+    self->drdy_us_.store(static_cast<uint32_t>(leor::now_us()), std::memory_order_relaxed);
+    self->drdy_count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool Mpu6050AhrsNg::drain_fifo() {
+    const int64_t now_us = leor::now_us();
+    if (fifo_backlog_ == 0 && now_us - last_drain_us_ < static_cast<int64_t>(kDrainIntervalMs) * 1000) {
+        return false;
+    }
+    last_drain_us_ = now_us;
+    fifo_backlog_ = 0;
+
+    uint8_t reg = 0x72;  // FIFO_COUNT_H
+    uint8_t count[2] = {};
+    reads_++;
+    if (i2c_master_transmit_receive(dev_, &reg, 1, count, sizeof(count), 100) != ESP_OK) {
+        return false;
+    }
+    const uint16_t bytes = static_cast<uint16_t>((count[0] << 8) | count[1]);
+    if (bytes > kFifoBytes - kSampleBytes) {
+        // Full: the sensor has been overwriting the oldest bytes, so the
+        // sample boundaries are gone.
+        resets_++;
+        LEOR_TRACE(IMU_FIFO_RESET, bytes, 0u);
+        reset_fifo();
+        return false;
+    }
+    const uint16_t queued = static_cast<uint16_t>(bytes / kSampleBytes);
+    if (queued == 0) {
+        return false;
+    }
+    const uint16_t n = std::min<uint16_t>(queued, kMaxBurstSamples);
+    reg = 0x74;  // FIFO_R_W
+    reads_++;
+    if (i2c_master_transmit_receive(dev_, &reg, 1, fifo_buf_, n * kSampleBytes, 100) != ESP_OK) {
+        // Part of a sample may have left the FIFO; realign from scratch.
+        resets_++;
+        LEOR_TRACE(IMU_FIFO_RESET, bytes, 1u);
+        reset_fifo();
+        return false;
+    }
+
+    // The newest queued sample was taken within the last period: at the
+    // data-ready edge if the ISR saw it, else half a period ago on average.
+    // Edges that fired during light sleep are missed, hence the age check.
+    const uint32_t drdy_age_us = static_cast<uint32_t>(now_us) - drdy_us_.load(std::memory_order_relaxed);
+    burst_anchor_us_ = int_pin_ >= 0 && drdy_age_us < kPeriodUs ? now_us - drdy_age_us : now_us - kPeriodUs / 2;
+    fifo_queued_ = queued;
+    fifo_len_ = n;
+    fifo_pos_ = 0;
+    fifo_backlog_ = static_cast<uint16_t>(queued - n);
+    bursts_++;
+    samples_ += n;
+    return true;
+}
+
+bool Mpu6050AhrsNg::next_fifo_sample(uint32_t* dt_us) {
+    if (fifo_pos_ >= fifo_len_ && !drain_fifo()) {
         return false;
     }
+    load_raw(fifo_buf_ + fifo_pos_ * kSampleBytes);
+    const int64_t target_us = burst_anchor_us_ - static_cast<int64_t>(fifo_queued_ - 1 - fifo_pos_) * kPeriodUs;
+    fifo_pos_++;
+
+    // Successive samples are one sensor period apart; the anchors only pull
+    // the chain toward the boot clock, an eighth of the error at a time, to
+    // absorb drift between the two oscillators without passing on anchor
+    // jitter. Far off (after a reset or a wake) it starts over.
+    const int64_t predicted_us = last_us_ + kPeriodUs;
+    const int64_t error_us = target_us - predicted_us;
+    if (!synced_ || error_us > 3 * kPeriodUs || error_us < -3 * kPeriodUs) {
+        synced_ = true;
+        last_us_ = target_us;
+        *dt_us = static_cast<uint32_t>(kPeriodUs);
+        return true;
+    }
+    const int64_t t_us = predicted_us + error_us / 8;
+    *dt_us = static_cast<uint32_t>(t_us - last_us_);
+    last_us_ = t_us;
+    return true;
+}
 
+void Mpu6050AhrsNg::load_raw(const uint8_t* raw) {
     data_.rawAx = be16(raw[0], raw[1]);
     data_.rawAy = be16(raw[2], raw[3]);
     data_.rawAz = be16(raw[4], raw[5]);
@@ -118,28 +252,50 @@ bool Mpu6050AhrsNg::read_sensors() {
     data_.rawGx = be16(raw[8], raw[9]);
     data_.rawGy = be16(raw[10], raw[11]);
     data_.rawGz = be16(raw[12], raw[13]);
-    return true;
 }
 
 bool Mpu6050AhrsNg::update() {
-    if (!read_sensors()) {
+    if (dev_ == nullptr) {
         return false;
     }
+    uint32_t dt_us = 0;
+    while (next_fifo_sample(&dt_us)) {
+        if (process_sample(dt_us)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Mpu6050AhrsNg::inject(const int16_t raw[7], uint32_t dt_us) {
+    data_.rawAx = raw[0];
+    data_.rawAy = raw[1];
+    data_.rawAz = raw[2];
+    data_.rawTemp = raw[3];
+    data_.rawGx = raw[4];
+    data_.rawGy = raw[5];
+    data_.rawGz = raw[6];
+    last_us_ += dt_us;
+    return process_sample(dt_us);
+}
 
+bool Mpu6050AhrsNg::process_sample(uint32_t dt_us) {
+    last_dt_us_ = dt_us;
     if (calibrating_) {
-        gsum_[0] += data_.rawGx;
-        gsum_[1] += data_.rawGy;
-        gsum_[2] += data_.rawGz;
-        cal_count_++;
-        if (cal_count_ >= 500) {
+        if (accumulate_bias()) {
+            g_off_[0] = g_refined_[0];
+            g_off_[1] = g_refined_[1];
+            g_off_[2] = g_refined_[2];
+            update_fixed_cal();
             calibrating_ = false;
-            g_off_[0] = static_cast<float>(gsum_[0]) / 500.0f;
-            g_off_[1] = static_cast<float>(gsum_[1]) / 500.0f;
-            g_off_[2] = static_cast<float>(gsum_[2]) / 500.0f;
-            last_us_ = esp_timer_get_time();
+            refining_ = true;
+            refined_ = true;
         }
         return false;
     }
+    if (refining_ && accumulate_bias()) {
+        refined_ = true;
+    }
 
     data_.tempC = static_cast<float>(data_.rawTemp) / 340.0f + 36.53f;
 
@@ -151,20 +307,125 @@ bool Mpu6050AhrsNg::update() {
     data_.ayG = ay * kAToG;
     data_.azG = az * kAToG;
 
-    float gx = (static_cast<float>(data_.rawGx) - g_off_[0]) * kGscale;
-    float gy = (static_cast<float>(data_.rawGy) - g_off_[1]) * kGscale;
-    float gz = (static_cast<float>(data_.rawGz) - g_off_[2]) * kGscale;
-
     data_.gxDps = (static_cast<float>(data_.rawGx) - g_off_[0]) * kGToDps;
     data_.gyDps = (static_cast<float>(data_.rawGy) - g_off_[1]) * kGToDps;
     data_.gzDps = (static_cast<float>(data_.rawGz) - g_off_[2]) * kGToDps;
 
-    const int64_t now_us = esp_timer_get_time();
-    const float dt = static_cast<float>(now_us - last_us_) * 1.0e-6f;
-    last_us_ = now_us;
+#if CONFIG_LEOR_AHRS_FIXED
+    const int16_t a_raw[3] = {data_.rawAx, data_.rawAy, data_.rawAz};
+    const int16_t g_raw[3] = {data_.rawGx, data_.rawGy, data_.rawGz};
+    int32_t a_q8[3];
+    int32_t g_q8[3];
+    for (int i = 0; i < 3; ++i) {
+        a_q8[i] = static_cast<int32_t>((static_cast<int64_t>(a_raw[i] * 256 - a_off_q8_[i]) * a_scale_q16_[i]) >> 16);
+        g_q8[i] = g_raw[i] * 256 - g_off_q8_[i];
+    }
+    ahrs_.update(a_q8[0], a_q8[1], a_q8[2], g_q8[0], g_q8[1], g_q8[2], dt_us);
+#else
+    ahrs_.update(ax, ay, az, (static_cast<float>(data_.rawGx) - g_off_[0]) * kGscale,
+                 (static_cast<float>(data_.rawGy) - g_off_[1]) * kGscale,
+                 (static_cast<float>(data_.rawGz) - g_off_[2]) * kGscale, dt_us);
+#endif
+    euler_valid_ = false;
+    return true;
+}
 
-    mahony_update(ax, ay, az, gx, gy, gz, dt);
-    compute_euler();
+float Mpu6050AhrsNg::euler(int axis) const {
+    if (!euler_valid_) {
+        float q[4];
+        ahrs_.quaternion(q);
+        quaternion_to_euler(q, &euler_[2], &euler_[0], &euler_[1]);
+        euler_valid_ = true;
+    }
+    return euler_[axis];
+}
+
+bool Mpu6050AhrsNg::tilt_exceeds(float deg) const {
+    if (euler_valid_ || deg >= 90.0f) {
+        return std::abs(pitch()) > deg || std::abs(roll()) > deg;
+    }
+    if (deg != tilt_deg_) {
+        tilt_deg_ = deg;
+        tilt_sin_ = std::sin(deg * kPi / 180.0f);
+        tilt_tan_ = std::tan(deg * kPi / 180.0f);
+    }
+    // The same terms quaternion_to_euler() feeds to asin and atan2:
+    // pitch = asin(sp), roll = atan2(ry, rx).
+    float q[4];
+    ahrs_.quaternion(q);
+    const float sp = 2.0f * (q[0] * q[2] - q[1] * q[3]);
+    const float ry = q[0] * q[1] + q[2] * q[3];
+    const float rx = 0.5f - (q[1] * q[1] + q[2] * q[2]);
+    if (std::abs(sp) > tilt_sin_) {
+        return true;
+    }
+    // Past 90 degrees of roll whenever rx is negative.
+    return rx <= 0.0f ? (rx < 0.0f || ry != 0.0f) : std::abs(ry) > rx * tilt_tan_;
+}
+
+void Mpu6050AhrsNg::update_fixed_cal() {
+#if CONFIG_LEOR_AHRS_FIXED
+    for (int i = 0; i < 3; ++i) {
+        g_off_q8_[i] = static_cast<int32_t>(std::lround(g_off_[i] * 256.0f));
+        a_off_q8_[i] = static_cast<int32_t>(std::lround(a_cal_[i] * 256.0f));
+        a_scale_q16_[i] = static_cast<int32_t>(std::lround(a_cal_[3 + i] * 65536.0f));
+    }
+#endif
+}
+
+bool Mpu6050AhrsNg::accumulate_bias() {
+    const int16_t g[3] = {data_.rawGx, data_.rawGy, data_.rawGz};
+    if (cal_count_ > 0) {
+        for (int i = 0; i < 3; ++i) {
+            if (std::abs(g[i] - gsum_[i] / cal_count_) > kStillLsb) {
+                // Moved: start the average over.
+                gsum_[0] = gsum_[1] = gsum_[2] = 0;
+                tsum_ = 0;
+                cal_count_ = 0;
+                break;
+            }
+        }
+    }
+    gsum_[0] += g[0];
+    gsum_[1] += g[1];
+    gsum_[2] += g[2];
+    tsum_ += data_.rawTemp;
+    cal_count_++;
+    if (cal_count_ < bias_window_) {
+        return false;
+    }
+    for (int i = 0; i < 3; ++i) {
+        g_refined_[i] = static_cast<float>(gsum_[i]) / static_cast<float>(cal_count_);
+    }
+    refined_temp_c_ = static_cast<float>(tsum_) / static_cast<float>(cal_count_) / 340.0f + 36.53f;
+    // Next window starts from scratch.
+    gsum_[0] = gsum_[1] = gsum_[2] = 0;
+    tsum_ = 0;
+    cal_count_ = 0;
+    bias_window_ = kBiasSamples;
+    return true;
+}
+
+void Mpu6050AhrsNg::start_bias_refine(uint16_t first_window) {
+    refining_ = true;
+    refined_ = false;
+    cal_count_ = 0;
+    bias_window_ = first_window > 0 ? first_window : 1;
+    gsum_[0] = gsum_[1] = gsum_[2] = 0;
+    tsum_ = 0;
+}
+
+bool Mpu6050AhrsNg::take_refined_offsets(float out[3], float* temp_c) {
+    if (!refined_) {
+        return false;
+    }
+    refined_ = false;
+    out[0] = g_refined_[0];
+    out[1] = g_refined_[1];
+    out[2] = g_refined_[2];
+    if (temp_c != nullptr) {
+        *temp_c = refined_temp_c_;
+    }
     return true;
 }
 
@@ -175,14 +436,25 @@ void Mpu6050AhrsNg::set_accel_cal(float off_x, float off_y, float off_z, float s
     a_cal_[3] = sc_x;
     a_cal_[4] = sc_y;
     a_cal_[5] = sc_z;
+    update_fixed_cal();
 }
 
 void Mpu6050AhrsNg::set_gyro_offsets(float off_x, float off_y, float off_z) {
     g_off_[0] = off_x;
     g_off_[1] = off_y;
     g_off_[2] = off_z;
+    update_fixed_cal();
     calibrating_ = false;
-    cal_count_ = 500;
+    refining_ = false;
+    refined_ = false;
+    cal_count_ = kBiasSamples;
+}
+
+void Mpu6050AhrsNg::adjust_gyro_offsets(const float off[3]) {
+    g_off_[0] = off[0];
+    g_off_[1] = off[1];
+    g_off_[2] = off[2];
+    update_fixed_cal();
 }
 
 void Mpu6050AhrsNg::sleep() {
@@ -193,11 +465,8 @@ void Mpu6050AhrsNg::wake() {
     write_reg(0x6B, 0x01);
     vTaskDelay(pdMS_TO_TICKS(100));
     write_reg(0x6C, 0x00);
-    write_reg(0x1B, 0x00);
-    write_reg(0x1C, 0x00);
-    write_reg(0x1A, 0x03);
-    write_reg(0x19, 0x00);
-    last_us_ = esp_timer_get_time();
+    configure();
+    last_us_ = leor::now_us();
 }
 
 void Mpu6050AhrsNg::low_power_accel_only(uint8_t wake_freq) {
@@ -206,58 +475,54 @@ void Mpu6050AhrsNg::low_power_accel_only(uint8_t wake_freq) {
     write_reg(0x6C, pwr2);
 }
 
-void Mpu6050AhrsNg::compute_euler() {
-    data_.roll = std::atan2((q_[0] * q_[1] + q_[2] * q_[3]), 0.5f - (q_[1] * q_[1] + q_[2] * q_[2])) * 180.0f / kPi;
-    data_.pitch = std::asin(2.0f * (q_[0] * q_[2] - q_[1] * q_[3])) * 180.0f / kPi;
-    data_.yaw = -std::atan2((q_[1] * q_[2] + q_[0] * q_[3]), 0.5f - (q_[2] * q_[2] + q_[3] * q_[3])) * 180.0f / kPi;
+bool Mpu6050AhrsNg::read_sample(int16_t raw[7]) {
+    if (dev_ == nullptr) {
+        return false;
+    }
+    const uint8_t reg = 0x3B;
+    uint8_t buf[kSampleBytes] = {};
+    if (i2c_master_transmit_receive(dev_, &reg, 1, buf, sizeof(buf), 100) != ESP_OK) {
+        return false;
+    }
+    for (int i = 0; i < 7; ++i) {
+        raw[i] = be16(buf[2 * i], buf[2 * i + 1]);
+    }
+    return true;
 }
 
-void Mpu6050AhrsNg::mahony_update(float ax, float ay, float az, float gx, float gy, float gz, float dt) {
-    const float tmp = ax * ax + ay * ay + az * az;
-    if (tmp > 0.0f) {
-        const float recip_norm = 1.0f / std::sqrt(tmp);
-        ax *= recip_norm;
-        ay *= recip_norm;
-        az *= recip_norm;
-
-        const float vx = q_[1] * q_[3] - q_[0] * q_[2];
-        const float vy = q_[0] * q_[1] + q_[2] * q_[3];
-        const float vz = q_[0] * q_[0] - 0.5f + q_[3] * q_[3];
-
-        const float ex = ay * vz - az * vy;
-        const float ey = az * vx - ax * vz;
-        const float ez = ax * vy - ay * vx;
-
-        if (ki_ > 0.0f) {
-            ix_ += ki_ * ex * dt;
-            iy_ += ki_ * ey * dt;
-            iz_ += ki_ * ez * dt;
-            gx += ix_;
-            gy += iy_;
-            gz += iz_;
-        }
-
-        gx += kp_ * ex;
-        gy += kp_ * ey;
-        gz += kp_ * ez;
+bool Mpu6050AhrsNg::arm_motion_wake(uint16_t threshold_mg) {
+    if (dev_ == nullptr) {
+        return false;
     }
+    // Data ready and the FIFO off, so only motion drives INT from here on.
+    write_reg(0x38, 0x00);
+    write_reg(0x6A, 0x00);
+    write_reg(0x6B, 0x00);  // awake with the accelerometer running while the high-pass settles
+    write_reg(0x1C, 0x01);  // +-2 g, ACCEL_HPF 5 Hz
+    write_reg(0x1F, static_cast<uint8_t>(std::min<uint16_t>(threshold_mg / 2, 255)));  // MOT_THR, 2 mg/LSB
+    write_reg(0x20, 0x01);  // MOT_DUR: one sample over, each cycle-mode wake being one sample
+    write_reg(0x69, 0x15);  // MOT_DETECT_CTRL: 1 ms extra accel on-delay, counters decrement by 1
+    write_reg(0x37, 0x20);  // INT active high, push-pull, latched until INT_STATUS is read
+    vTaskDelay(pdMS_TO_TICKS(10));
+    uint8_t status = 0;
+    read_reg(0x3A, &status);  // drop anything latched while reconfiguring
+    if (write_reg(0x38, 0x40) != ESP_OK) {  // MOT_EN
+        return false;
+    }
+    low_power_accel_only(1);  // 5 Hz
+    return true;
+}
 
-    dt *= 0.5f;
-    gx *= dt;
-    gy *= dt;
-    gz *= dt;
-    const float qa = q_[0], qb = q_[1], qc = q_[2];
-
-    q_[0] += (-qb * gx - qc * gy - q_[3] * gz);
-    q_[1] += (qa * gx + qc * gz - q_[3] * gy);
-    q_[2] += (qa * gy - qb * gz + q_[3] * gx);
-    q_[3] += (qa * gz + qb * gy - qc * gx);
-
-    const float recip_norm = 1.0f / std::sqrt(q_[0] * q_[0] + q_[1] * q_[1] + q_[2] * q_[2] + q_[3] * q_[3]);
-    q_[0] *= recip_norm;
-    q_[1] *= recip_norm;
-    q_[2] *= recip_norm;
-    q_[3] *= recip_norm;
+std::string Mpu6050AhrsNg::stats_json() const {
+    char buf[192];
+    std::snprintf(buf, sizeof(buf),
+                  "{\"type\":\"imu\",\"hz\":%u,\"int\":%d,\"drdy\":%u,\"reads\":%u,\"bursts\":%u,"
+                  "\"samples\":%u,\"resets\":%u,\"dt_us\":%u}",
+                  static_cast<unsigned>(kSampleHz), int_pin_,
+                  static_cast<unsigned>(drdy_count_.load(std::memory_order_relaxed)), static_cast<unsigned>(reads_),
+                  static_cast<unsigned>(bursts_), static_cast<unsigned>(samples_), static_cast<unsigned>(resets_),
+                  static_cast<unsigned>(last_dt_us_));
+    return buf;
 }
 
 }  // namespace leor
@@ -2,8 +2,9 @@
 
 #include "esp_log.h"
 #include "esp_ota_ops.h"
-#include "esp_timer.h"
 #include "esp_system.h"
+#include "leor/time_source.hpp"
+#include "leor/trace.hpp"
 
 namespace leor {
 
@@ -59,7 +60,7 @@ uint8_t OtaService::handle_control_write(uint8_t opcode) {
         packets_rx_ = 0;
         bytes_rx_ = 0;
         expected_size_ = ota_partition_->size;
-        ESP_LOGI(kTag, "OTA started, pkt=%u", static_cast<unsigned>(packet_size_));
+        LEOR_TRACE(OTA_START, packet_size_);
         return kCtrlRequestAck;
     }
 
@@ -85,8 +86,8 @@ uint8_t OtaService::handle_control_write(uint8_t opcode) {
 
         in_progress_ = false;
         reboot_pending_ = true;
-        reboot_at_us_ = esp_timer_get_time() + 1000000ULL;
-        ESP_LOGI(kTag, "OTA complete, rebooting soon");
+        reboot_at_us_ = now_us() + 1000000ULL;
+        LEOR_TRACE(OTA_COMPLETE, bytes_rx_);
         return kCtrlDoneAck;
     }
 
@@ -117,21 +118,20 @@ uint8_t OtaService::handle_data_write(const uint8_t* data, size_t len) {
     }
 
     if (packets_rx_ == 0 && (data[0] != 0xE9 || len < 16)) {
-        ESP_LOGW(kTag, "invalid image header: 0x%02x, len=%zu", data[0], len);
+        LEOR_TRACE(OTA_BAD_HEADER, data[0], len);
         set_error("Invalid ESP32 bin!");
         return kCtrlDoneNak;
     }
 
     if (ota_partition_ != nullptr && bytes_rx_ + len > ota_partition_->size) {
-        ESP_LOGW(kTag, "OTA data exceeds partition size! rx=%u, len=%zu, max=%u",
-                 (unsigned)bytes_rx_, len, (unsigned)ota_partition_->size);
+        LEOR_TRACE(OTA_TOO_LARGE, bytes_rx_, len, ota_partition_->size);
         set_error("File too large!");
         return kCtrlDoneNak;
     }
 
     const esp_err_t err = esp_ota_write(ota_handle_, data, len);
     if (err != ESP_OK) {
-        ESP_LOGW(kTag, "esp_ota_write failed: %s", esp_err_to_name(err));
+        LEOR_TRACE(OTA_WRITE_FAILED, err);
         set_error("Write error!");
         return kCtrlDoneNak;
     }
@@ -148,7 +148,7 @@ uint8_t OtaService::handle_data_write(const uint8_t* data, size_t len) {
 }
 
 void OtaService::poll() {
-    if (reboot_pending_ && esp_timer_get_time() >= static_cast<int64_t>(reboot_at_us_)) {
+    if (reboot_pending_ && now_us() >= static_cast<int64_t>(reboot_at_us_)) {
         esp_restart();
     }
 }
@@ -169,12 +169,12 @@ int OtaService::progress_percent() const {
 }
 
 bool OtaService::error_pending() const {
-    return show_error_until_us_ > 0 && esp_timer_get_time() < show_error_until_us_;
+    return show_error_until_us_ > 0 && now_us() < show_error_until_us_;
 }
 
 void OtaService::set_error(const char* msg) {
     error_message_ = msg;
-    show_error_until_us_ = esp_timer_get_time() + 3000000ULL;
+    show_error_until_us_ = now_us() + 3000000ULL;
     reset();
 }
 
@@ -0,0 +1,191 @@
+#include "leor/power_policy.hpp"
+
+#include "esp_log.h"
+#include "esp_pm.h"
+
+#include <cstdio>
+
+namespace leor {
+
+namespace {
+
+constexpr const char *kTag = "leor_pm";
+constexpr const char *kModeNames[] = {"face_idle", "face_anim", "menu", "clock",
+                                      "ota"};
+
+unsigned to_ms(uint64_t us) { return static_cast<unsigned>(us / 1000); }
+
+} // namespace
+
+void PowerPolicy::init(uint32_t max_mhz, int64_t now_us) {
+  max_mhz_ = max_mhz == kApbMhz ? kApbMhz : kDefaultMaxMhz;
+  last_us_ = now_us;
+#if CONFIG_PM_ENABLE
+  configure();
+  if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "leor_max", &max_lock_) !=
+      ESP_OK) {
+    max_lock_ = nullptr;
+    ESP_LOGW(kTag, "max clock lock unavailable");
+  }
+  if (esp_pm_lock_create(ESP_PM_APB_FREQ_MAX, 0, "leor_apb", &apb_lock_) !=
+      ESP_OK) {
+    apb_lock_ = nullptr;
+    ESP_LOGW(kTag, "apb clock lock unavailable");
+  }
+#endif
+}
+
+void PowerPolicy::configure() {
+#if CONFIG_PM_ENABLE
+  // APB_FREQ_MAX runs the CPU at min(max, 80 MHz) on the C3, and no lock at
+  // all lets the idle task drop to XTAL or light-sleep.
+  esp_pm_config_t pm_config = {.max_freq_mhz = static_cast<int>(max_mhz_),
+                               .min_freq_mhz = static_cast<int>(kMinMhz),
+                               .light_sleep_enable = true};
+  ESP_ERROR_CHECK(esp_pm_configure(&pm_config));
+#endif
+}
+
+bool PowerPolicy::set_max_mhz(uint32_t mhz) {
+  if (mhz != kApbMhz && mhz != kDefaultMaxMhz) {
+    return false;
+  }
+  max_mhz_ = mhz;
+  configure();
+  return true;
+}
+
+PowerPolicy::Level PowerPolicy::burst_level(PowerMode mode) {
+  switch (mode) {
+  case PowerMode::kFaceAnimating:
+  case PowerMode::kOta:
+    return kLevelMax;
+  case PowerMode::kFaceIdle:
+  case PowerMode::kMenu:
+    return kLevelApb;
+  case PowerMode::kClock:
+  default:
+    return kLevelMin;
+  }
+}
+
+esp_pm_lock_handle_t PowerPolicy::lock_for(Level level) const {
+  return level == kLevelMax   ? max_lock_
+         : level == kLevelApb ? apb_lock_
+                              : nullptr;
+}
+
+PowerPolicy::Level PowerPolicy::level() const {
+  if (mode_lock_held_) {
+    return kLevelMax;
+  }
+  return in_burst_ ? burst_held_ : kLevelMin;
+}
+
+void PowerPolicy::account(int64_t now_us) {
+  const uint64_t elapsed =
+      now_us > last_us_ ? static_cast<uint64_t>(now_us - last_us_) : 0;
+  level_us_[level()] += elapsed;
+  mode_us_[static_cast<int>(mode_)] += elapsed;
+  last_us_ = now_us;
+}
+
+void PowerPolicy::set_mode(PowerMode mode, int64_t now_us) {
+  if (mode == mode_) {
+    return;
+  }
+  account(now_us);
+  mode_ = mode;
+  const bool want_lock = mode == PowerMode::kOta;
+  if (want_lock == mode_lock_held_) {
+    return;
+  }
+#if CONFIG_PM_ENABLE
+  if (max_lock_ != nullptr) {
+    if (want_lock) {
+      esp_pm_lock_acquire(max_lock_);
+    } else {
+      esp_pm_lock_release(max_lock_);
+    }
+  }
+#endif
+  mode_lock_held_ = want_lock;
+}
+
+void PowerPolicy::begin_burst(int64_t now_us) {
+  if (in_burst_) {
+    return;
+  }
+  account(now_us);
+  in_burst_ = true;
+  // OTA already holds the max lock for the whole mode.
+  burst_held_ = mode_lock_held_ ? kLevelMin : burst_level(mode_);
+  bursts_[mode_lock_held_ ? kLevelMax : burst_held_]++;
+#if CONFIG_PM_ENABLE
+  if (esp_pm_lock_handle_t lock = lock_for(burst_held_)) {
+    esp_pm_lock_acquire(lock);
+  }
+#endif
+}
+
+void PowerPolicy::end_burst(int64_t now_us) {
+  if (!in_burst_) {
+    return;
+  }
+  account(now_us);
+#if CONFIG_PM_ENABLE
+  if (esp_pm_lock_handle_t lock = lock_for(burst_held_)) {
+    esp_pm_lock_release(lock);
+  }
+#endif
+  in_burst_ = false;
+  burst_held_ = kLevelMin;
+}
+
+void PowerPolicy::reset_stats(int64_t now_us) {
+  for (int i = 0; i < kLevelCount; i++) {
+    level_us_[i] = 0;
+    bursts_[i] = 0;
+  }
+  for (int i = 0; i < static_cast<int>(PowerMode::kCount); i++) {
+    mode_us_[i] = 0;
+  }
+  last_us_ = now_us;
+}
+
+std::string PowerPolicy::stats_json(int64_t now_us) const {
+  // Include the time spent at the current level so far.
+  uint64_t level_us[kLevelCount];
+  uint64_t mode_us[static_cast<int>(PowerMode::kCount)];
+  for (int i = 0; i < kLevelCount; i++) {
+    level_us[i] = level_us_[i];
+  }
+  for (int i = 0; i < static_cast<int>(PowerMode::kCount); i++) {
+    mode_us[i] = mode_us_[i];
+  }
+  const uint64_t elapsed =
+      now_us > last_us_ ? static_cast<uint64_t>(now_us - last_us_) : 0;
+  level_us[level()] += elapsed;
+  mode_us[static_cast<int>(mode_)] += elapsed;
+  const unsigned apb_mhz = max_mhz_ < kApbMhz ? max_mhz_ : kApbMhz;
+
+  char buf[384];
+  std::snprintf(
+      buf, sizeof(buf),
+      "{\"type\":\"pm\",\"mode\":\"%s\",\"mhz\":[%u,%u,%u],"
+      "\"ms\":{\"max\":%u,\"apb\":%u,\"min\":%u},"
+      "\"bursts\":{\"max\":%u,\"apb\":%u,\"min\":%u},"
+      "\"modes\":{\"face_idle\":%u,\"face_anim\":%u,\"menu\":%u,\"clock\":%u,"
+      "\"ota\":%u}}",
+      kModeNames[static_cast<int>(mode_)], static_cast<unsigned>(max_mhz_),
+      apb_mhz, static_cast<unsigned>(kMinMhz), to_ms(level_us[kLevelMax]),
+      to_ms(level_us[kLevelApb]), to_ms(level_us[kLevelMin]),
+      static_cast<unsigned>(bursts_[kLevelMax]),
+      static_cast<unsigned>(bursts_[kLevelApb]),
+      static_cast<unsigned>(bursts_[kLevelMin]), to_ms(mode_us[0]),
+      to_ms(mode_us[1]), to_ms(mode_us[2]), to_ms(mode_us[3]),
+      to_ms(mode_us[4]));
+  return buf;
+}
+
+} // namespace leor
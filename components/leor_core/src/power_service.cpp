@@ -1,12 +1,15 @@
 #include "leor/power_service.hpp"
 
 #include "driver/gpio.h"
+#include "esp_attr.h"
 #include "esp_log.h"
 #include "esp_pm.h"
 #include "esp_rom_gpio.h"
 #include "esp_sleep.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "hal/gpio_ll.h"
+#include "leor/time_source.hpp"
 
 static const char* kTag = "leor_power";
 
@@ -66,17 +69,6 @@ void drive_high_and_hold(int pin) {
   gpio_hold_en(g);
 }
 
-// Atomically transition a GPIO to output LOW and hold it (for power-on).
-void drive_low_output_and_hold(int pin) {
-  if (pin < 0) return;
-  const gpio_num_t g = static_cast<gpio_num_t>(pin);
-  esp_rom_gpio_pad_select_gpio(g);
-  gpio_hold_dis(g);
-  gpio_set_direction(g, GPIO_MODE_OUTPUT);
-  gpio_set_level(g, 0);
-  gpio_hold_en(g);
-}
-
 } // namespace
 
 void PowerService::init(uint8_t touch_pin, uint8_t active_level,
@@ -113,14 +105,25 @@ void PowerService::set_sleep_prepare_callback(SleepPrepareCallback callback) {
   sleep_prepare_callback_ = std::move(callback);
 }
 
+void PowerService::set_edge_callback(EdgeCallback callback) {
+  edge_callback_ = std::move(callback);
+}
+
 void PowerService::set_i2c_pins(int sda_pin, int scl_pin) {
   i2c_sda_pin_ = sda_pin;
   i2c_scl_pin_ = scl_pin;
 }
 
+void PowerService::set_motion_wake(int pin, MotionArmCallback arm) {
+  motion_pin_ = pin;
+  motion_arm_ = std::move(arm);
+}
+
 void PowerService::arm(uint32_t delay_ms, uint32_t now_ms) {
   enable_at_ms_ = now_ms + delay_ms;
-  press_start_ms_ = 0;
+  enable_pending_ = true;
+  press_valid_ = false;
+  double_armed_ = false;
   last_state_ = pressed();
 }
 
@@ -133,40 +136,153 @@ void PowerService::set_hold_ms(uint32_t value_ms) {
 }
 
 bool PowerService::pressed() const {
+  if (input_override_ >= 0) {
+    return input_override_ != 0;
+  }
   return gpio_get_level(static_cast<gpio_num_t>(touch_pin_)) ==
          static_cast<int>(active_level_);
 }
 
-ButtonEvent PowerService::poll(uint32_t now_ms) {
-  if (now_ms < enable_at_ms_) {
-    return ButtonEvent::kNone;
+bool PowerService::enable_edge_events(EventGroupHandle_t group,
+                                      EventBits_t bit) {
+  const gpio_num_t pin = static_cast<gpio_num_t>(touch_pin_);
+  esp_err_t err = gpio_install_isr_service(0);
+  if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+    ESP_LOGW(kTag, "gpio isr service failed: %s", esp_err_to_name(err));
+    return false;
+  }
+  gpio_set_intr_type(pin, GPIO_INTR_DISABLE);
+  err = gpio_isr_handler_add(pin, &PowerService::edge_isr, this);
+  if (err != ESP_OK) {
+    ESP_LOGW(kTag, "touch isr add failed: %s", esp_err_to_name(err));
+    return false;
+  }
+  esp_sleep_enable_gpio_wakeup();
+  edge_group_ = group;
+  edge_bit_ = bit;
+  arm_edge_event();
+  return true;
+}
+
+void PowerService::arm_edge_event() {
+  if (edge_group_ == nullptr) {
+    return;
+  }
+  // Level-triggered on the opposite of the current state, and flipped by the
+  // ISR on every change: an any-edge interrupt that still works as a
+  // light-sleep wakeup (edge interrupts do not).
+  const gpio_num_t pin = static_cast<gpio_num_t>(touch_pin_);
+  const bool currently_high = gpio_get_level(pin) != 0;
+  const gpio_int_type_t type =
+      currently_high ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL;
+  gpio_set_intr_type(pin, type);
+  gpio_wakeup_enable(pin, type);
+  gpio_intr_enable(pin);
+}
+
+void IRAM_ATTR PowerService::edge_isr(void *arg) {
+  auto *self = static_cast<PowerService *>(arg);
+  const uint32_t pin = self->touch_pin_;
+  const bool high = gpio_ll_get_level(&GPIO, pin) != 0;
+  gpio_ll_set_intr_type(&GPIO, pin,
+                        high ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+  // A full queue drops the edge; poll() resyncs from the pin level.
+  self->edges_.push(
+      TouchEdge{now_ms(), high == (self->active_level_ != 0)});
+  BaseType_t woken = pdFALSE;
+  xEventGroupSetBitsFromISR(self->edge_group_, self->edge_bit_, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+bool PowerService::next_edge(uint32_t now_ms, TouchEdge *edge) {
+  const bool queued = edge_group_ != nullptr && input_override_ < 0;
+  while (edges_.pop(*edge)) {
+    // Repeats of the current state come from resyncing below while the ISR
+    // for the same change was still pending.
+    if (queued && edge->pressed != last_state_) {
+      return true;
+    }
   }
+  // Sampled input, or a change whose edge was dropped: stamp it now.
   const bool current = pressed();
-  ButtonEvent event = ButtonEvent::kNone;
+  if (current == last_state_) {
+    return false;
+  }
+  *edge = TouchEdge{now_ms, current};
+  return true;
+}
 
-  if (!last_state_ && current) {
-    press_start_ms_ = now_ms;
+ButtonEvent PowerService::on_edge(const TouchEdge &edge) {
+  last_state_ = edge.pressed;
+  if (edge_callback_) {
+    edge_callback_(edge.t_ms, edge.pressed);
   }
-  
-  if (last_state_ && !current) {
-    if (press_start_ms_ != 0) {
-      uint32_t duration = now_ms - press_start_ms_;
-      if (duration >= 50 && duration < hold_ms_) { // 50ms debounce
-        event = ButtonEvent::kShortPress;
+  if (edge.pressed) {
+    press_start_ms_ = edge.t_ms;
+    press_valid_ = true;
+    return ButtonEvent::kNone;
+  }
+  if (!press_valid_) {
+    return ButtonEvent::kNone;
+  }
+  press_valid_ = false;
+  const uint32_t held_ms = edge.t_ms - press_start_ms_;
+  if (held_ms < kDebounceMs) {
+    return ButtonEvent::kNone;
+  }
+  if (held_ms >= hold_ms_) {
+    // Released before poll() saw the deadline pass.
+    double_armed_ = false;
+    return ButtonEvent::kLongPress;
+  }
+  if (double_armed_ && edge.t_ms - last_short_ms_ < kDoublePressMs) {
+    double_armed_ = false;
+    return ButtonEvent::kDoublePress;
+  }
+  double_armed_ = true;
+  last_short_ms_ = edge.t_ms;
+  return ButtonEvent::kShortPress;
+}
+
+ButtonEvent PowerService::poll(uint32_t now_ms) {
+  TouchEdge edge;
+  if (enable_pending_) {
+    if (!time_reached(now_ms, enable_at_ms_)) {
+      while (edges_.pop(edge)) {
       }
+      last_state_ = pressed();
+      return ButtonEvent::kNone;
     }
-    press_start_ms_ = 0;
+    enable_pending_ = false;
   }
-
-  if (current && press_start_ms_ != 0) {
-    if (now_ms - press_start_ms_ >= hold_ms_) {
-      event = ButtonEvent::kLongPress;
-      press_start_ms_ = 0; // Consume
+  while (next_edge(now_ms, &edge)) {
+    const ButtonEvent event = on_edge(edge);
+    if (event != ButtonEvent::kNone) {
+      return event;
     }
   }
+  uint32_t deadline_ms = 0;
+  if (long_press_deadline(&deadline_ms) && time_reached(now_ms, deadline_ms)) {
+    press_valid_ = false; // consumed; the release is not a short press
+    double_armed_ = false;
+    return ButtonEvent::kLongPress;
+  }
+  return ButtonEvent::kNone;
+}
 
-  last_state_ = current;
-  return event;
+bool PowerService::long_press_deadline(uint32_t *deadline_ms) const {
+  if (!last_state_ || !press_valid_) {
+    return false;
+  }
+  *deadline_ms = press_start_ms_ + hold_ms_;
+  return true;
+}
+
+bool PowerService::needs_polling(uint32_t now_ms) const {
+  if (edge_group_ != nullptr && input_override_ < 0) {
+    return false;
+  }
+  return last_state_ || (double_armed_ && now_ms - last_short_ms_ < kDoublePressMs);
 }
 
 void PowerService::do_sleep() {
@@ -193,46 +309,34 @@ void PowerService::do_sleep() {
     sleep_prepare_callback_();
   }
 
-  // --- Step 2: Pull I2C lines LOW before cutting VCC_PERIPH ---
-  // The on-board pull-up resistors sit on the switched VCC_PERIPH rail.
-  // If SDA/SCL float HIGH while the PNP is off, current leaks through
-  // ESP32's ESD diodes back into VCC_PERIPH (~2.7V), keeping the
-  // OLED/IMU partially alive. Driving them LOW + hold breaks that path.
-  drive_low_and_hold(i2c_sda_pin_);
-  drive_low_and_hold(i2c_scl_pin_);
-
-  // --- Step 3: Cut VCC_PERIPH (PNP OFF = GPIO HIGH) ---
-  if (pwr_ctrl_pin_ >= 0) {
-    drive_high_and_hold(pwr_ctrl_pin_);
-  }
-
-  // --- Step 4: LED off ---
+  // --- Step 2: LED off ---
   if (led_pin_ >= 0) {
     drive_high_and_hold(led_pin_);
   }
 
-  // --- Step 5: Configure touch pin for wakeup ---
+  // --- Step 3: Configure touch pin for wakeup ---
   const gpio_num_t touch_gpio = static_cast<gpio_num_t>(touch_pin_);
+  if (edge_group_ != nullptr) {
+    // The main-loop edge interrupt must not fire while we wait for release.
+    gpio_intr_disable(touch_gpio);
+    gpio_wakeup_disable(touch_gpio);
+  }
   configure_touch_inactive_level(touch_gpio, active_level_);
   gpio_hold_en(touch_gpio);
 
-  // --- Step 6: Wait for user to release the button ---
-  const uint32_t release_start_ms =
-      static_cast<uint32_t>(xTaskGetTickCount() * portTICK_PERIOD_MS);
+  // --- Step 4: Wait for user to release the button ---
+  const uint32_t release_start_ms = now_ms();
   while (pressed()) {
-    const uint32_t loop_now =
-        static_cast<uint32_t>(xTaskGetTickCount() * portTICK_PERIOD_MS);
+    const uint32_t loop_now = now_ms();
     if (loop_now - release_start_ms > 5000U) {
       // User held too long — abort sleep, power everything back on
       ESP_LOGW(kTag, "sleep aborted: button held >5s");
       gpio_hold_dis(touch_gpio);
-      if (pwr_ctrl_pin_ >= 0) {
-        drive_low_output_and_hold(pwr_ctrl_pin_); // PNP ON
-      }
       if (led_pin_ >= 0) {
         drive_high_and_hold(led_pin_);
       }
-      press_start_ms_ = 0;
+      press_valid_ = false;
+      arm_edge_event();
 #if CONFIG_PM_ENABLE
       if (pm_lock) {
         esp_pm_lock_release(pm_lock);
@@ -245,6 +349,29 @@ void PowerService::do_sleep() {
   }
   vTaskDelay(pdMS_TO_TICKS(50));
 
+  // --- Step 5: Arm the IMU motion interrupt, if wanted ---
+  // After the release, so the press itself does not latch a wake. The
+  // IMU needs its rail and the bus, so both stay up; the idle-high bus
+  // lines are held as they are and draw nothing through the pull-ups.
+  const bool motion_wake = motion_pin_ >= 0 && motion_arm_ && motion_arm_();
+  if (motion_wake) {
+    if (i2c_sda_pin_ >= 0) gpio_hold_en(static_cast<gpio_num_t>(i2c_sda_pin_));
+    if (i2c_scl_pin_ >= 0) gpio_hold_en(static_cast<gpio_num_t>(i2c_scl_pin_));
+  } else {
+    // --- Step 6a: Pull I2C lines LOW before cutting VCC_PERIPH ---
+    // The on-board pull-up resistors sit on the switched VCC_PERIPH rail.
+    // If SDA/SCL float HIGH while the PNP is off, current leaks through
+    // ESP32's ESD diodes back into VCC_PERIPH (~2.7V), keeping the
+    // OLED/IMU partially alive. Driving them LOW + hold breaks that path.
+    drive_low_and_hold(i2c_sda_pin_);
+    drive_low_and_hold(i2c_scl_pin_);
+
+    // --- Step 6b: Cut VCC_PERIPH (PNP OFF = GPIO HIGH) ---
+    if (pwr_ctrl_pin_ >= 0) {
+      drive_high_and_hold(pwr_ctrl_pin_);
+    }
+  }
+
   // --- Step 7: Configure GPIO wakeup (AFTER button released) ---
   const esp_sleep_gpio_wake_up_mode_t wake_mode =
       active_level_ == 0 ? ESP_GPIO_WAKEUP_GPIO_LOW
@@ -254,6 +381,14 @@ void PowerService::do_sleep() {
   if (err != ESP_OK) {
     ESP_LOGE(kTag, "gpio wakeup config failed: %s", esp_err_to_name(err));
   }
+  if (motion_wake) {
+    // The MPU drives INT high and holds it until it is reset on wake.
+    err = esp_sleep_enable_gpio_wakeup_on_hp_periph_powerdown(
+        (1ULL << motion_pin_), ESP_GPIO_WAKEUP_GPIO_HIGH);
+    if (err != ESP_OK) {
+      ESP_LOGE(kTag, "motion wakeup config failed: %s", esp_err_to_name(err));
+    }
+  }
 
   // --- Step 8: Enter deep sleep ---
   ESP_LOGI(kTag, "entering deep sleep...");
@@ -84,6 +84,14 @@ std::string Preferences::getString(const char* key, const char* fallback) const
     return value;
 }
 
+bool Preferences::getBytes(const char* key, void* out, size_t length) const {
+    size_t stored = 0;
+    if (!open_ || nvs_get_blob(handle_, key, nullptr, &stored) != ESP_OK || stored != length) {
+        return false;
+    }
+    return nvs_get_blob(handle_, key, out, &stored) == ESP_OK;
+}
+
 void Preferences::putBool(const char* key, bool value) {
     if (open_) {
         nvs_set_u8(handle_, key, value ? 1 : 0);
@@ -128,4 +136,17 @@ void Preferences::putString(const char* key, const std::string& value) {
     }
 }
 
+void Preferences::putBytes(const char* key, const void* value, size_t length) {
+    if (open_) {
+        nvs_set_blob(handle_, key, value, length);
+        nvs_commit(handle_);
+    }
+}
+
+void Preferences::remove(const char* key) {
+    if (open_ && nvs_erase_key(handle_, key) == ESP_OK) {
+        nvs_commit(handle_);
+    }
+}
+
 }  // namespace leor
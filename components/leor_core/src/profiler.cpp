@@ -0,0 +1,146 @@
+#include "leor/profiler.hpp"
+
+#include <cstdio>
+
+#if CONFIG_LEOR_PROFILER
+#include "esp_rom_sys.h"
+#endif
+
+namespace leor {
+
+namespace {
+
+constexpr const char *kStageNames[PERF_STAGE_COUNT] = {
+    "tick",  "ble",  "gesture", "timers", "params",  "eyes",  "mouth", "sweat",
+    "love",  "uwu",  "xd",      "tears",  "knocked", "sleep", "send",  "ota"};
+
+} // namespace
+
+const char *perf_stage_name(PerfStage stage) {
+  return stage < PERF_STAGE_COUNT ? kStageNames[stage] : "?";
+}
+
+#if CONFIG_LEOR_PROFILER
+
+Profiler &Profiler::instance() {
+  static Profiler profiler;
+  return profiler;
+}
+
+int Profiler::bucket_for(uint32_t cycles) {
+  if (cycles < (1U << kMinBits)) {
+    return 0;
+  }
+  const int msb = 31 - __builtin_clz(cycles);
+  if (msb >= kMaxBits) {
+    return kBuckets - 1;
+  }
+  // Two bits below the leading one pick the quarter within the octave.
+  const int sub = static_cast<int>((cycles >> (msb - 2)) & 3U);
+  return 1 + (msb - kMinBits) * kSubBuckets + sub;
+}
+
+uint32_t Profiler::bucket_ceiling(int bucket) {
+  if (bucket == 0) {
+    return 1U << kMinBits;
+  }
+  if (bucket >= kBuckets - 1) {
+    return UINT32_MAX;
+  }
+  const int msb = kMinBits + (bucket - 1) / kSubBuckets;
+  const uint32_t sub = static_cast<uint32_t>((bucket - 1) % kSubBuckets);
+  return (5U + sub) << (msb - 2);
+}
+
+void Profiler::record(PerfStage stage, uint32_t cycles) {
+  Histogram &h = stages_[stage];
+  const int bucket = bucket_for(cycles);
+  if (h.counts[bucket] == UINT16_MAX) {
+    h.total = 0;
+    for (int i = 0; i < kBuckets; i++) {
+      h.counts[i] >>= 1;
+      h.total += h.counts[i];
+    }
+  }
+  h.counts[bucket]++;
+  h.total++;
+  tick_[stage] += cycles;
+
+  if (h.frames == 0) {
+    h.min = h.max = h.avg = cycles;
+  } else {
+    if (cycles < h.min) h.min = cycles;
+    if (cycles > h.max) h.max = cycles;
+    h.avg = static_cast<uint32_t>(
+        (static_cast<uint64_t>(h.avg) * 15 + cycles) / 16);
+  }
+  h.frames++;
+}
+
+void Profiler::begin_tick() {
+  for (uint32_t &cycles : tick_) {
+    cycles = 0;
+  }
+}
+
+void Profiler::reset() {
+  for (Histogram &h : stages_) {
+    h = Histogram{};
+  }
+}
+
+uint32_t Profiler::percentile(const Histogram &h, uint32_t per_mille) {
+  const uint32_t rank =
+      static_cast<uint32_t>((static_cast<uint64_t>(h.total) * per_mille + 999) /
+                            1000);
+  uint32_t seen = 0;
+  for (int i = 0; i < kBuckets; i++) {
+    seen += h.counts[i];
+    if (seen >= rank) {
+      const uint32_t ceiling = bucket_ceiling(i);
+      return ceiling < h.max ? ceiling : h.max;
+    }
+  }
+  return h.max;
+}
+
+std::string Profiler::json() const {
+  // [samples, min, avg, p99, max] in CPU cycles per stage.
+  std::string out;
+  out.reserve(64 + PERF_STAGE_COUNT * 56);
+  char buf[96];
+  std::snprintf(buf, sizeof(buf), "{\"type\":\"perf\",\"mhz\":%u,\"cyc\":{",
+                static_cast<unsigned>(esp_rom_get_cpu_ticks_per_us()));
+  out += buf;
+  bool first = true;
+  for (int i = 0; i < PERF_STAGE_COUNT; i++) {
+    const Histogram &h = stages_[i];
+    if (h.frames == 0) {
+      continue;
+    }
+    std::snprintf(buf, sizeof(buf), "%s\"%s\":[%u,%u,%u,%u,%u]",
+                  first ? "" : ",", kStageNames[i],
+                  static_cast<unsigned>(h.frames), static_cast<unsigned>(h.min),
+                  static_cast<unsigned>(h.avg),
+                  static_cast<unsigned>(percentile(h, 990)),
+                  static_cast<unsigned>(h.max));
+    out += buf;
+    first = false;
+  }
+  out += "}}";
+  return out;
+}
+
+std::string perf_json() { return Profiler::instance().json(); }
+
+void perf_reset() { Profiler::instance().reset(); }
+
+#else
+
+std::string perf_json() { return "{\"type\":\"perf\",\"enabled\":0}"; }
+
+void perf_reset() {}
+
+#endif
+
+} // namespace leor
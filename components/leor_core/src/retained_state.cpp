@@ -0,0 +1,66 @@
+#include "leor/retained_state.hpp"
+
+#include <cstring>
+#include <type_traits>
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+
+namespace leor {
+
+namespace {
+
+constexpr const char *kTag = "leor_rtc";
+constexpr uint32_t kRetainedMagic = 0x4C524D31U; // "LRM1"
+
+struct RetainedHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;
+  uint32_t crc;
+};
+
+static_assert(std::is_trivially_copyable<RetainedState>::value,
+              "RetainedState is copied to and from RTC memory as bytes");
+
+// Raw bytes rather than a typed object: nothing may construct over the
+// block at startup, and RTC_NOINIT memory is never loaded or zeroed.
+RTC_NOINIT_ATTR uint8_t
+    s_retained[sizeof(RetainedHeader) + sizeof(RetainedState)];
+
+uint32_t payload_crc(const uint8_t *payload) {
+  return esp_rom_crc32_le(0, payload, sizeof(RetainedState));
+}
+
+} // namespace
+
+void save_retained_state(const RetainedState &state) {
+  uint8_t *payload = s_retained + sizeof(RetainedHeader);
+  std::memcpy(payload, &state, sizeof(state));
+  const RetainedHeader header = {kRetainedMagic, kRetainedStateVersion,
+                                 static_cast<uint16_t>(sizeof(RetainedState)),
+                                 payload_crc(payload)};
+  std::memcpy(s_retained, &header, sizeof(header));
+}
+
+bool load_retained_state(RetainedState &out) {
+  RetainedHeader header;
+  std::memcpy(&header, s_retained, sizeof(header));
+  const uint8_t *payload = s_retained + sizeof(RetainedHeader);
+  bool valid = header.magic == kRetainedMagic &&
+               header.version == kRetainedStateVersion &&
+               header.size == sizeof(RetainedState);
+  if (valid && header.crc != payload_crc(payload)) {
+    ESP_LOGW(kTag, "retained state CRC mismatch, cold start");
+    valid = false;
+  }
+  if (valid) {
+    std::memcpy(&out, payload, sizeof(out));
+  }
+  header.magic = 0;
+  std::memcpy(s_retained, &header, sizeof(header));
+  return valid;
+}
+
+} // namespace leor
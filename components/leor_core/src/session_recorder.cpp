@@ -0,0 +1,258 @@
+#include "leor/session_recorder.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "esp_log.h"
+
+namespace leor {
+
+namespace {
+
+constexpr const char* kTag = "leor_rec";
+constexpr size_t kRecordHeaderBytes = 6;  // u32 t_ms, u8 kind, u8 len
+constexpr size_t kImuPayloadBytes = sizeof(int16_t) * 7 + sizeof(uint32_t) * 2;
+
+class ScopedLock {
+  public:
+    explicit ScopedLock(SemaphoreHandle_t mutex) : mutex_(mutex) {
+        if (mutex_ != nullptr) xSemaphoreTake(mutex_, portMAX_DELAY);
+    }
+    ~ScopedLock() {
+        if (mutex_ != nullptr) xSemaphoreGive(mutex_);
+    }
+
+  private:
+    SemaphoreHandle_t mutex_;
+};
+
+}  // namespace
+
+bool SessionRecorder::start(uint32_t seed, size_t capacity) {
+    if (mutex_ == nullptr) {
+        mutex_ = xSemaphoreCreateMutex();
+    }
+    ScopedLock lock(mutex_);
+    if (!buf_ || capacity_ != capacity) {
+        buf_.reset(new (std::nothrow) uint8_t[capacity]);
+        capacity_ = buf_ ? capacity : 0;
+    }
+    used_ = 0;
+    full_ = false;
+    seed_ = seed;
+    active_ = capacity_ > 0;
+    if (!active_) {
+        ESP_LOGE(kTag, "no memory for %u byte recording", static_cast<unsigned>(capacity));
+    } else {
+        ESP_LOGI(kTag, "recording started seed=%u cap=%u", static_cast<unsigned>(seed),
+                 static_cast<unsigned>(capacity_));
+    }
+    return active_;
+}
+
+void SessionRecorder::clear() {
+    ScopedLock lock(mutex_);
+    active_ = false;
+    full_ = false;
+    used_ = 0;
+    capacity_ = 0;
+    buf_.reset();
+}
+
+void SessionRecorder::set_gyro_offsets(const float offsets[3]) {
+    gyro_offsets_[0] = offsets[0];
+    gyro_offsets_[1] = offsets[1];
+    gyro_offsets_[2] = offsets[2];
+}
+
+void SessionRecorder::append(uint32_t t_ms, RecordKind kind, const void* payload, size_t len) {
+    ScopedLock lock(mutex_);
+    if (!active_) {
+        return;
+    }
+    if (used_ + kRecordHeaderBytes + len > capacity_) {
+        active_ = false;
+        full_ = true;
+        ESP_LOGW(kTag, "recording buffer full after %u bytes", static_cast<unsigned>(used_));
+        return;
+    }
+    uint8_t* p = buf_.get() + used_;
+    std::memcpy(p, &t_ms, sizeof(t_ms));
+    p[4] = static_cast<uint8_t>(kind);
+    p[5] = static_cast<uint8_t>(len);
+    std::memcpy(p + kRecordHeaderBytes, payload, len);
+    used_ += kRecordHeaderBytes + len;
+}
+
+void SessionRecorder::record_command(uint32_t t_ms, std::string_view command) {
+    if (!active_) return;
+    char text[255];
+    const size_t len = std::min(command.size(), sizeof(text));
+    for (size_t i = 0; i < len; ++i) {
+        // Keep the export one event per line.
+        text[i] = (command[i] == '\n' || command[i] == '\r') ? ' ' : command[i];
+    }
+    append(t_ms, RecordKind::kCommand, text, len);
+}
+
+void SessionRecorder::record_touch(uint32_t t_ms, bool pressed) {
+    if (!active_) return;
+    const uint8_t level = pressed ? 1 : 0;
+    append(t_ms, RecordKind::kTouch, &level, 1);
+}
+
+void SessionRecorder::record_button(uint32_t t_ms, uint8_t event) {
+    if (!active_) return;
+    append(t_ms, RecordKind::kButton, &event, 1);
+}
+
+void SessionRecorder::record_imu(uint32_t t_ms, const int16_t raw[7], uint32_t dt_us, uint32_t sample_ms) {
+    if (!active_) return;
+    uint8_t payload[kImuPayloadBytes];
+    std::memcpy(payload, raw, sizeof(int16_t) * 7);
+    std::memcpy(payload + sizeof(int16_t) * 7, &dt_us, sizeof(dt_us));
+    std::memcpy(payload + sizeof(int16_t) * 7 + sizeof(dt_us), &sample_ms, sizeof(sample_ms));
+    append(t_ms, RecordKind::kImu, payload, sizeof(payload));
+}
+
+std::string SessionRecorder::header_line() const {
+    char line[128];
+    std::snprintf(line, sizeof(line), "# leor-rec 1 seed=%u goff=%.9g,%.9g,%.9g\n",
+                  static_cast<unsigned>(seed_), gyro_offsets_[0], gyro_offsets_[1], gyro_offsets_[2]);
+    return line;
+}
+
+size_t SessionRecorder::export_text(size_t offset, std::string& out, size_t max_chars) const {
+    ScopedLock lock(mutex_);
+    char line[320];
+    while (offset + kRecordHeaderBytes <= used_) {
+        const uint8_t* p = buf_.get() + offset;
+        uint32_t t_ms = 0;
+        std::memcpy(&t_ms, p, sizeof(t_ms));
+        const auto kind = static_cast<RecordKind>(p[4]);
+        const size_t len = p[5];
+        const uint8_t* payload = p + kRecordHeaderBytes;
+
+        int n = 0;
+        switch (kind) {
+            case RecordKind::kCommand:
+                n = std::snprintf(line, sizeof(line), "%u c %.*s\n", static_cast<unsigned>(t_ms),
+                                  static_cast<int>(len), reinterpret_cast<const char*>(payload));
+                break;
+            case RecordKind::kTouch:
+            case RecordKind::kButton:
+                n = std::snprintf(line, sizeof(line), "%u %c %u\n", static_cast<unsigned>(t_ms),
+                                  static_cast<char>(kind), static_cast<unsigned>(payload[0]));
+                break;
+            case RecordKind::kImu: {
+                int16_t raw[7];
+                uint32_t dt_us = 0;
+                uint32_t sample_ms = 0;
+                std::memcpy(raw, payload, sizeof(raw));
+                std::memcpy(&dt_us, payload + sizeof(raw), sizeof(dt_us));
+                std::memcpy(&sample_ms, payload + sizeof(raw) + sizeof(dt_us), sizeof(sample_ms));
+                n = std::snprintf(line, sizeof(line), "%u i %d %d %d %d %d %d %d %u %u\n",
+                                  static_cast<unsigned>(t_ms), raw[0], raw[1], raw[2], raw[3],
+                                  raw[4], raw[5], raw[6], static_cast<unsigned>(dt_us),
+                                  static_cast<unsigned>(sample_ms));
+                break;
+            }
+        }
+        if (n <= 0 || out.size() + static_cast<size_t>(n) > max_chars) {
+            break;
+        }
+        out.append(line, static_cast<size_t>(n));
+        offset += kRecordHeaderBytes + len;
+    }
+    return offset;
+}
+
+std::string SessionRecorder::status_json() const {
+    char buf[128];
+    std::snprintf(buf, sizeof(buf),
+                  "{\"type\":\"rec\",\"on\":%d,\"full\":%d,\"bytes\":%u,\"cap\":%u,\"seed\":%u}",
+                  active_ ? 1 : 0, full_ ? 1 : 0, static_cast<unsigned>(used_),
+                  static_cast<unsigned>(capacity_), static_cast<unsigned>(seed_));
+    return buf;
+}
+
+bool SessionReplayer::load(const std::string& text) {
+    events_.clear();
+    cursor_ = 0;
+    skipped_lines_ = 0;
+    seed_ = 0;
+    gyro_offsets_[0] = gyro_offsets_[1] = gyro_offsets_[2] = 0.0f;
+
+    bool has_header = false;
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos) end = text.size();
+        std::string line = text.substr(start, end - start);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        start = end + 1;
+        if (line.empty()) continue;
+
+        if (line[0] == '#') {
+            unsigned seed = 0;
+            float gx = 0.0f, gy = 0.0f, gz = 0.0f;
+            if (std::sscanf(line.c_str(), "# leor-rec 1 seed=%u goff=%f,%f,%f", &seed, &gx, &gy, &gz) == 4) {
+                seed_ = seed;
+                gyro_offsets_[0] = gx;
+                gyro_offsets_[1] = gy;
+                gyro_offsets_[2] = gz;
+                has_header = true;
+            }
+            continue;
+        }
+        if (!parse_line(line)) {
+            ++skipped_lines_;
+        }
+    }
+    return has_header;
+}
+
+bool SessionReplayer::parse_line(const std::string& line) {
+    RecordedEvent event;
+    unsigned t_ms = 0;
+    char kind = 0;
+    int consumed = 0;
+    if (std::sscanf(line.c_str(), "%u %c %n", &t_ms, &kind, &consumed) < 2) {
+        return false;
+    }
+    event.t_ms = t_ms;
+    event.kind = static_cast<RecordKind>(kind);
+    const char* rest = line.c_str() + consumed;
+
+    switch (event.kind) {
+        case RecordKind::kCommand:
+            event.command = rest;
+            break;
+        case RecordKind::kTouch:
+        case RecordKind::kButton:
+            event.value = static_cast<uint8_t>(std::atoi(rest));
+            break;
+        case RecordKind::kImu: {
+            int v[7];
+            unsigned dt_us = 0;
+            unsigned sample_ms = t_ms;
+            if (std::sscanf(rest, "%d %d %d %d %d %d %d %u %u", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5],
+                            &v[6], &dt_us, &sample_ms) < 8) {
+                return false;
+            }
+            for (int i = 0; i < 7; ++i) event.raw[i] = static_cast<int16_t>(v[i]);
+            event.dt_us = dt_us;
+            event.sample_ms = sample_ms;
+            break;
+        }
+        default:
+            return false;
+    }
+    events_.push_back(std::move(event));
+    return true;
+}
+
+}  // namespace leor
@@ -1,6 +1,6 @@
 #include "leor/shuffle_service.hpp"
 
-#include <cstdlib>
+#include "leor/time_source.hpp"
 
 namespace leor {
 
@@ -20,6 +20,32 @@ void ShuffleService::reset() {
     last_shuffle_index_ = -1;
 }
 
+void ShuffleService::snapshot(ShuffleSnapshot& out, uint32_t now_ms) const {
+    out.enabled = enabled_;
+    out.needs_init = needs_init_;
+    out.expression_phase = expression_phase_;
+    out.last_index = static_cast<int8_t>(last_shuffle_index_);
+    out.expr_min_ms = expr_min_ms_;
+    out.expr_max_ms = expr_max_ms_;
+    out.neutral_min_ms = neutral_min_ms_;
+    out.neutral_max_ms = neutral_max_ms_;
+    out.remaining_ms = time_reached(now_ms, next_change_ms_) ? 0 : next_change_ms_ - now_ms;
+    out.rng = rng_;
+}
+
+void ShuffleService::resume(const ShuffleSnapshot& in, uint32_t now_ms) {
+    enabled_ = in.enabled;
+    needs_init_ = in.needs_init;
+    expression_phase_ = in.expression_phase;
+    last_shuffle_index_ = in.last_index;
+    expr_min_ms_ = in.expr_min_ms;
+    expr_max_ms_ = in.expr_max_ms;
+    neutral_min_ms_ = in.neutral_min_ms;
+    neutral_max_ms_ = in.neutral_max_ms;
+    next_change_ms_ = now_ms + in.remaining_ms;
+    rng_ = in.rng;
+}
+
 void ShuffleService::set_enabled(bool enabled) {
     enabled_ = enabled;
     if (enabled_) {
@@ -37,7 +63,7 @@ void ShuffleService::set_neutral_range(uint32_t min_ms, uint32_t max_ms) {
     neutral_max_ms_ = max_ms < min_ms ? min_ms : max_ms;
 }
 
-bool ShuffleService::should_emit(uint32_t now_ms, bool reacting, bool training, const char** command_out) {
+bool ShuffleService::should_emit(uint32_t now_ms, bool reacting, bool training, Action* action_out) {
     if (!enabled_ || reacting || training) {
         return false;
     }
@@ -46,35 +72,36 @@ bool ShuffleService::should_emit(uint32_t now_ms, bool reacting, bool training,
         expression_phase_ = false;
         // After a reset (e.g. manual command), wait for a full expression cycle 
         // before emitting "neutral", so the manual expression has time to show.
-        next_change_ms_ = now_ms + expr_min_ms_ + (std::rand() % (expr_max_ms_ - expr_min_ms_ + 1U));
+        next_change_ms_ = now_ms + expr_min_ms_ + rng_.below(expr_max_ms_ - expr_min_ms_ + 1U);
         return false;
     }
-    if (next_change_ms_ != 0 && now_ms < next_change_ms_) {
+    if (!time_reached(now_ms, next_change_ms_)) {
         return false;
     }
     if (expression_phase_) {
         expression_phase_ = false;
-        next_change_ms_ = now_ms + neutral_min_ms_ + (std::rand() % (neutral_max_ms_ - neutral_min_ms_ + 1U));
-        *command_out = "neutral";
+        next_change_ms_ = now_ms + neutral_min_ms_ + rng_.below(neutral_max_ms_ - neutral_min_ms_ + 1U);
+        *action_out = Action::kNeutral;
         return true;
     }
 
-    static const char* expressions[] = {
-        "happy", "sad", "angry", "love", "surprised", "confused",
-        "sleepy", "curious", "nervous", "knocked",
-        "glee", "worried", "focused", "annoyed", "skeptic",
-        "frustrated", "unimpressed", "suspicious", "squint",
-        "furious", "scared", "awe"
+    // Order matters: the retained snapshot stores an index into this list.
+    static constexpr Action expressions[] = {
+        Action::kHappy, Action::kSad, Action::kAngry, Action::kLove, Action::kSurprised, Action::kConfused,
+        Action::kSleepy, Action::kCurious, Action::kNervous, Action::kKnocked,
+        Action::kGlee, Action::kWorried, Action::kFocused, Action::kAnnoyed, Action::kSkeptic,
+        Action::kFrustrated, Action::kUnimpressed, Action::kSuspicious, Action::kSquint,
+        Action::kFurious, Action::kScared, Action::kAwe
     };
     const int count = static_cast<int>(sizeof(expressions) / sizeof(expressions[0]));
-    int idx = std::rand() % count;
+    int idx = static_cast<int>(rng_.below(static_cast<uint32_t>(count)));
     if (idx == last_shuffle_index_) {
         idx = (idx + 1) % count;
     }
     last_shuffle_index_ = idx;
     expression_phase_ = true;
-    next_change_ms_ = now_ms + expr_min_ms_ + (std::rand() % (expr_max_ms_ - expr_min_ms_ + 1U));
-    *command_out = expressions[idx];
+    next_change_ms_ = now_ms + expr_min_ms_ + rng_.below(expr_max_ms_ - expr_min_ms_ + 1U);
+    *action_out = expressions[idx];
     return true;
 }
 
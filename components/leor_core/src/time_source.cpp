@@ -0,0 +1,40 @@
+#include "leor/time_source.hpp"
+
+#include <sys/time.h>
+
+#include "esp_timer.h"
+
+namespace leor {
+
+namespace {
+
+class SystemTimeSource final : public TimeSource {
+public:
+  int64_t monotonic_us() override { return esp_timer_get_time(); }
+
+  int64_t wall_us() override {
+    struct timeval tv {};
+    gettimeofday(&tv, nullptr);
+    return static_cast<int64_t>(tv.tv_sec) * 1000000LL + tv.tv_usec;
+  }
+
+  void set_wall_us(int64_t us) override {
+    struct timeval tv {};
+    tv.tv_sec = static_cast<time_t>(us / 1000000LL);
+    tv.tv_usec = static_cast<suseconds_t>(us % 1000000LL);
+    settimeofday(&tv, nullptr);
+  }
+};
+
+SystemTimeSource s_system;
+TimeSource *s_source = &s_system;
+
+} // namespace
+
+TimeSource &time_source() { return *s_source; }
+
+void set_time_source(TimeSource *source) {
+  s_source = source != nullptr ? source : &s_system;
+}
+
+} // namespace leor
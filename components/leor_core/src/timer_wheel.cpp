@@ -0,0 +1,193 @@
+#include "leor/timer_wheel.hpp"
+
+namespace leor {
+
+void TimerWheel::reset(uint32_t now_ms) {
+  for (auto &timer : timers_) {
+    timer = Timer{};
+  }
+  for (auto &level : heads_) {
+    for (auto &head : level) {
+      head = kNil;
+    }
+  }
+  tick_ = 0;
+  tick_base_ms_ = now_ms;
+  now_ms_ = now_ms;
+  pending_ = 0;
+  next_deadline_ms_ = kNoDeadline;
+}
+
+void TimerWheel::schedule(uint8_t id, uint32_t deadline_ms) {
+  if (id >= kMaxTimers) {
+    return;
+  }
+  if (timers_[id].armed) {
+    unlink(id);
+  }
+  timers_[id].deadline_ms = deadline_ms;
+  timers_[id].armed = true;
+  place(id);
+  refresh_next_deadline();
+}
+
+void TimerWheel::cancel(uint8_t id) {
+  if (id >= kMaxTimers || !timers_[id].armed) {
+    return;
+  }
+  unlink(id);
+  timers_[id].armed = false;
+  refresh_next_deadline();
+}
+
+void TimerWheel::place(uint8_t id) {
+  Timer &timer = timers_[id];
+  const int32_t delta_ms =
+      static_cast<int32_t>(timer.deadline_ms - tick_base_ms_);
+  if (delta_ms < 0 || time_reached(now_ms_, timer.deadline_ms)) {
+    // Overdue at scheduling time: report it on the next advance().
+    timer.level = 2;
+    pending_ |= 1u << id;
+    return;
+  }
+
+  const uint32_t delta_ticks = static_cast<uint32_t>(delta_ms) / kTickMs;
+  const uint32_t due_tick = tick_ + delta_ticks;
+  if (delta_ticks < kSlots) {
+    timer.level = 0;
+    timer.slot = due_tick & kSlotMask;
+  } else {
+    // Level-1 slots are visited when level 0 wraps; park out-of-range
+    // deadlines in the furthest slot so they get re-placed on the way.
+    const uint32_t max_ticks = static_cast<uint32_t>(kSlots) * (kSlots - 1);
+    const uint32_t parked_tick =
+        delta_ticks < max_ticks ? due_tick : tick_ + max_ticks;
+    timer.level = 1;
+    timer.slot = (parked_tick >> kSlotBits) & kSlotMask;
+  }
+  timer.next = heads_[timer.level][timer.slot];
+  heads_[timer.level][timer.slot] = id;
+}
+
+void TimerWheel::unlink(uint8_t id) {
+  Timer &timer = timers_[id];
+  if (timer.level > 1) {
+    pending_ &= ~(1u << id);
+    return;
+  }
+  uint8_t *link = &heads_[timer.level][timer.slot];
+  while (*link != kNil) {
+    if (*link == id) {
+      *link = timer.next;
+      break;
+    }
+    link = &timers_[*link].next;
+  }
+  timer.next = kNil;
+}
+
+void TimerWheel::cascade() {
+  const uint8_t slot = (tick_ >> kSlotBits) & kSlotMask;
+  uint8_t id = heads_[1][slot];
+  heads_[1][slot] = kNil;
+  while (id != kNil) {
+    const uint8_t next = timers_[id].next;
+    timers_[id].next = kNil;
+    place(id);
+    id = next;
+  }
+}
+
+uint32_t TimerWheel::expire_slot(uint32_t now_ms) {
+  uint32_t fired = 0;
+  uint8_t *link = &heads_[0][tick_ & kSlotMask];
+  while (*link != kNil) {
+    const uint8_t id = *link;
+    Timer &timer = timers_[id];
+    // A slot spans kTickMs; only fire entries whose exact deadline passed.
+    if (time_reached(now_ms, timer.deadline_ms)) {
+      *link = timer.next;
+      timer.next = kNil;
+      timer.armed = false;
+      fired |= 1u << id;
+    } else {
+      link = &timer.next;
+    }
+  }
+  return fired;
+}
+
+void TimerWheel::rebuild(uint32_t now_ms) {
+  for (auto &level : heads_) {
+    for (auto &head : level) {
+      head = kNil;
+    }
+  }
+  tick_ = 0;
+  tick_base_ms_ = now_ms - (now_ms % kTickMs);
+  now_ms_ = now_ms;
+  for (uint8_t id = 0; id < kMaxTimers; id++) {
+    if (timers_[id].armed && timers_[id].level <= 1) {
+      timers_[id].next = kNil;
+      place(id);
+    }
+  }
+}
+
+uint32_t TimerWheel::advance(uint32_t now_ms) {
+  const int32_t elapsed_ms = static_cast<int32_t>(now_ms - tick_base_ms_);
+  if (elapsed_ms < 0) {
+    return 0;
+  }
+
+  uint32_t elapsed_ticks = static_cast<uint32_t>(elapsed_ms) / kTickMs;
+  if (elapsed_ticks > kSlots) {
+    // Long gap (e.g. after light sleep): re-placing a handful of timers is
+    // cheaper than stepping through every empty slot.
+    rebuild(now_ms);
+    elapsed_ticks = 0;
+  }
+
+  now_ms_ = now_ms;
+  uint32_t fired = expire_slot(now_ms);
+  while (elapsed_ticks-- > 0) {
+    tick_++;
+    tick_base_ms_ += kTickMs;
+    if ((tick_ & kSlotMask) == 0) {
+      cascade();
+    }
+    fired |= expire_slot(now_ms);
+  }
+  // Entries that were overdue when scheduled (or surfaced by cascade()).
+  for (uint8_t id = 0; id < kMaxTimers; id++) {
+    if (pending_ & (1u << id)) {
+      timers_[id].armed = false;
+    }
+  }
+  fired |= pending_;
+  pending_ = 0;
+
+  if (fired != 0) {
+    refresh_next_deadline();
+  }
+  return fired;
+}
+
+void TimerWheel::refresh_next_deadline() {
+  // With kMaxTimers entries a linear scan beats walking the slot arrays.
+  bool found = false;
+  uint32_t best = 0;
+  for (const auto &timer : timers_) {
+    if (!timer.armed) {
+      continue;
+    }
+    if (!found ||
+        static_cast<int32_t>(timer.deadline_ms - best) < 0) {
+      best = timer.deadline_ms;
+      found = true;
+    }
+  }
+  next_deadline_ms_ = found ? best : kNoDeadline;
+}
+
+} // namespace leor
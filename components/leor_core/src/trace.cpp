@@ -0,0 +1,133 @@
+#include "leor/trace.hpp"
+
+#include <cstdio>
+
+#include "leor/time_source.hpp"
+
+namespace leor {
+
+#if CONFIG_LEOR_TRACE
+
+namespace {
+
+// Namespace scope so writing an event never takes a static-init guard.
+TraceRing s_ring;
+
+} // namespace
+
+TraceRing &TraceRing::instance() { return s_ring; }
+
+void TraceRing::write(TraceId id, const uint32_t *args, uint32_t argc) {
+  const uint32_t seq = next_.fetch_add(1, std::memory_order_relaxed);
+  Slot &slot = slots_[seq % kRecords];
+  slot.stamp.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.t_us = static_cast<uint32_t>(now_us());
+  slot.id = static_cast<uint16_t>(id);
+  slot.argc = static_cast<uint16_t>(argc);
+  for (uint32_t i = 0; i < argc; ++i) {
+    slot.args[i] = args[i];
+  }
+  slot.stamp.store(seq + 1, std::memory_order_release);
+}
+
+void TraceRing::clear() {
+  cleared_at_.store(head(), std::memory_order_release);
+}
+
+uint32_t TraceRing::oldest() const {
+  const uint32_t next = head();
+  const uint32_t cleared = cleared_at_.load(std::memory_order_acquire);
+  const uint32_t window = next > kRecords ? next - kRecords : 0;
+  return cleared > window ? cleared : window;
+}
+
+uint32_t TraceRing::export_text(uint32_t from_seq, std::string &out,
+                                size_t max_chars) const {
+  const uint32_t next = head();
+  uint32_t seq = from_seq < oldest() ? oldest() : from_seq;
+  char line[96];
+  for (; seq < next; ++seq) {
+    const Slot &slot = slots_[seq % kRecords];
+    const uint32_t stamp = slot.stamp.load(std::memory_order_acquire);
+    if (stamp != seq + 1) {
+      continue; // still being written, or already overwritten
+    }
+    const uint32_t t_us = slot.t_us;
+    const uint16_t id = slot.id;
+    const uint16_t argc = slot.argc < kMaxArgs ? slot.argc : kMaxArgs;
+    uint32_t args[kMaxArgs] = {};
+    for (uint16_t i = 0; i < argc; ++i) {
+      args[i] = slot.args[i];
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.stamp.load(std::memory_order_relaxed) != stamp) {
+      continue; // a writer lapped the ring while we copied
+    }
+
+    int n = std::snprintf(line, sizeof(line), "%u %u %u",
+                          static_cast<unsigned>(seq),
+                          static_cast<unsigned>(t_us),
+                          static_cast<unsigned>(id));
+    for (uint16_t i = 0; i < argc && n > 0; ++i) {
+      n += std::snprintf(line + n, sizeof(line) - static_cast<size_t>(n),
+                         " %x", static_cast<unsigned>(args[i]));
+    }
+    if (n <= 0 || out.size() + static_cast<size_t>(n) + 1 > max_chars) {
+      break;
+    }
+    out.append(line, static_cast<size_t>(n));
+    out.push_back('\n');
+  }
+  return seq;
+}
+
+std::string TraceRing::status_json() const {
+  const uint32_t next = head();
+  const uint32_t first = oldest();
+  char buf[128];
+  std::snprintf(buf, sizeof(buf),
+                "{\"type\":\"trace\",\"cap\":%u,\"events\":%u,\"oldest\":%u,"
+                "\"next\":%u}",
+                static_cast<unsigned>(kRecords),
+                static_cast<unsigned>(next - first),
+                static_cast<unsigned>(first), static_cast<unsigned>(next));
+  return buf;
+}
+
+std::string trace_status_json() { return TraceRing::instance().status_json(); }
+
+std::string trace_dump(uint32_t from_seq) {
+  // Pages stay under ~2 KB like rec:dump; the first one carries a header
+  // naming the format so trace_decode.py can check it.
+  constexpr size_t kPageChars = 2048;
+  const TraceRing &ring = TraceRing::instance();
+  if (from_seq >= ring.head()) {
+    return "trace:end";
+  }
+  std::string lines;
+  if (from_seq <= ring.oldest()) {
+    char header[64];
+    std::snprintf(header, sizeof(header), "# leor-trace 1 ids=%u\n",
+                  static_cast<unsigned>(TraceId::kCount));
+    lines = header;
+  }
+  const uint32_t next = ring.export_text(from_seq, lines, kPageChars);
+  return "trace:" + std::to_string(next) + "\n" + lines;
+}
+
+void trace_clear() { TraceRing::instance().clear(); }
+
+#else
+
+std::string trace_status_json() {
+  return "{\"type\":\"trace\",\"enabled\":0}";
+}
+
+std::string trace_dump(uint32_t) { return "trace:end"; }
+
+void trace_clear() {}
+
+#endif
+
+} // namespace leor
@@ -0,0 +1,33 @@
+#pragma once
+// Host shim: declarations only, implemented in host/shim/src.
+#include <stdint.h>
+#include "esp_err.h"
+typedef enum { GPIO_NUM_NC = -1, GPIO_NUM_0 = 0, GPIO_NUM_MAX = 22 } gpio_num_t;
+typedef enum { GPIO_MODE_INPUT = 1, GPIO_MODE_OUTPUT = 2 } gpio_mode_t;
+typedef enum { GPIO_PULLUP_DISABLE = 0, GPIO_PULLUP_ENABLE = 1 } gpio_pullup_t;
+typedef enum { GPIO_PULLDOWN_DISABLE = 0, GPIO_PULLDOWN_ENABLE = 1 } gpio_pulldown_t;
+typedef enum { GPIO_INTR_DISABLE = 0, GPIO_INTR_POSEDGE, GPIO_INTR_NEGEDGE, GPIO_INTR_ANYEDGE, GPIO_INTR_LOW_LEVEL, GPIO_INTR_HIGH_LEVEL } gpio_int_type_t;
+typedef struct { uint64_t pin_bit_mask; gpio_mode_t mode; gpio_pullup_t pull_up_en; gpio_pulldown_t pull_down_en; gpio_int_type_t intr_type; } gpio_config_t;
+typedef void (*gpio_isr_t)(void*);
+esp_err_t gpio_config(const gpio_config_t*);
+esp_err_t gpio_set_level(gpio_num_t, uint32_t);
+int gpio_get_level(gpio_num_t);
+esp_err_t gpio_hold_en(gpio_num_t);
+esp_err_t gpio_hold_dis(gpio_num_t);
+void gpio_deep_sleep_hold_en(void);
+void gpio_deep_sleep_hold_dis(void);
+esp_err_t gpio_set_direction(gpio_num_t, gpio_mode_t);
+esp_err_t gpio_pullup_dis(gpio_num_t);
+esp_err_t gpio_pulldown_dis(gpio_num_t);
+esp_err_t gpio_pullup_en(gpio_num_t);
+esp_err_t gpio_pulldown_en(gpio_num_t);
+esp_err_t gpio_install_isr_service(int);
+esp_err_t gpio_isr_handler_add(gpio_num_t, gpio_isr_t, void*);
+esp_err_t gpio_isr_handler_remove(gpio_num_t);
+esp_err_t gpio_set_intr_type(gpio_num_t, gpio_int_type_t);
+esp_err_t gpio_intr_enable(gpio_num_t);
+esp_err_t gpio_intr_disable(gpio_num_t);
+esp_err_t gpio_wakeup_enable(gpio_num_t, gpio_int_type_t);
+esp_err_t gpio_wakeup_disable(gpio_num_t);
+#define ESP_INTR_FLAG_IRAM (1 << 10)
+
@@ -0,0 +1,17 @@
+#pragma once
+// Host shim: only the context type named by display_backend.hpp.
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef struct {
+    struct {
+        int i2c_port;
+        int sda_pin;
+        int scl_pin;
+        uint32_t clk_hz;
+        uint8_t dev_addr_7bit;
+        int timeout_ms;
+        int reset_pin;
+    } cfg;
+    void* bus_handle;
+} u8g2_esp32_i2c_ctx_t;
@@ -0,0 +1,6 @@
+#pragma once
+// Host shim: no RTC or IRAM sections; RTC_NOINIT data is ordinary zeroed
+// static storage, so every simulator run starts cold.
+#define RTC_NOINIT_ATTR
+#define RTC_DATA_ATTR
+#define IRAM_ATTR
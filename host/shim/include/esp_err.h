@@ -0,0 +1,34 @@
+#pragma once
+// Host shim: the subset of esp_err.h leor_core uses. ESP_ERROR_CHECK aborts
+// like the firmware does, so a failing shim call is never silently ignored.
+#include <stdint.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_INVALID_SIZE 0x104
+#define ESP_ERR_NOT_FOUND 0x105
+#define ESP_ERR_NOT_SUPPORTED 0x106
+#define ESP_ERR_TIMEOUT 0x107
+#define ESP_ERR_INVALID_CRC 0x109
+#define ESP_ERR_NVS_NO_FREE_PAGES 0x1100
+#define ESP_ERR_NVS_NEW_VERSION_FOUND 0x1101
+#define ESP_ERR_NVS_NOT_FOUND 0x1102
+#define ESP_ERR_NVS_INVALID_LENGTH 0x110c
+#define ESP_ERR_OTA_VALIDATE_FAILED 0x1503
+
+const char* esp_err_to_name(esp_err_t code);
+void host_esp_error_check_failed(esp_err_t code, const char* file, int line, const char* expr);
+
+#define ESP_ERROR_CHECK(x)                                                  \
+    do {                                                                    \
+        const esp_err_t err_rc_ = (x);                                      \
+        if (err_rc_ != ESP_OK) {                                            \
+            host_esp_error_check_failed(err_rc_, __FILE__, __LINE__, #x);   \
+        }                                                                   \
+    } while (0)
+#define ESP_ERROR_CHECK_WITHOUT_ABORT(x) (x)
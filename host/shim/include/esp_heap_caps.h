@@ -0,0 +1,19 @@
+#pragma once
+// Host shim: declarations only, implemented in host/shim/src.
+#include <stddef.h>
+#include <stdint.h>
+#define MALLOC_CAP_8BIT 4
+#define MALLOC_CAP_DEFAULT 4096
+size_t heap_caps_get_free_size(uint32_t);
+size_t heap_caps_get_largest_free_block(uint32_t);
+size_t heap_caps_get_minimum_free_size(uint32_t);
+// Defined by the application when CONFIG_HEAP_USE_HOOKS is set; the host
+// operator new/delete (shim/src/heap.cpp) calls them as the IDF heap would.
+#ifdef __cplusplus
+extern "C" {
+#endif
+void esp_heap_trace_alloc_hook(void* ptr, size_t size, uint32_t caps);
+void esp_heap_trace_free_hook(void* ptr);
+#ifdef __cplusplus
+}
+#endif
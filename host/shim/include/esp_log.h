@@ -0,0 +1,28 @@
+#pragma once
+// Host shim: ESP_LOGx print to stderr above a runtime level, so simulator
+// output on stdout stays machine-readable.
+#include <stdio.h>
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+extern esp_log_level_t host_log_level;
+
+#define HOST_LOG_AT(level, letter, tag, fmt, ...)                           \
+    do {                                                                    \
+        if (host_log_level >= (level)) {                                    \
+            fprintf(stderr, letter " (%s) " fmt "\n", tag, ##__VA_ARGS__);  \
+        }                                                                   \
+    } while (0)
+
+#define ESP_LOGE(tag, fmt, ...) HOST_LOG_AT(ESP_LOG_ERROR, "E", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) HOST_LOG_AT(ESP_LOG_WARN, "W", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) HOST_LOG_AT(ESP_LOG_INFO, "I", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) HOST_LOG_AT(ESP_LOG_DEBUG, "D", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGV(tag, fmt, ...) HOST_LOG_AT(ESP_LOG_VERBOSE, "V", tag, fmt, ##__VA_ARGS__)
@@ -0,0 +1,12 @@
+#pragma once
+// Host shim: declarations only, implemented in host/shim/src.
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+typedef enum { ESP_PARTITION_TYPE_APP = 0, ESP_PARTITION_TYPE_DATA = 1 } esp_partition_type_t;
+typedef enum { ESP_PARTITION_SUBTYPE_ANY = 0xff } esp_partition_subtype_t;
+typedef struct { esp_partition_type_t type; int subtype; uint32_t address; uint32_t size; uint32_t erase_size; char label[17]; } esp_partition_t;
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t, esp_partition_subtype_t, const char*);
+esp_err_t esp_partition_read(const esp_partition_t*, size_t, void*, size_t);
+esp_err_t esp_partition_write(const esp_partition_t*, size_t, const void*, size_t);
+esp_err_t esp_partition_erase_range(const esp_partition_t*, size_t, size_t);
@@ -0,0 +1,5 @@
+#pragma once
+// Host shim: declarations only, implemented in host/shim/src.
+#include <stdint.h>
+
+uint32_t esp_random(void);
@@ -0,0 +1,4 @@
+#pragma once
+// Host shim: declarations only, implemented in host/shim/src.
+#include <stdint.h>
+void esp_rom_gpio_pad_select_gpio(uint32_t);
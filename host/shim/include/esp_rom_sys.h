@@ -0,0 +1,6 @@
+#pragma once
+// Host shim: esp_cpu_get_cycle_count() counts nanoseconds on the host, so
+// the profiler reports a 1000 MHz "CPU".
+#include <stdint.h>
+
+static inline uint32_t esp_rom_get_cpu_ticks_per_us(void) { return 1000; }
@@ -0,0 +1,16 @@
+#pragma once
+// Host shim: declarations only, implemented in host/shim/src.
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+typedef enum { ESP_GPIO_WAKEUP_GPIO_LOW = 0, ESP_GPIO_WAKEUP_GPIO_HIGH = 1 } esp_deepsleep_gpio_wake_up_mode_t;
+typedef esp_deepsleep_gpio_wake_up_mode_t esp_sleep_gpio_wake_up_mode_t;
+typedef enum { ESP_SLEEP_WAKEUP_UNDEFINED = 0, ESP_SLEEP_WAKEUP_TIMER = 4, ESP_SLEEP_WAKEUP_GPIO = 7 } esp_sleep_wakeup_cause_t;
+esp_err_t esp_sleep_enable_gpio_wakeup_on_hp_periph_powerdown(uint64_t, esp_sleep_gpio_wake_up_mode_t);
+esp_err_t esp_deep_sleep_enable_gpio_wakeup(uint64_t, esp_deepsleep_gpio_wake_up_mode_t);
+void esp_deep_sleep_start(void);
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause(void);
+uint64_t esp_sleep_get_gpio_wakeup_status(void);
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t);
+esp_err_t esp_sleep_enable_gpio_wakeup(void);
+bool esp_sleep_is_valid_wakeup_gpio(gpio_num_t);
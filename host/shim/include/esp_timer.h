@@ -0,0 +1,4 @@
+#pragma once
+// Host shim: declarations only, implemented in host/shim/src.
+#include <stdint.h>
+int64_t esp_timer_get_time(void);
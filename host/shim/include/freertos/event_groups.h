@@ -0,0 +1,11 @@
+#pragma once
+// Host shim: declarations only, implemented in host/shim/src.
+#include "freertos/FreeRTOS.h"
+typedef void* EventGroupHandle_t;
+typedef uint32_t EventBits_t;
+EventGroupHandle_t xEventGroupCreate(void);
+EventBits_t xEventGroupSetBits(EventGroupHandle_t, EventBits_t);
+BaseType_t xEventGroupSetBitsFromISR(EventGroupHandle_t, EventBits_t, BaseType_t*);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t, EventBits_t);
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t, EventBits_t, BaseType_t, BaseType_t, TickType_t);
+EventBits_t xEventGroupGetBits(EventGroupHandle_t);
@@ -0,0 +1,14 @@
+#pragma once
+// Host shim: the simulator is single-threaded. xTaskCreate() runs the task
+// function to completion on the caller, so only start-up tasks that return
+// are supported; delays advance the virtual clock.
+#include "freertos/FreeRTOS.h"
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+void vTaskDelay(TickType_t);
+void vTaskDelayUntil(TickType_t*, TickType_t);
+TickType_t xTaskGetTickCount(void);
+BaseType_t xTaskCreate(TaskFunction_t, const char*, uint32_t, void*, UBaseType_t, TaskHandle_t*);
+void vTaskDelete(TaskHandle_t);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+UBaseType_t uxTaskPriorityGet(TaskHandle_t);
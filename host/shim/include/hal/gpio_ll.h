@@ -0,0 +1,9 @@
+#pragma once
+// Host shim: the register-level accessors an ISR may call, on top of the
+// driver/gpio.h pin array in host/shim/src/gpio.cpp.
+#include <stdint.h>
+#include "driver/gpio.h"
+typedef struct { int unused; } gpio_dev_t;
+extern gpio_dev_t GPIO;
+static inline int gpio_ll_get_level(gpio_dev_t*, uint32_t gpio_num) { return gpio_get_level((gpio_num_t)gpio_num); }
+static inline void gpio_ll_set_intr_type(gpio_dev_t*, uint32_t gpio_num, gpio_int_type_t type) { gpio_set_intr_type((gpio_num_t)gpio_num, type); }
@@ -0,0 +1,58 @@
+#pragma once
+
+// Controls for the host shims, used by leor_sim to drive the core services
+// the way the board would: a virtual clock, scripted sensor data, pin levels
+// and a view of what the panel shows. Nothing here exists on the device.
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "leor/time_source.hpp"
+
+namespace leor::host {
+
+// Virtual clock behind esp_timer_get_time(), xTaskGetTickCount() and
+// vTaskDelay(). It only moves when the simulator (or a delay) moves it;
+// install it with leor::set_time_source(&clock()) so the core reads it too.
+ManualTimeSource& clock();
+int64_t now_us();
+void set_now_us(int64_t us);
+void advance_us(int64_t us);
+
+// esp_random() is a seeded generator so runs repeat exactly.
+void seed_random(uint32_t seed);
+
+// Scripted MPU6050 at I2C 0x68. A sample is the seven raw words read from
+// ACCEL_XOUT_H onwards (ax ay az temp gx gy gz); each burst read consumes
+// one, as does each period of the virtual clock while the FIFO runs, and
+// the last one repeats once the script runs out. With nothing queued the
+// sensor lies flat and still.
+void imu_set_present(bool present);
+void imu_push_sample(const int16_t raw[7]);
+size_t imu_pending();
+
+// Bytes and blocks currently allocated through operator new; the firmware
+// sees the same figures as free heap out of 256 KB.
+size_t heap_live_bytes();
+size_t heap_live_blocks();
+
+// Drives an input pin; a level change fires an enabled GPIO interrupt.
+void gpio_drive(int pin, int level);
+
+// The last frame sent to the headless panel, one byte (0 or 1) per pixel,
+// row-major. Null until the display backend has been initialised.
+const uint8_t* framebuffer();
+int framebuffer_width();
+int framebuffer_height();
+uint32_t frames_sent();
+uint8_t contrast();
+
+// Simulated central. ble_write() goes through the same command queue as a
+// GATT write; replies and other notifications reach the sink.
+void ble_connect(bool connected);
+bool ble_write(const std::string& command);
+void set_ble_notify_sink(std::function<void(const std::string&)> sink);
+
+} // namespace leor::host
@@ -0,0 +1,5 @@
+#pragma once
+// Host shim: declarations only, implemented in host/shim/src.
+#include "nvs.h"
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_erase(void);
@@ -0,0 +1,10 @@
+#pragma once
+// Host build configuration. Mirrors the options leor_core reads from the
+// firmware sdkconfig.
+#define CONFIG_PM_ENABLE 1
+#define CONFIG_FREERTOS_HZ 1000
+#define CONFIG_LEOR_PROFILER 1
+#define CONFIG_HEAP_USE_HOOKS 1
+#define CONFIG_LEOR_ALLOC_COUNTER 1
+#define CONFIG_LEOR_TRACE 1
+#define CONFIG_LEOR_AHRS_FIXED 1
@@ -0,0 +1,156 @@
+// Host shim: clock, randomness, CRC, reset, sleep and power management.
+// The heap lives in heap.cpp.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "esp_cpu.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_random.h"
+#include "esp_rom_crc.h"
+#include "esp_rom_gpio.h"
+#include "esp_sleep.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "leor/time_source.hpp"
+#include "leor_host.hpp"
+
+esp_log_level_t host_log_level = ESP_LOG_WARN;
+
+namespace {
+
+leor::ManualTimeSource s_clock;
+uint64_t s_random_state = 0x853c49e6748fea9bULL;
+
+} // namespace
+
+struct esp_pm_lock {
+    int held = 0;
+};
+
+namespace leor::host {
+
+ManualTimeSource& clock() { return s_clock; }
+int64_t now_us() { return s_clock.monotonic_us(); }
+void set_now_us(int64_t us) { s_clock.set_monotonic_us(us); }
+void advance_us(int64_t us) { s_clock.advance_us(us); }
+
+void seed_random(uint32_t seed) {
+    s_random_state = 0x853c49e6748fea9bULL ^ (static_cast<uint64_t>(seed) << 1);
+}
+
+} // namespace leor::host
+
+const char* esp_err_to_name(esp_err_t code) {
+    switch (code) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_FAIL: return "ESP_FAIL";
+    case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+    case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+    case ESP_ERR_NVS_INVALID_LENGTH: return "ESP_ERR_NVS_INVALID_LENGTH";
+    default: return "ESP_ERR_UNKNOWN";
+    }
+}
+
+void host_esp_error_check_failed(esp_err_t code, const char* file, int line, const char* expr) {
+    std::fprintf(stderr, "ESP_ERROR_CHECK failed: %s (0x%x) at %s:%d: %s\n",
+                 esp_err_to_name(code), static_cast<unsigned>(code), file, line, expr);
+    std::abort();
+}
+
+int64_t esp_timer_get_time(void) { return s_clock.monotonic_us(); }
+
+uint32_t esp_random(void) {
+    // PCG32 output step; deterministic for a given leor::host::seed_random().
+    const uint64_t old = s_random_state;
+    s_random_state = old * 6364136223846793005ULL + 1442695040888963407ULL;
+    const uint32_t xorshifted = static_cast<uint32_t>(((old >> 18U) ^ old) >> 27U);
+    const uint32_t rot = static_cast<uint32_t>(old >> 59U);
+    return (xorshifted >> rot) | (xorshifted << ((32U - rot) & 31U));
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len) {
+    // Same convention as the ROM routine: reflected 0xEDB88320, inverted in
+    // and out.
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+        }
+    }
+    return ~crc;
+}
+
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void) {
+    // Host nanoseconds; see esp_rom_get_cpu_ticks_per_us().
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch());
+    return static_cast<esp_cpu_cycle_count_t>(ns.count());
+}
+
+esp_reset_reason_t esp_reset_reason(void) { return ESP_RST_POWERON; }
+
+void esp_restart(void) {
+    std::fprintf(stderr, "[host] esp_restart at %lld ms\n",
+                 static_cast<long long>(s_clock.monotonic_us() / 1000));
+    std::exit(0);
+}
+
+void esp_rom_gpio_pad_select_gpio(uint32_t) {}
+
+esp_err_t esp_sleep_enable_gpio_wakeup_on_hp_periph_powerdown(uint64_t, esp_sleep_gpio_wake_up_mode_t) {
+    return ESP_OK;
+}
+esp_err_t esp_deep_sleep_enable_gpio_wakeup(uint64_t, esp_deepsleep_gpio_wake_up_mode_t) { return ESP_OK; }
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t) { return ESP_OK; }
+esp_err_t esp_sleep_enable_gpio_wakeup(void) { return ESP_OK; }
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause(void) { return ESP_SLEEP_WAKEUP_UNDEFINED; }
+uint64_t esp_sleep_get_gpio_wakeup_status(void) { return 0; }
+// The ESP32-C3 wakes from deep sleep on its RTC pins, GPIO0-5.
+bool esp_sleep_is_valid_wakeup_gpio(gpio_num_t gpio) { return gpio >= 0 && gpio <= 5; }
+
+void esp_deep_sleep_start(void) {
+    // Never returns on the device; the simulated session ends here.
+    std::fprintf(stderr, "[host] deep sleep at %lld ms\n",
+                 static_cast<long long>(s_clock.monotonic_us() / 1000));
+    std::exit(0);
+}
+
+esp_err_t esp_pm_configure(const void*) { return ESP_OK; }
+
+esp_err_t esp_pm_lock_create(esp_pm_lock_type_t, int, const char*, esp_pm_lock_handle_t* out) {
+    *out = new esp_pm_lock();
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t lock) {
+    lock->held++;
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t lock) {
+    if (lock->held == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    lock->held--;
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_delete(esp_pm_lock_handle_t lock) {
+    if (lock->held != 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    delete lock;
+    return ESP_OK;
+}
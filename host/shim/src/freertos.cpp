@@ -0,0 +1,124 @@
+// Host shim: single-threaded FreeRTOS primitives on the virtual clock.
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "leor_host.hpp"
+
+namespace {
+
+struct EventGroup {
+    EventBits_t bits = 0;
+};
+
+struct Semaphore {
+    int count = 0;
+};
+
+int s_current_task = 0;
+
+} // namespace
+
+void vTaskDelay(TickType_t ticks) {
+    leor::host::advance_us(static_cast<int64_t>(pdTICKS_TO_MS(ticks)) * 1000);
+}
+
+void vTaskDelayUntil(TickType_t* previous_wake, TickType_t period) {
+    *previous_wake += period;
+    const TickType_t now = xTaskGetTickCount();
+    if (static_cast<int32_t>(*previous_wake - now) > 0) {
+        vTaskDelay(*previous_wake - now);
+    }
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return static_cast<TickType_t>(leor::host::now_us() / 1000);
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char*, uint32_t, void* arg, UBaseType_t, TaskHandle_t* out) {
+    if (out != nullptr) {
+        *out = &s_current_task;
+    }
+    fn(arg);
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t) {}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) { return &s_current_task; }
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t) { return 1; }
+
+EventGroupHandle_t xEventGroupCreate(void) { return new EventGroup(); }
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    auto* g = static_cast<EventGroup*>(group);
+    g->bits |= bits;
+    return g->bits;
+}
+
+BaseType_t xEventGroupSetBitsFromISR(EventGroupHandle_t group, EventBits_t bits, BaseType_t* woken) {
+    xEventGroupSetBits(group, bits);
+    if (woken != nullptr) {
+        *woken = pdFALSE;
+    }
+    return pdPASS;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    auto* g = static_cast<EventGroup*>(group);
+    const EventBits_t before = g->bits;
+    g->bits &= ~bits;
+    return before;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear_on_exit,
+                                BaseType_t wait_for_all, TickType_t timeout) {
+    // Nothing else can set bits while we wait, so an unsatisfied wait just
+    // lets its timeout elapse on the virtual clock.
+    auto* g = static_cast<EventGroup*>(group);
+    const EventBits_t value = g->bits;
+    const bool satisfied = wait_for_all ? (value & bits) == bits : (value & bits) != 0;
+    if (satisfied) {
+        if (clear_on_exit) {
+            g->bits &= ~bits;
+        }
+    } else if (timeout != portMAX_DELAY) {
+        vTaskDelay(timeout);
+    }
+    return value;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+    return static_cast<EventGroup*>(group)->bits;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    auto* s = new Semaphore();
+    s->count = 1;
+    return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) { return new Semaphore(); }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t timeout) {
+    auto* s = static_cast<Semaphore*>(sem);
+    if (s->count == 0) {
+        if (timeout != portMAX_DELAY) {
+            vTaskDelay(timeout);
+        }
+        return pdFALSE;
+    }
+    s->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    auto* s = static_cast<Semaphore*>(sem);
+    if (s->count > 0) {
+        return pdFALSE;
+    }
+    s->count++;
+    return pdTRUE;
+}
@@ -0,0 +1,145 @@
+// Host shim: pin levels in an array; leor::host::gpio_drive() stands in for
+// the outside world and fires an enabled edge or level interrupt.
+
+#include "driver/gpio.h"
+#include "hal/gpio_ll.h"
+#include "leor_host.hpp"
+
+gpio_dev_t GPIO;
+
+namespace {
+
+struct Pin {
+    int level = 0;
+    gpio_int_type_t intr_type = GPIO_INTR_DISABLE;
+    bool intr_enabled = false;
+    gpio_isr_t isr = nullptr;
+    void* isr_arg = nullptr;
+};
+
+Pin s_pins[GPIO_NUM_MAX];
+
+Pin* pin_at(int pin) {
+    return pin >= 0 && pin < GPIO_NUM_MAX ? &s_pins[pin] : nullptr;
+}
+
+bool should_fire(const Pin& p, int old_level) {
+    switch (p.intr_type) {
+    case GPIO_INTR_POSEDGE: return old_level == 0 && p.level == 1;
+    case GPIO_INTR_NEGEDGE: return old_level == 1 && p.level == 0;
+    case GPIO_INTR_ANYEDGE: return old_level != p.level;
+    case GPIO_INTR_LOW_LEVEL: return p.level == 0;
+    case GPIO_INTR_HIGH_LEVEL: return p.level == 1;
+    default: return false;
+    }
+}
+
+void maybe_fire(Pin& p, int old_level) {
+    if (p.intr_enabled && p.isr != nullptr && should_fire(p, old_level)) {
+        p.isr(p.isr_arg);
+    }
+}
+
+} // namespace
+
+namespace leor::host {
+
+void gpio_drive(int pin, int level) {
+    Pin* p = pin_at(pin);
+    if (p == nullptr) {
+        return;
+    }
+    const int old_level = p->level;
+    p->level = level ? 1 : 0;
+    maybe_fire(*p, old_level);
+}
+
+} // namespace leor::host
+
+esp_err_t gpio_config(const gpio_config_t* config) {
+    for (int pin = 0; pin < GPIO_NUM_MAX; pin++) {
+        if (config->pin_bit_mask & (1ULL << pin)) {
+            s_pins[pin].intr_type = config->intr_type;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level) {
+    Pin* p = pin_at(pin);
+    if (p == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    p->level = level ? 1 : 0;
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t pin) {
+    const Pin* p = pin_at(pin);
+    return p != nullptr ? p->level : 0;
+}
+
+esp_err_t gpio_hold_en(gpio_num_t) { return ESP_OK; }
+esp_err_t gpio_hold_dis(gpio_num_t) { return ESP_OK; }
+void gpio_deep_sleep_hold_en(void) {}
+void gpio_deep_sleep_hold_dis(void) {}
+esp_err_t gpio_set_direction(gpio_num_t, gpio_mode_t) { return ESP_OK; }
+esp_err_t gpio_pullup_dis(gpio_num_t) { return ESP_OK; }
+esp_err_t gpio_pulldown_dis(gpio_num_t) { return ESP_OK; }
+esp_err_t gpio_pullup_en(gpio_num_t) { return ESP_OK; }
+esp_err_t gpio_pulldown_en(gpio_num_t) { return ESP_OK; }
+esp_err_t gpio_install_isr_service(int) { return ESP_OK; }
+
+esp_err_t gpio_isr_handler_add(gpio_num_t pin, gpio_isr_t isr, void* arg) {
+    Pin* p = pin_at(pin);
+    if (p == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    p->isr = isr;
+    p->isr_arg = arg;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t pin) {
+    Pin* p = pin_at(pin);
+    if (p == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    p->isr = nullptr;
+    p->isr_arg = nullptr;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t pin, gpio_int_type_t type) {
+    Pin* p = pin_at(pin);
+    if (p == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    p->intr_type = type;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t pin) {
+    Pin* p = pin_at(pin);
+    if (p == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    p->intr_enabled = true;
+    // A level interrupt armed while the level already holds fires at once.
+    if (p->intr_type == GPIO_INTR_LOW_LEVEL || p->intr_type == GPIO_INTR_HIGH_LEVEL) {
+        maybe_fire(*p, p->level);
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t pin) {
+    Pin* p = pin_at(pin);
+    if (p == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    p->intr_enabled = false;
+    return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_enable(gpio_num_t, gpio_int_type_t) { return ESP_OK; }
+esp_err_t gpio_wakeup_disable(gpio_num_t) { return ESP_OK; }
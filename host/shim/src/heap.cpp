@@ -0,0 +1,67 @@
+// Host shim: a heap the size of the C3's. operator new/delete call the
+// CONFIG_HEAP_USE_HOOKS hooks the way the IDF allocator does and keep live
+// totals, so free-heap figures move and leaks show. The simulator is
+// single-threaded.
+
+#include <malloc.h>
+
+#include <cstdlib>
+#include <new>
+
+#include "esp_heap_caps.h"
+#include "esp_system.h"
+#include "leor_host.hpp"
+
+namespace {
+
+constexpr size_t kHeapBytes = 256 * 1024;
+
+size_t s_live_bytes = 0;
+size_t s_live_blocks = 0;
+size_t s_peak_bytes = 0;
+
+size_t free_bytes(size_t used) {
+    return used < kHeapBytes ? kHeapBytes - used : 0;
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    void* p = std::malloc(size > 0 ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    s_live_bytes += malloc_usable_size(p);
+    ++s_live_blocks;
+    if (s_live_bytes > s_peak_bytes) {
+        s_peak_bytes = s_live_bytes;
+    }
+    esp_heap_trace_alloc_hook(p, size, MALLOC_CAP_DEFAULT);
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    if (p == nullptr) {
+        return;
+    }
+    esp_heap_trace_free_hook(p);
+    s_live_bytes -= malloc_usable_size(p);
+    --s_live_blocks;
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+
+uint32_t esp_get_free_heap_size(void) { return static_cast<uint32_t>(free_bytes(s_live_bytes)); }
+uint32_t esp_get_minimum_free_heap_size(void) { return static_cast<uint32_t>(free_bytes(s_peak_bytes)); }
+size_t heap_caps_get_free_size(uint32_t) { return free_bytes(s_live_bytes); }
+// No fragmentation model: the largest block is whatever is free.
+size_t heap_caps_get_largest_free_block(uint32_t) { return free_bytes(s_live_bytes); }
+size_t heap_caps_get_minimum_free_size(uint32_t) { return free_bytes(s_peak_bytes); }
+
+namespace leor::host {
+
+size_t heap_live_bytes() { return s_live_bytes; }
+size_t heap_live_blocks() { return s_live_blocks; }
+
+} // namespace leor::host
@@ -0,0 +1,256 @@
+// Host shim: an I2C master with one scripted device, an MPU6050 at 0x68.
+// Register writes land in a register file; a burst read from ACCEL_XOUT_H
+// returns the next scripted sample. With the FIFO enabled the sensor fills
+// it on the virtual clock at the configured sample rate, one scripted sample
+// per period, and FIFO_COUNT / FIFO_R_W read it back. Any other address
+// NACKs.
+
+#include <cstring>
+#include <deque>
+
+#include "driver/i2c_master.h"
+#include "leor_host.hpp"
+
+namespace {
+
+constexpr uint16_t kMpuAddress = 0x68;
+constexpr uint8_t kRegSmplrtDiv = 0x19;
+constexpr uint8_t kRegConfig = 0x1A;
+constexpr uint8_t kRegFifoEn = 0x23;
+constexpr uint8_t kRegAccelXoutH = 0x3B;
+constexpr uint8_t kRegUserCtrl = 0x6A;
+constexpr uint8_t kRegPwrMgmt1 = 0x6B;
+constexpr uint8_t kRegFifoCountH = 0x72;
+constexpr uint8_t kRegFifoRw = 0x74;
+constexpr uint8_t kRegWhoAmI = 0x75;
+
+constexpr uint8_t kUserCtrlFifoEn = 0x40;
+constexpr uint8_t kUserCtrlFifoReset = 0x04;
+constexpr uint8_t kPwrSleep = 0x40;
+constexpr size_t kFifoBytes = 1024;
+constexpr size_t kSampleBytes = 14;
+
+struct Sample {
+    int16_t raw[7];
+};
+
+// Flat on the table, 1 g on +Z at the default +-2 g range.
+constexpr Sample kStill = {{0, 0, 16384, 0, 0, 0, 0}};
+
+bool s_mpu_present = true;
+uint8_t s_regs[128] = {};
+std::deque<Sample> s_script;
+Sample s_last = kStill;
+bool s_bus_created = false;
+
+// Fixed ring like the chip's: when full, each new byte pushes out the oldest.
+uint8_t s_fifo[kFifoBytes] = {};
+size_t s_fifo_head = 0;
+size_t s_fifo_count = 0;
+int64_t s_fifo_next_us = 0;
+
+void fifo_clear() {
+    s_fifo_head = 0;
+    s_fifo_count = 0;
+}
+
+void reset_regs() {
+    std::memset(s_regs, 0, sizeof(s_regs));
+    s_regs[kRegPwrMgmt1] = kPwrSleep; // sleep bit set after reset
+    s_regs[kRegWhoAmI] = 0x68;
+    fifo_clear();
+}
+
+void advance_script() {
+    if (!s_script.empty()) {
+        s_last = s_script.front();
+        s_script.pop_front();
+    }
+}
+
+void encode_sample(uint8_t* bytes) {
+    for (int i = 0; i < 7; i++) {
+        const uint16_t word = static_cast<uint16_t>(s_last.raw[i]);
+        bytes[i * 2] = static_cast<uint8_t>(word >> 8);
+        bytes[i * 2 + 1] = static_cast<uint8_t>(word & 0xFF);
+    }
+}
+
+void next_sample(uint8_t* out, size_t len) {
+    advance_script();
+    uint8_t bytes[kSampleBytes];
+    encode_sample(bytes);
+    std::memcpy(out, bytes, len < sizeof(bytes) ? len : sizeof(bytes));
+}
+
+bool fifo_running() {
+    return (s_regs[kRegUserCtrl] & kUserCtrlFifoEn) && s_regs[kRegFifoEn] != 0 &&
+           !(s_regs[kRegPwrMgmt1] & kPwrSleep);
+}
+
+int64_t sample_period_us() {
+    // The gyro output runs at 8 kHz with the DLPF off, 1 kHz with it on.
+    const uint8_t dlpf = s_regs[kRegConfig] & 0x07U;
+    const int64_t gyro_hz = (dlpf == 0 || dlpf == 7) ? 8000 : 1000;
+    return (1 + s_regs[kRegSmplrtDiv]) * 1000000LL / gyro_hz;
+}
+
+void sync_count_regs() {
+    s_regs[kRegFifoCountH] = static_cast<uint8_t>(s_fifo_count >> 8);
+    s_regs[kRegFifoCountH + 1] = static_cast<uint8_t>(s_fifo_count & 0xFF);
+}
+
+void fifo_push(const uint8_t* bytes, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (s_fifo_count == kFifoBytes) {
+            s_fifo_head = (s_fifo_head + 1) % kFifoBytes;
+            s_fifo_count--;
+        }
+        s_fifo[(s_fifo_head + s_fifo_count) % kFifoBytes] = bytes[i];
+        s_fifo_count++;
+    }
+}
+
+// Brings the FIFO up to the virtual clock. Only the layout the firmware
+// enables is modelled: every enabled FIFO writes the full 14-byte frame.
+void fifo_catch_up() {
+    const int64_t now = leor::host::now_us();
+    const int64_t period = sample_period_us();
+    if (!fifo_running()) {
+        // Starting (or waking) the FIFO restarts the sample clock from then.
+        s_fifo_next_us = now + period;
+        sync_count_regs();
+        return;
+    }
+    // After a long jump only the last FIFO's worth survives; the script
+    // still moves on by every sample taken in between.
+    const int64_t keep = static_cast<int64_t>(kFifoBytes / kSampleBytes) + 1;
+    if (now - s_fifo_next_us > keep * period) {
+        const int64_t skipped = (now - s_fifo_next_us) / period - keep;
+        for (int64_t i = 0; i < skipped && !s_script.empty(); i++) {
+            advance_script();
+        }
+        s_fifo_next_us += skipped * period;
+    }
+    while (s_fifo_next_us <= now) {
+        advance_script();
+        uint8_t bytes[kSampleBytes];
+        encode_sample(bytes);
+        fifo_push(bytes, sizeof(bytes));
+        s_fifo_next_us += period;
+    }
+    sync_count_regs();
+}
+
+void fifo_read(uint8_t* out, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (s_fifo_count == 0) {
+            out[i] = 0;
+            continue;
+        }
+        out[i] = s_fifo[s_fifo_head];
+        s_fifo_head = (s_fifo_head + 1) % kFifoBytes;
+        s_fifo_count--;
+    }
+    sync_count_regs();
+}
+
+} // namespace
+
+struct i2c_master_bus_t {
+    i2c_port_num_t port = 0;
+};
+
+struct i2c_master_dev_t {
+    uint16_t address = 0;
+};
+
+namespace leor::host {
+
+void imu_set_present(bool present) { s_mpu_present = present; }
+
+void imu_push_sample(const int16_t raw[7]) {
+    Sample s;
+    std::memcpy(s.raw, raw, sizeof(s.raw));
+    s_script.push_back(s);
+}
+
+size_t imu_pending() { return s_script.size(); }
+
+} // namespace leor::host
+
+esp_err_t i2c_master_get_bus_handle(i2c_port_num_t, i2c_master_bus_handle_t*) {
+    return ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t* config, i2c_master_bus_handle_t* out) {
+    if (s_bus_created) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_bus_created = true;
+    reset_regs();
+    *out = new i2c_master_bus_t{config->i2c_port};
+    return ESP_OK;
+}
+
+esp_err_t i2c_del_master_bus(i2c_master_bus_handle_t bus) {
+    delete bus;
+    s_bus_created = false;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t, const i2c_device_config_t* config,
+                                    i2c_master_dev_handle_t* out) {
+    *out = new i2c_master_dev_t{config->device_address};
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_rm_device(i2c_master_dev_handle_t dev) {
+    delete dev;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t dev, const uint8_t* data, size_t len, int) {
+    if (dev->address != kMpuAddress || !s_mpu_present) {
+        return ESP_FAIL;
+    }
+    fifo_catch_up();
+    if (len >= 2) {
+        if (data[0] == kRegPwrMgmt1 && (data[1] & 0x80U)) {
+            reset_regs();
+        } else if (data[0] == kRegUserCtrl && (data[1] & kUserCtrlFifoReset)) {
+            // Self-clearing; only takes while the FIFO is disabled.
+            if (!(s_regs[kRegUserCtrl] & kUserCtrlFifoEn)) {
+                fifo_clear();
+            }
+            s_regs[kRegUserCtrl] = data[1] & ~kUserCtrlFifoReset;
+        } else {
+            s_regs[data[0] & 0x7FU] = data[1];
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_transmit_receive(i2c_master_dev_handle_t dev, const uint8_t* tx, size_t tx_len,
+                                      uint8_t* rx, size_t rx_len, int) {
+    if (dev->address != kMpuAddress || !s_mpu_present || tx_len < 1) {
+        return ESP_FAIL;
+    }
+    if (tx[0] == kRegAccelXoutH) {
+        next_sample(rx, rx_len);
+        return ESP_OK;
+    }
+    fifo_catch_up();
+    if (tx[0] == kRegFifoRw) {
+        fifo_read(rx, rx_len);
+        return ESP_OK;
+    }
+    for (size_t i = 0; i < rx_len; i++) {
+        rx[i] = s_regs[(tx[0] + i) & 0x7FU];
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_probe(i2c_master_bus_handle_t, uint16_t address, int) {
+    return address == kMpuAddress && s_mpu_present ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
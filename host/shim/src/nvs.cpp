@@ -0,0 +1,148 @@
+// Host shim: NVS as an in-memory map, typed like the real store (a key
+// written as u32 is not found by nvs_get_i32). Nothing persists between
+// simulator runs.
+
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "nvs.h"
+#include "nvs_flash.h"
+
+namespace {
+
+enum class EntryType : uint8_t { kU8, kI32, kU32, kU64, kStr, kBlob };
+
+struct Entry {
+    EntryType type = EntryType::kU8;
+    uint64_t number = 0;
+    std::string bytes;
+};
+
+using Namespace = std::map<std::string, Entry>;
+
+std::map<std::string, Namespace> s_store;
+std::vector<std::string> s_handles; // handle - 1 -> namespace name
+
+Namespace* lookup(nvs_handle_t handle) {
+    if (handle == 0 || handle > s_handles.size()) {
+        return nullptr;
+    }
+    return &s_store[s_handles[handle - 1]];
+}
+
+template <typename T>
+esp_err_t get_number(nvs_handle_t handle, const char* key, EntryType type, T* out) {
+    Namespace* ns = lookup(handle);
+    if (ns == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const auto it = ns->find(key);
+    if (it == ns->end() || it->second.type != type) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    *out = static_cast<T>(it->second.number);
+    return ESP_OK;
+}
+
+esp_err_t set_entry(nvs_handle_t handle, const char* key, Entry entry) {
+    Namespace* ns = lookup(handle);
+    if (ns == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    (*ns)[key] = std::move(entry);
+    return ESP_OK;
+}
+
+esp_err_t get_bytes(nvs_handle_t handle, const char* key, EntryType type, void* out, size_t* length,
+                    bool terminate) {
+    Namespace* ns = lookup(handle);
+    if (ns == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const auto it = ns->find(key);
+    if (it == ns->end() || it->second.type != type) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    const std::string& bytes = it->second.bytes;
+    const size_t needed = bytes.size() + (terminate ? 1 : 0);
+    if (out == nullptr) {
+        *length = needed;
+        return ESP_OK;
+    }
+    if (*length < needed) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    std::memcpy(out, bytes.data(), bytes.size());
+    if (terminate) {
+        static_cast<char*>(out)[bytes.size()] = '\0';
+    }
+    *length = needed;
+    return ESP_OK;
+}
+
+} // namespace
+
+esp_err_t nvs_flash_init(void) { return ESP_OK; }
+
+esp_err_t nvs_flash_erase(void) {
+    s_store.clear();
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char* name, nvs_open_mode_t, nvs_handle_t* out) {
+    s_handles.emplace_back(name);
+    *out = static_cast<nvs_handle_t>(s_handles.size());
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t) {}
+
+esp_err_t nvs_get_u8(nvs_handle_t h, const char* key, uint8_t* out) {
+    return get_number(h, key, EntryType::kU8, out);
+}
+esp_err_t nvs_get_i32(nvs_handle_t h, const char* key, int32_t* out) {
+    return get_number(h, key, EntryType::kI32, out);
+}
+esp_err_t nvs_get_u32(nvs_handle_t h, const char* key, uint32_t* out) {
+    return get_number(h, key, EntryType::kU32, out);
+}
+esp_err_t nvs_get_u64(nvs_handle_t h, const char* key, uint64_t* out) {
+    return get_number(h, key, EntryType::kU64, out);
+}
+esp_err_t nvs_get_str(nvs_handle_t h, const char* key, char* out, size_t* length) {
+    return get_bytes(h, key, EntryType::kStr, out, length, true);
+}
+esp_err_t nvs_get_blob(nvs_handle_t h, const char* key, void* out, size_t* length) {
+    return get_bytes(h, key, EntryType::kBlob, out, length, false);
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t h, const char* key, uint8_t value) {
+    return set_entry(h, key, {EntryType::kU8, value, {}});
+}
+esp_err_t nvs_set_i32(nvs_handle_t h, const char* key, int32_t value) {
+    return set_entry(h, key, {EntryType::kI32, static_cast<uint64_t>(static_cast<int64_t>(value)), {}});
+}
+esp_err_t nvs_set_u32(nvs_handle_t h, const char* key, uint32_t value) {
+    return set_entry(h, key, {EntryType::kU32, value, {}});
+}
+esp_err_t nvs_set_u64(nvs_handle_t h, const char* key, uint64_t value) {
+    return set_entry(h, key, {EntryType::kU64, value, {}});
+}
+esp_err_t nvs_set_str(nvs_handle_t h, const char* key, const char* value) {
+    return set_entry(h, key, {EntryType::kStr, 0, value});
+}
+esp_err_t nvs_set_blob(nvs_handle_t h, const char* key, const void* value, size_t length) {
+    return set_entry(h, key, {EntryType::kBlob, 0, std::string(static_cast<const char*>(value), length)});
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t h, const char* key) {
+    Namespace* ns = lookup(h);
+    if (ns == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ns->erase(key) > 0 ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_commit(nvs_handle_t) { return ESP_OK; }
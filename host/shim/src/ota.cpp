@@ -0,0 +1,71 @@
+// Host shim: there is no flash to update, so OTA fails cleanly at begin.
+// The one partition found is "imutrace", held in RAM with NOR flash rules:
+// erase sets 4 KB sectors to 0xFF and a write can only clear bits. Nothing
+// persists between runs.
+
+#include <cstring>
+#include <vector>
+
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+
+namespace {
+
+constexpr uint32_t kSectorBytes = 4096;
+
+esp_partition_t g_imutrace = {ESP_PARTITION_TYPE_DATA, 0x40, 0x340000, 256 * 1024, kSectorBytes, "imutrace"};
+
+std::vector<uint8_t>& flash() {
+    static std::vector<uint8_t> bytes(g_imutrace.size, 0xFF);
+    return bytes;
+}
+
+bool in_range(const esp_partition_t* part, size_t offset, size_t size) {
+    return part == &g_imutrace && offset <= part->size && size <= part->size - offset;
+}
+
+} // namespace
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char* label) {
+    if (type == g_imutrace.type && static_cast<int>(subtype) == g_imutrace.subtype && label != nullptr &&
+        std::strcmp(label, g_imutrace.label) == 0) {
+        return &g_imutrace;
+    }
+    return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* part, size_t offset, void* dst, size_t size) {
+    if (!in_range(part, offset, size)) return ESP_ERR_INVALID_ARG;
+    std::memcpy(dst, flash().data() + offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* part, size_t offset, const void* src, size_t size) {
+    if (!in_range(part, offset, size)) return ESP_ERR_INVALID_ARG;
+    const uint8_t* in = static_cast<const uint8_t*>(src);
+    for (size_t i = 0; i < size; ++i) {
+        flash()[offset + i] &= in[i];
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* part, size_t offset, size_t size) {
+    if (!in_range(part, offset, size) || offset % kSectorBytes != 0 || size % kSectorBytes != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::memset(flash().data() + offset, 0xFF, size);
+    return ESP_OK;
+}
+
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t*) { return nullptr; }
+const esp_partition_t* esp_ota_get_running_partition(void) { return nullptr; }
+esp_err_t esp_ota_begin(const esp_partition_t*, size_t, esp_ota_handle_t*) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t esp_ota_write(esp_ota_handle_t, const void*, size_t) { return ESP_ERR_INVALID_STATE; }
+esp_err_t esp_ota_end(esp_ota_handle_t) { return ESP_ERR_INVALID_STATE; }
+esp_err_t esp_ota_abort(esp_ota_handle_t) { return ESP_OK; }
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t*) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t esp_ota_get_state_partition(const esp_partition_t*, esp_ota_img_states_t*) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+esp_err_t esp_ota_mark_app_valid_cancel_rollback(void) { return ESP_OK; }
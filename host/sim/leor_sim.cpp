@@ -0,0 +1,893 @@
+// leor_sim: runs the firmware's Application on the host shims.
+//
+//   leor_sim run [options]          live session on the virtual clock
+//   leor_sim replay <log> [options] replay a rec:dump log (API.md)
+//   leor_sim soak [options]         long scripted session with health checks
+//   leor_sim alloc-check [options]  fail if a steady-state tick allocates
+//   leor_sim ahrs-bench             fixed-point vs float Mahony filter
+//   leor_sim replay-imu <capture>   score gesture matching on a cap:dump
+//
+// Options:
+//   --ms N            simulated run length (run: default 10000; replay: until
+//                     the log ends plus 1000)
+//   --hours N         soak length in virtual hours (default 24)
+//   --start-ms N      monotonic clock at power-on (soak default: 12 h before
+//                     the uint32 millisecond wrap, so a day crosses it)
+//   --seed N          esp_random() and soak workload seed
+//   --cmd [T:]CMD     BLE command write at T ms (default 0); repeatable
+//   --touch T:LEVEL   drive the touch pad pin at T ms; repeatable
+//   --imu FILE        scripted MPU6050 samples, one "ax ay az temp gx gy gz"
+//                     line per 50 Hz sample period
+//   --connect         a central is connected from the start
+//   --ascii           print the final frame as text
+//   --set KEY=VALUE   replay-imu: gesture setting as its BLE command (gst=,
+//                     gpt=, gvt=, gtt=, gtd=, gcf=, grt=, gcd=, ginv=, ged=)
+//   --min-accuracy P  replay-imu: fail below P percent of labels recognised
+//   --max-fp-per-min N  replay-imu: fail above N false positives a minute
+//   -v                ESP_LOGI output on stderr
+//
+// Input times are ms after power-on. Stdout gets one "< reply" line per BLE
+// notification and a final summary line with a hash of the last frame, so
+// two runs can be diffed. soak prints one line per virtual hour instead and
+// exits 1 if the loop stalls, spins, stops rendering, leaks heap or resets.
+// alloc-check runs the face (with shuffle), the clock and gesture matching
+// in turn, configured over BLE first, and exits 1 if any tick in the
+// measured stretch allocated from the heap. ahrs-bench prints the timing
+// and accuracy JSON of mahony_bench_json() (host nanoseconds stand in for
+// cycles) and exits 1 if the fixed-point pitch or roll strays from the float
+// filter's by more than kAhrsMaxErrorDeg.
+//
+// replay-imu takes the cap:dump pages (the replies as logged, or this
+// program's own "< " output) or a raw read of the imutrace partition, and
+// runs each capture session through a fresh GestureService, one sample per
+// poll(). A labelled gesture counts as recognised when the same gesture is
+// matched within kLabelWindowMs of the label; any other match is a false
+// positive. It prints recall per label, false positives per minute of
+// samples and the decision latency per gesture, and exits 1 on a missed
+// limit.
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "esp_log.h"
+#include "leor/alloc_counter.hpp"
+#include "leor/application.hpp"
+#include "leor/gesture_service.hpp"
+#include "leor/imu_capture.hpp"
+#include "leor/mahony.hpp"
+#include "leor/rng.hpp"
+#include "leor/session_recorder.hpp"
+#include "leor/time_source.hpp"
+#include "leor_host.hpp"
+
+namespace {
+
+// PowerService's default wake_pin.
+constexpr int kTouchPin = 0;
+constexpr int64_t kMsPerHour = 3600LL * 1000LL;
+// Soak limits: Application idles at most kIdleTickMaxMs between ticks and
+// renders at most 60 Hz.
+constexpr int64_t kSoakMaxGapMs = 1100;
+constexpr uint64_t kSoakMaxTicksPerHour = 66ULL * 3600ULL;
+constexpr size_t kSoakMaxHeapGrowth = 4096;
+// 2026-01-01T00:00:00Z, for clock mode.
+constexpr int64_t kSoakEpochMs = 1767225600000LL;
+// A minute of 50 Hz samples; the gesture thresholds work in whole degrees.
+constexpr uint32_t kAhrsBenchSamples = 3000;
+constexpr float kAhrsMaxErrorDeg = 0.1f;
+// A cap:label= sent within this long of the gesture, before or after.
+constexpr uint32_t kLabelWindowMs = 3000;
+
+enum class InputKind { kCommand, kTouch, kConnect, kShake };
+
+struct Input {
+    int64_t t_ms = 0;
+    InputKind kind = InputKind::kCommand;
+    int level = 0;
+    std::string command;
+};
+
+struct Options {
+    std::string mode;
+    std::string log_path;
+    std::string imu_path;
+    uint32_t run_ms = 0;
+    uint32_t hours = 24;
+    int64_t start_ms = -1;
+    uint32_t seed = 1;
+    bool connect = false;
+    bool ascii = false;
+    std::vector<Input> inputs;
+    std::vector<std::string> gesture_settings;
+    float min_accuracy = -1.0f;
+    float max_fp_per_min = -1.0f;
+};
+
+[[noreturn]] void usage() {
+    std::fprintf(stderr,
+                 "usage: leor_sim run [--ms N] [--seed N] [--start-ms N] [--cmd [T:]CMD]...\n"
+                 "                    [--touch T:LEVEL]... [--imu FILE] [--connect] [--ascii] [-v]\n"
+                 "       leor_sim replay LOG [--ms N] [--ascii] [-v]\n"
+                 "       leor_sim soak [--hours N] [--seed N] [--start-ms N] [-v]\n"
+                 "       leor_sim alloc-check [--seed N] [-v]\n"
+                 "       leor_sim ahrs-bench\n"
+                 "       leor_sim replay-imu CAPTURE [--set KEY=VALUE]... [--min-accuracy P]\n"
+                 "                    [--max-fp-per-min N]\n");
+    std::exit(2);
+}
+
+uint64_t parse_u64(const char* text) {
+    char* end = nullptr;
+    const unsigned long long value = std::strtoull(text, &end, 0);
+    if (end == text || *end != '\0') {
+        usage();
+    }
+    return value;
+}
+
+uint32_t parse_u32(const char* text) {
+    return static_cast<uint32_t>(parse_u64(text));
+}
+
+float parse_float(const char* text) {
+    char* end = nullptr;
+    const float value = std::strtof(text, &end);
+    if (end == text || *end != '\0') {
+        usage();
+    }
+    return value;
+}
+
+// Applies one --set; false for a key GestureService has no setting for.
+bool apply_gesture_setting(leor::GestureService& g, const std::string& setting) {
+    const size_t eq = setting.find('=');
+    if (eq == std::string::npos) {
+        return false;
+    }
+    const std::string key = setting.substr(0, eq);
+    const float value = std::strtof(setting.c_str() + eq + 1, nullptr);
+    if (key == "gst") {
+        g.set_shake_threshold(value);
+    } else if (key == "gpt") {
+        g.set_pat_threshold(value);
+    } else if (key == "gvt") {
+        g.set_swipe_threshold(value);
+    } else if (key == "gtt") {
+        g.set_touch_threshold(value);
+    } else if (key == "gtd") {
+        g.set_pickup_tilt_deg(value);
+    } else if (key == "gcf") {
+        g.set_confidence(static_cast<uint32_t>(value));
+    } else if (key == "grt") {
+        g.set_reaction_time(static_cast<uint32_t>(value));
+    } else if (key == "gcd") {
+        g.set_cooldown(static_cast<uint32_t>(value));
+    } else if (key == "ginv") {
+        g.set_inverted(value != 0.0f);
+    } else if (key == "ged") {
+        g.set_early_decisions(value != 0.0f);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// "[T:]rest" -> T (0 if absent) and rest. Commands start with a letter, so a
+// leading number is always a timestamp.
+int64_t split_time(const std::string& arg, std::string& rest) {
+    size_t i = 0;
+    while (i < arg.size() && std::isdigit(static_cast<unsigned char>(arg[i]))) {
+        ++i;
+    }
+    if (i > 0 && i < arg.size() && arg[i] == ':') {
+        rest = arg.substr(i + 1);
+        return std::strtoll(arg.substr(0, i).c_str(), nullptr, 10);
+    }
+    rest = arg;
+    return 0;
+}
+
+void sort_inputs(std::vector<Input>& inputs) {
+    std::stable_sort(inputs.begin(), inputs.end(),
+                     [](const Input& a, const Input& b) { return a.t_ms < b.t_ms; });
+}
+
+Options parse_args(int argc, char** argv) {
+    if (argc < 2) {
+        usage();
+    }
+    Options opt;
+    opt.mode = argv[1];
+    int i = 2;
+    if (opt.mode == "replay" || opt.mode == "replay-imu") {
+        if (argc < 3) {
+            usage();
+        }
+        opt.log_path = argv[2];
+        i = 3;
+    } else if (opt.mode != "run" && opt.mode != "soak" && opt.mode != "alloc-check" &&
+               opt.mode != "ahrs-bench") {
+        usage();
+    }
+    for (; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--ms" && has_value) {
+            opt.run_ms = parse_u32(argv[++i]);
+        } else if (arg == "--hours" && has_value) {
+            opt.hours = parse_u32(argv[++i]);
+        } else if (arg == "--start-ms" && has_value) {
+            opt.start_ms = static_cast<int64_t>(parse_u64(argv[++i]));
+        } else if (arg == "--seed" && has_value) {
+            opt.seed = parse_u32(argv[++i]);
+        } else if (arg == "--cmd" && has_value) {
+            Input in;
+            in.t_ms = split_time(argv[++i], in.command);
+            opt.inputs.push_back(in);
+        } else if (arg == "--touch" && has_value) {
+            Input in;
+            std::string level;
+            in.t_ms = split_time(argv[++i], level);
+            in.kind = InputKind::kTouch;
+            in.level = level == "1" ? 1 : 0;
+            opt.inputs.push_back(in);
+        } else if (arg == "--imu" && has_value) {
+            opt.imu_path = argv[++i];
+        } else if (arg == "--connect") {
+            opt.connect = true;
+        } else if (arg == "--ascii") {
+            opt.ascii = true;
+        } else if (arg == "--set" && has_value) {
+            leor::GestureService probe;
+            opt.gesture_settings.push_back(argv[++i]);
+            if (!apply_gesture_setting(probe, opt.gesture_settings.back())) {
+                usage();
+            }
+        } else if (arg == "--min-accuracy" && has_value) {
+            opt.min_accuracy = parse_float(argv[++i]);
+        } else if (arg == "--max-fp-per-min" && has_value) {
+            opt.max_fp_per_min = parse_float(argv[++i]);
+        } else if (arg == "-v") {
+            host_log_level = ESP_LOG_INFO;
+        } else {
+            usage();
+        }
+    }
+    sort_inputs(opt.inputs);
+    return opt;
+}
+
+bool read_file(const std::string& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::ostringstream text;
+    text << in.rdbuf();
+    out = text.str();
+    return true;
+}
+
+bool load_imu_script(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        int values[7];
+        int n = 0;
+        while (n < 7 && fields >> values[n]) {
+            ++n;
+        }
+        if (n != 7) {
+            continue;
+        }
+        int16_t raw[7];
+        for (int k = 0; k < 7; ++k) {
+            raw[k] = static_cast<int16_t>(values[k]);
+        }
+        leor::host::imu_push_sample(raw);
+    }
+    return true;
+}
+
+// 64-bit so the driver itself never wraps; the firmware sees uint32.
+int64_t clock_ms() {
+    return leor::host::now_us() / 1000;
+}
+
+void push_shake() {
+    // About a second of vigorous shaking, then back to rest.
+    for (int i = 0; i < 48; ++i) {
+        const int16_t s = (i & 1) ? 1 : -1;
+        const int16_t raw[7] = {static_cast<int16_t>(s * 14000), static_cast<int16_t>(s * -9000), 16384, 0,
+                                static_cast<int16_t>(s * 30000), static_cast<int16_t>(s * 20000), 0};
+        leor::host::imu_push_sample(raw);
+    }
+    const int16_t still[7] = {0, 0, 16384, 0, 0, 0, 0};
+    leor::host::imu_push_sample(still);
+}
+
+uint32_t frame_hash() {
+    // FNV-1a over the panel pixels.
+    const uint8_t* fb = leor::host::framebuffer();
+    uint32_t hash = 2166136261U;
+    if (fb == nullptr) {
+        return hash;
+    }
+    const int n = leor::host::framebuffer_width() * leor::host::framebuffer_height();
+    for (int i = 0; i < n; ++i) {
+        hash = (hash ^ fb[i]) * 16777619U;
+    }
+    return hash;
+}
+
+void print_frame() {
+    const uint8_t* fb = leor::host::framebuffer();
+    if (fb == nullptr) {
+        return;
+    }
+    const int w = leor::host::framebuffer_width();
+    const int h = leor::host::framebuffer_height();
+    std::string row(static_cast<size_t>(w), ' ');
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            row[static_cast<size_t>(x)] = fb[y * w + x] ? '#' : '.';
+        }
+        std::printf("%s\n", row.c_str());
+    }
+}
+
+// Mirrors Application::run(): tick, then sleep for the governor's delay
+// unless an input arrives first. Inputs and replay events due at or before
+// the current time are delivered before the tick, as a wake would.
+struct Driver {
+    leor::Application& app;
+    std::vector<Input> inputs;
+    leor::SessionReplayer* replayer = nullptr;
+    bool echo_commands = true;
+    size_t next_input = 0;
+    uint64_t ticks = 0;
+    uint64_t alloc_ticks = 0; // ticks that allocated on the app task
+    int64_t last_tick_ms = -1;
+    int64_t max_gap_ms = 0;
+
+    // Replay timestamps are the device's uint32 milliseconds.
+    int64_t replay_due_ms(int64_t now) const {
+        const uint32_t now32 = static_cast<uint32_t>(now);
+        return now + static_cast<int32_t>(replayer->next_time_ms() - now32);
+    }
+
+    void deliver_due(int64_t now) {
+        while (next_input < inputs.size() && inputs[next_input].t_ms <= now) {
+            const Input& in = inputs[next_input++];
+            switch (in.kind) {
+            case InputKind::kCommand:
+                if (echo_commands) {
+                    std::printf("> %s\n", in.command.c_str());
+                }
+                leor::host::ble_write(in.command);
+                break;
+            case InputKind::kTouch:
+                leor::host::gpio_drive(kTouchPin, in.level);
+                break;
+            case InputKind::kConnect:
+                leor::host::ble_connect(in.level != 0);
+                break;
+            case InputKind::kShake:
+                push_shake();
+                break;
+            }
+        }
+        while (replayer != nullptr && !replayer->done() && replay_due_ms(now) <= now) {
+            app.apply_replay_event(replayer->next(), static_cast<uint32_t>(now));
+            replayer->advance();
+        }
+    }
+
+    int64_t next_wake(int64_t planned) const {
+        if (next_input < inputs.size()) {
+            planned = std::min(planned, inputs[next_input].t_ms);
+        }
+        if (replayer != nullptr && !replayer->done()) {
+            planned = std::min(planned, replay_due_ms(clock_ms()));
+        }
+        return planned;
+    }
+
+    void run_until(int64_t end_ms) {
+        while (clock_ms() < end_ms) {
+            const int64_t started = clock_ms();
+            deliver_due(started);
+            if (last_tick_ms >= 0) {
+                max_gap_ms = std::max(max_gap_ms, started - last_tick_ms);
+            }
+            last_tick_ms = started;
+            app.tick();
+            ++ticks;
+            if (leor::AllocCounter::instance().last_tick_allocs() > 0) {
+                ++alloc_ticks;
+            }
+            const int64_t now = clock_ms();
+            int64_t wake = next_wake(std::max(now, started + app.next_tick_delay_ms()));
+            wake = std::max(wake, std::max(now, started + 1));
+            leor::host::set_now_us(std::min(wake, end_ms) * 1000);
+        }
+    }
+};
+
+// A day in the life: bursts of BLE commands, taps that open the BLE window,
+// shakes, clock-mode stretches and shuffle changes, a few minutes apart.
+std::vector<Input> soak_workload(uint32_t seed, int64_t begin_ms, int64_t end_ms) {
+    static const char* const kCommands[] = {
+        "happy", "sad", "angry", "love", "surprised", "sleepy", "curious", "neutral",
+        "blink", "wink", "laugh", "talk 2000", "chew 1500", "wobble 1000", "ne", "sw", "center",
+        "sweat", "br", "sh:", "fb:", "fps:", "perf:", "boot:", "ble:", "clock:", "s:",
+    };
+    static const char* const kShuffle[] = {"sh:quick", "sh:slow", "sh:off", "sh:on"};
+    constexpr size_t kCommandCount = sizeof(kCommands) / sizeof(kCommands[0]);
+
+    leor::Rng rng;
+    rng.seed(seed, static_cast<uint64_t>(0x50414B));
+    std::vector<Input> out;
+    auto add = [&](int64_t t, InputKind kind, int level, std::string command = {}) {
+        Input in;
+        in.t_ms = t;
+        in.kind = kind;
+        in.level = level;
+        in.command = std::move(command);
+        out.push_back(std::move(in));
+    };
+
+    add(begin_ms, InputKind::kCommand, 0, "clock:sync=" + std::to_string(kSoakEpochMs) + ",0");
+    int64_t t = begin_ms + 60000;
+    while (t < end_ms) {
+        switch (rng.below(5)) {
+        case 0: {
+            add(t, InputKind::kConnect, 1);
+            const uint32_t n = 1 + rng.below(4);
+            for (uint32_t i = 0; i < n; ++i) {
+                add(t + 500 + i * 1500, InputKind::kCommand, 0, kCommands[rng.below(kCommandCount)]);
+            }
+            add(t + 30000, InputKind::kConnect, 0);
+            break;
+        }
+        case 1:
+            add(t, InputKind::kTouch, 1);
+            add(t + 120, InputKind::kTouch, 0);
+            break;
+        case 2:
+            add(t, InputKind::kShake, 0);
+            break;
+        case 3:
+            add(t, InputKind::kCommand, 0, "clock:on");
+            add(t + 60000 + rng.below(50 * 60000), InputKind::kCommand, 0, "clock:off");
+            break;
+        default:
+            add(t, InputKind::kCommand, 0, kShuffle[rng.below(4)]);
+            break;
+        }
+        t += 2 * 60000 + rng.below(18 * 60000);
+    }
+    sort_inputs(out);
+    return out;
+}
+
+bool g_soak_finished = false;
+
+void fail_on_unexpected_exit() {
+    // Deep sleep and restarts exit() from inside the shims.
+    if (!g_soak_finished) {
+        std::fprintf(stderr, "soak FAIL: device reset or slept\n");
+        std::fflush(stdout);
+        _exit(1);
+    }
+}
+
+int run_soak(leor::Application& app, const Options& opt, int64_t begin_ms) {
+    const int64_t end_ms = begin_ms + static_cast<int64_t>(opt.hours) * kMsPerHour;
+    Driver driver{app, soak_workload(opt.seed, begin_ms, end_ms)};
+    driver.echo_commands = false;
+    std::atexit(fail_on_unexpected_exit);
+
+    bool ok = true;
+    size_t heap_baseline = 0;
+    uint32_t frames_before = leor::host::frames_sent();
+    const auto wall_start = std::chrono::steady_clock::now();
+    for (uint32_t hour = 1; hour <= opt.hours; ++hour) {
+        const uint64_t ticks_before = driver.ticks;
+        driver.max_gap_ms = 0;
+        const auto wall_hour = std::chrono::steady_clock::now();
+        driver.run_until(begin_ms + hour * kMsPerHour);
+
+        const uint64_t ticks = driver.ticks - ticks_before;
+        const uint32_t frames = leor::host::frames_sent() - frames_before;
+        frames_before = leor::host::frames_sent();
+        const long long cpu_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                                     std::chrono::steady_clock::now() - wall_hour)
+                                     .count();
+        if (hour == 1) {
+            heap_baseline = leor::host::heap_live_bytes();
+        }
+        std::printf("hour %2u: uptime_ms=%u ticks=%llu frames=%u max_gap=%lldms heap=%zu/%zu cpu=%lldus\n", hour,
+                    static_cast<unsigned>(clock_ms()), static_cast<unsigned long long>(ticks),
+                    static_cast<unsigned>(frames), static_cast<long long>(driver.max_gap_ms), leor::host::heap_live_bytes(),
+                    leor::host::heap_live_blocks(), cpu_us);
+
+        if (driver.max_gap_ms > kSoakMaxGapMs) {
+            std::printf("soak FAIL: loop stalled %lld ms in hour %u\n", static_cast<long long>(driver.max_gap_ms),
+                        hour);
+            ok = false;
+        }
+        if (ticks > kSoakMaxTicksPerHour) {
+            std::printf("soak FAIL: %llu ticks in hour %u, loop is spinning\n",
+                        static_cast<unsigned long long>(ticks), hour);
+            ok = false;
+        }
+        if (frames == 0) {
+            std::printf("soak FAIL: no frame sent in hour %u\n", hour);
+            ok = false;
+        }
+        if (leor::host::heap_live_bytes() > heap_baseline + kSoakMaxHeapGrowth) {
+            std::printf("soak FAIL: heap grew %zu bytes since hour 1\n", leor::host::heap_live_bytes() - heap_baseline);
+            ok = false;
+        }
+    }
+    const long long wall_ms =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - wall_start)
+            .count();
+    std::printf("soak %s: %u h in %lld ms wall, %llu ticks, fb=%08x\n", ok ? "ok" : "FAIL", opt.hours, wall_ms,
+                static_cast<unsigned long long>(driver.ticks), static_cast<unsigned>(frame_hash()));
+    g_soak_finished = true;
+    return ok ? 0 : 1;
+}
+
+
+// One alloc-check stage: BLE commands set it up (and may allocate), then
+// nothing but the firmware's own activity and the scripted inputs runs for
+// `measure_ms`.
+struct AllocStage {
+    const char* name;
+    std::vector<std::string> setup;
+    int64_t measure_ms;
+    bool taps;
+    bool shakes;
+};
+
+int run_alloc_check(leor::Application& app, int64_t begin_ms) {
+    const std::string sync = "clock:sync=" + std::to_string(kSoakEpochMs) + ",0";
+    const AllocStage stages[] = {
+        {"face", {"clock:off", "gm=0", "sh:quick"}, 30000, true, false},
+        {"clock", {"sh:off", sync, "clock:on"}, 75000, true, false},
+        {"gesture", {"clock:off", "neutral", "gm=1"}, 30000, true, true},
+    };
+    // Past the boot-time IMU calibration and first NVS writes.
+    Driver driver{app, {}};
+    driver.echo_commands = false;
+    driver.run_until(begin_ms + 10000);
+
+    bool ok = true;
+    for (const AllocStage& stage : stages) {
+        int64_t t = clock_ms();
+        std::vector<Input> inputs;
+        for (const std::string& command : stage.setup) {
+            Input in;
+            in.t_ms = t;
+            in.command = command;
+            inputs.push_back(in);
+            t += 100;
+        }
+        const int64_t measure_from = t + 2000;
+        const int64_t measure_to = measure_from + stage.measure_ms;
+        for (int64_t at = measure_from + 500; at < measure_to; at += 4000) {
+            if (stage.taps) {
+                Input down;
+                down.t_ms = at;
+                down.kind = InputKind::kTouch;
+                down.level = 1;
+                inputs.push_back(down);
+                Input up = down;
+                up.t_ms = at + 120;
+                up.level = 0;
+                inputs.push_back(up);
+            }
+            if (stage.shakes) {
+                Input shake;
+                shake.t_ms = at + 1500;
+                shake.kind = InputKind::kShake;
+                inputs.push_back(shake);
+            }
+        }
+        sort_inputs(inputs);
+        driver.inputs = std::move(inputs);
+        driver.next_input = 0;
+        driver.run_until(measure_from);
+
+        const uint64_t ticks_before = driver.ticks;
+        const uint64_t alloc_before = driver.alloc_ticks;
+        const uint32_t frames_before = leor::host::frames_sent();
+        driver.run_until(measure_to);
+        const uint64_t ticks = driver.ticks - ticks_before;
+        const uint64_t alloc_ticks = driver.alloc_ticks - alloc_before;
+        std::printf("%-8s ticks=%llu frames=%u alloc_ticks=%llu\n", stage.name,
+                    static_cast<unsigned long long>(ticks),
+                    static_cast<unsigned>(leor::host::frames_sent() - frames_before),
+                    static_cast<unsigned long long>(alloc_ticks));
+        if (alloc_ticks > 0) {
+            ok = false;
+        }
+    }
+    std::printf("alloc-check %s\n", ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+int run_ahrs_bench() {
+    const std::string json = leor::mahony_bench_json(kAhrsBenchSamples);
+    std::printf("%s\n", json.c_str());
+    // max_deg is [pitch, roll, yaw]; yaw has no accelerometer reference and
+    // only drifts, so it is reported but not held to the limit.
+    float pitch = 0.0f;
+    float roll = 0.0f;
+    const char* max = std::strstr(json.c_str(), "\"max_deg\":[");
+    const bool ok = max != nullptr && std::sscanf(max, "\"max_deg\":[%f,%f", &pitch, &roll) == 2 &&
+                    pitch <= kAhrsMaxErrorDeg && roll <= kAhrsMaxErrorDeg;
+    std::printf("ahrs-bench %s\n", ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+struct ImuMark {
+    int session;
+    uint32_t t_ms;
+    int label;  // GestureService label index, -1 for "none"
+    bool matched = false;
+};
+
+// Matches the first unmatched detection within kLabelWindowMs of `mark`,
+// nearest first; with `same_label` only one of the marked gesture.
+bool match_mark(ImuMark& mark, std::vector<ImuMark>& detections, bool same_label) {
+    ImuMark* best = nullptr;
+    uint32_t best_gap = kLabelWindowMs + 1;
+    for (ImuMark& d : detections) {
+        if (d.matched || d.session != mark.session || (same_label && d.label != mark.label)) {
+            continue;
+        }
+        const uint32_t gap = d.t_ms > mark.t_ms ? d.t_ms - mark.t_ms : mark.t_ms - d.t_ms;
+        if (gap < best_gap) {
+            best = &d;
+            best_gap = gap;
+        }
+    }
+    if (best == nullptr) {
+        return false;
+    }
+    best->matched = true;
+    mark.matched = true;
+    return true;
+}
+
+int run_replay_imu(const Options& opt) {
+    std::string bytes;
+    leor::CaptureReader reader;
+    if (!read_file(opt.log_path, bytes) ||
+        (!reader.load_dump_text(bytes) &&
+         !reader.load(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size()))) {
+        std::fprintf(stderr, "cannot load IMU capture %s\n", opt.log_path.c_str());
+        return 1;
+    }
+
+    std::vector<ImuMark> marks;
+    std::vector<ImuMark> detections;
+    std::vector<uint32_t> latencies[4];  // per detected gesture
+    uint64_t sample_us = 0;
+    size_t samples = 0;
+    int session = -1;
+    std::unique_ptr<leor::GestureService> gestures;
+    auto begin_session = [&](const int16_t* offsets_q8) {
+        ++session;
+        gestures = std::make_unique<leor::GestureService>();
+        // Every gesture maps to a face action, so each match shows in poll().
+        for (int i = 0; i < 4; ++i) {
+            gestures->set_action(i, "happy");
+        }
+        for (const std::string& setting : opt.gesture_settings) {
+            apply_gesture_setting(*gestures, setting);
+        }
+        const float offsets[3] = {offsets_q8[0] / 256.0f, offsets_q8[1] / 256.0f, offsets_q8[2] / 256.0f};
+        gestures->begin_replay(offsets);
+    };
+    for (const leor::CaptureRecord& r : reader.records()) {
+        if (r.kind == 's' || (r.kind == 'i' && !gestures)) {
+            const int16_t zero[3] = {0, 0, 0};
+            begin_session(r.kind == 's' ? r.raw : zero);
+        }
+        if (r.kind == 'l') {
+            marks.push_back({session, r.t_ms, r.raw[0]});
+        } else if (r.kind == 'i') {
+            ++samples;
+            sample_us += r.dt_us;
+            gestures->inject_sample(r.raw, r.dt_us, r.t_ms);
+            const leor::Action action = gestures->poll(r.t_ms, (r.flags & 1) != 0);
+            if (action != leor::Action::kNone && action != leor::Action::kNeutral) {
+                detections.push_back({session, r.t_ms, gestures->last_label()});
+                latencies[gestures->last_label()].push_back(gestures->decision_latency_ms());
+            }
+        }
+    }
+
+    // Same-gesture matches first, so a nearby wrong one cannot take a mark.
+    for (ImuMark& m : marks) {
+        if (m.label >= 0) {
+            match_mark(m, detections, true);
+        }
+    }
+    const char* names[] = {"pat", "shake", "swipe", "pickup"};
+    int marked[4] = {};
+    int hits[4] = {};
+    int confused[4] = {};
+    int quiet_marks = 0;
+    for (ImuMark& m : marks) {
+        if (m.label < 0 || m.label > 3) {
+            ++quiet_marks;
+            continue;
+        }
+        ++marked[m.label];
+        if (m.matched) {
+            ++hits[m.label];
+        } else if (match_mark(m, detections, false)) {
+            ++confused[m.label];
+        }
+    }
+    int false_positives = 0;
+    for (const ImuMark& d : detections) {
+        if (!d.matched) {
+            ++false_positives;
+        }
+    }
+
+    const double minutes = sample_us / 60e6;
+    std::printf("capture: %d sessions, %zu samples (%.1f min), %zu labels, %zu sectors, %zu bad records\n",
+                session + 1, samples, minutes, marks.size(), reader.sectors(), reader.bad_records());
+    // Decision latency of every match of the gesture, labelled or not.
+    std::printf("label   marked  hit  confused  missed  latency ms: p50  p90  max\n");
+    int total_marked = 0;
+    int total_hits = 0;
+    std::vector<uint32_t> all_latencies;
+    for (int i = 0; i < 4; ++i) {
+        std::printf("%-7s %6d %4d %9d %7d", names[i], marked[i], hits[i], confused[i],
+                    marked[i] - hits[i] - confused[i]);
+        std::vector<uint32_t>& l = latencies[i];
+        if (!l.empty()) {
+            std::sort(l.begin(), l.end());
+            std::printf("  %15u %4u %4u", l[l.size() / 2], l[l.size() * 9 / 10], l.back());
+        }
+        std::printf("\n");
+        all_latencies.insert(all_latencies.end(), l.begin(), l.end());
+        total_marked += marked[i];
+        total_hits += hits[i];
+    }
+    std::printf("none    %6d\n", quiet_marks);
+    const double accuracy = total_marked > 0 ? 100.0 * total_hits / total_marked : 100.0;
+    const double fp_per_min = minutes > 0.0 ? false_positives / minutes : 0.0;
+    std::printf("accuracy %.1f%% (%d/%d), false positives %d (%.2f/min), %zu detections\n", accuracy, total_hits,
+                total_marked, false_positives, fp_per_min, detections.size());
+    if (!all_latencies.empty()) {
+        std::sort(all_latencies.begin(), all_latencies.end());
+        uint64_t sum = 0;
+        for (uint32_t l : all_latencies) {
+            sum += l;
+        }
+        std::printf("latency ms: mean %llu p50 %u p95 %u max %u\n",
+                    static_cast<unsigned long long>(sum / all_latencies.size()),
+                    all_latencies[all_latencies.size() / 2], all_latencies[all_latencies.size() * 95 / 100],
+                    all_latencies.back());
+    }
+
+    bool ok = true;
+    if (opt.min_accuracy >= 0.0f && accuracy < opt.min_accuracy) {
+        ok = false;
+    }
+    if (opt.max_fp_per_min >= 0.0f && fp_per_min > opt.max_fp_per_min) {
+        ok = false;
+    }
+    std::printf("replay-imu %s\n", ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt = parse_args(argc, argv);
+    if (opt.mode == "ahrs-bench") {
+        return run_ahrs_bench();
+    }
+    if (opt.mode == "replay-imu") {
+        return run_replay_imu(opt);
+    }
+    const bool soak = opt.mode == "soak";
+
+    leor::set_time_source(&leor::host::clock());
+    if (opt.start_ms < 0) {
+        opt.start_ms = soak ? (1LL << 32) - 12 * kMsPerHour : 0;
+    }
+    leor::host::set_now_us(opt.start_ms * 1000);
+    leor::host::clock().set_wall_us(kSoakEpochMs * 1000);
+    const int64_t begin_ms = opt.start_ms;
+    for (Input& in : opt.inputs) {
+        in.t_ms += begin_ms;
+    }
+
+    if (opt.mode == "run" || opt.mode == "replay") {
+        leor::host::set_ble_notify_sink([](const std::string& text) { std::printf("< %s\n", text.c_str()); });
+    }
+    leor::host::seed_random(opt.seed);
+    if (!opt.imu_path.empty() && !load_imu_script(opt.imu_path)) {
+        std::fprintf(stderr, "cannot read IMU script %s\n", opt.imu_path.c_str());
+        return 1;
+    }
+
+    leor::SessionReplayer replayer;
+    if (opt.mode == "replay") {
+        std::string text;
+        if (!read_file(opt.log_path, text) || !replayer.load(text)) {
+            std::fprintf(stderr, "cannot load session log %s\n", opt.log_path.c_str());
+            return 1;
+        }
+        if (replayer.skipped_lines() > 0) {
+            std::fprintf(stderr, "skipped %u malformed log lines\n",
+                         static_cast<unsigned>(replayer.skipped_lines()));
+        }
+    }
+
+    static leor::Application app;
+    if (app.start() != ESP_OK) {
+        std::fprintf(stderr, "Application::start failed\n");
+        return 1;
+    }
+    if (soak) {
+        return run_soak(app, opt, begin_ms);
+    }
+    if (opt.mode == "alloc-check") {
+        return run_alloc_check(app, begin_ms);
+    }
+    if (opt.connect) {
+        leor::host::ble_connect(true);
+    }
+
+    Driver driver{app, opt.inputs};
+    int64_t end_ms = clock_ms() + (opt.run_ms > 0 ? opt.run_ms : 10000);
+    if (opt.mode == "replay") {
+        app.begin_replay(replayer);
+        driver.replayer = &replayer;
+        int64_t last_event_ms = clock_ms();
+        for (replayer.rewind(); !replayer.done(); replayer.advance()) {
+            last_event_ms = std::max(last_event_ms, driver.replay_due_ms(clock_ms()));
+        }
+        replayer.rewind();
+        end_ms = opt.run_ms > 0 ? clock_ms() + opt.run_ms : last_event_ms + 1000;
+    }
+    driver.run_until(end_ms);
+
+    if (opt.ascii) {
+        print_frame();
+    }
+    std::printf("t=%lld ms ticks=%llu frames=%u fb=%08x\n", static_cast<long long>(clock_ms() - begin_ms),
+                static_cast<unsigned long long>(driver.ticks), static_cast<unsigned>(leor::host::frames_sent()),
+                static_cast<unsigned>(frame_hash()));
+    return 0;
+}
@@ -0,0 +1,203 @@
+// Host build of BleService: the command and reply queues are the real ones,
+// but there is no radio. leor::host::ble_write() plays the GATT command
+// write and notifications go to a sink instead of a connected central.
+
+#include "leor/ble_service.hpp"
+
+#include <cstring>
+
+#include "esp_log.h"
+#include "leor/time_source.hpp"
+#include "leor/trace.hpp"
+#include "leor_host.hpp"
+
+namespace leor {
+
+namespace {
+
+static const char* kTag = "leor_ble";
+static BleService* s_service = nullptr;
+static bool s_link_up = false;
+static int64_t s_first_adv_us = 0;
+static std::function<void(const std::string&)> s_notify_sink;
+
+void advertise() {
+    if (s_first_adv_us == 0) {
+        s_first_adv_us = now_us();
+    }
+}
+
+}  // namespace
+
+esp_err_t BleService::start(const std::string& device_name, CommandHandler handler) {
+    command_handler_ = std::move(handler);
+    s_service = this;
+    if (notify_mutex_ == nullptr) {
+        notify_mutex_ = xSemaphoreCreateMutex();
+    }
+    ESP_LOGI(kTag, "host BLE stub up as \"%s\"", device_name.c_str());
+    started_.store(true, std::memory_order_release);
+    if (advertising_enabled_) {
+        advertise();
+    }
+    return ESP_OK;
+}
+
+int64_t BleService::first_advertising_us() const {
+    return s_first_adv_us;
+}
+
+void BleService::stop(bool disconnect_connected) {
+    advertising_enabled_ = false;
+    if (!started()) {
+        return;
+    }
+    if (disconnect_connected && connected_) {
+        host::ble_connect(false);
+    }
+}
+
+void BleService::start_advertising() {
+    advertising_enabled_ = true;
+    if (started()) {
+        advertise();
+    }
+}
+
+bool BleService::advertising_enabled() const {
+    return advertising_enabled_;
+}
+
+void BleService::poll() {
+    apply_commands();
+    ota_.poll();
+    if (connected_ && ota_.control_notify_pending()) {
+        ota_.consume_control_notify();
+    }
+}
+
+void BleService::notify_status(const std::string& status) {
+    if (s_notify_sink) {
+        s_notify_sink(status);
+    }
+}
+
+void BleService::notify_gesture(const std::string& gesture) {
+    if (s_notify_sink) {
+        s_notify_sink("gesture:" + gesture);
+    }
+}
+
+void BleService::on_connected(uint16_t conn_handle) {
+    connected_ = conn_handle != 0xffff;
+}
+
+void BleService::on_disconnected() {
+    connected_ = false;
+    if (ota_.in_progress()) {
+        ota_.set_error("BLE Disconnected");
+    }
+}
+
+uint8_t BleService::ota_handle_control(uint8_t opcode) {
+    return ota_.handle_control_write(opcode);
+}
+
+uint8_t BleService::ota_handle_data(const uint8_t* data, size_t len) {
+    return ota_.handle_data_write(data, len);
+}
+
+bool BleService::ota_has_pending_notify() const {
+    return ota_.control_notify_pending();
+}
+
+uint8_t BleService::ota_pending_notify_code() const {
+    return ota_.control_notify_code();
+}
+
+void BleService::ota_consume_pending_notify() {
+    ota_.consume_control_notify();
+}
+
+bool BleService::enqueue_command(const char* data, size_t len) {
+    if (len > kMaxCommandBytes) {
+        return false;
+    }
+    CommandSlot slot;
+    slot.len = static_cast<uint16_t>(len);
+    std::memcpy(slot.text, data, len);
+    return commands_.push(std::move(slot));
+}
+
+void BleService::apply_commands() {
+    CommandSlot slot;
+    for (size_t i = 0; i < commands_.capacity() && commands_.pop(slot); ++i) {
+        if (!command_handler_) {
+            continue;
+        }
+        std::string response = command_handler_(std::string_view(slot.text, slot.len));
+        if (!response.empty()) {
+            post_response(std::move(response));
+        }
+    }
+}
+
+void BleService::post_response(std::string response) {
+    [[maybe_unused]] const size_t len = response.size();
+    if (!responses_.push(std::move(response))) {
+        LEOR_TRACE(BLE_REPLY_DROPPED, len);
+        return;
+    }
+    // No host task to hand off to: deliver straight away.
+    flush_responses();
+}
+
+void BleService::flush_responses() {
+    std::string response;
+    while (responses_.pop(response)) {
+        notify_status(response);
+    }
+}
+
+namespace host {
+
+void ble_connect(bool connected) {
+    if (s_service == nullptr || connected == s_link_up) {
+        return;
+    }
+    s_link_up = connected;
+    if (connected) {
+        LEOR_TRACE(BLE_CONNECT, 1u);
+        s_service->on_connected(1);
+        s_service->notify_status("connected");
+    } else {
+        // 0x13: remote user terminated connection, as a phone closing the app.
+        LEOR_TRACE(BLE_DISCONNECT, 0x13u);
+        s_service->on_disconnected();
+        if (s_service->advertising_enabled()) {
+            advertise();
+        }
+    }
+    s_service->signal_activity(BleActivity::kLink);
+}
+
+bool ble_write(const std::string& command) {
+    if (s_service == nullptr) {
+        return false;
+    }
+    if (!s_service->enqueue_command(command.data(), command.size())) {
+        LEOR_TRACE(BLE_CMD_DROPPED, command.size());
+        s_service->notify_status("Busy: command dropped");
+        return false;
+    }
+    s_service->signal_activity(BleActivity::kCommand);
+    return true;
+}
+
+void set_ble_notify_sink(std::function<void(const std::string&)> sink) {
+    s_notify_sink = std::move(sink);
+}
+
+}  // namespace host
+
+}  // namespace leor
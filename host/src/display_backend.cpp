@@ -0,0 +1,266 @@
+// Host build of the display backends. U8g2DisplayBackend draws into a
+// headless 1-byte-per-pixel framebuffer with u8g2's colour rules (0 clear,
+// 1 set, 2 XOR); send_buffer() copies it to the "panel" that
+// leor::host::framebuffer() exposes. There are no fonts on the host, so text
+// renders as one solid cell per glyph at the real fonts' advance widths.
+
+#include "leor/display_backend.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "esp_log.h"
+#include "leor_host.hpp"
+
+namespace leor {
+
+namespace {
+
+static const char* kTag = "leor_display";
+
+struct GlyphMetrics {
+    int advance;
+    int ascent;
+};
+
+// profont11, profont15 and logisoso32 (digits).
+constexpr GlyphMetrics kFontSmall = {6, 8};
+constexpr GlyphMetrics kFontMedium = {7, 10};
+constexpr GlyphMetrics kFontLarge = {20, 32};
+
+uint8_t s_color = 1;
+uint8_t s_contrast = 0x7f;
+GlyphMetrics s_font = kFontSmall;
+int s_width = 0;
+int s_height = 0;
+uint8_t* s_draw = nullptr;
+std::vector<uint8_t> s_panel;
+uint32_t s_frames_sent = 0;
+
+void plot(int x, int y) {
+    if (x < 0 || x >= s_width || y < 0 || y >= s_height) return;
+    uint8_t& px = s_draw[y * s_width + x];
+    if (s_color == 0) {
+        px = 0;
+    } else if (s_color == 1) {
+        px = 1;
+    } else {
+        px ^= 1;
+    }
+}
+
+void raw_hline(int x, int y, int w) {
+    for (int i = 0; i < w; ++i) plot(x + i, y);
+}
+
+void raw_vline(int x, int y, int h) {
+    for (int i = 0; i < h; ++i) plot(x, y + i);
+}
+
+}  // namespace
+
+bool NullDisplayBackend::init(const DisplayConfig& config) {
+    width_ = config.width;
+    height_ = config.height;
+    return true;
+}
+
+U8g2DisplayBackend::U8g2DisplayBackend() = default;
+U8g2DisplayBackend::~U8g2DisplayBackend() {
+    if (s_draw == storage_.get()) {
+        s_draw = nullptr;
+    }
+}
+
+bool U8g2DisplayBackend::init(const DisplayConfig& config) {
+    width_ = config.width;
+    height_ = config.height;
+    storage_ = std::make_unique<uint8_t[]>(static_cast<size_t>(width_ * height_));
+    s_draw = storage_.get();
+    s_width = width_;
+    s_height = height_;
+    s_panel.assign(static_cast<size_t>(width_ * height_), 0);
+    s_frames_sent = 0;
+    s_color = 1;
+    ESP_LOGI(kTag, "headless framebuffer %dx%d", width_, height_);
+    set_font_small();
+    clear();
+    send_buffer();
+    return true;
+}
+
+void U8g2DisplayBackend::prepare_sleep() {
+    std::fill(s_panel.begin(), s_panel.end(), 0);
+}
+
+int U8g2DisplayBackend::width() const { return width_; }
+int U8g2DisplayBackend::height() const { return height_; }
+void U8g2DisplayBackend::clear() { std::memset(storage_.get(), 0, static_cast<size_t>(width_ * height_)); }
+void U8g2DisplayBackend::send_buffer() {
+    std::memcpy(s_panel.data(), storage_.get(), s_panel.size());
+    s_frames_sent++;
+}
+void U8g2DisplayBackend::set_contrast(uint8_t value) { s_contrast = value; }
+void U8g2DisplayBackend::set_color(uint8_t color) { s_color = color; }
+void U8g2DisplayBackend::draw_pixel(int x, int y) { plot(x, y); }
+void U8g2DisplayBackend::draw_line(int x0, int y0, int x1, int y1) {
+    const int dx = std::abs(x1 - x0);
+    const int sx = x0 < x1 ? 1 : -1;
+    const int dy = -std::abs(y1 - y0);
+    const int sy = y0 < y1 ? 1 : -1;
+    int err = dx + dy;
+    while (true) {
+        plot(x0, y0);
+        if (x0 == x1 && y0 == y1) break;
+        const int e2 = 2 * err;
+        if (e2 >= dy) { err += dy; x0 += sx; }
+        if (e2 <= dx) { err += dx; y0 += sy; }
+    }
+}
+void U8g2DisplayBackend::draw_hline(int x, int y, int w) { raw_hline(x, y, w); }
+void U8g2DisplayBackend::draw_vline(int x, int y, int h) { raw_vline(x, y, h); }
+void U8g2DisplayBackend::draw_box(int x, int y, int w, int h) {
+    draw_hline(x, y, w);
+    draw_hline(x, y + h - 1, w);
+    draw_vline(x, y, h);
+    draw_vline(x + w - 1, y, h);
+}
+void U8g2DisplayBackend::draw_frame(int x, int y, int w, int h) {
+    draw_box(x, y, w, h);
+}
+void U8g2DisplayBackend::draw_rbox(int x, int y, int w, int h, int r) {
+    fill_rbox(x, y, w, h, r);
+}
+void U8g2DisplayBackend::draw_rframe(int, int, int, int, int) {
+    // Unused, as on the device.
+}
+void U8g2DisplayBackend::draw_disc(int x, int y, int r) { fill_circle(x, y, r); }
+void U8g2DisplayBackend::draw_circle(int x0, int y0, int r) {
+    // Midpoint circle, the same outline u8g2_DrawCircle produces.
+    int x = r;
+    int y = 0;
+    int err = 1 - r;
+    while (x >= y) {
+        plot(x0 + x, y0 + y); plot(x0 - x, y0 + y);
+        plot(x0 + x, y0 - y); plot(x0 - x, y0 - y);
+        plot(x0 + y, y0 + x); plot(x0 - y, y0 + x);
+        plot(x0 + y, y0 - x); plot(x0 - y, y0 - x);
+        ++y;
+        if (err < 0) {
+            err += 2 * y + 1;
+        } else {
+            --x;
+            err += 2 * (y - x) + 1;
+        }
+    }
+}
+
+void U8g2DisplayBackend::fill_box(int x, int y, int w, int h) {
+    if (w <= 0 || h <= 0) return;
+    for (int iy = y; iy < y + h; ++iy) {
+        raw_hline(x, iy, w);
+    }
+}
+void U8g2DisplayBackend::fill_rbox(int x, int y, int w, int h, int r) {
+    if (w <= 0 || h <= 0) return;
+    int max_radius = std::min(w, h) / 2;
+    if (r > max_radius) r = max_radius;
+    if (r <= 0) {
+        fill_box(x, y, w, h);
+        return;
+    }
+    for (int iy = y + r; iy < y + h - r; ++iy) {
+        raw_hline(x, iy, w);
+    }
+    for (int dy = 1; dy <= r; ++dy) {
+        int dx = static_cast<int>(std::round(std::sqrt(r * r - dy * dy)));
+        int line_width = (w - 2 * r) + 2 * dx;
+        int line_x = x + r - dx;
+        raw_hline(line_x, y + r - dy, line_width);
+        raw_hline(line_x, y + h - 1 - r + dy, line_width);
+    }
+}
+void U8g2DisplayBackend::fill_circle(int x, int y, int r) {
+    if (r <= 0) return;
+    raw_hline(x - r, y, 2 * r + 1);
+    for (int dy = 1; dy <= r; ++dy) {
+        int dx = static_cast<int>(std::round(std::sqrt(r * r - dy * dy)));
+        raw_hline(x - dx, y - dy, 2 * dx + 1);
+        raw_hline(x - dx, y + dy, 2 * dx + 1);
+    }
+}
+void U8g2DisplayBackend::fill_triangle(int x0, int y0, int x1, int y1, int x2, int y2) {
+    // Same span rasteriser as the device backend, so pixels match.
+    struct Pt {
+        int x;
+        int y;
+    } pts[3] = {{x0, y0}, {x1, y1}, {x2, y2}};
+
+    if (pts[1].y < pts[0].y) std::swap(pts[0], pts[1]);
+    if (pts[2].y < pts[1].y) std::swap(pts[1], pts[2]);
+    if (pts[1].y < pts[0].y) std::swap(pts[0], pts[1]);
+
+    const auto draw_span = [&](int y, float xa, float xb) {
+        if (xa > xb) {
+            std::swap(xa, xb);
+        }
+        const int x_start = static_cast<int>(xa + 0.5f);
+        const int x_end = static_cast<int>(xb + 0.5f);
+        raw_hline(x_start, y, x_end - x_start + 1);
+    };
+
+    const Pt& p0 = pts[0];
+    const Pt& p1 = pts[1];
+    const Pt& p2 = pts[2];
+
+    if (p0.y == p2.y) {
+        draw_span(p0.y, static_cast<float>(std::min({p0.x, p1.x, p2.x})), static_cast<float>(std::max({p0.x, p1.x, p2.x})));
+        return;
+    }
+
+    const auto interp_x = [](const Pt& a, const Pt& b, int y) -> float {
+        if (a.y == b.y) {
+            return static_cast<float>(a.x);
+        }
+        return static_cast<float>(a.x) + (static_cast<float>(y - a.y) * static_cast<float>(b.x - a.x)) / static_cast<float>(b.y - a.y);
+    };
+
+    for (int y = p0.y; y <= p2.y; ++y) {
+        if (y < p1.y) {
+            draw_span(y, interp_x(p0, p2, y), interp_x(p0, p1, y));
+        } else {
+            draw_span(y, interp_x(p0, p2, y), interp_x(p1, p2, y));
+        }
+    }
+}
+void U8g2DisplayBackend::fill_round_rect(int x, int y, int w, int h, int r) { fill_rbox(x, y, w, h, r); }
+
+void U8g2DisplayBackend::select_font(const uint8_t*) {}
+void U8g2DisplayBackend::set_font_small() { s_font = kFontSmall; }
+void U8g2DisplayBackend::set_font_medium() { s_font = kFontMedium; }
+void U8g2DisplayBackend::set_font_large() { s_font = kFontLarge; }
+void U8g2DisplayBackend::draw_text(int x, int y, const char* text) {
+    // y is the baseline, as with u8g2_DrawStr.
+    for (const char* c = text; *c != '\0'; ++c, x += s_font.advance) {
+        if (*c != ' ') {
+            fill_box(x, y - s_font.ascent, s_font.advance - 1, s_font.ascent);
+        }
+    }
+}
+int U8g2DisplayBackend::text_width(const char* text) {
+    return static_cast<int>(std::strlen(text)) * s_font.advance;
+}
+
+namespace host {
+
+const uint8_t* framebuffer() { return s_panel.empty() ? nullptr : s_panel.data(); }
+int framebuffer_width() { return s_width; }
+int framebuffer_height() { return s_height; }
+uint32_t frames_sent() { return s_frames_sent; }
+uint8_t contrast() { return s_contrast; }
+
+}  // namespace host
+
+}  // namespace leor
@@ -21,11 +21,7 @@ extern "C" void app_main(void) {
         }
     }
 
-    TickType_t xLastWakeTime = xTaskGetTickCount();
-    const TickType_t xFrequency = pdMS_TO_TICKS(33); // ~30 FPS (33ms)
-
-    while (true) {
-        app.tick();
-        vTaskDelayUntil(&xLastWakeTime, xFrequency);
-    }
+    // ~30 FPS (33ms) while animating; blocks on input events or the next
+    // face deadline when idle.
+    app.run();
 }
@@ -0,0 +1,366 @@
+#!/usr/bin/env python3
+"""Train the gesture decision trees from recorded gesture windows.
+
+With gf=1 the device reports every window it classifies as one "gfeat"
+JSON line whose "v" array is the model input (see API.md). This script
+collects those lines, fits a decision tree (or a small random forest) on
+them, cross-validates it and writes the node table the firmware compiles,
+components/leor_core/include/leor/gesture_tree.def.
+
+Inputs are files or directories. Each file is labelled by the directory it
+sits in, or failing that the start of its name: pat, shake, swipe, pickup,
+or none for windows that should not fire (setting the device down, walking
+with it). Session logs (rec:dump output, starting "# leor-rec") are
+replayed through leor_sim with gf=1 and early decisions off (ged=0), so
+every window is the full 800 ms; any other file is scanned for gfeat lines,
+so a BLE console capture works as it is (send ged=0 as well when capturing
+training data live).
+
+    python3 tools/gesture_train.py data/
+    python3 tools/gesture_train.py data/ --trees 7 --depth 4 --write
+"""
+
+import argparse
+import json
+import math
+import os
+import random
+import re
+import struct
+import subprocess
+import sys
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), os.pardir)
+INCLUDE = os.path.join(ROOT, "components", "leor_core", "include", "leor")
+MODEL_HPP = os.path.join(INCLUDE, "gesture_model.hpp")
+TREE_DEF = os.path.join(INCLUDE, "gesture_tree.def")
+DEFAULT_SIM = os.path.join(ROOT, "build-host", "host", "leor_sim")
+
+# GestureService label indices; -1 is "no gesture".
+LABELS = {"none": -1, "pat": 0, "shake": 1, "swipe": 2, "pickup": 3}
+NAMES = {v: k for k, v in LABELS.items()}
+ORDER = [-1, 0, 1, 2, 3]  # firmware vote order; ties go to the first
+MAX_TREES = 64
+MAX_NODES = 65535
+
+ENUM_RE = re.compile(r"enum\s+GestureFeatureId\b[^{]*\{(.*?)\}", re.S)
+
+
+def load_feature_names(path):
+    with open(path, encoding="utf-8") as f:
+        m = ENUM_RE.search(f.read())
+    if not m:
+        sys.exit(f"no GestureFeatureId enum in {path}")
+    names = re.findall(r"^\s*(k\w+)\s*,", m.group(1), re.M)
+    return [n for n in names if n != "kGestureFeatureCount"]
+
+
+def label_for(path):
+    parts = os.path.normpath(path).split(os.sep)
+    candidates = parts[-2::-1] + [parts[-1]]
+    for part in candidates:
+        if part in LABELS:
+            return LABELS[part]
+    stem = os.path.basename(path).lower()
+    for name, label in LABELS.items():
+        if stem.startswith(name):
+            return label
+    return None
+
+
+def windows_from_text(text, width):
+    out = []
+    for raw in text.splitlines():
+        line = raw.strip()
+        if line.startswith("< "):
+            line = line[2:]
+        if not line.startswith('{"type":"gfeat"'):
+            continue
+        try:
+            v = json.loads(line).get("v")
+        except json.JSONDecodeError:
+            continue
+        if isinstance(v, list) and len(v) == width:
+            out.append([float(x) for x in v])
+    return out
+
+
+def windows_from_file(path, width, sim):
+    with open(path, encoding="utf-8", errors="replace") as f:
+        text = f.read()
+    if text.startswith("# leor-rec"):
+        if not os.path.exists(sim):
+            sys.exit(f"{path} is a session log and {sim} does not exist; build the "
+                     "host target or pass --sim")
+        run = subprocess.run([sim, "replay", path, "--cmd", "0:gf=1", "--cmd", "0:ged=0"],
+                             capture_output=True, text=True, check=False)
+        if run.returncode != 0:
+            sys.exit(f"leor_sim replay {path} failed:\n{run.stderr}")
+        text = run.stdout
+    return windows_from_text(text, width)
+
+
+def collect(paths, width, sim, forced_label):
+    files = []
+    for p in paths:
+        if os.path.isdir(p):
+            for dirpath, _, names in os.walk(p):
+                files.extend(os.path.join(dirpath, n) for n in sorted(names))
+        else:
+            files.append(p)
+    rows = []  # (vector, label, source index)
+    sources = []
+    for path in files:
+        label = forced_label if forced_label is not None else label_for(path)
+        if label is None:
+            print(f"skipping {path}: no label in its directory or name", file=sys.stderr)
+            continue
+        windows = windows_from_file(path, width, sim)
+        if not windows:
+            print(f"warning: no gfeat windows in {path}", file=sys.stderr)
+            continue
+        for v in windows:
+            rows.append((v, label, len(sources)))
+        sources.append(path)
+    return rows, sources
+
+
+def f32(x):
+    """Rounds to the float the firmware stores the threshold as."""
+    return struct.unpack("<f", struct.pack("<f", x))[0]
+
+
+def c_float(x):
+    text = f"{x:.9g}"
+    if not any(c in text for c in ".en"):
+        text += ".0"
+    return text + "f"
+
+
+def counts_of(rows):
+    counts = {label: 0 for label in ORDER}
+    for _, label, _ in rows:
+        counts[label] += 1
+    return counts
+
+
+def gini(counts, n):
+    if n == 0:
+        return 0.0
+    return 1.0 - sum((c / n) ** 2 for c in counts.values())
+
+
+def make_leaf(rows):
+    counts = counts_of(rows)
+    best = max(ORDER, key=lambda label: (counts[label], -ORDER.index(label)))
+    # Laplace-smoothed, so a two-sample leaf does not claim certainty.
+    conf = round(100 * (counts[best] + 1) / (len(rows) + len(ORDER)))
+    return {"label": best, "conf": conf, "n": len(rows)}
+
+
+def best_split(rows, features, min_leaf):
+    n = len(rows)
+    parent = gini(counts_of(rows), n)
+    best = None
+    for f in features:
+        ordered = sorted(rows, key=lambda r: r[0][f])
+        left = {label: 0 for label in ORDER}
+        right = counts_of(rows)
+        for i in range(n - 1):
+            label = ordered[i][1]
+            left[label] += 1
+            right[label] -= 1
+            a, b = ordered[i][0][f], ordered[i + 1][0][f]
+            if f32(a) == f32(b) or i + 1 < min_leaf or n - i - 1 < min_leaf:
+                continue
+            score = ((i + 1) * gini(left, i + 1) + (n - i - 1) * gini(right, n - i - 1)) / n
+            if best is None or score < best[0]:
+                best = (score, f, f32((a + b) / 2))
+    if best is None or best[0] >= parent - 1e-9:
+        return None
+    return best[1], best[2]
+
+
+def build(rows, depth, min_leaf, feature_pool, rng, subsample):
+    counts = counts_of(rows)
+    if depth == 0 or len(rows) < 2 * min_leaf or max(counts.values()) == len(rows):
+        return make_leaf(rows)
+    features = feature_pool
+    if subsample:
+        features = rng.sample(feature_pool, max(1, int(math.sqrt(len(feature_pool)))))
+    split = best_split(rows, features, min_leaf)
+    if split is None:
+        return make_leaf(rows)
+    f, t = split
+    left = [r for r in rows if f32(r[0][f]) <= t]
+    right = [r for r in rows if f32(r[0][f]) > t]
+    return {"f": f, "t": t,
+            "l": build(left, depth - 1, min_leaf, feature_pool, rng, subsample),
+            "r": build(right, depth - 1, min_leaf, feature_pool, rng, subsample)}
+
+
+def train(rows, args, width):
+    rng = random.Random(args.seed)
+    pool = list(range(width))
+    if args.trees == 1:
+        return [build(rows, args.depth, args.min_leaf, pool, rng, False)]
+    forest = []
+    for _ in range(args.trees):
+        sample = [rows[rng.randrange(len(rows))] for _ in rows]
+        forest.append(build(sample, args.depth, args.min_leaf, pool, rng, True))
+    return forest
+
+
+def predict(forest, x):
+    """Same vote as predict_gesture() in gesture_model.cpp."""
+    votes = {label: 0 for label in ORDER}
+    for tree in forest:
+        node = tree
+        while "f" in node:
+            node = node["l"] if f32(x[node["f"]]) <= node["t"] else node["r"]
+        votes[node["label"]] += node["conf"]
+    best = ORDER[0]
+    for label in ORDER[1:]:
+        if votes[label] > votes[best]:
+            best = label
+    return best, votes[best] // len(forest)
+
+
+def evaluate(rows, sources, args, width):
+    """Cross-validation with whole source files held out when there are
+    enough of them, so windows of one session never train and test at once."""
+    by_file = len(sources) >= args.folds
+    keys = list(range(len(sources))) if by_file else list(range(len(rows)))
+    random.Random(args.seed).shuffle(keys)
+    fold_of = {k: i % args.folds for i, k in enumerate(keys)}
+    confusion = {(a, b): 0 for a in ORDER for b in ORDER}
+    for fold in range(args.folds):
+        def held(i, r):
+            return fold_of[r[2] if by_file else i] == fold
+        test = [r for i, r in enumerate(rows) if held(i, r)]
+        train_rows = [r for i, r in enumerate(rows) if not held(i, r)]
+        if not test or not train_rows:
+            continue
+        forest = train(train_rows, args, width)
+        for v, label, _ in test:
+            pred, conf = predict(forest, v)
+            if conf < args.confidence:
+                pred = -1
+            confusion[(label, pred)] += 1
+    return confusion, by_file
+
+
+def print_confusion(confusion, out):
+    total = sum(confusion.values())
+    right = sum(confusion[(a, a)] for a in ORDER)
+    out.write("true\\pred " + "".join(f"{NAMES[b]:>8}" for b in ORDER) + "  recall\n")
+    for a in ORDER:
+        row = [confusion[(a, b)] for b in ORDER]
+        n = sum(row)
+        recall = f"{100 * confusion[(a, a)] / n:6.1f}%" if n else "     -"
+        out.write(f"{NAMES[a]:>9} " + "".join(f"{c:8d}" for c in row) + f"  {recall}\n")
+    out.write(f"accuracy {100 * right / total:.1f}% of {total} windows\n" if total else "no windows\n")
+    return 100 * right / total if total else 0.0
+
+
+def flatten(forest):
+    lines, roots = [], []
+
+    def emit(node):
+        index = len(lines)
+        if "f" not in node:
+            lines.append(f"LEOR_GESTURE_LEAF({node['label']}, {node['conf']})")
+            return
+        lines.append(None)
+        emit(node["l"])
+        right = len(lines)
+        emit(node["r"])
+        lines[index] = (node["f"], node["t"], right)
+
+    for tree in forest:
+        roots.append(len(lines))
+        emit(tree)
+    return lines, roots
+
+
+def render(forest, names, summary):
+    lines, roots = flatten(forest)
+    if len(lines) > MAX_NODES:
+        sys.exit(f"{len(lines)} nodes do not fit the uint16 table; lower --depth or --trees")
+    # Keep the format legend at the top of the current file.
+    legend = []
+    with open(TREE_DEF, encoding="utf-8") as f:
+        for line in f:
+            if not line.startswith("//"):
+                break
+            legend.append(line)
+            if line.startswith("// Features are"):
+                break
+    out = legend + ["//\n"] + [f"// {s}\n" for s in summary] + ["\n"]
+    root_at = {r: i for i, r in enumerate(roots)}
+    for i, line in enumerate(lines):
+        if i in root_at:
+            if i:
+                out.append("\n")
+            out.append(f"LEOR_GESTURE_ROOT({i})\n")
+        if isinstance(line, tuple):
+            f, t, right = line
+            out.append(f"LEOR_GESTURE_SPLIT({names[f]}, {c_float(t)}, {right})\n")
+        else:
+            out.append(line + "\n")
+    return "".join(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("inputs", nargs="+", help="labelled files or directories")
+    parser.add_argument("--label", choices=sorted(LABELS), help="label every input with this")
+    parser.add_argument("--sim", default=DEFAULT_SIM, help="leor_sim for replaying session logs")
+    parser.add_argument("--trees", type=int, default=1, help="1 for a single tree, more for a forest")
+    parser.add_argument("--depth", type=int, default=5)
+    parser.add_argument("--min-leaf", type=int, default=3, help="fewest windows in a leaf")
+    parser.add_argument("--folds", type=int, default=5)
+    parser.add_argument("--confidence", type=int, default=70,
+                        help="gcf to evaluate at: predictions below it count as none")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--write", action="store_true", help=f"overwrite {os.path.relpath(TREE_DEF)}")
+    args = parser.parse_args()
+    if not 1 <= args.trees <= MAX_TREES:
+        parser.error(f"--trees must be 1..{MAX_TREES}")
+    if args.folds < 2:
+        parser.error("--folds must be at least 2")
+
+    names = load_feature_names(MODEL_HPP)
+    forced = LABELS[args.label] if args.label else None
+    rows, sources = collect(args.inputs, len(names), args.sim, forced)
+    if not rows:
+        sys.exit("no labelled windows")
+    counts = counts_of(rows)
+    print(f"{len(rows)} windows from {len(sources)} files: " +
+          ", ".join(f"{NAMES[label]} {counts[label]}" for label in ORDER))
+
+    confusion, by_file = evaluate(rows, sources, args, len(names))
+    print(f"{args.folds}-fold cross-validation by {'file' if by_file else 'window'} "
+          f"at gcf={args.confidence}:")
+    accuracy = print_confusion(confusion, sys.stdout)
+
+    forest = train(rows, args, len(names))
+    kind = "tree" if args.trees == 1 else f"forest of {args.trees} trees"
+    summary = [
+        f"Generated by tools/gesture_train.py: a {kind}, depth {args.depth}, min leaf "
+        f"{args.min_leaf}, seed {args.seed},",
+        f"from {len(rows)} windows (" + ", ".join(f"{NAMES[label]} {counts[label]}" for label in ORDER) +
+        f"); {args.folds}-fold accuracy {accuracy:.1f}% at gcf={args.confidence}.",
+        "Retrain rather than edit by hand.",
+    ]
+    text = render(forest, names, summary)
+    if args.write:
+        with open(TREE_DEF, "w", encoding="utf-8") as f:
+            f.write(text)
+        print(f"wrote {os.path.relpath(TREE_DEF)}")
+    else:
+        print("(dry run; --write to update gesture_tree.def)")
+
+
+if __name__ == "__main__":
+    main()
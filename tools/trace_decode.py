@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""Decode a Leor binary trace dump.
+
+The device keeps trace events as an id plus raw 32-bit words (see
+components/leor_core/include/leor/trace_events.def) and exports them with
+trace:dump=<seq>. Paste or pipe every page of that output into this script;
+the "trace:<next>" page lines are skipped and the formats from the .def file
+are applied here.
+
+    python3 tools/trace_decode.py dump.txt
+    leor_sim run --cmd trace:dump=0 | python3 tools/trace_decode.py
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+DEFAULT_DEF = os.path.join(os.path.dirname(os.path.abspath(__file__)), os.pardir,
+                           "components", "leor_core", "include", "leor",
+                           "trace_events.def")
+
+EVENT_RE = re.compile(r'^\s*LEOR_TRACE_EVENT\(\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+SPEC_RE = re.compile(r"%[-+ 0#]*\d*(?:\.\d+)?([a-zA-Z%])")
+
+
+def load_events(path):
+    events = []
+    with open(path, encoding="utf-8") as f:
+        for line in f:
+            m = EVENT_RE.match(line)
+            if m:
+                events.append((m.group(1), m.group(2)))
+    return events
+
+
+def format_event(fmt, words):
+    values = []
+    it = iter(words)
+    for m in SPEC_RE.finditer(fmt):
+        conv = m.group(1)
+        if conv == "%":
+            continue
+        word = next(it, 0)
+        if conv in "fFeEgG":
+            values.append(struct.unpack("<f", struct.pack("<I", word))[0])
+        elif conv in "di":
+            values.append(word - (1 << 32) if word & 0x80000000 else word)
+        else:
+            values.append(word)
+    # Python has no %u; it formats like %d for the unsigned word.
+    return fmt.replace("%u", "%d") % tuple(values)
+
+
+def decode(lines, events, out):
+    last_t = None
+    t_base = 0
+    first_us = None
+    last_seq = None
+    for raw in lines:
+        # Tolerate leor_sim's "< " reply prefix and any other chatter around
+        # the pages.
+        line = raw.strip().removeprefix("< ")
+        if not line or line.startswith("trace:"):
+            continue
+        if line.startswith("# leor-trace"):
+            fields = dict(f.split("=", 1) for f in line.split()[3:] if "=" in f)
+            header_ids = int(fields.get("ids", 0))
+            if header_ids != len(events):
+                print(f"warning: dump has {header_ids} event types, "
+                      f"{len(events)} in the table", file=sys.stderr)
+            continue
+        parts = line.split()
+        if len(parts) < 3 or not all(p.isdigit() for p in parts[:3]):
+            continue
+        seq, t_us, event_id = int(parts[0]), int(parts[1]), int(parts[2])
+        words = [int(w, 16) for w in parts[3:]]
+
+        # t_us is the low 32 bits of the boot clock; unwrap every 71 minutes.
+        if last_t is not None and t_us < last_t:
+            t_base += 1 << 32
+        last_t = t_us
+        t = t_base + t_us
+        if first_us is None:
+            first_us = t
+        if last_seq is not None and seq != last_seq + 1:
+            out.write(f"{'':>12}  ... {seq - last_seq - 1} events lost\n")
+        last_seq = seq
+
+        if event_id < len(events):
+            name, fmt = events[event_id]
+            try:
+                text = format_event(fmt, words)
+            except (TypeError, ValueError):
+                text = f"{name} {' '.join(parts[3:])}"
+        else:
+            text = f"unknown event {event_id} {' '.join(parts[3:])}"
+        out.write(f"{(t - first_us) / 1000.0:12.3f}  {text}\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("dump", nargs="?", help="trace:dump output (default: stdin)")
+    parser.add_argument("--events", default=DEFAULT_DEF,
+                        help="trace_events.def to decode against")
+    args = parser.parse_args()
+
+    events = load_events(args.events)
+    if args.dump:
+        with open(args.dump, encoding="utf-8") as f:
+            decode(f, events, sys.stdout)
+    else:
+        decode(sys.stdin, events, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()